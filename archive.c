@@ -0,0 +1,421 @@
+/*
+ * archive.c
+ * 		module stores many assembled modules in a single archive file "[name].oar" along with an index
+ * 		of the symbols they define, so the module defining a symbol is found without reading the others
+ *
+ * 		An archive is made of fixed size records, so it is mapped to memory and used in place:
+ * 			header		magic, byte order, offset of the current index and the geometry of the members
+ * 			members		for every member - its words, followed by its entries and its extern uses
+ * 			index		amount of members and symbols, a record per member (name, offset and sizes)
+ * 						and the entries of all members sorted by name (searched with a binary search)
+ * 		Adding members appends them along with a new index and only then points the header to the new index,
+ * 		so existing members are never rewritten and an interrupted update leaves the archive as it was.
+ * 		The space of replaced members and old indexes is reclaimed when the archive is created again.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "archive.h"
+#include "geometry.h"
+
+#define ARCHIVE_MAGIC "OARCHIV"
+#define BYTE_ORDER_MARK 0x01020304L
+#define ARCHIVE_ALIGNMENT sizeof(long)
+
+int validateArchive(Archive *archive);
+int validateSymbols(ArchiveSymbol *symbols, int count);
+int writeArchive(FILE *file, Archive *old, ObjectModule **modules, int moduleCount, int isNew, char *url);
+int collectSymbols(Archive *old, ArchiveMember *members, ObjectModule **sources, int memberCount,
+		ArchiveSymbol **symbols, char *url);
+void writeMember(FILE *file, ObjectModule *module, ArchiveMember *member);
+void writeSymbolRecords(FILE *file, ObjectSymbol *symbols);
+void alignArchive(FILE *file);
+int compareSymbols(const void *first, const void *second);
+char* getMemberName(char *moduleName);
+
+/*
+ * Maps the archive at url to memory
+ * Returns the archive or NULL if it can't be read or isn't an archive for the current geometry (reporting why)
+ */
+Archive* openArchive(char *url){
+	Archive *archive;
+	ArchiveHeader *header;
+	struct stat status;
+	char *map;
+	int fd = open(url, O_RDONLY), *counts;
+
+	if(fd < 0 || fstat(fd, &status) < 0){
+		fprintf(stderr,"Error: couldn't read archive %s\n",url);
+		if(fd >= 0)
+			close(fd);
+		return NULL;
+	}
+	map = (status.st_size >= (long)sizeof(ArchiveHeader))?
+			(char*)mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0) : (char*)MAP_FAILED;
+	close(fd);
+	header = (ArchiveHeader*)map;
+	if(map == (char*)MAP_FAILED || memcmp(header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 || header->byteOrder != BYTE_ORDER_MARK
+			|| header->indexOffset < (long)sizeof(ArchiveHeader) || header->indexOffset + 2 * (long)sizeof(int) > status.st_size){
+		fprintf(stderr,"Error: %s is not an archive of this machine\n",url);
+		if(map != (char*)MAP_FAILED)
+			munmap(map, status.st_size);
+		return NULL;
+	}
+	if(header->loadAddress != getLoadAddress() || header->wordWidth != getWordWidth()){
+		fprintf(stderr,"Error: %s holds modules for load address %d and %d bit words\n",url,header->loadAddress,header->wordWidth);
+		munmap(map, status.st_size);
+		return NULL;
+	}
+	archive = (Archive*)malloc(sizeof(Archive));
+	archive->map = map;
+	archive->length = status.st_size;
+	counts = (int*)(map + header->indexOffset);
+	archive->memberCount = counts[0];
+	archive->symbolCount = counts[1];
+	archive->members = (ArchiveMember*)(map + header->indexOffset + ARCHIVE_ALIGNMENT);
+	archive->symbols = (ArchiveSymbol*)(archive->members + archive->memberCount);
+	if(archive->memberCount < 0 || archive->symbolCount < 0 || (char*)(archive->symbols + archive->symbolCount) > map + status.st_size){
+		fprintf(stderr,"Error: the index of %s is truncated\n",url);
+		closeArchive(archive);
+		return NULL;
+	}
+	if(!validateArchive(archive)){
+		fprintf(stderr,"Error: the index of %s describes members outside of the archive\n",url);
+		closeArchive(archive);
+		return NULL;
+	}
+	return archive;
+}
+
+/*
+ * Checks the index describes members and symbols that lie within the archive - every member record
+ * is used in place later, so a damaged archive must be rejected before any of it is read
+ * Returns 1 if the archive is valid or 0 if not
+ */
+int validateArchive(Archive *archive){
+	ArchiveMember *member;
+	long limit = (long)archive->length, wordsLength;
+	int i;
+
+	if(!validateSymbols(archive->symbols, archive->symbolCount))
+		return 0;
+	for(i = 0; i < archive->symbolCount; i++){
+		if(archive->symbols[i].value < 0 || archive->symbols[i].value >= archive->memberCount)
+			return 0;
+	}
+	for(i = 0; i < archive->memberCount; i++){
+		member = &archive->members[i];
+		/* every size is bounded by the archive before they are added up, so the sum can't overflow */
+		if(!memchr(member->name, '\0', MAX_MEMBER_NAME_LENGTH) || member->offset < (long)sizeof(ArchiveHeader)
+				|| member->offset > limit || member->offset % sizeof(int) != 0
+				|| member->codeLength < 0 || member->codeLength > limit || member->dataLength < 0 || member->dataLength > limit
+				|| member->entryCount < 0 || member->entryCount > limit || member->externCount < 0 || member->externCount > limit)
+			return 0;
+		wordsLength = (long)sizeof(int) * ((long)member->codeLength + member->dataLength);
+		if(member->offset + wordsLength + (long)sizeof(ArchiveSymbol) * ((long)member->entryCount + member->externCount) > limit
+				|| !validateSymbols((ArchiveSymbol*)(archive->map + member->offset + wordsLength),
+						member->entryCount + member->externCount))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Returns 1 if the name of every symbol ends within its record or 0 if not
+ */
+int validateSymbols(ArchiveSymbol *symbols, int count){
+	int i;
+	for(i = 0; i < count; i++){
+		if(!memchr(symbols[i].name, '\0', MAX_LABEL_NAME_LENGTH))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Returns the index of the member defining the symbol or -1 if no member defines it
+ */
+int findArchiveSymbol(Archive *archive, char *name){
+	ArchiveSymbol key, *symbol;
+	if(strlen(name) >= MAX_LABEL_NAME_LENGTH)
+		return -1;
+	strcpy(key.name, name);
+	symbol = (ArchiveSymbol*)bsearch(&key, archive->symbols, archive->symbolCount, sizeof(ArchiveSymbol), compareSymbols);
+	return (symbol)? symbol->value : -1;
+}
+
+/*
+ * Returns the index of the member with the given name or -1 if there is none
+ */
+int findArchiveMember(Archive *archive, char *name){
+	int i;
+	for(i = 0; i < archive->memberCount; i++){
+		if(strcmp(archive->members[i].name, name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * Returns a copy of the member as a module
+ */
+ObjectModule* extractArchiveMember(Archive *archive, int member){
+	ArchiveMember *record = &archive->members[member];
+	ObjectModule *module = (ObjectModule*)calloc(1, sizeof(ObjectModule));
+	ObjectSymbol **lists[2], *symbol, *tail;
+	ArchiveSymbol *symbols;
+	int i, j, counts[2];
+
+	module->name = (char*)malloc(strlen(record->name) + 1);
+	strcpy(module->name, record->name);
+	module->codeLength = record->codeLength;
+	module->dataLength = record->dataLength;
+	module->words = (int*)malloc(sizeof(int) * (record->codeLength + record->dataLength + 1));
+	memcpy(module->words, archive->map + record->offset, sizeof(int) * (record->codeLength + record->dataLength));
+
+	symbols = (ArchiveSymbol*)(archive->map + record->offset + sizeof(int) * (record->codeLength + record->dataLength));
+	lists[0] = &module->entries;
+	lists[1] = &module->externs;
+	counts[0] = record->entryCount;
+	counts[1] = record->externCount;
+	for(i = 0; i < 2; i++){
+		for(j = 0, tail = NULL; j < counts[i]; j++, symbols++){
+			symbol = (ObjectSymbol*)malloc(sizeof(ObjectSymbol));
+			strcpy(symbol->name, symbols->name);
+			symbol->address = symbols->value;
+			symbol->next = NULL;
+			if(tail)
+				tail->next = symbol;
+			else
+				*lists[i] = symbol;
+			tail = symbol;
+		}
+	}
+	return module;
+}
+
+/*
+ * Adds the modules to the archive at url, replacing members of the same name (a module is named without its directory)
+ * Existing members are kept in place - only the new members and a new index are written at the end of the file,
+ * unless create is set or there is no archive yet, in which case the archive is written from scratch
+ * Returns 1 if succeeded or 0 if encountered errors (reporting them) - the archive is left unchanged on errors
+ */
+int updateArchive(char *url, ObjectModule **modules, int moduleCount, int create){
+	Archive *old = NULL;
+	FILE *file;
+	char *temporaryUrl = NULL;
+	int success;
+
+	if(!create && access(url, F_OK) == 0 && !(old = openArchive(url)))
+		return 0;
+	if(old)
+		file = fopen(url, "r+b");
+	else{
+		/* a new archive replaces the old one only once it is complete */
+		temporaryUrl = (char*)malloc(strlen(url) + 5);
+		strcpy(temporaryUrl, url);
+		strcat(temporaryUrl, ".tmp");
+		file = fopen(temporaryUrl, "wb");
+	}
+	if(!file){
+		fprintf(stderr,"Error: couldn't write archive %s\n",url);
+		closeArchive(old);
+		free(temporaryUrl);
+		return 0;
+	}
+	success = writeArchive(file, old, modules, moduleCount, !old, url);
+	success = fclose(file) == 0 && success;
+	if(temporaryUrl){
+		if(success && rename(temporaryUrl, url) != 0){
+			fprintf(stderr,"Error: couldn't replace archive %s\n",url);
+			success = 0;
+		}
+		if(!success)
+			remove(temporaryUrl);
+	}
+	closeArchive(old);
+	free(temporaryUrl);
+	return success;
+}
+
+/*
+ * Writes the new members and the new index, then points the header to the index
+ * (writing the header first instead when the archive is new)
+ * Returns 1 if succeeded or 0 if encountered errors (reporting them)
+ */
+int writeArchive(FILE *file, Archive *old, ObjectModule **modules, int moduleCount, int isNew, char *url){
+	int i, j, memberCount = (old)? old->memberCount : 0, symbolCount, counts[2];
+	ArchiveMember *members = (ArchiveMember*)malloc(sizeof(ArchiveMember) * (memberCount + moduleCount));
+	ObjectModule **sources = (ObjectModule**)calloc(memberCount + moduleCount, sizeof(ObjectModule*));
+	ArchiveSymbol *symbols;
+	ArchiveHeader header;
+	char *name;
+
+	if(old)
+		memcpy(members, old->members, sizeof(ArchiveMember) * memberCount);
+	/* a module replaces the member of the same name, or is added after the last member */
+	for(i = 0; i < moduleCount; i++){
+		name = getMemberName(modules[i]->name);
+		if(strlen(name) >= MAX_MEMBER_NAME_LENGTH){
+			fprintf(stderr,"Error: member name %s is too long\n",name);
+			free(members);
+			free(sources);
+			return 0;
+		}
+		for(j = 0; j < memberCount && strcmp(members[j].name, name) != 0; j++)
+			;
+		if(j == memberCount)
+			memberCount++;
+		strcpy(members[j].name, name);
+		sources[j] = modules[i];
+	}
+	if((symbolCount = collectSymbols(old, members, sources, memberCount, &symbols, url)) < 0){
+		free(members);
+		free(sources);
+		return 0;
+	}
+
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, ARCHIVE_MAGIC);
+	header.byteOrder = BYTE_ORDER_MARK;
+	header.loadAddress = getLoadAddress();
+	header.wordWidth = getWordWidth();
+	if(isNew)
+		fwrite(&header, sizeof(header), 1, file);
+	fseek(file, 0, SEEK_END);
+	for(i = 0; i < memberCount; i++){
+		if(sources[i])
+			writeMember(file, sources[i], &members[i]);
+	}
+	alignArchive(file);
+	header.indexOffset = ftell(file);
+	counts[0] = memberCount;
+	counts[1] = symbolCount;
+	fwrite(counts, sizeof(int), 2, file);
+	alignArchive(file);
+	fwrite(members, sizeof(ArchiveMember), memberCount, file);
+	fwrite(symbols, sizeof(ArchiveSymbol), symbolCount, file);
+	/* the index is complete on disk before the header points to it */
+	fflush(file);
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	free(members);
+	free(sources);
+	free(symbols);
+	if(ferror(file)){
+		fprintf(stderr,"Error: couldn't write archive %s\n",url);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Collects the entries of every member sorted by name into symbols (taking new members from sources
+ * and the others from the old archive)
+ * Returns the amount of symbols or -1 if two members define the same symbol (reporting it)
+ */
+int collectSymbols(Archive *old, ArchiveMember *members, ObjectModule **sources, int memberCount,
+		ArchiveSymbol **symbols, char *url){
+	ObjectSymbol *entry;
+	ArchiveSymbol *oldEntries;
+	int i, j, count = 0, capacity = 0;
+
+	for(i = 0; i < memberCount; i++){
+		if(!sources[i])
+			capacity += members[i].entryCount;
+		for(entry = (sources[i])? sources[i]->entries : NULL; entry; entry = entry->next)
+			capacity++;
+	}
+	*symbols = (ArchiveSymbol*)malloc(sizeof(ArchiveSymbol) * (capacity + 1));
+	for(i = 0; i < memberCount; i++){
+		if(sources[i]){
+			for(entry = sources[i]->entries; entry; entry = entry->next, count++){
+				strcpy((*symbols)[count].name, entry->name);
+				(*symbols)[count].value = i;
+			}
+			continue;
+		}
+		oldEntries = (ArchiveSymbol*)(old->map + members[i].offset + sizeof(int) * (members[i].codeLength + members[i].dataLength));
+		for(j = 0; j < members[i].entryCount; j++, count++){
+			strcpy((*symbols)[count].name, oldEntries[j].name);
+			(*symbols)[count].value = i;
+		}
+	}
+	qsort(*symbols, count, sizeof(ArchiveSymbol), compareSymbols);
+	for(i = 1; i < count; i++){
+		if(strcmp((*symbols)[i-1].name, (*symbols)[i].name) == 0){
+			fprintf(stderr,"Error: symbol '%s' is an entry of both %s and %s in %s\n",(*symbols)[i].name,
+					members[(*symbols)[i-1].value].name, members[(*symbols)[i].value].name, url);
+			free(*symbols);
+			return -1;
+		}
+	}
+	return count;
+}
+
+/*
+ * Writes the words and symbols of the module at the end of the archive, filling the record of the member
+ */
+void writeMember(FILE *file, ObjectModule *module, ArchiveMember *member){
+	ObjectSymbol *symbol;
+	alignArchive(file);
+	member->offset = ftell(file);
+	member->codeLength = module->codeLength;
+	member->dataLength = module->dataLength;
+	for(member->entryCount = 0, symbol = module->entries; symbol; symbol = symbol->next)
+		member->entryCount++;
+	for(member->externCount = 0, symbol = module->externs; symbol; symbol = symbol->next)
+		member->externCount++;
+	fwrite(module->words, sizeof(int), module->codeLength + module->dataLength, file);
+	writeSymbolRecords(file, module->entries);
+	writeSymbolRecords(file, module->externs);
+}
+
+/*
+ * Writes a record holding the name and address of every symbol
+ */
+void writeSymbolRecords(FILE *file, ObjectSymbol *symbols){
+	ArchiveSymbol record;
+	for(; symbols; symbols = symbols->next){
+		memset(&record, 0, sizeof(record));
+		strcpy(record.name, symbols->name);
+		record.value = symbols->address;
+		fwrite(&record, sizeof(record), 1, file);
+	}
+}
+
+/*
+ * Pads the archive so the next record starts at an offset aligned for every field type
+ */
+void alignArchive(FILE *file){
+	long offset = ftell(file);
+	for(; offset % ARCHIVE_ALIGNMENT; offset++)
+		fputc('\0', file);
+}
+
+int compareSymbols(const void *first, const void *second){
+	return strcmp(((ArchiveSymbol*)first)->name, ((ArchiveSymbol*)second)->name);
+}
+
+/*
+ * Returns the name of the module without its directory
+ */
+char* getMemberName(char *moduleName){
+	char *slash = strrchr(moduleName, '/');
+	return (slash)? slash + 1 : moduleName;
+}
+
+/*
+ * Unmaps the archive and frees space dynamically allocated to it
+ */
+void closeArchive(Archive *archive){
+	if(!archive)
+		return;
+	munmap(archive->map, archive->length);
+	free(archive);
+}
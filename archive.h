@@ -0,0 +1,79 @@
+/*
+ * archive.h
+ * 		module stores many assembled modules in a single archive file "[name].oar" along with an index
+ * 		of the symbols they define, so the module defining a symbol is found without reading the others
+ */
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+#include <stddef.h>
+#include "object.h"
+
+#define ARCHIVE_EXTENSION ".oar"
+#define MAX_MEMBER_NAME_LENGTH 64
+
+typedef struct ArchiveHeader {
+	char magic[8];
+	long byteOrder;			/* archives are read in place, so they are only valid on machines of the same byte order */
+	long indexOffset;		/* offset of the current index - replaced whenever members are added */
+	int loadAddress;		/* geometry the members were assembled for */
+	int wordWidth;
+} ArchiveHeader;
+
+typedef struct ArchiveMember {
+	char name[MAX_MEMBER_NAME_LENGTH];
+	long offset;			/* offset of the words, followed by the entries and extern uses */
+	int codeLength;
+	int dataLength;
+	int entryCount;
+	int externCount;
+} ArchiveMember;
+
+typedef struct ArchiveSymbol {
+	char name[MAX_LABEL_NAME_LENGTH];
+	int value;				/* the member defining an indexed symbol, or the address of a member's symbol */
+} ArchiveSymbol;
+
+typedef struct Archive {
+	char *map;				/* the whole archive file, mapped to memory */
+	size_t length;
+	int memberCount;
+	ArchiveMember *members;
+	int symbolCount;
+	ArchiveSymbol *symbols;	/* entries of every member, sorted by name */
+} Archive;
+
+/*
+ * Maps the archive at url to memory
+ * Returns the archive or NULL if it can't be read or isn't an archive for the current geometry (reporting why)
+ */
+Archive* openArchive(char *url);
+
+/*
+ * Returns the index of the member defining the symbol or -1 if no member defines it
+ */
+int findArchiveSymbol(Archive *archive, char *name);
+
+/*
+ * Returns the index of the member with the given name or -1 if there is none
+ */
+int findArchiveMember(Archive *archive, char *name);
+
+/*
+ * Returns a copy of the member as a module
+ */
+ObjectModule* extractArchiveMember(Archive *archive, int member);
+
+/*
+ * Adds the modules to the archive at url, replacing members of the same name (a module is named without its directory)
+ * Existing members are kept in place - only the new members and a new index are written at the end of the file,
+ * unless create is set or there is no archive yet, in which case the archive is written from scratch
+ * Returns 1 if succeeded or 0 if encountered errors (reporting them) - the archive is left unchanged on errors
+ */
+int updateArchive(char *url, ObjectModule **modules, int moduleCount, int create);
+
+/*
+ * Unmaps the archive and frees space dynamically allocated to it
+ */
+void closeArchive(Archive *archive);
+
+#endif
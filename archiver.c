@@ -0,0 +1,128 @@
+/*
+ * archiver.c
+ * 		the archiver - bundles assembled modules into an archive the linker pulls members from
+ *
+ * 		Usage: archiver command [--memory N] [--load-address N] [--word-width N] archive [module...]
+ * 			c	creates the archive from the modules (given without extension)
+ * 			r	adds the modules to the archive, replacing members of the same name
+ * 			t	lists the members of the archive along with their sizes and entries
+ * 			x	extracts the given members (or all of them) to "[member].ob", ".ent" and ".ext"
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "archive.h"
+#include "object.h"
+#include "geometry.h"
+#include "constraints.h"
+
+int addModules(char *url, char **names, int nameCount, int create);
+void listArchive(Archive *archive);
+int extractMembers(Archive *archive, char **names, int nameCount);
+int extractMember(Archive *archive, int member);
+
+int main(int argc, char **argv){
+	Archive *archive;
+	char **names = (char**)malloc(sizeof(char*) * argc), *url = NULL, command = '\0';
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, nameCount = 0, success = 1;
+
+	if(argc > 1 && strlen(argv[1]) == 1 && strchr("crtx", argv[1][0]))
+		command = argv[1][0];
+	for(i = 2; success && command && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(argv[i][0] == '-'){
+			fprintf(stderr,"Error: unknown option '%s'\n",argv[i]);
+			success = 0;
+		}
+		else if(!url)
+			url = argv[i];
+		else
+			names[nameCount++] = argv[i];
+	}
+	if(success && (!url || ((command == 'c' || command == 'r') && !nameCount))){
+		fprintf(stderr,"Usage: archiver c|r|t|x [--memory N] [--load-address N] [--word-width N] archive [module...]\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+
+	if(success && (command == 'c' || command == 'r'))
+		success = addModules(url, names, nameCount, command == 'c');
+	else if(success){
+		if((success = (archive = openArchive(url)) != NULL)){
+			if(command == 't')
+				listArchive(archive);
+			else
+				success = extractMembers(archive, names, nameCount);
+			closeArchive(archive);
+		}
+	}
+	free(names);
+	return !success;
+}
+
+/*
+ * Reads the modules and adds them to the archive (creating it from scratch if create is set)
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int addModules(char *url, char **names, int nameCount, int create){
+	ObjectModule **modules = (ObjectModule**)malloc(sizeof(ObjectModule*) * nameCount);
+	int i, readCount = 0, success = 1;
+
+	for(; success && readCount < nameCount; readCount++)
+		success = (modules[readCount] = readObjectModule(names[readCount])) != NULL;
+	if(success)
+		success = updateArchive(url, modules, nameCount, create);
+	for(i = 0; i < readCount; i++)
+		destroyObjectModule(modules[i]);
+	free(modules);
+	return success;
+}
+
+/*
+ * Prints a line per member - its name, code and data sizes - followed by a line per entry it defines
+ */
+void listArchive(Archive *archive){
+	ArchiveMember *member;
+	ArchiveSymbol *entries;
+	int i, j;
+	for(i = 0; i < archive->memberCount; i++){
+		member = &archive->members[i];
+		printf("%s\tcode %d\tdata %d\n", member->name, member->codeLength, member->dataLength);
+		entries = (ArchiveSymbol*)(archive->map + member->offset + sizeof(int) * (member->codeLength + member->dataLength));
+		for(j = 0; j < member->entryCount; j++)
+			printf("\t%s\n", entries[j].name);
+	}
+}
+
+/*
+ * Extracts the named members, or every member if no name is given
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int extractMembers(Archive *archive, char **names, int nameCount){
+	int i, member, success = 1;
+	for(i = 0; i < archive->memberCount && !nameCount; i++)
+		success = extractMember(archive, i) && success;
+	for(i = 0; i < nameCount; i++){
+		if((member = findArchiveMember(archive, names[i])) < 0){
+			fprintf(stderr,"Error: the archive has no member %s\n",names[i]);
+			success = 0;
+		}
+		else
+			success = extractMember(archive, member) && success;
+	}
+	return success;
+}
+
+/*
+ * Writes the member to "[member].ob", ".ent" and ".ext" in the current directory
+ * Returns 1 if succeeded or 0 if the files can't be written
+ */
+int extractMember(Archive *archive, int member){
+	ObjectModule *module = extractArchiveMember(archive, member);
+	int success = writeObjectFile(module->name, module) && writeSymbolFile(module->name, "ent", module->entries)
+			&& writeSymbolFile(module->name, "ext", module->externs);
+	destroyObjectModule(module);
+	return success;
+}
@@ -8,115 +8,312 @@
 #include <stdlib.h>
 #include "assembly.h"
 #include "utilities.h"
+#include "diagnostics.h"
 #include "constraints.h"
 #include "command.h"
 #include "output.h"
 #include "data.h"
+#include "template.h"
+#include "image.h"
+#include "geometry.h"
+#include "object.h"
+#include "lines.h"
+#include "peephole.h"
+#include "pool.h"
+#include "collect.h"
+#include "map.h"
+#include "timings.h"
 
-#define DATA_LENGTH 6
-#define STRING_LENGTH 8
-#define STRUCT_LENGTH 8
-#define ENTRY_LENGTH 7
-#define EXTERN_LENGTH 8
-
-enum statementType { emptyStatement, commandStatement, dataStatement, stringStatement, structStatement, entryStatement, externStatement };
 enum externalStatus { regularLabel, external, entry };
-enum ARE {LOCAL_ARE, EXTERNAL_ARE, RELOCATABLE_ARE };
 
-int firstPass (char* url, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LENGTH], int* ic, int* dc, Symbol** symTable, int* dataArray);
+int firstPass (FILE* amFile, SourceStream* stream, int variant, Image* image, int* ic, int* dc, Symbol** symTable, TemplateCache* templates, LineTable* lines, int deferDataCheck);
+int decodeStreamLine (StreamLine* line, TemplateCache* templates);
+int copyDecodedData (StreamLine* line, Image* image, int* dc);
+void ignoreDiagnostic (int isError, int lineNumber, char* message);
+int isWithinMemory (int ic, int dc, int lineNumber, int* reported);
 int prepareSecondPass (Symbol* symTable, int ic);
-int secondPass (char* name, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LENGTH], int ic, int dc, Symbol* symTable, int* dataArray);
-int getStatementType (char* line);
+int checkLabels (Image* image, int ic, Symbol* symTable);
+int secondPass (char* name, Image* image, int ic, int dc, Symbol* symTable, int writeRelocations);
 
 /*
  * Manages the assembly process.
- * Receives a .am file name (without extension), performs validation and compiling on the file
+ * Receives a .am file name (without extension) and the decoded stream of its source (see decodeStream),
+ * performs validation and compiling on the lines of the stream belonging to the variant
  * If file is valid the function writes the compiled object, entry and extern files
+ * (and the relocation file if writeRelocations is set, the line table if writeLines is set)
+ * If optimize is set redundant instructions are removed between the passes (see peephole.h),
+ * if collect is set the code and data never reached are removed (see collect.h),
+ * if pool is set data statements share identical words (see pool.h)
+ * If mapFormat isn't NO_MAP the memory map is written once the words are laid out (see map.h) -
+ * also when the program doesn't fit in the memory
  * Returns 1 if succeeded or 0 if encountered errors
  */
-int assemble(char *filename){
-	char memory [TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LENGTH];
+int assemble(char *filename, int writeRelocations, int writeLines, int optimize, int pool, int collect, int mapFormat, SourceStream *stream, int variant){
+	Image* image;
+	PeepholeReport report;
+	PoolReport poolReport;
+	CollectReport collectReport;
+	Symbol *symbol;
+	LineTable* lines = (writeLines || mapFormat != NO_MAP)? createLineTable() : NULL;
 	char* inputUrl = constructUrl(filename,"am");
 	Symbol *symbolTable = NULL;
-	int dc = 0, ic = PROGRAM_LOAD_ADDRESS;
+	int dc = 0, ic = getLoadAddress();
 	int success=1;
-	int dataArray [TARGET_MACHINE_MEMORY_LENGTH];
+	clock_t start;
 
-	success = firstPass(inputUrl, memory, &ic, &dc, &symbolTable, dataArray);
+	image = createImage();
+	start = startPhase();
+	success = firstPass(NULL, stream, variant, image, &ic, &dc, &symbolTable, stream->templates, lines, optimize || pool || collect);
+	endPhase(FIRST_PASS_PHASE, start, inputUrl);
 	if(!success){
+		free(inputUrl);
+		/* the map shows where the words of a program too big for the memory go */
+		if(mapFormat != NO_MAP && ic + dc > getMemoryLength())
+			writeMemoryMap(filename, mapFormat, image, ic, dc, symbolTable, lines);
+		destroyLineTable(lines);
 		destroySymbols(symbolTable);
+		destroyImage(image);
 		return success;
 	}
-	free(inputUrl);
 
-	success = prepareSecondPass(symbolTable, ic);
+	if(optimize){
+		if(!optimizeCode(image, &ic, symbolTable, lines, &report))
+			reportProgress("Couldn't optimize %s: its code can't be decoded", filename);
+		else
+			reportProgress("Optimized %s: removed %d instructions (%d mov, %d inc/dec pairs, %d jumps, %d cmp), saving %d words of code and %d cycles each time they would have run",
+					filename, report.instructions, report.moves, report.pairs, report.jumps, report.compares, report.words, report.cycles);
+	}
+	if(collect){
+		if(!collectGarbage(image, &ic, &dc, &symbolTable, lines, &collectReport))
+			reportProgress("Couldn't collect the garbage of %s: its code can't be decoded", filename);
+		else{
+			for(symbol = collectReport.removed; symbol; symbol = symbol->next)
+				reportProgress("Removed unreachable %s label '%s'", (symbol->segment == COMMAND_SEGMENT)? "code" : "data", symbol->name);
+			reportProgress("Collected the garbage of %s: removed %d code words and %d data words",
+					filename, collectReport.codeWords, collectReport.dataWords);
+			destroySymbols(collectReport.removed);
+		}
+	}
+	if(pool){
+		if(!poolData(image, ic, &dc, symbolTable, lines, &poolReport))
+			reportProgress("Couldn't pool the data of %s: its code can't be decoded", filename);
+		else
+			reportProgress("Pooled the data of %s: %d statements share the words of others, saving %d words",
+					filename, poolReport.statements, poolReport.words);
+	}
+	if(optimize || pool || collect){
+		/* the data was only checked to fit in the memory once optimized, pooled and collected */
+		success = ic + dc <= getMemoryLength();
+		if(!success)
+			reportSummary("Error: %s doesn't fit in the memory of %d words", filename, getMemoryLength());
+	}
+	if(mapFormat != NO_MAP && (success || ic + dc > getMemoryLength()))
+		success = writeMemoryMap(filename, mapFormat, image, ic, dc, symbolTable, lines) && success;
+
+	/* the second pass reads no file - its throughput is told by the lines of the expanded source it encodes */
+	start = startPhase();
+	success = success && prepareSecondPass(symbolTable, ic);
 	if(!success){
+		free(inputUrl);
+		destroyLineTable(lines);
 		destroySymbols(symbolTable);
+		destroyImage(image);
 		return success;
 	}
 
-	success = secondPass(filename, memory, ic, dc, symbolTable, dataArray);
+	success = secondPass(filename, image, ic, dc, symbolTable, writeRelocations);
+	endPhase(SECOND_PASS_PHASE, start, inputUrl);
+	free(inputUrl);
+	if(success && writeLines)
+		success = writeLineTable(filename, lines, ic);
+	destroyLineTable(lines);
 	destroySymbols(symbolTable);
+	destroyImage(image);
 	return success;
 }
 
 /*
- * Function reads the given filename and decodes what it can while advancing the ic,dc indexes
- * going over the the file it populates the memory, symTable and dataArray,
- * returns 0 if encountered an error otherwise returns 1
+ * Validates the expanded source code read from amFile without encoding it or writing any file:
+ * performs the first pass (only laying out the words), the entry checks and the search for unknown labels
+ * Returns 1 if the code is valid or 0 if encountered errors
  */
-int firstPass (char* url, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LENGTH], int* ic, int* dc, Symbol** symTable, int* dataArray){
+int checkAssembly(FILE *amFile){
+	Image *image = createImage();
+	Symbol *symbolTable = NULL;
+	int dc = 0, ic = getLoadAddress();
 	int success=1;
-	int i, labelDetectedFlag, lineType, lineNumber = 0;
-	FILE* amFile; /*stream for the .am file*/
+
+	success = firstPass(amFile, NULL, 0, image, &ic, &dc, &symbolTable, NULL, NULL, 0);
+	/* unlike assemble, keeps going after errors so every diagnostic is reported at once */
+	success = prepareSecondPass(symbolTable, ic) && success;
+	success = checkLabels(image, ic, symbolTable) && success;
+	destroySymbols(symbolTable);
+	destroyImage(image);
+	return success;
+}
+
+/*
+ * Lexes and validates every line of the stream once for all the variants holding it - its label, its type and
+ * the words of a command (through the templates of the stream) or the values of a data statement
+ * A line with errors is left undecoded, to be reported by every variant holding it with its own line number
+ */
+void decodeStream(SourceStream *stream){
+	int i;
+	/* the errors are reported by the variants, each at the line number of its own expanded source */
+	setDiagnosticsHandler(ignoreDiagnostic);
+	for(i = 0; i < stream->count; i++)
+		stream->lines[i].isDecoded = decodeStreamLine(&stream->lines[i], stream->templates);
+	setDiagnosticsHandler(NULL);
+}
+
+/*
+ * Lexes the line as the first pass does (leaving its text trimmed the same way) and decodes its statement
+ * returns 0 if encountered an error otherwise returns 1
+ */
+int decodeStreamLine (StreamLine* line, TemplateCache* templates){
+	char buffer[MAX_LINE_LENGTH]; /* the decoding functions cut the statement they read */
+	int values[MAX_LINE_LENGTH], count = 0, address = 0;
+	CompiledLine *decoded;
+	char *running;
+
+	strTrim(line->text);
+	if(*line->text == '\0' || *line->text == ';'){
+		line->type = BLANK_STATEMENT;
+		return 1;
+	}
+	line->labelLength = getLabel(line->text, line->label);
+	if(line->labelLength && !isValidLabelName(line->label))
+		return 0;
+	running = line->text + line->labelLength;
+	line->type = getStatementType(running);
+	strcpy(buffer, running);
+	switch(line->type){
+		case emptyStatement:
+			return 1;
+		case entryStatement:
+			return isValidLabelName(running + ENTRY_LENGTH);
+		case externStatement:
+			return isValidLabelName(running + EXTERN_LENGTH);
+		case commandStatement:
+			line->template = findTemplate(templates, running);
+			if(!line->template){
+				decoded = decodeCommandLine(buffer, &address, 0);
+				if(!decoded)
+					return 0;
+				line->template = storeTemplate(templates, running, decoded, 0);
+				destroyDecoded(decoded);
+			}
+			return 1;
+		case dataStatement:
+			if(!storeDataType(buffer + DATA_LENGTH, values, &count, 0))
+				return 0;
+			break;
+		case stringStatement:
+			if(!storeStringType(buffer + STRING_LENGTH, values, &count, 0))
+				return 0;
+			break;
+		case structStatement:
+			if(!storeStructType(buffer + STRUCT_LENGTH, values, &count, 0))
+				return 0;
+			break;
+	}
+	line->data = (int*)malloc(sizeof(int) * (count + 1));
+	memcpy(line->data, values, sizeof(int) * count);
+	line->dataCount = count;
+	return 1;
+}
+
+/*
+ * Swallows the diagnostics of decoding the stream
+ */
+void ignoreDiagnostic (int isError, int lineNumber, char* message){
+}
+
+/*
+ * Copies the values of the decoded data statement to the data segment, advancing dc over them
+ * returns 1, as the functions storing a data statement do once it is valid
+ */
+int copyDecodedData (StreamLine* line, Image* image, int* dc){
+	memcpy(reserveImageData(image, *dc, line->dataCount) + *dc, line->data, sizeof(int) * line->dataCount);
+	*dc += line->dataCount;
+	return 1;
+}
+
+/*
+ * Function reads the given stream and decodes what it can while advancing the ic,dc indexes
+ * going over the the file it populates the image (code words and data segment) and symTable,
+ * if stream isn't NULL the lines of the variant are read from it instead of amFile - a decoded line is laid out
+ * as decoded, only the lines with errors are lexed and decoded again
+ * commands are decoded through the templates (adding the new ones), or if templates is NULL only validated -
+ * the image then holds just the label references and blank words
+ * if lines isn't NULL the first address of every statement holding words is added to it
+ * if deferDataCheck is set only the code is checked to fit in the memory (the caller checks the data)
+ * returns 0 if encountered an error otherwise returns 1
+ */
+int firstPass (FILE* amFile, SourceStream* stream, int variant, Image* image, int* ic, int* dc, Symbol** symTable, TemplateCache* templates, LineTable* lines, int deferDataCheck){
+	int success=1, index;
+	int i, labelDetectedFlag, lineType, lineNumber = 0, address, overflowReported = 0, statementIc, statementDc;
 	CompiledLine *decoded; /*stores the list of decoded words derived from a command */
 	CompiledLine *compiledPtr; /*a pointer to traverse the list while retain a reference to the head for freeing it)*/
 	char potentialLabel[MAX_LABEL_NAME_LENGTH]; /*if the line has a label it will be stored here*/
 	char *buffer = (char*)malloc(MAX_LINE_LENGTH * sizeof(char)); /*used as a line buffer*/
 	char *running; /*used to advance within the buffer (retaining a pointer to head for freeing allocated space)*/
+	StreamLine *streamLine = NULL; /*the line read from the stream, NULL when reading amFile*/
 
-	amFile = fopen(url, "r"); /*opening the .am file*/
-	if(amFile == NULL){
-		fprintf(stderr,"Error: couldn't open file %s\n", url);
-		free(buffer);
-		return 0;
-	}
-
-	while(fgets(buffer, MAX_LINE_LENGTH, amFile)){
+	/* once too many errors were reported the rest of the file is skipped */
+	for(index = 0; !isErrorLimitReached() && ((stream)? index < stream->count : fgets(buffer, MAX_LINE_LENGTH, amFile) != NULL); index++){
+		if(stream){
+			streamLine = &stream->lines[index];
+			if(!(streamLine->variantMask & (1UL << variant)))
+				continue;
+			if(!streamLine->isDecoded)
+				strcpy(buffer, streamLine->text);
+		}
 		lineNumber++;
 		labelDetectedFlag = 0;
 		memset(potentialLabel,'\0',MAX_LABEL_NAME_LENGTH);
 
-		strTrim(buffer);
-
-		/* if an empty or comment line then skip over it*/
-		if(*buffer == '\0' || *buffer == ';'){
-			continue;
+		if(streamLine && streamLine->isDecoded){
+			if(streamLine->type == BLANK_STATEMENT)
+				continue;
+			labelDetectedFlag = streamLine->labelLength > 0;
+			strcpy(potentialLabel, streamLine->label);
+			running = streamLine->text + streamLine->labelLength;
+			lineType = streamLine->type;
 		}
+		else{
+			strTrim(buffer);
 
-		/* if the line starts with a label then retrieve it into potentialLabel*/
-		i = getLabel(buffer, potentialLabel);
-		labelDetectedFlag = (i==0)? 0:1;
-
-		if(labelDetectedFlag == 1){
-			if(!isValidLabelName(potentialLabel)){
-				fprintf(stderr,"Error detected in line [%d]: '%s' is not a valid label name\n",lineNumber,potentialLabel);
-				success = 0;
+			/* if an empty or comment line then skip over it*/
+			if(*buffer == '\0' || *buffer == ';'){
 				continue;
 			}
-		}
-		running = buffer+i; /*advance line buffer beyond potential label */
 
+			/* if the line starts with a label then retrieve it into potentialLabel*/
+			i = getLabel(buffer, potentialLabel);
+			labelDetectedFlag = (i==0)? 0:1;
+
+			if(labelDetectedFlag == 1){
+				if(!isValidLabelName(potentialLabel)){
+					reportError(lineNumber, LABEL_NAME_DIAGNOSTIC, "'%s' is not a valid label name",potentialLabel);
+					success = 0;
+					continue;
+				}
+			}
+			running = buffer+i; /*advance line buffer beyond potential label */
+			lineType = getStatementType(running);
+		}
+		statementIc = *ic;
+		statementDc = *dc;
 
-		lineType = getStatementType(running);
 		switch(lineType){
 			case entryStatement:{
 				if(labelDetectedFlag){
-					printf("Warning: in line [%d], ignored label '%s' before .entry statement\n",lineNumber,potentialLabel);
+					reportWarning(lineNumber, IGNORED_LABEL_DIAGNOSTIC, "ignored label '%s' before .entry statement",potentialLabel);
 				}
 				running += ENTRY_LENGTH; /*skipping the word '.entry ' */
 				if(!isValidLabelName(running)){
-					fprintf(stderr,"Error detected in line [%d]: '%s' is not a valid label name \n",lineNumber,running);
+					reportError(lineNumber, LABEL_NAME_DIAGNOSTIC, "'%s' is not a valid label name",running);
 					success = 0;
 					continue;
 				}
@@ -125,11 +322,11 @@ int firstPass (char* url, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LEN
 				break;
 			case externStatement:{
 				if(labelDetectedFlag){
-					printf("Warning: in line [%d], ignored label '%s' before .extern statement\n",lineNumber,potentialLabel);
+					reportWarning(lineNumber, IGNORED_LABEL_DIAGNOSTIC, "ignored label '%s' before .extern statement",potentialLabel);
 				}
 				running += EXTERN_LENGTH; /*skipping the word '.extern ' */
 				if(!isValidLabelName(running)){
-					fprintf(stderr,"Error detected in line [%d]: '%s' is not a valid label name \n",lineNumber,running);
+					reportError(lineNumber, LABEL_NAME_DIAGNOSTIC, "'%s' is not a valid label name",running);
 					success = 0;
 					continue;
 				}
@@ -146,48 +343,96 @@ int firstPass (char* url, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LEN
 				if(labelDetectedFlag){
 					success = storeLabel(symTable, potentialLabel, *ic, REGULAR_LABEL_SYM, COMMAND_SEGMENT, lineNumber);
 				}
-				/* decoded will be a linked list of 1-5 words or NULL if encountered errors*/
-				decoded = decodeCommandLine(running, ic, lineNumber);
+				if(streamLine && streamLine->isDecoded){
+					/* decoded once for every variant holding the line */
+					writeTemplate(streamLine->template, image, ic, lineNumber);
+					decoded = NULL;
+				}
+				else if(templates){
+					/* a command repeated (by macro expansions) is copied from the words decoded the first time*/
+					decoded = instantiateTemplate(templates, running, ic, lineNumber);
+					if(!decoded){
+						/* decoded will be a linked list of 1-5 words or NULL if encountered errors*/
+						address = *ic;
+						decoded = decodeCommandLine(running, ic, lineNumber);
+						if(!decoded)
+							success = 0;
+						else
+							storeTemplate(templates, running, decoded, address);
+					}
+				}
+				else{
+					/* decoded will only hold the words referencing labels*/
+					address = *ic;
+					if(!validateCommandLine(running, ic, lineNumber, &decoded))
+						success = 0;
+					for(; address < *ic && address < getMemoryLength(); address++)
+						getImageWord(image, address)[0] = '\0';
+				}
+				/* words beyond the memory are dropped - the program is reported as too big */
 				compiledPtr = decoded;
-				while(compiledPtr){
-					strcpy(memory[compiledPtr->address],compiledPtr->binaryStr);
+				while(compiledPtr && compiledPtr->address < getMemoryLength()){
+					strcpy(getImageWord(image, compiledPtr->address),compiledPtr->binaryStr);
 					compiledPtr = compiledPtr->next;
 				}
-
-				if(decoded)
-					destroyDecoded(decoded);
-				else
-					success = 0;
+				destroyDecoded(decoded);
 			}
 				break;
 			case dataStatement:{
 				if(labelDetectedFlag){
 					success = storeLabel(symTable, potentialLabel, *dc, REGULAR_LABEL_SYM, DATA_SEGMENT, lineNumber);
 				}
-				success = storeDataType(running + DATA_LENGTH, dataArray, dc, lineNumber);
+				success = (streamLine && streamLine->isDecoded)? copyDecodedData(streamLine, image, dc)
+						: storeDataType(running + DATA_LENGTH, reserveImageData(image, *dc, MAX_LINE_LENGTH), dc, lineNumber);
 			}
 				break;
 			case stringStatement:{
 				if(labelDetectedFlag){
 					success = storeLabel(symTable, potentialLabel, *dc, REGULAR_LABEL_SYM, DATA_SEGMENT, lineNumber);
 				}
-				success = storeStringType(running + STRING_LENGTH, dataArray, dc, lineNumber);
+				success = (streamLine && streamLine->isDecoded)? copyDecodedData(streamLine, image, dc)
+						: storeStringType(running + STRING_LENGTH, reserveImageData(image, *dc, MAX_LINE_LENGTH), dc, lineNumber);
 			}				
 				break;
 			case structStatement:{
 				if(labelDetectedFlag){
 					success = storeLabel(symTable, potentialLabel, *dc, REGULAR_LABEL_SYM, DATA_SEGMENT, lineNumber);
 				}
-				success = storeStructType(running + STRUCT_LENGTH, dataArray, dc, lineNumber);
+				success = (streamLine && streamLine->isDecoded)? copyDecodedData(streamLine, image, dc)
+						: storeStructType(running + STRUCT_LENGTH, reserveImageData(image, *dc, MAX_LINE_LENGTH), dc, lineNumber);
 			}				
 				break;
 		}
+		/* a label on a line of its own names the code following it */
+		if(lines && (*ic > statementIc || (labelDetectedFlag && lineType == emptyStatement)))
+			addLineEntry(lines, statementIc, 0, lineNumber, (labelDetectedFlag)? potentialLabel : NULL);
+		else if(lines && *dc > statementDc)
+			addLineEntry(lines, statementDc, 1, lineNumber, (labelDetectedFlag)? potentialLabel : NULL);
+		if(*dc > statementDc)
+			addImageStatement(image, statementDc);
+		if(!isWithinMemory(*ic, (deferDataCheck)? 0 : *dc, lineNumber, &overflowReported))
+			success = 0;
 	}
+	if(isErrorLimitReached())
+		success = 0;
 	free(buffer);
-	fclose(amFile);
 	return success;
 }
 
+/*
+ * Checks that the code (up to ic) and the data following it fit in the memory of the target machine,
+ * reporting the first line which doesn't fit only once
+ * returns 1 for true 0 for false
+ */
+int isWithinMemory (int ic, int dc, int lineNumber, int* reported){
+	if(ic + dc <= getMemoryLength())
+		return 1;
+	if(!*reported)
+		reportError(lineNumber, MEMORY_FIT_DIAGNOSTIC, "program doesn't fit in the memory of %d words", getMemoryLength());
+	*reported = 1;
+	return 0;
+}
+
 /*
  * In between first and second pass - advances data segment by ic
  * Also flags error if a .entry symbol was declared but never defined - if so returns 0 otherwise 1
@@ -199,7 +444,7 @@ int prepareSecondPass (Symbol* symTable, int ic){
 			symTable->address += ic;
 		}
 		if(symTable->isExternal == ENTRY_AWAITING_ADDRESS_SYM){
-			fprintf(stderr,"Error detected in line [%d]: label '%s' is declared as entry but never defined\n",symTable->address, symTable->name);
+			reportError(symTable->address, UNDEFINED_ENTRY_DIAGNOSTIC, "label '%s' is declared as entry but never defined", symTable->name);
 			return 0;
 		}
 		symTable= symTable->next;
@@ -208,42 +453,74 @@ int prepareSecondPass (Symbol* symTable, int ic){
 }
 
 /*
- * Function goes over the memory array, replacing labels with their address
+ * Goes over the code words of the image reporting labels which are not in the symbol table
+ * returns 0 if encountered unknown labels or 1 if not
+ */
+int checkLabels (Image* image, int ic, Symbol* symTable){
+	int success = 1, address = getLoadAddress();
+	char copy [IMAGE_WORD_LENGTH];
+	char *label, *lineNumber, *word;
+	for(; address < ic && address < getMemoryLength() && !isErrorLimitReached() ; address++){
+		word = getImageWord(image, address);
+		if(isalpha(word[0])){
+			strcpy(copy,word);
+			label = strtok(copy,"|");
+			lineNumber = strtok(NULL,"|");
+			if(!findSymbolInTable(label, symTable)){
+				reportError(atoi(lineNumber), UNKNOWN_LABEL_DIAGNOSTIC, "unknown label '%s'",label);
+				success = 0;
+			}
+		}
+	}
+	return success;
+}
+
+/*
+ * Function goes over the code words of the image, replacing labels with their address
  * Writes compiled words to .ob file
  * Writes extern line numbers to .ext file (if found any)
  * Writes entry symbols and addresses to .ent fil (if found any)
+ * Writes the load address and the addresses of relocatable words to .rel file (if writeRelocations is set)
  * returns 0 if encountered errors or 1 if not
  */
-int secondPass (char* name, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_LENGTH], int ic, int dc, Symbol* symTable, int* dataArray){
+int secondPass (char* name, Image* image, int ic, int dc, Symbol* symTable, int writeRelocations){
 	int success = 1;
-	int i, address = PROGRAM_LOAD_ADDRESS, entryDetected=0, externDetected=0;
-	char *outputLine, *binary, *label, *lineNumber;
-	char copy [MAX_LINE_LENGTH];
+	int i, address = getLoadAddress(), entryDetected=0, externDetected=0;
+	char *outputLine, *binary, *label, *lineNumber, *word;
+	char copy [IMAGE_WORD_LENGTH];
 	Symbol* symbol;
-	char *obUrl, *entUrl, *extUrl;	/* url for output files*/
-	FILE *obFile, *entFile, *extFile; /* stream for output files*/
+	char *obUrl, *entUrl, *extUrl, *relUrl;	/* url for output files*/
+	FILE *obFile, *entFile, *extFile, *relFile = NULL; /* stream for output files*/
 
 	obUrl = constructUrl(name,"ob");
 	entUrl = constructUrl (name, "ent");
 	extUrl = constructUrl (name, "ext");
+	relUrl = constructUrl (name, "rel");
 
 	obFile = fopen(obUrl, "w");
 	entFile = fopen(entUrl, "w");
 	extFile = fopen(extUrl, "w");
+	if(writeRelocations){
+		relFile = fopen(relUrl, "w");
+		outputLine = convertDecimalBase32(getLoadAddress());
+		fprintf(relFile,"%s\n",outputLine);
+		free(outputLine);
+	}
 
-	outputLine = constructObjectFileFirstLine((ic-PROGRAM_LOAD_ADDRESS),dc);
+	outputLine = constructObjectFileFirstLine((ic-getLoadAddress()),dc);
 	fprintf(obFile,"%s\n",outputLine);
 	free(outputLine);
 
-	for(; address < ic ; address++){
-		if(isalpha(memory[address][0])){
+	for(; address < ic && !isErrorLimitReached() ; address++){
+		word = getImageWord(image, address);
+		if(isalpha(word[0])){
 			/*first handles labels which were not compiled in the first pass*/
-			strcpy(copy,memory[address]);
+			strcpy(copy,word);
 			label = strtok(copy,"|");
 			lineNumber = strtok(NULL,"|");
 			symbol = findSymbolInTable(label, symTable);
 			if(!symbol){
-				fprintf(stderr,"Error in line [%s]: unknown label '%s'\n",lineNumber,label);
+				reportError(atoi(lineNumber), UNKNOWN_LABEL_DIAGNOSTIC, "unknown label '%s'",label);
 				success=0;
 				continue;
 			}
@@ -259,12 +536,17 @@ int secondPass (char* name, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_L
 			}
 			else{
 				binary = constructType2Binary(symbol->address, RELOCATABLE_ARE);
+				if(relFile && success){
+					outputLine = convertDecimalBase32(address);
+					fprintf(relFile,"%s\n",outputLine);
+					free(outputLine);
+				}
 			}
-			strcpy(memory[address],binary);
+			strcpy(word,binary);
 			free(binary);
 		}
 		if(success){
-			outputLine = constructObjectFileLine(address,memory[address]);
+			outputLine = constructObjectFileLine(address,word);
 			fprintf(obFile,"%s\n",outputLine);
 			free(outputLine);
 		}
@@ -272,10 +554,11 @@ int secondPass (char* name, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_L
 	ic += dc;
 	for(i=0; i < dc; i++, address++){
 		if(success){
-			binary = constructType3Binary (dataArray[i]);
+			binary = constructType3Binary (image->data[i]);
 			outputLine = constructObjectFileLine(address, binary);
 			fprintf(obFile,"%s\n",outputLine);
 			free(outputLine);
+			free(binary);
 		}
 	}
 	if(success){
@@ -295,20 +578,25 @@ int secondPass (char* name, char memory[TARGET_MACHINE_MEMORY_LENGTH][MAX_LINE_L
 		remove(obUrl);
 		remove(entUrl);
 		remove(extUrl);
+		if(relFile)
+			remove(relUrl);
 	}
 	else {
 		if(!entryDetected){
-			printf("No entry directives found, not creating %s file\n",entUrl);
+			reportProgress("No entry directives found, not creating %s file",entUrl);
 			remove(entUrl);
 		}
 		if(!externDetected){
-			printf("No extern labels found, not creating %s file\n",extUrl);
+			reportProgress("No extern labels found, not creating %s file",extUrl);
 			remove(extUrl);
 		}
 	}
 	free(obUrl);
 	free(extUrl);
 	free(entUrl);
+	free(relUrl);
+	if(relFile)
+		fclose(relFile);
 	fclose(obFile);
 	fclose(entFile);
 	fclose(extFile);
@@ -4,14 +4,51 @@
  */
 #ifndef ASSEMBLY_H
 #define ASSEMBLY_H
+#include <stdio.h>
 #include "data.h"
+#include "template.h"
+#include "stream.h"
+
+#define DATA_LENGTH 6
+#define STRING_LENGTH 8
+#define STRUCT_LENGTH 8
+#define ENTRY_LENGTH 7
+#define EXTERN_LENGTH 8
+
+enum statementType { emptyStatement, commandStatement, dataStatement, stringStatement, structStatement, entryStatement, externStatement };
 
 /*
  * Manages the assembly process.
- * Receives a .am file name (without extension), performs validation and compiling on the file
+ * Receives a .am file name (without extension) and the decoded stream of its source (see decodeStream),
+ * performs validation and compiling on the lines of the stream belonging to the variant
  * If file is valid the function writes the compiled object, entry and extern files
+ * (and the relocation file if writeRelocations is set, the line table if writeLines is set)
+ * If optimize is set redundant instructions are removed between the passes (see peephole.h),
+ * if collect is set the code and data never reached are removed (see collect.h),
+ * if pool is set data statements share identical words (see pool.h)
+ * If mapFormat isn't NO_MAP the memory map is written once the words are laid out (see map.h) -
+ * also when the program doesn't fit in the memory
  * Returns 1 if succeeded or 0 if encountered errors
  */
-int assemble (char *name);
+int assemble (char *name, int writeRelocations, int writeLines, int optimize, int pool, int collect, int mapFormat, SourceStream *stream, int variant);
+
+/*
+ * Lexes and validates every line of the stream once for all the variants holding it - its label, its type and
+ * the words of a command (through the templates of the stream) or the values of a data statement
+ * A line with errors is left undecoded, to be reported by every variant holding it with its own line number
+ */
+void decodeStream(SourceStream *stream);
+
+/*
+ * Validates the expanded source code read from amFile without encoding it or writing any file:
+ * performs the first pass (only laying out the words), the entry checks and the search for unknown labels
+ * Returns 1 if the code is valid or 0 if encountered errors
+ */
+int checkAssembly(FILE *amFile);
+
+/*
+ * Receives a line (without a label declaration) and returns the type as an integer (using enum statementType)
+ */
+int getStatementType (char* line);
 
 #endif
@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# bench.sh
+# 		the throughput benchmark (make bench) - assembles synthetic corpora (see generator.c) from 1 KB to 100 MB
+# 		and reports the lines and megabytes every phase of the assembler handles in a second (see timings.h)
+#
+# 		A corpus is made of programs of up to BENCH_LINES lines, each fitting the largest memory, generated
+# 		with consecutive seeds until the corpus reaches its size (within 5% either way - the last program is sized
+# 		by the bytes per line measured so far, and generated again with fewer lines while it overshoots). A small corpus is assembled
+# 		repeatedly (in the same run) until BENCH_MIN_BYTES went through the assembler, so its timings are
+# 		long enough to measure. The results of every corpus are written as an element of a JSON array to
+# 		BENCH_RESULTS, to be compared between builds.
+#
+# 		Settings (environment):
+# 			BENCH_SIZES		corpus sizes in bytes (default 1 KB, 10 KB ... 100 MB)
+# 			BENCH_LINES		lines in every program of a corpus (default 12000)
+# 			BENCH_MIN_BYTES	bytes assembled at least for every corpus (default 10 MB, up to 1000 repeats)
+# 			BENCH_DIR		directory the corpora are generated in (default a directory in /tmp, removed after)
+# 			BENCH_RESULTS	file the results are written to (default bench.json)
+#
+
+SIZES=${BENCH_SIZES:-"1000 10000 100000 1000000 10000000 100000000"}
+LINES=${BENCH_LINES:-12000}
+MIN_BYTES=${BENCH_MIN_BYTES:-10000000}
+MAX_REPEATS=1000
+DIR=${BENCH_DIR:-${TMPDIR:-/tmp}/assembler-bench.$$}
+RESULTS=${BENCH_RESULTS:-bench.json}
+GEOMETRY="--memory 65536 --word-width 20"
+BYTES_PER_LINE=16	# roughly what a generated line takes, until the first program of a corpus is measured
+
+ASSEMBLER=$(pwd)/assembler
+GENERATOR=$(pwd)/generator
+case $RESULTS in
+	/*) ;;
+	*) RESULTS=$(pwd)/$RESULTS ;;
+esac
+
+mkdir -p "$DIR" || exit 1
+[ -z "$BENCH_DIR" ] && trap 'cd / && rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+echo "[" > "$RESULTS"
+separator=""
+for size in $SIZES; do
+	rm -f corpus*.*
+	bytes=0
+	generated=0
+	files=""
+	count=0
+	while [ "$bytes" -lt $((size - size / 20)) ]; do
+		if [ "$generated" -gt 0 ]; then
+			lines=$(( (size - bytes) * generated / bytes + 1 ))
+		else
+			lines=$(( (size - bytes) / BYTES_PER_LINE + 1 ))
+		fi
+		[ "$lines" -gt "$LINES" ] && lines=$LINES
+		count=$((count + 1))
+		while :; do
+			"$GENERATOR" --lines "$lines" --seed "$count" $GEOMETRY "corpus$count" || exit 1
+			programBytes=$(wc -c < "corpus$count.as")
+			[ $((bytes + programBytes)) -le $((size + size / 20)) ] || [ "$lines" -le 1 ] && break
+			# scaled to the room left, always fewer lines than the last try
+			shorter=$(( lines * (size - bytes) / programBytes ))
+			[ "$shorter" -ge "$lines" ] && shorter=$((lines - 1))
+			[ "$shorter" -lt 1 ] && shorter=1
+			lines=$shorter
+		done
+		bytes=$((bytes + programBytes))
+		generated=$((generated + lines))
+		files="$files corpus$count"
+	done
+	if [ "$bytes" -gt $((size + size / 20)) ]; then
+		echo "Error: the corpus of $size bytes came out at $bytes bytes" >&2
+		exit 1
+	fi
+
+	repeats=$(( (MIN_BYTES + bytes - 1) / bytes ))
+	[ "$repeats" -gt "$MAX_REPEATS" ] && repeats=$MAX_REPEATS
+	[ "$repeats" -lt 1 ] && repeats=1
+	run=""
+	i=0
+	while [ "$i" -lt "$repeats" ]; do
+		run="$run$files"
+		i=$((i + 1))
+	done
+
+	echo "Corpus of $size bytes: $count programs, $bytes bytes, assembled $repeats times"
+	"$ASSEMBLER" -q $GEOMETRY --timings timings.json $run
+	assembled=$(ls corpus*.ob 2>/dev/null | wc -l)
+	if [ "$assembled" -ne "$count" ]; then
+		echo "Error: only $assembled of the $count programs assembled" >&2
+		exit 1
+	fi
+
+	printf '%s{"corpus": %s, "programs": %s, "bytes": %s, "repeats": %s, "phases": %s}' \
+			"$separator" "$size" "$count" "$bytes" "$repeats" "$(cat timings.json)" >> "$RESULTS"
+	separator=",
+"
+done
+printf '\n]\n' >> "$RESULTS"
+
+echo "Results written to $RESULTS"
@@ -0,0 +1,510 @@
+/*
+ * cache.c
+ * 		module keeps a local on-disk cache of assembled outputs, keyed by a digest of the source code,
+ * 		the assembler version and the options affecting the output
+ *
+ * 		Entries are built in a temporary directory and published with rename, so a reader either sees a complete
+ * 		entry or none at all. Evicted entries are renamed away before they are deleted for the same reason.
+ * 		The statistics file and eviction are guarded by a lock on the "lock" file of the cache.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "main.h"
+#include "hash.h"
+#include "preprocessor.h"
+#include "utilities.h"
+#include "constraints.h"
+#include "diagnostics.h"
+#include "map.h"
+
+#define COPY_CHUNK 65536
+#define STALE_TEMPORARY_SECONDS 3600
+#define NUM_OF_CACHED_EXTENSIONS 8
+#define MAX_ENTRY_FILE_NAME 16
+#define TEMPORARY_PREFIX "tmp."
+
+typedef struct CacheEntry {
+	char name[HASH_HEX_LENGTH];
+	time_t lastUse;
+	long size;
+} CacheEntry;
+
+/* the object file comes first so a missing entry is detected before any output is touched */
+static char *cachedExtensions[NUM_OF_CACHED_EXTENSIONS] = { "ob", "ent", "ext", "am", "d", "rel", "lin", "map" };
+static long cacheHits = 0, cacheMisses = 0;
+
+char* readWholeFile(char *url, size_t *length);
+void computeKey(char *source, size_t length, Options *options, char *key);
+void hashIncludes(Hash *hash, char *source);
+char* constructOutputUrl(char *filename, Options *options, int variant, char *extension);
+char* constructPath(char *directory, char *name);
+int restoreEntry(char *entryPath, char *filename, Options *options);
+void storeEntry(char *key, char *filename, Options *options);
+int copyFile(char *from, char *to);
+void removeDirectory(char *path);
+long directorySize(char *path);
+int lockCache(char *directory);
+void updateStatistics(char *directory, long *totalHits, long *totalMisses);
+void evictEntries(char *directory, long limit, long *totalSize, int *entryCount);
+int compareEntries(const void *first, const void *second);
+
+/*
+ * Same as assembleFile, but restores the outputs from the cache when the same source was already assembled
+ * with the same options, and stores the outputs of a successful assembly otherwise
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int cachedAssembleFile(char *filename, Options *options){
+	char key[HASH_HEX_LENGTH];
+	char *url, *source, *entryPath;
+	size_t length;
+	FILE *stream;
+	int success;
+
+	url = constructUrl(filename, "as");
+	source = readWholeFile(url, &length);
+	free(url);
+	if(!source)
+		return assembleSource(filename, NULL, options); /* reports the unreadable file as usual */
+
+	computeKey(source, length, options, key);
+	entryPath = constructPath(options->cacheDir, key);
+	if(restoreEntry(entryPath, filename, options)){
+		cacheHits++;
+		utime(entryPath, NULL); /* the modification time of an entry marks its last use */
+		free(entryPath);
+		free(source);
+		return 1;
+	}
+	free(entryPath);
+
+	/* the source already read for the key is assembled from memory instead of being read again */
+	cacheMisses++;
+	stream = openExpandedBuffer(source, length);
+	success = assembleSource(filename, stream, options);
+	fclose(stream);
+	if(success)
+		storeEntry(key, filename, options);
+	free(source);
+	return success;
+}
+
+/*
+ * Adds the hits and misses of this process to the statistics kept in the cache, evicts the least recently used
+ * entries beyond the size limit, and prints the statistics if requested
+ */
+void finishCache(Options *options){
+	long totalHits = 0, totalMisses = 0, totalSize = 0;
+	int lockFd, entryCount = 0;
+
+	if(!options->cacheDir)
+		return;
+	mkdir(options->cacheDir, 0777);
+	lockFd = lockCache(options->cacheDir);
+	if(lockFd < 0){
+		fprintf(stderr,"Error: couldn't lock the build cache at %s\n",options->cacheDir);
+		return;
+	}
+	updateStatistics(options->cacheDir, &totalHits, &totalMisses);
+	evictEntries(options->cacheDir, options->cacheLimit, &totalSize, &entryCount);
+	close(lockFd); /* releases the lock */
+
+	if(options->cacheStats){
+		printf("Build cache: %ld hits, %ld misses in this run (%ld hits, %ld misses overall), %d entries using %ld bytes\n",
+				cacheHits, cacheMisses, totalHits, totalMisses, entryCount, totalSize);
+	}
+	cacheHits = 0;
+	cacheMisses = 0;
+}
+
+/*
+ * Reads the whole file into a new null terminated buffer, storing its length (without the null) in length
+ * Returns the buffer or NULL if the file can't be read
+ */
+char* readWholeFile(char *url, size_t *length){
+	FILE *file = fopen(url, "rb");
+	char *buffer;
+	long size;
+
+	if(!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	buffer = (char*)malloc(size + 1);
+	*length = fread(buffer, 1, size, file);
+	buffer[*length] = '\0';
+	fclose(file);
+	return buffer;
+}
+
+/*
+ * Computes the key of an entry from the assembler version, the variants (with their symbols), the machine geometry
+ * and the source code
+ */
+void computeKey(char *source, size_t length, Options *options, char *key){
+	char geometry[MAX_LINE_LENGTH];
+	Hash hash;
+	int i, j;
+	Variant *variant;
+
+	hashInit(&hash);
+	hashUpdate(&hash, ASSEMBLER_VERSION, strlen(ASSEMBLER_VERSION) + 1);
+	for(i = 0; i < options->variantCount; i++){
+		variant = &options->variants[i];
+		if(variant->name)
+			hashUpdate(&hash, variant->name, strlen(variant->name));
+		hashUpdate(&hash, ":", 1);
+		for(j = 0; j < variant->defineCount; j++)
+			hashUpdate(&hash, variant->defines[j], strlen(variant->defines[j]) + 1);
+		hashUpdate(&hash, ";", 1);
+	}
+	hashUpdate(&hash, options->writeDependencies? "deps" : "", options->writeDependencies? 5 : 1);
+	hashUpdate(&hash, options->writeRelocations? "reloc" : "", options->writeRelocations? 6 : 1);
+	hashUpdate(&hash, options->writeLineTable? "lines" : "", options->writeLineTable? 6 : 1);
+	hashUpdate(&hash, options->optimize? "optimize" : "", options->optimize? 9 : 1);
+	hashUpdate(&hash, options->poolData? "pool" : "", options->poolData? 5 : 1);
+	hashUpdate(&hash, options->collectGarbage? "gc" : "", options->collectGarbage? 3 : 1);
+	hashUpdate(&hash, (options->mapFormat == HUMAN_MAP)? "map" : "", (options->mapFormat == HUMAN_MAP)? 4 : 1);
+	hashUpdate(&hash, (options->mapFormat == JSON_MAP)? "json" : "", (options->mapFormat == JSON_MAP)? 5 : 1);
+	sprintf(geometry, "%d:%d:%d", options->memoryLength, options->loadAddress, options->wordWidth);
+	hashUpdate(&hash, geometry, strlen(geometry) + 1);
+	hashUpdate(&hash, source, length);
+	hashIncludes(&hash, source);
+	hashFinal(&hash, key);
+}
+
+/*
+ * Adds the content of every library included by the source to the key
+ * (libraries can't include other libraries, so the source lists all of them)
+ */
+void hashIncludes(Hash *hash, char *source){
+	char line[MAX_LINE_LENGTH], name[MAX_LINE_LENGTH];
+	char *end, *url, *content;
+	size_t length;
+	for(; *source; source = (*end)? end + 1 : end){
+		end = strchr(source, '\n');
+		if(!end)
+			end = source + strlen(source);
+		length = end - source;
+		if(length >= MAX_LINE_LENGTH)
+			length = MAX_LINE_LENGTH - 1;
+		strncpy(line, source, length);
+		line[length] = '\0';
+		if(!getIncludeName(line, name))
+			continue;
+		/* a library shipped only precompiled is identified by its precompiled file */
+		url = constructUrl(name, "as");
+		content = readWholeFile(url, &length);
+		if(!content){
+			free(url);
+			url = constructUrl(name, "aml");
+			content = readWholeFile(url, &length);
+		}
+		hashUpdate(hash, name, strlen(name) + 1);
+		if(content)
+			hashUpdate(hash, content, length);
+		free(content);
+		free(url);
+	}
+}
+
+/*
+ * Returns the output file of the given extension for a variant, or NULL if it isn't kept in the cache
+ * (the dependency file is written once per source file, and only when requested)
+ */
+char* constructOutputUrl(char *filename, Options *options, int variant, char *extension){
+	char *variantName, *url;
+	if(strcmp(extension, "d") == 0)
+		return (variant == 0 && options->writeDependencies)? constructUrl(filename, extension) : NULL;
+	if(strcmp(extension, "rel") == 0 && !options->writeRelocations)
+		return NULL;
+	if(strcmp(extension, "lin") == 0 && !options->writeLineTable)
+		return NULL;
+	if(strcmp(extension, "map") == 0 && options->mapFormat == NO_MAP)
+		return NULL;
+	variantName = constructVariantName(filename, &options->variants[variant]);
+	url = constructUrl(variantName, extension);
+	free(variantName);
+	return url;
+}
+
+/*
+ * Returns a new string containing "[directory]/[name]"
+ */
+char* constructPath(char *directory, char *name){
+	char *path = (char*)malloc(strlen(directory) + strlen(name) + 2);
+	strcpy(path, directory);
+	strcat(path, "/");
+	strcat(path, name);
+	return path;
+}
+
+/*
+ * Copies the cached outputs of every variant to their output files
+ * Returns 1 if the entry was restored or 0 if there is no complete entry
+ */
+int restoreEntry(char *entryPath, char *filename, Options *options){
+	char entryFileName[MAX_ENTRY_FILE_NAME];
+	char *variantName, *cachedPath, *destination;
+	int i, j, copied, success = 1;
+
+	for(i = 0; success && i < options->variantCount; i++){
+		variantName = constructVariantName(filename, &options->variants[i]);
+		for(j = 0; success && j < NUM_OF_CACHED_EXTENSIONS; j++){
+			if(options->cacheSkipAm && strcmp(cachedExtensions[j], "am") == 0)
+				continue;
+			if(!(destination = constructOutputUrl(filename, options, i, cachedExtensions[j])))
+				continue;
+			sprintf(entryFileName, "%d.%s", i, cachedExtensions[j]);
+			cachedPath = constructPath(entryPath, entryFileName);
+			copied = copyFile(cachedPath, destination);
+			/* entry and extern files only exist when the program has entries or externs */
+			if(copied < 0 && (strcmp(cachedExtensions[j], "ent") == 0 || strcmp(cachedExtensions[j], "ext") == 0))
+				remove(destination);
+			else if(copied <= 0)
+				success = 0;
+			free(destination);
+			free(cachedPath);
+		}
+		if(success)
+			reportProgress("Restored %s from the build cache", variantName);
+		free(variantName);
+	}
+	return success;
+}
+
+/*
+ * Copies the outputs of every variant into a new entry named key
+ * An entry stored meanwhile by another process is kept and this copy is discarded
+ */
+void storeEntry(char *key, char *filename, Options *options){
+	char entryFileName[MAX_ENTRY_FILE_NAME + HASH_HEX_LENGTH + 32];
+	char *temporaryPath, *entryPath, *cachedPath, *output;
+	int i, j;
+
+	mkdir(options->cacheDir, 0777);
+	sprintf(entryFileName, TEMPORARY_PREFIX "%ld.%s", (long)getpid(), key);
+	temporaryPath = constructPath(options->cacheDir, entryFileName);
+	if(mkdir(temporaryPath, 0777) != 0){
+		free(temporaryPath);
+		return;
+	}
+	for(i = 0; i < options->variantCount; i++){
+		for(j = 0; j < NUM_OF_CACHED_EXTENSIONS; j++){
+			if(!(output = constructOutputUrl(filename, options, i, cachedExtensions[j])))
+				continue;
+			sprintf(entryFileName, "%d.%s", i, cachedExtensions[j]);
+			cachedPath = constructPath(temporaryPath, entryFileName);
+			copyFile(output, cachedPath);
+			free(output);
+			free(cachedPath);
+		}
+	}
+	entryPath = constructPath(options->cacheDir, key);
+	if(rename(temporaryPath, entryPath) != 0)
+		removeDirectory(temporaryPath);
+	free(entryPath);
+	free(temporaryPath);
+}
+
+/*
+ * Copies the content of the file from to the file to
+ * Returns 1 if succeeded, -1 if from doesn't exist or 0 if encountered other errors
+ */
+int copyFile(char *from, char *to){
+	char buffer[COPY_CHUNK];
+	int input, output;
+	ssize_t amount;
+	int success = 1;
+
+	input = open(from, O_RDONLY);
+	if(input < 0)
+		return -1;
+	output = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if(output < 0){
+		close(input);
+		return 0;
+	}
+	while(success && (amount = read(input, buffer, COPY_CHUNK)) > 0)
+		success = write(output, buffer, amount) == amount;
+	if(amount < 0)
+		success = 0;
+	close(input);
+	if(close(output) != 0)
+		success = 0;
+	return success;
+}
+
+/*
+ * Deletes a directory along with the files in it
+ */
+void removeDirectory(char *path){
+	DIR *directory = opendir(path);
+	struct dirent *file;
+	char *filePath;
+	if(directory){
+		while((file = readdir(directory))){
+			if(strcmp(file->d_name, ".") == 0 || strcmp(file->d_name, "..") == 0)
+				continue;
+			filePath = constructPath(path, file->d_name);
+			unlink(filePath);
+			free(filePath);
+		}
+		closedir(directory);
+	}
+	rmdir(path);
+}
+
+/*
+ * Returns the total size in bytes of the files in a directory
+ */
+long directorySize(char *path){
+	DIR *directory = opendir(path);
+	struct dirent *file;
+	struct stat status;
+	char *filePath;
+	long size = 0;
+	if(!directory)
+		return 0;
+	while((file = readdir(directory))){
+		filePath = constructPath(path, file->d_name);
+		if(stat(filePath, &status) == 0 && S_ISREG(status.st_mode))
+			size += status.st_size;
+		free(filePath);
+	}
+	closedir(directory);
+	return size;
+}
+
+/*
+ * Waits for an exclusive lock on the cache
+ * Returns the descriptor holding the lock (closing it releases the lock) or -1 if encountered errors
+ */
+int lockCache(char *directory){
+	struct flock lock;
+	char *lockPath = constructPath(directory, "lock");
+	int fd = open(lockPath, O_RDWR | O_CREAT, 0666);
+	free(lockPath);
+	if(fd < 0)
+		return -1;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	if(fcntl(fd, F_SETLKW, &lock) != 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Adds the hits and misses of this process to the "stats" file of the cache (the caller holds the lock)
+ * storing the updated totals in totalHits and totalMisses
+ */
+void updateStatistics(char *directory, long *totalHits, long *totalMisses){
+	char *statsPath = constructPath(directory, "stats");
+	char *temporaryPath = constructPath(directory, TEMPORARY_PREFIX "stats");
+	FILE *stats = fopen(statsPath, "r");
+
+	*totalHits = 0;
+	*totalMisses = 0;
+	if(stats){
+		if(fscanf(stats, "hits %ld misses %ld", totalHits, totalMisses) != 2){
+			*totalHits = 0;
+			*totalMisses = 0;
+		}
+		fclose(stats);
+	}
+	*totalHits += cacheHits;
+	*totalMisses += cacheMisses;
+	stats = fopen(temporaryPath, "w");
+	if(stats){
+		fprintf(stats, "hits %ld misses %ld\n", *totalHits, *totalMisses);
+		fclose(stats);
+		rename(temporaryPath, statsPath);
+	}
+	free(temporaryPath);
+	free(statsPath);
+}
+
+/*
+ * Deletes the least recently used entries until the cache holds at most limit bytes (no limit if limit is 0)
+ * along with temporary directories abandoned by processes that died (the caller holds the lock)
+ * storing the size and amount of the remaining entries in totalSize and entryCount
+ */
+void evictEntries(char *directory, long limit, long *totalSize, int *entryCount){
+	DIR *cache = opendir(directory);
+	struct dirent *file;
+	struct stat status;
+	CacheEntry *entries = NULL;
+	char evictedName[HASH_HEX_LENGTH + 64];
+	char *path, *evictedPath;
+	int i, count = 0, capacity = 0;
+	time_t now = time(NULL);
+
+	*totalSize = 0;
+	*entryCount = 0;
+	if(!cache)
+		return;
+	while((file = readdir(cache))){
+		if(file->d_name[0] == '.' || strcmp(file->d_name, "lock") == 0 || strcmp(file->d_name, "stats") == 0)
+			continue;
+		path = constructPath(directory, file->d_name);
+		if(stat(path, &status) != 0 || !S_ISDIR(status.st_mode)){
+			free(path);
+			continue;
+		}
+		if(strncmp(file->d_name, TEMPORARY_PREFIX, strlen(TEMPORARY_PREFIX)) == 0){
+			if(now - status.st_mtime > STALE_TEMPORARY_SECONDS)
+				removeDirectory(path);
+		}
+		else if(strlen(file->d_name) == HASH_HEX_LENGTH - 1){
+			if(count == capacity){
+				capacity = (capacity)? capacity * 2 : 64;
+				entries = (CacheEntry*)realloc(entries, sizeof(CacheEntry) * capacity);
+			}
+			strcpy(entries[count].name, file->d_name);
+			entries[count].lastUse = status.st_mtime;
+			entries[count].size = directorySize(path);
+			*totalSize += entries[count++].size;
+		}
+		free(path);
+	}
+	closedir(cache);
+
+	qsort(entries, count, sizeof(CacheEntry), compareEntries);
+	for(i = 0; limit > 0 && *totalSize > limit && i < count; i++){
+		/* renaming first removes the entry from view at once, readers copying from it are unaffected */
+		path = constructPath(directory, entries[i].name);
+		sprintf(evictedName, TEMPORARY_PREFIX "evicted.%ld.%s", (long)getpid(), entries[i].name);
+		evictedPath = constructPath(directory, evictedName);
+		if(rename(path, evictedPath) == 0){
+			removeDirectory(evictedPath);
+			*totalSize -= entries[i].size;
+			entries[i].size = -1;
+		}
+		free(evictedPath);
+		free(path);
+	}
+	for(i = 0; i < count; i++)
+		*entryCount += (entries[i].size >= 0);
+	free(entries);
+}
+
+/*
+ * Orders cache entries from the least to the most recently used
+ */
+int compareEntries(const void *first, const void *second){
+	time_t a = ((CacheEntry*)first)->lastUse, b = ((CacheEntry*)second)->lastUse;
+	return (a > b) - (a < b);
+}
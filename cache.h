@@ -0,0 +1,26 @@
+/*
+ * cache.h
+ * 		module keeps a local on-disk cache of assembled outputs, keyed by a digest of the source code,
+ * 		the assembler version and the options affecting the output
+ *
+ * 		every entry is a directory named after the key holding the .am/.ob/.ent/.ext files of each variant,
+ * 		entries are published with an atomic rename so parallel processes may share the cache safely
+ */
+#ifndef CACHE_H
+#define CACHE_H
+#include "options.h"
+
+/*
+ * Same as assembleFile, but restores the outputs from the cache when the same source was already assembled
+ * with the same options, and stores the outputs of a successful assembly otherwise
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int cachedAssembleFile(char *filename, Options *options);
+
+/*
+ * Adds the hits and misses of this process to the statistics kept in the cache, evicts the least recently used
+ * entries beyond the size limit, and prints the statistics if requested
+ */
+void finishCache(Options *options);
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * check.c
+ * 		module validates source files entirely in memory, reporting diagnostics without writing any file
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "check.h"
+#include "assembly.h"
+#include "preprocessor.h"
+#include "diagnostics.h"
+#include "utilities.h"
+
+/*
+ * Expands "[filename].as" (or the given source stream) in memory and validates every variant:
+ * statements, symbol definitions, entries and label references - nothing is encoded or written
+ * Returns 1 if the source is valid or 0 if encountered errors
+ */
+int checkFile(char *filename, FILE *source, Options *options){
+	FILE *asFile = (source)? source : openSourceFile(filename), *expanded;
+	char *buffers[MAX_VARIANTS];
+	size_t lengths[MAX_VARIANTS];
+	char *variantName, *url;
+	int i, success;
+
+	if(!asFile){
+		flushDiagnostics();
+		return 0;
+	}
+	resetDiagnostics();
+	url = constructUrl(filename, "as");
+	setDiagnosticsSource(url);
+	success = expandToMemory(asFile, filename, options->variants, options->variantCount, buffers, lengths);
+	if(!source)
+		fclose(asFile);
+	free(url);
+
+	for(i = 0; i < options->variantCount; i++){
+		if(success){
+			/* line numbers of the assembly stage refer to the expanded code */
+			variantName = constructVariantName(filename, &options->variants[i]);
+			url = constructUrl(variantName, "am");
+			setDiagnosticsSource(url);
+			expanded = openExpandedBuffer(buffers[i], lengths[i]);
+			resetDiagnostics();
+			success = checkAssembly(expanded) && success;
+			fclose(expanded);
+			free(url);
+			free(variantName);
+		}
+		free(buffers[i]);
+	}
+	flushDiagnostics();
+	setDiagnosticsSource(NULL);
+	return success;
+}
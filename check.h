@@ -0,0 +1,17 @@
+/*
+ * check.h
+ * 		module validates source files entirely in memory, reporting diagnostics without writing any file
+ */
+#ifndef CHECK_H
+#define CHECK_H
+#include <stdio.h>
+#include "options.h"
+
+/*
+ * Expands "[filename].as" (or the given source stream) in memory and validates every variant:
+ * statements, symbol definitions, entries and label references - nothing is encoded or written
+ * Returns 1 if the source is valid or 0 if encountered errors
+ */
+int checkFile(char *filename, FILE *source, Options *options);
+
+#endif
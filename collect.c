@@ -0,0 +1,303 @@
+/*
+ * collect.c
+ * 		module removes the code and data a program never reaches between the first and the second pass (with --gc)
+ * 		- the regions between labels reached from neither the start of the program nor an entry
+ *
+ * 		Labels cut the code and the data into regions - a region runs from a label (or the start of its segment)
+ * 		to the next label. Words referencing labels are still labels at this point ("[label]|[line]"), so every
+ * 		operand naming a label is a reference from the region of its instruction to the region of the label
+ * 		(and to the region following the label for the second field of a struct). A region of code also reaches
+ * 		the region following it unless its last instruction is a jmp, rts or hlt. The regions reached from the
+ * 		region of the load address and from the regions of the entries are kept, the rest are removed and
+ * 		the regions following them move down. Addresses computed without labels (an immediate jmp target)
+ * 		are not followed.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "collect.h"
+#include "instruction.h"
+#include "geometry.h"
+
+/* code or data from a label up to the next */
+typedef struct Region {
+	int start;			/* address of the code or offset of the data */
+	int end;
+	int fallsThrough;	/* the code may run into the following region */
+	int firstEdge;		/* the references of the region are edges firstEdge up to lastEdge */
+	int lastEdge;
+	int reached;
+} Region;
+
+int buildRegions(int *starts, int count, int end, Region *regions);
+int compareAddresses(const void *first, const void *second);
+int findRegion(Region *regions, int count, int address);
+int linkRegions(Image *image, int ic, Symbol *symTable, Region *regions, int codeCount, int dataCount, int **edges);
+int addEdge(int **edges, int edgeCount, Region *region, int target);
+void reachRegions(Region *regions, int codeCount, int dataCount, int *edges, Symbol *symTable);
+void pushRegion(Region *regions, int *stack, int *depth, int region);
+int regionOf(Region *regions, int codeCount, int dataCount, int segment, int address);
+int* removeRegions(Region *regions, int count, int *values, int length, char **words);
+int isCollectable(Symbol *symbol);
+
+/*
+ * Removes the regions of the image never reached, moving the rest down - ic, dc, the labels, the data statements
+ * of the image and the entries of lines (unless NULL) follow, the labels of the removed regions are moved to the report
+ * Returns 1 if succeeded or 0 if the code can't be decoded (leaving the image as it is)
+ */
+int collectGarbage(Image *image, int *ic, int *dc, Symbol **symTable, LineTable *lines, CollectReport *report){
+	int loadAddress = getLoadAddress(), codeLength = *ic - loadAddress;
+	int *codeStarts, *dataStarts, codeCount = 1, dataCount = 1, *edges = NULL, *codeRemoved, *dataRemoved, i, j, region;
+	char **codeWords = (char**)malloc(sizeof(char*) * (codeLength + 1));
+	Region *regions;
+	Symbol **link, *symbol;
+	LineEntry *entry;
+
+	memset(report, 0, sizeof(CollectReport));
+	for(i = 0, symbol = *symTable; symbol; symbol = symbol->next)
+		i++;
+	codeStarts = (int*)malloc(sizeof(int) * (i + 1));
+	dataStarts = (int*)malloc(sizeof(int) * (i + 1));
+	codeStarts[0] = loadAddress;
+	dataStarts[0] = 0;
+	for(symbol = *symTable; symbol; symbol = symbol->next){
+		if(isCollectable(symbol) && symbol->segment == COMMAND_SEGMENT)
+			codeStarts[codeCount++] = symbol->address;
+		else if(isCollectable(symbol))
+			dataStarts[dataCount++] = symbol->address;
+	}
+	regions = (Region*)malloc(sizeof(Region) * (codeCount + dataCount));
+	codeCount = buildRegions(codeStarts, codeCount, *ic, regions);
+	dataCount = buildRegions(dataStarts, dataCount, *dc, regions + codeCount);
+	free(codeStarts);
+	free(dataStarts);
+	if(linkRegions(image, *ic, *symTable, regions, codeCount, dataCount, &edges) < 0){
+		free(regions);
+		free(edges);
+		free(codeWords);
+		return 0;
+	}
+	reachRegions(regions, codeCount, dataCount, edges, *symTable);
+	free(edges);
+
+	/* the words of the code and the values of the data move down over the removed regions */
+	for(i = 0; i < codeLength; i++)
+		codeWords[i] = getImageWord(image, loadAddress + i);
+	for(i = 0; i < codeCount; i++){
+		regions[i].start -= loadAddress;
+		regions[i].end -= loadAddress;
+	}
+	codeRemoved = removeRegions(regions, codeCount, NULL, codeLength, codeWords);
+	dataRemoved = removeRegions(regions + codeCount, dataCount, image->data, *dc, NULL);
+	for(i = 0; i < codeCount; i++){
+		regions[i].start += loadAddress;
+		regions[i].end += loadAddress;
+	}
+
+	/* the labels of removed regions move to the report, keeping the order they were defined in */
+	for(link = symTable; *link;){
+		symbol = *link;
+		if(!isCollectable(symbol) || (region = regionOf(regions, codeCount, dataCount, symbol->segment, symbol->address)) < 0){
+			link = &symbol->next;
+			continue;
+		}
+		if(!regions[region].reached){
+			*link = symbol->next;
+			symbol->next = report->removed;
+			report->removed = symbol;
+			continue;
+		}
+		symbol->address -= (symbol->segment == COMMAND_SEGMENT)? codeRemoved[symbol->address - loadAddress] : dataRemoved[symbol->address];
+		link = &symbol->next;
+	}
+	for(i = 0, j = 0; lines && i < lines->count; i++){
+		entry = &lines->entries[i];
+		region = regionOf(regions, codeCount, dataCount, (entry->isData)? DATA_SEGMENT : COMMAND_SEGMENT, entry->address);
+		if(region >= 0 && !regions[region].reached)
+			continue;
+		if(region >= 0)
+			entry->address -= (entry->isData)? dataRemoved[entry->address] : codeRemoved[entry->address - loadAddress];
+		lines->entries[j++] = *entry;
+	}
+	if(lines)
+		lines->count = j;
+	for(i = 0, j = 0; i < image->statementCount; i++){
+		region = regionOf(regions, codeCount, dataCount, DATA_SEGMENT, image->statements[i]);
+		if(region < 0 || regions[region].reached)
+			image->statements[j++] = image->statements[i] - dataRemoved[image->statements[i]];
+	}
+	image->statementCount = j;
+
+	report->codeWords = codeRemoved[codeLength];
+	report->dataWords = dataRemoved[*dc];
+	*ic -= report->codeWords;
+	*dc -= report->dataWords;
+	free(codeRemoved);
+	free(dataRemoved);
+	free(codeWords);
+	free(regions);
+	return 1;
+}
+
+/*
+ * Fills the regions starting at the (unsorted, repeating) starts, the last of them ending at end
+ * Returns the amount of regions
+ */
+int buildRegions(int *starts, int count, int end, Region *regions){
+	int i, regionCount = 0;
+	qsort(starts, count, sizeof(int), compareAddresses);
+	for(i = 0; i < count; i++){
+		if(regionCount && regions[regionCount - 1].start == starts[i])
+			continue;
+		if(regionCount)
+			regions[regionCount - 1].end = starts[i];
+		regions[regionCount].start = starts[i];
+		regions[regionCount].end = end;
+		regions[regionCount].fallsThrough = 0;
+		regions[regionCount].firstEdge = 0;
+		regions[regionCount].lastEdge = 0;
+		regions[regionCount++].reached = 0;
+	}
+	return regionCount;
+}
+
+int compareAddresses(const void *first, const void *second){
+	return *(int*)first - *(int*)second;
+}
+
+/*
+ * Returns the index of the region holding the address (the last region starting at or before it), -1 if none does
+ */
+int findRegion(Region *regions, int count, int address){
+	int first = 0, last = count - 1, middle;
+	if(!count || address < regions[0].start || address > regions[last].end)
+		return -1;
+	while(first < last){
+		middle = (first + last + 1) / 2;
+		if(regions[middle].start <= address)
+			first = middle;
+		else
+			last = middle - 1;
+	}
+	return first;
+}
+
+/*
+ * Decodes the code, adding an edge for every operand naming a label of the program and setting which regions
+ * of code fall through
+ * Returns the amount of edges or -1 if the code can't be decoded
+ */
+int linkRegions(Image *image, int ic, Symbol *symTable, Region *regions, int codeCount, int dataCount, int **edges){
+	int words[MAX_INSTRUCTION_LENGTH], address, i, region = 0, target, edgeCount = 0, isDestination;
+	char label[IMAGE_WORD_LENGTH];
+	Instruction instruction;
+	DecodedOperand *operand;
+	Symbol *symbol;
+
+	for(address = getLoadAddress(); address < ic; address += instruction.length){
+		for(i = 0; i < MAX_INSTRUCTION_LENGTH && address + i < ic; i++)
+			words[i] = readImageWord(image, address + i);
+		if(!decodeInstruction(words, i, &instruction))
+			return -1;
+		while(region + 1 < codeCount && regions[region + 1].start <= address){
+			region++;
+			regions[region].firstEdge = regions[region].lastEdge = edgeCount;
+		}
+		for(isDestination = (instruction.operandCount < 2); isDestination <= (instruction.operandCount > 0); isDestination++){
+			operand = (isDestination)? &instruction.dst : &instruction.src;
+			if(operand->mode != DIRECT_MODE && operand->mode != STRUCT_MODE)
+				continue;
+			strcpy(label, getImageWord(image, address + operand->wordOffset));
+			label[strcspn(label, "|")] = '\0';
+			if(!(symbol = findSymbolInTable(label, symTable)) || !isCollectable(symbol))
+				continue;
+			if((target = regionOf(regions, codeCount, dataCount, symbol->segment, symbol->address)) >= 0)
+				edgeCount = addEdge(edges, edgeCount, &regions[region], target);
+			/* the second field of a struct is the word following the label */
+			if(operand->field == 2 && (target = regionOf(regions, codeCount, dataCount, symbol->segment, symbol->address + 1)) >= 0)
+				edgeCount = addEdge(edges, edgeCount, &regions[region], target);
+		}
+		regions[region].fallsThrough = instruction.opCode != JMP_OP && instruction.opCode != RTS_OP && instruction.opCode != HLT_OP;
+	}
+	return edgeCount;
+}
+
+/*
+ * Adds an edge from the region (whose edges are the last ones) to the target region
+ * Returns the new amount of edges
+ */
+int addEdge(int **edges, int edgeCount, Region *region, int target){
+	if(!(edgeCount & (edgeCount - 1)))
+		*edges = (int*)realloc(*edges, sizeof(int) * ((edgeCount)? edgeCount * 2 : 1));
+	(*edges)[edgeCount++] = target;
+	region->lastEdge = edgeCount;
+	return edgeCount;
+}
+
+/*
+ * Marks the regions reached from the region of the load address and the regions of the entries
+ */
+void reachRegions(Region *regions, int codeCount, int dataCount, int *edges, Symbol *symTable){
+	int *stack = (int*)malloc(sizeof(int) * (codeCount + dataCount)), depth = 0, region, i;
+
+	pushRegion(regions, stack, &depth, regionOf(regions, codeCount, dataCount, COMMAND_SEGMENT, getLoadAddress()));
+	for(; symTable; symTable = symTable->next){
+		if(symTable->isExternal == ENTRY_SYM)
+			pushRegion(regions, stack, &depth, regionOf(regions, codeCount, dataCount, symTable->segment, symTable->address));
+	}
+	while(depth){
+		region = stack[--depth];
+		for(i = regions[region].firstEdge; i < regions[region].lastEdge; i++)
+			pushRegion(regions, stack, &depth, edges[i]);
+		if(regions[region].fallsThrough && region + 1 < codeCount)
+			pushRegion(regions, stack, &depth, region + 1);
+	}
+	free(stack);
+}
+
+void pushRegion(Region *regions, int *stack, int *depth, int region){
+	if(region < 0 || regions[region].reached)
+		return;
+	regions[region].reached = 1;
+	stack[(*depth)++] = region;
+}
+
+/*
+ * Returns the index of the region holding the address of the segment (the data regions follow the code regions),
+ * -1 if none does
+ */
+int regionOf(Region *regions, int codeCount, int dataCount, int segment, int address){
+	int region;
+	if(segment == COMMAND_SEGMENT)
+		return findRegion(regions, codeCount, address);
+	region = findRegion(regions + codeCount, dataCount, address);
+	return (region >= 0)? codeCount + region : -1;
+}
+
+/*
+ * Moves the values (or the words) of the regions reached down over the ones which weren't
+ * Returns a new array of the amount of values removed before every offset (up to length)
+ */
+int* removeRegions(Region *regions, int count, int *values, int length, char **words){
+	int *removedBefore = (int*)malloc(sizeof(int) * (length + 1)), region = 0, offset, removed = 0;
+	for(offset = 0; offset < length; offset++){
+		while(region + 1 < count && regions[region + 1].start <= offset)
+			region++;
+		removedBefore[offset] = removed;
+		if(!regions[region].reached)
+			removed++;
+		else if(removed && values)
+			values[offset - removed] = values[offset];
+		else if(removed)
+			strcpy(words[offset - removed], words[offset]);
+	}
+	removedBefore[length] = removed;
+	return removedBefore;
+}
+
+/*
+ * Returns 1 if the symbol is a label of the program (which a removed region takes along), otherwise 0
+ */
+int isCollectable(Symbol *symbol){
+	return symbol->isExternal == REGULAR_LABEL_SYM || symbol->isExternal == ENTRY_SYM;
+}
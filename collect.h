@@ -0,0 +1,26 @@
+/*
+ * collect.h
+ * 		module removes the code and data a program never reaches between the first and the second pass (with --gc)
+ * 		- the regions between labels reached from neither the start of the program nor an entry
+ */
+#ifndef COLLECT_H
+#define COLLECT_H
+#include "image.h"
+#include "data.h"
+#include "lines.h"
+
+/* what the collection removed */
+typedef struct CollectReport {
+	int codeWords;
+	int dataWords;
+	Symbol *removed;	/* the labels of the removed regions, taken out of the symbol table in the order they were defined */
+} CollectReport;
+
+/*
+ * Removes the regions of the image never reached, moving the rest down - ic, dc, the labels, the data statements
+ * of the image and the entries of lines (unless NULL) follow, the labels of the removed regions are moved to the report
+ * Returns 1 if succeeded or 0 if the code can't be decoded (leaving the image as it is)
+ */
+int collectGarbage(Image *image, int *ic, int *dc, Symbol **symTable, LineTable *lines, CollectReport *report);
+
+#endif
@@ -6,12 +6,15 @@
 #include "command.h"
 #include "output.h"
 #include "utilities.h"
+#include "diagnostics.h"
 #include "constraints.h"
+#include "geometry.h"
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 
+#define IMMEDIATE_RESERVED_BITS 3 /* the ARE bits and the sign bit of an immediate word */
 /*const declarations */
 enum operandType { IMMEDIATE_OP,  LABEL_OP, STRUCT_OP, REGISTER_OP}; /* type of operands - immediate, label, struct, register*/
 
@@ -42,7 +45,7 @@ static int legalOperandTypes [8][16] = {
 static char operandTypes [4][10]= { "Immediate", "Label", "Struct", "Register" };
 
 typedef struct Operand {
-	char op [30];
+	char op [MAX_LINE_LENGTH]; /* an operand is never longer than its line */
 	int type; /* enum operator types*/
 	int numField;
 	/*numField :
@@ -70,6 +73,7 @@ typedef struct CrudeCommand {
 CrudeCommand* initialDeconstruction (char* line, int lineNumber);
 Command* validateCrudeCommand (CrudeCommand* crud, int lineNumber);
 CompiledLine* finalEncoding (Command* cmd, int* ic, int lineNumber);
+CompiledLine* layoutCommand (Command* cmd, int* ic, int lineNumber);
 
 CompiledLine* decodeOperand (Operand* op, int isSrc, int *ic, int lineNumber);
 CompiledLine* decodeLabel (Operand* op, int *ic, int lineNumber);
@@ -81,6 +85,7 @@ void destroyCommand (Command* cmd);
 
 int isLegalCommand (Command c, int lineNumber);
 Operand* constructOperand (char* op, int lineNumber);
+int getOperandKind (char* op);
 
 /*decode */
 /*
@@ -102,6 +107,55 @@ CompiledLine* decodeCommandLine (char* line, int* ic, int lineNumber){
 	return ret;
 }
 
+/*
+ * Validates the command in the line without encoding it, advancing ic over the words it occupies
+ * labelWords receives the list of words referencing labels (as decodeCommandLine constructs them) or NULL if there are none
+ * Returns 1 if the command is valid or 0 if encountered errors
+ */
+int validateCommandLine (char* line, int* ic, int lineNumber, CompiledLine** labelWords){
+	CrudeCommand* crud;
+	Command* cmd;
+
+	crud = initialDeconstruction (line, lineNumber);
+	cmd = validateCrudeCommand (crud, lineNumber);
+	*labelWords = (cmd)? layoutCommand (cmd, ic, lineNumber) : NULL;
+
+	destroyCrude(crud);
+	destroyCommand(cmd);
+	return cmd != NULL;
+}
+
+/*
+ * Counts the memory words the command in the line occupies, judging only by the mnemonic and the operand kinds
+ * (operands are neither validated nor encoded)
+ * Returns -1 if the mnemonic is unrecognized or there are more than two operands
+ */
+int countCommandWords (char* line){
+	char cpy [MAX_LINE_LENGTH];
+	char *t, *operands[2];
+	int i, kinds[2], amount = 0, words = 1;
+
+	strcpy(cpy,line);
+	t = strtok(cpy," ");
+	for(i=0; t && i<16 && strcmp(t, validCommands[i]); i++){
+	}
+	if(!t || i==16)
+		return -1;
+	for(t = strtok(NULL,","); t; t = strtok(NULL,",")){
+		if(amount == 2)
+			return -1;
+		operands[amount++] = t;
+	}
+	for(i=0; i<amount; i++){
+		kinds[i] = getOperandKind(operands[i]);
+		words += (kinds[i] == STRUCT_OP)? 2:1;
+	}
+	/* two register operands share a single word */
+	if(amount == 2 && kinds[0] == REGISTER_OP && kinds[1] == REGISTER_OP)
+		words--;
+	return words;
+}
+
 /*
  * Phase I of decoding - using strtok breaks down the string to up to three strings:
  * 			command and two optional operators
@@ -119,12 +173,12 @@ CrudeCommand* initialDeconstruction (char* line, int lineNumber){
 	strcpy(cpy,line);
 	t = strtok(cpy," ");
 	if(t){
-		cmd->command = (char*)malloc(sizeof(char)*30);
+		cmd->command = (char*)malloc(strlen(t) + 1);
 		strcpy(cmd->command,t);
 	}
 	t = strtok(NULL,",");
 	if(t!=NULL){
-		cmd->op1 = (char*)malloc(sizeof(char)*30);
+		cmd->op1 = (char*)malloc(strlen(t) + 1);
 		strcpy(cmd->op1,t);
 	}
 	else{
@@ -132,12 +186,12 @@ CrudeCommand* initialDeconstruction (char* line, int lineNumber){
 	}
 	t = strtok(NULL,",");
 	if(t!=NULL){
-		cmd->op2 = (char*)malloc(sizeof(char)*30);
+		cmd->op2 = (char*)malloc(strlen(t) + 1);
 		strcpy(cmd->op2,t);
 	}
 	t = strtok(NULL,",");
 	if(t!=NULL){
-		fprintf(stderr, "Error detected in line [%d]: illegal amount of operands (more than 2)\n",lineNumber);
+		reportError(lineNumber, OPERAND_COUNT_DIAGNOSTIC, "illegal amount of operands (more than 2)");
 		destroyCrude(cmd);
 		return NULL;
 	}
@@ -164,7 +218,7 @@ Command* validateCrudeCommand (CrudeCommand* crud, int lineNumber){
 		}
 	}
 	if(flag){
-		fprintf(stderr, "Error detected in line [%d]: unrecognized command '%s'\n",lineNumber, crud->command);
+		reportError(lineNumber, UNKNOWN_COMMAND_DIAGNOSTIC, "unrecognized command '%s'", crud->command);
 		free(cmd);
 		return NULL;
 	}
@@ -192,13 +246,13 @@ Command* validateCrudeCommand (CrudeCommand* crud, int lineNumber){
 		}
 		cmd->dstOp = constructOperand(crud->op2, lineNumber);
 		if(!cmd->dstOp){
-			free(cmd);
+			destroyCommand(cmd);
 			return NULL;
 		}
 	}
 
 	if(!isLegalCommand(*cmd, lineNumber)) {
-		free(cmd);
+		destroyCommand(cmd);
 		return NULL;
 	}
 	return cmd;
@@ -269,44 +323,77 @@ CompiledLine* finalEncoding (Command* cmd, int* ic, int lineNumber){
 
 
 
+/*
+ * Same as finalEncoding without the encoding - advances ic over the words of a valid command
+ * and returns only the words referencing labels
+ */
+CompiledLine* layoutCommand (Command* cmd, int* ic, int lineNumber){
+	CompiledLine *retH = NULL, *label;
+	Operand* op;
+	int i;
+
+	(*ic)++; /* the instruction word */
+	if(cmd->srcOp && cmd->dstOp && cmd->srcOp->type == REGISTER_OP && cmd->dstOp->type == REGISTER_OP){
+		(*ic)++;
+		return NULL;
+	}
+	for(i = 0; i < 2; i++){
+		op = (i == 0)? cmd->srcOp : cmd->dstOp;
+		if(!op)
+			continue;
+		if(op->type == LABEL_OP || op->type == STRUCT_OP){
+			strTrim(op->op);
+			label = decodeLabel(op, ic, lineNumber);
+			label->next = retH;
+			retH = label;
+			if(op->type == STRUCT_OP)
+				(*ic)++; /* the field index */
+		}
+		else
+			(*ic)++;
+	}
+	return retH;
+}
+
 int isLegalCommand (Command c, int lineNumber){
 	int amountReg=0;
+	int limit = (1 << (getWordWidth() - IMMEDIATE_RESERVED_BITS)) - 1;
 	if(c.srcOp){
 		amountReg++;
 		if(!(legalOperandTypes[c.srcOp->type][c.opCode])){
-			fprintf(stderr, "Error detected in line [%d]: incompatible source operand of type '%s' for the command '%s'\n",lineNumber,operandTypes[c.srcOp->type],validCommands[c.opCode]);
+			reportError(lineNumber, INCOMPATIBLE_OPERAND_DIAGNOSTIC, "incompatible source operand of type '%s' for the command '%s'",operandTypes[c.srcOp->type],validCommands[c.opCode]);
 			return 0;
 		}
 		if(c.srcOp->type == IMMEDIATE_OP){
-			if(c.srcOp->numField>127 || c.srcOp->numField<-127){
-				fprintf(stderr, "Error detected in line [%d]: immediate value exceeds bounds of [-127,127]\n",lineNumber);
+			if(c.srcOp->numField>limit || c.srcOp->numField<-limit){
+				reportError(lineNumber, IMMEDIATE_BOUNDS_DIAGNOSTIC, "immediate value exceeds bounds of [-%d,%d]", limit, limit);
 				return 0;
 			}
 		}
 		if(c.srcOp->type == STRUCT_OP && (c.srcOp->numField>2 || c.srcOp->numField<1)){
-			fprintf(stderr, "Error detected in line [%d]: struct directives can only access 1st or 2nd field\n",lineNumber);
+			reportError(lineNumber, STRUCT_FIELD_DIAGNOSTIC, "struct directives can only access 1st or 2nd field");
 				return 0;
 		}
 	}
 	if(c.dstOp){
 		amountReg++;
 		if(!(legalOperandTypes[4+c.dstOp->type][c.opCode])){
-			fprintf(stderr, "Error detected in line [%d]: incompatible destination operand of type '%s' for the command' %s'\n",lineNumber,operandTypes[c.dstOp->type],validCommands[c.opCode]);
+			reportError(lineNumber, INCOMPATIBLE_OPERAND_DIAGNOSTIC, "incompatible destination operand of type '%s' for the command' %s'",operandTypes[c.dstOp->type],validCommands[c.opCode]);
 			return 0;
 		}
 		if(c.dstOp->type == IMMEDIATE_OP){
-			if(c.dstOp->numField>127 || c.dstOp->numField<-127){
-				fprintf(stderr, "Error detected in line [%d]: immediate value exceeds bounds of [-127,127]\n",lineNumber);
+			if(c.dstOp->numField>limit || c.dstOp->numField<-limit){
+				reportError(lineNumber, IMMEDIATE_BOUNDS_DIAGNOSTIC, "immediate value exceeds bounds of [-%d,%d]", limit, limit);
 				return 0;
 			}
 		}
 		if(c.dstOp->type == STRUCT_OP && (c.dstOp->numField>2 || c.dstOp->numField<1)){
-			fprintf(stderr, "Error detected in line [%d]: struct directives can only access 1st or 2nd field\n",lineNumber);
+			reportError(lineNumber, STRUCT_FIELD_DIAGNOSTIC, "struct directives can only access 1st or 2nd field");
 				return 0;
 		}
 	}
 	if(legalAmountOperands[c.opCode]!=amountReg){
-		fprintf(stderr, "Error detected in line [%d]: illegal amount of operands for the command '%s'\n",lineNumber, validCommands[c.opCode]);
+		reportError(lineNumber, OPERAND_COUNT_DIAGNOSTIC, "illegal amount of operands for the command '%s'", validCommands[c.opCode]);
 		return 0;
 	}
 	return 1;
@@ -328,7 +415,7 @@ Operand* constructOperand (char* op, int lineNumber){
 		}
 		else{
 			/*invalid immediate*/
-			printf("Error detected in line [%d]: invalid number for immediate value\n",lineNumber);
+			reportError(lineNumber, INVALID_IMMEDIATE_DIAGNOSTIC, "invalid number for immediate value");
 			free(o);
 			return NULL;
 		}
@@ -359,6 +446,21 @@ Operand* constructOperand (char* op, int lineNumber){
 }
 
 
+/*
+ * Returns the type of the operand in the string (using enum operandType) the same way constructOperand discerns it
+ */
+int getOperandKind (char* op){
+	for(; isspace(*op); op++){
+	}
+	if(op[0]=='#')
+		return IMMEDIATE_OP;
+	if(op[0]=='r' && op[1]>='0' && op[1]<='7' && (!op[2] || isspace(op[2])))
+		return REGISTER_OP;
+	if(strchr(op,'.'))
+		return STRUCT_OP;
+	return LABEL_OP;
+}
+
 /*
  * Handles the decoding of an operand and directs it to each usecase based on type
  */
@@ -393,8 +495,10 @@ CompiledLine* decodeLabel (Operand* op, int *ic, int lineNumber){
 	CompiledLine *comp = (CompiledLine*)malloc(sizeof(CompiledLine));
 	char* lineNumberString = customItoa(lineNumber);
 
-	comp -> binaryStr = (char*)malloc(sizeof(char)*MAX_LABEL_NAME_LENGTH);
-	strcpy(comp-> binaryStr,op->op);
+	/* a label longer than any symbol can't be found in the second pass - only as much of it is kept as fits a word*/
+	comp -> binaryStr = (char*)malloc(MAX_LABEL_NAME_LENGTH + strlen(lineNumberString) + 2);
+	strncpy(comp-> binaryStr,op->op,MAX_LABEL_NAME_LENGTH);
+	comp -> binaryStr[MAX_LABEL_NAME_LENGTH] = '\0';
 	strcat(comp-> binaryStr, "|");
 	strcat(comp-> binaryStr, lineNumberString); /*used in the second pass for printing errors*/
 	comp -> address = (*ic)++;
@@ -471,5 +575,6 @@ void destroyDecoded(CompiledLine* decoded){
 	}
 	destroyDecoded(decoded->next);
 	decoded->next = NULL;
+	free(decoded->binaryStr);
 	free(decoded);
 }
@@ -19,6 +19,20 @@ typedef struct CompiledLine {
  */
 CompiledLine* decodeCommandLine (char* line, int* ic, int lineNumber);
 
+/*
+ * Validates the command in the line without encoding it, advancing ic over the words it occupies
+ * labelWords receives the list of words referencing labels (as decodeCommandLine constructs them) or NULL if there are none
+ * Returns 1 if the command is valid or 0 if encountered errors
+ */
+int validateCommandLine (char* line, int* ic, int lineNumber, CompiledLine** labelWords);
+
+/*
+ * Counts the memory words the command in the line occupies, judging only by the mnemonic and the operand kinds
+ * (operands are neither validated nor encoded)
+ * Returns -1 if the mnemonic is unrecognized or there are more than two operands
+ */
+int countCommandWords (char* line);
+
 /*
  * Frees space dynamically allocated to CompiledLine instances
  */
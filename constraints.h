@@ -1,10 +1,16 @@
 /*
  *  file serves as a setting file for app wide constants
  */
-#define TARGET_MACHINE_MEMORY_LENGTH 256
-#define PROGRAM_LOAD_ADDRESS 100
+#define DEFAULT_MEMORY_LENGTH 256                /*geometry of the target machine unless configured otherwise (see geometry.h)*/
+#define DEFAULT_LOAD_ADDRESS 100
+#define DEFAULT_WORD_WIDTH 10
+#define MAX_MEMORY_LENGTH 65536
+#define MIN_WORD_WIDTH 10                       /*the fields of an instruction word take 10 bits*/
+#define MAX_WORD_WIDTH 30
+#define MAX_MACRO_LENGTH 256                    /*the maximum length of a macro's content*/
 #define MAX_LINE_LENGTH 81
 #define MAX_FILE_NAME_LENGTH 31
 #define MAX_LABEL_NAME_LENGTH 32
 #define MAX_TYPE_LENGTH 8                       /*the maximum length for the first (valid) word, used to identify statement type*/
 
+#define ASSEMBLER_VERSION "1.1"                 /*identifies the output format, part of the build cache key*/
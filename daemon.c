@@ -0,0 +1,536 @@
+/*
+ * daemon.c
+ * 		module keeps the assembler resident as a daemon serving assembly jobs over a unix socket,
+ * 		and provides the client side which forwards the command line files to a running daemon
+ *
+ * 		The daemon pre-forks a pool of worker processes which all accept connections on the same socket.
+ * 		A worker stays alive between jobs, so whatever it allocated and loaded remains warm for the next job.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "daemon.h"
+#include "main.h"
+#include "cache.h"
+#include "constraints.h"
+#include "diagnostics.h"
+
+#define MAX_PROTOCOL_LINE 4200
+#define MAX_PATH_LENGTH 4096
+#define MAX_SOURCE_LENGTH (64L * 1024 * 1024)	/* bytes of a source sent with SOURCE */
+#define CAPTURE_CHUNK 4096
+#define LISTEN_BACKLOG 64
+
+static volatile sig_atomic_t stopRequested = 0;
+
+int openListeningSocket(char *path);
+int connectSocket(char *path);
+pid_t startWorker(int listenFd, Options *options);
+void workerLoop(int listenFd, Options *options);
+void serveConnection(int fd, char *home, Options *options);
+int configureJobs(int fd, Options *options, char **clientArguments, int clientCount, Options *jobOptions);
+void runJob(int fd, char *name, FILE *source, Options *options);
+int beginCapture(FILE *capture, FILE *stream);
+void endCapture(int saved, FILE *stream);
+void sendCapture(int fd, char *tag, FILE *capture);
+void sendMessage(int fd, char *tag, char *format, char *argument);
+void sendStatus(int fd, char *name, int success);
+int relayFrame(FILE *connection, int length, FILE *destination);
+int writeAll(int fd, char *buffer, size_t length);
+int isValidJobName(char *name);
+void onStopSignal(int sig);
+
+/*
+ * Listens on options->daemonSocket and runs the received jobs on a pool of options->workers processes
+ * Returns when receiving SIGINT or SIGTERM
+ */
+int runDaemon(Options *options){
+	int i, listenFd, status;
+	pid_t pid, *workers;
+	struct sigaction action;
+
+	listenFd = openListeningSocket(options->daemonSocket);
+	if(listenFd < 0)
+		return 1;
+
+	/* handlers are installed without SA_RESTART so wait() returns once a stop is requested */
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onStopSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	workers = (pid_t*)malloc(sizeof(pid_t) * options->workers);
+	for(i = 0; i < options->workers; i++)
+		workers[i] = startWorker(listenFd, options);
+	printf("Assembler daemon listening on %s with %d workers\n", options->daemonSocket, options->workers);
+	fflush(stdout);
+
+	while(!stopRequested){
+		pid = wait(&status);
+		if(pid < 0){
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+		/* a worker died - replace it so the pool keeps its size */
+		for(i = 0; i < options->workers; i++){
+			if(workers[i] == pid && !stopRequested)
+				workers[i] = startWorker(listenFd, options);
+		}
+	}
+
+	for(i = 0; i < options->workers; i++){
+		if(workers[i] > 0)
+			kill(workers[i], SIGTERM);
+	}
+	while(wait(&status) > 0){
+	}
+	free(workers);
+	close(listenFd);
+	unlink(options->daemonSocket);
+	printf("Assembler daemon stopped\n");
+	return 1;
+}
+
+/*
+ * Sends the command line files and options to the daemon listening on options->clientSocket,
+ * relaying the output of each job as if it were assembled locally
+ * Returns the exit status of the assembler running the same jobs
+ */
+int runClient(Options *options){
+	int i, fd, length, jobSuccess, success = 1;
+	char line[MAX_PROTOCOL_LINE];
+	char cwd[MAX_PATH_LENGTH];
+	FILE *connection;
+
+	fd = connectSocket(options->clientSocket);
+	if(fd < 0)
+		return 1;
+	if (options->fileCount < 1)
+		printf("No command line parameters found.\nProgram requires files to compile and assemble.\nPlease enter .as file names (without extension) as command line parameters.\n");
+
+	if(getcwd(cwd, MAX_PATH_LENGTH)){
+		sprintf(line, "CWD %s\n", cwd);
+		writeAll(fd, line, strlen(line));
+	}
+	/* the jobs run with the options of the client, so the client behaves like the assembler itself */
+	for(i = 0; i < options->argumentCount; i++){
+		if(strcmp(options->arguments[i], "--client") == 0)
+			i++;
+		else if(strlen(options->arguments[i]) >= MAX_PROTOCOL_LINE - 8){
+			fprintf(stderr,"Error: option %s is too long\n",options->arguments[i]);
+			close(fd);
+			return 1;
+		}
+		else{
+			sprintf(line, "OPTION %s\n", options->arguments[i]);
+			writeAll(fd, line, strlen(line));
+		}
+	}
+	for(i = 0; i < options->fileCount; i++){
+		if(strlen(options->files[i]) >= MAX_PROTOCOL_LINE - 8){
+			fprintf(stderr,"Error: file name %s is too long\n",options->files[i]);
+			continue;
+		}
+		sprintf(line, "FILE %s\n", options->files[i]);
+		writeAll(fd, line, strlen(line));
+	}
+	writeAll(fd, "END\n", 4);
+
+	connection = fdopen(fd, "r");
+	while(fgets(line, MAX_PROTOCOL_LINE, connection)){
+		if(sscanf(line, "OUT %d", &length) == 1){
+			if(!relayFrame(connection, length, stdout))
+				break;
+		}
+		else if(sscanf(line, "ERR %d", &length) == 1){
+			if(!relayFrame(connection, length, stderr))
+				break;
+		}
+		else if(sscanf(line, "STATUS %*s %d", &jobSuccess) == 1)
+			success = success && jobSuccess;
+		else if(strcmp(line, "DONE\n") == 0)
+			break;
+	}
+	fclose(connection);
+	/* like the assembler, only a check tells from its exit status whether every file is valid */
+	return (options->checkOnly)? !success : 1;
+}
+
+/*
+ * Creates the unix socket at path and starts listening on it
+ * Returns the socket descriptor or -1 if encountered errors
+ */
+int openListeningSocket(char *path){
+	int fd;
+	struct sockaddr_un address;
+
+	if(strlen(path) >= sizeof(address.sun_path)){
+		fprintf(stderr,"Error: socket path %s is too long\n",path);
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0){
+		fprintf(stderr,"Error: couldn't create socket %s\n",path);
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path); /* a socket left behind by a previous daemon would fail bind */
+	if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, LISTEN_BACKLOG) < 0){
+		fprintf(stderr,"Error: couldn't listen on socket %s\n",path);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Connects to the daemon listening on the unix socket at path
+ * Returns the socket descriptor or -1 if encountered errors
+ */
+int connectSocket(char *path){
+	int fd;
+	struct sockaddr_un address;
+
+	if(strlen(path) >= sizeof(address.sun_path)){
+		fprintf(stderr,"Error: socket path %s is too long\n",path);
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	if(fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0){
+		fprintf(stderr,"Error: couldn't connect to assembler daemon at %s\n",path);
+		if(fd >= 0)
+			close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ * Forks a worker process serving connections from listenFd
+ * Returns the pid of the worker (in the daemon process)
+ */
+pid_t startWorker(int listenFd, Options *options){
+	pid_t pid = fork();
+	if(pid == 0){
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		workerLoop(listenFd, options);
+		exit(0);
+	}
+	if(pid < 0)
+		fprintf(stderr,"Error: couldn't start daemon worker\n");
+	return pid;
+}
+
+/*
+ * Accepts connections one at a time for as long as the worker lives
+ */
+void workerLoop(int listenFd, Options *options){
+	char home[MAX_PATH_LENGTH];
+	int fd;
+	/* every connection starts in the directory the daemon was started in */
+	if(!getcwd(home, MAX_PATH_LENGTH))
+		strcpy(home, "/");
+	for(;;){
+		fd = accept(listenFd, NULL, NULL);
+		if(fd < 0){
+			if(errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return;
+		}
+		serveConnection(fd, home, options);
+	}
+}
+
+/*
+ * Reads the jobs of a single client and answers each of them, starting in the home directory -
+ * a worker serves many clients, so none runs in the directory of the previous one
+ * The jobs run with the options of the daemon followed by the options the client sent
+ * The connection is closed on return (also once its directory can't be entered)
+ */
+void serveConnection(int fd, char *home, Options *options){
+	char line[MAX_PROTOCOL_LINE];
+	char name[MAX_PROTOCOL_LINE];
+	char *sourceText, **clientArguments = NULL;
+	int i, clientCount = 0, configured = 0, saved;
+	long length;
+	FILE *connection, *source, *capture;
+	Options jobOptions;
+
+	connection = fdopen(dup(fd), "r");
+	if(!connection || chdir(home) != 0){
+		writeAll(fd, "STATUS - 0\nDONE\n", 16);
+		if(connection)
+			fclose(connection);
+		close(fd);
+		return;
+	}
+	while(fgets(line, MAX_PROTOCOL_LINE, connection)){
+		line[strcspn(line, "\n")] = '\0';
+		if(strncmp(line, "OPTION ", 7) == 0 && !configured){
+			clientArguments = (char**)realloc(clientArguments, sizeof(char*) * (clientCount + 1));
+			clientArguments[clientCount] = (char*)malloc(strlen(line + 7) + 1);
+			strcpy(clientArguments[clientCount++], line + 7);
+			continue;
+		}
+		/* the options are complete once the first job arrives */
+		if(!configured && (strncmp(line, "FILE ", 5) == 0 || strncmp(line, "SOURCE ", 7) == 0)){
+			if(!configureJobs(fd, options, clientArguments, clientCount, &jobOptions)){
+				destroyOptions(&jobOptions);
+				sendStatus(fd, "-", 0);
+				break;
+			}
+			configured = 1;
+		}
+		if(strncmp(line, "CWD ", 4) == 0){
+			/* the jobs that follow would otherwise run in the wrong directory */
+			if(chdir(line + 4) != 0){
+				sendMessage(fd, "ERR", "Error: the daemon couldn't enter directory %s\n", line + 4);
+				sendStatus(fd, "-", 0);
+				break;
+			}
+		}
+		else if(strncmp(line, "FILE ", 5) == 0){
+			runJob(fd, line + 5, NULL, &jobOptions);
+		}
+		else if(sscanf(line, "SOURCE %s %ld", name, &length) == 2){
+			if(length < 0 || length > MAX_SOURCE_LENGTH || !(sourceText = (char*)malloc(length + 1))){
+				/* the source can't be skipped without reading it, so the connection ends */
+				sendMessage(fd, "ERR", "Error: the source of %s has an invalid length (up to 64 MB)\n", name);
+				sendStatus(fd, name, 0);
+				break;
+			}
+			if(fread(sourceText, 1, length, connection) != (size_t)length){
+				free(sourceText);
+				break;
+			}
+			/* an empty buffer can't be opened as a stream, an empty temporary file stands for it */
+			source = (length > 0)? fmemopen(sourceText, length, "r") : tmpfile();
+			if(source){
+				runJob(fd, name, source, &jobOptions);
+				fclose(source);
+			}
+			else{
+				sendMessage(fd, "ERR", "Error: the daemon couldn't read the source of %s\n", name);
+				sendStatus(fd, name, 0);
+			}
+			free(sourceText);
+		}
+		else if(strcmp(line, "END") == 0)
+			break;
+	}
+	if(configured){
+		/* the cache statistics are printed for the client */
+		if((capture = tmpfile()) != NULL){
+			saved = beginCapture(capture, stdout);
+			finishCache(&jobOptions);
+			endCapture(saved, stdout);
+			sendCapture(fd, "OUT", capture);
+			fclose(capture);
+		}
+		else
+			finishCache(&jobOptions);
+		destroyOptions(&jobOptions);
+	}
+	for(i = 0; i < clientCount; i++)
+		free(clientArguments[i]);
+	free(clientArguments);
+	writeAll(fd, "DONE\n", 5);
+	fclose(connection);
+	close(fd);
+}
+
+/*
+ * Parses the options of the daemon followed by the options of the client into jobOptions -
+ * parsing them again for every connection also sets back what a previous client changed
+ * Returns 1 if succeeded or 0 if encountered errors (sending them to the client)
+ */
+int configureJobs(int fd, Options *options, char **clientArguments, int clientCount, Options *jobOptions){
+	char **arguments = (char**)malloc(sizeof(char*) * (1 + options->argumentCount + clientCount));
+	int i, count = 0, success, savedErr = -1;
+	FILE *err = tmpfile();
+
+	arguments[count++] = "assembler";
+	for(i = 0; i < options->argumentCount; i++)
+		arguments[count++] = options->arguments[i];
+	for(i = 0; i < clientCount; i++)
+		arguments[count++] = clientArguments[i];
+	if(err)
+		savedErr = beginCapture(err, stderr);
+	success = parseOptions(count, arguments, jobOptions);
+	if(err){
+		endCapture(savedErr, stderr);
+		if(!success)
+			sendCapture(fd, "ERR", err);
+		fclose(err);
+	}
+	free(arguments);
+	return success;
+}
+
+/*
+ * Runs a single job while capturing its standard output and error, then sends both
+ * followed by the job status to the client
+ */
+void runJob(int fd, char *name, FILE *source, Options *options){
+	int success = 0, savedOut, savedErr, banners;
+	FILE *out = tmpfile(), *err = tmpfile();
+
+	if(!out || !err){
+		sendStatus(fd, name, 0);
+		return;
+	}
+
+	savedOut = beginCapture(out, stdout);
+	savedErr = beginCapture(err, stderr);
+
+	/* the banners are those of the assembler, which prints none when only sizing or checking */
+	banners = !options->sizeOnly && !options->checkOnly;
+	if(banners)
+		reportProgress("Begin operation on %s.as",name);
+	if(!isValidJobName(name))
+		reportSummary("Error: '%s' is not a valid file name",name);
+	else
+		success = (source)? assembleSource(name, source, options) : assembleFile(name, options);
+	if(banners)
+		reportProgress("-------------");
+	flushDiagnostics();
+
+	endCapture(savedOut, stdout);
+	endCapture(savedErr, stderr);
+
+	sendCapture(fd, "OUT", out);
+	sendCapture(fd, "ERR", err);
+	sendStatus(fd, name, success);
+	fclose(out);
+	fclose(err);
+}
+
+/*
+ * Redirects the stream (stdout or stderr) into the capture file
+ * Returns the descriptor the stream is restored from by endCapture
+ */
+int beginCapture(FILE *capture, FILE *stream){
+	int saved;
+	fflush(stream);
+	saved = dup(fileno(stream));
+	dup2(fileno(capture), fileno(stream));
+	return saved;
+}
+
+/*
+ * Restores the stream redirected by beginCapture
+ */
+void endCapture(int saved, FILE *stream){
+	fflush(stream);
+	dup2(saved, fileno(stream));
+	close(saved);
+}
+
+/*
+ * Sends the content of a capture file as a single frame: "<tag> <length>\n" followed by the bytes
+ */
+void sendCapture(int fd, char *tag, FILE *capture){
+	char header[32];
+	char chunk[CAPTURE_CHUNK];
+	long length;
+	ssize_t amount;
+	int captureFd = fileno(capture);
+
+	length = lseek(captureFd, 0, SEEK_END);
+	if(length <= 0)
+		return;
+	sprintf(header, "%s %ld\n", tag, length);
+	writeAll(fd, header, strlen(header));
+	lseek(captureFd, 0, SEEK_SET);
+	while((amount = read(captureFd, chunk, CAPTURE_CHUNK)) > 0)
+		writeAll(fd, chunk, amount);
+}
+
+/*
+ * Sends a message (formatted like printf with a single string argument) as a frame: "<tag> <length>\n"
+ * followed by the message
+ */
+void sendMessage(int fd, char *tag, char *format, char *argument){
+	char header[32];
+	char *message = (char*)malloc(strlen(format) + strlen(argument) + 1);
+	sprintf(message, format, argument);
+	sprintf(header, "%s %ld\n", tag, (long)strlen(message));
+	writeAll(fd, header, strlen(header));
+	writeAll(fd, message, strlen(message));
+	free(message);
+}
+
+/*
+ * Sends the status of the job: "STATUS <name> <1|0>\n"
+ */
+void sendStatus(int fd, char *name, int success){
+	writeAll(fd, "STATUS ", 7);
+	writeAll(fd, name, strlen(name));
+	writeAll(fd, (success)? " 1\n" : " 0\n", 3);
+}
+
+/*
+ * Copies a frame of length bytes from the connection to destination
+ * Returns 1 if succeeded or 0 if the connection was closed prematurely
+ */
+int relayFrame(FILE *connection, int length, FILE *destination){
+	char chunk[CAPTURE_CHUNK];
+	size_t amount;
+	while(length > 0){
+		amount = fread(chunk, 1, (length < CAPTURE_CHUNK)? length : CAPTURE_CHUNK, connection);
+		if(amount == 0)
+			return 0;
+		fwrite(chunk, 1, amount, destination);
+		length -= amount;
+	}
+	fflush(destination);
+	return 1;
+}
+
+/*
+ * Writes the whole buffer to fd
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int writeAll(int fd, char *buffer, size_t length){
+	ssize_t written;
+	while(length > 0){
+		written = write(fd, buffer, length);
+		if(written < 0){
+			if(errno == EINTR)
+				continue;
+			return 0;
+		}
+		buffer += written;
+		length -= written;
+	}
+	return 1;
+}
+
+/*
+ * Job names are used to construct the output file names (of any length), so only an empty name is invalid
+ * returns 1 for true 0 for false
+ */
+int isValidJobName(char *name){
+	return *name != '\0';
+}
+
+void onStopSignal(int sig){
+	stopRequested = 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * daemon.h
+ * 		module keeps the assembler resident as a daemon serving assembly jobs over a unix socket,
+ * 		and provides the client side which forwards the command line files to a running daemon
+ *
+ * 		protocol (text lines, client to daemon):
+ * 			CWD <directory>				directory the following jobs are relative to (the directory the daemon
+ * 										was started in until then, the connection ends if it can't be entered)
+ * 			OPTION <argument>			an argument of the client's command line besides its files (before the
+ * 										first job) - the jobs run with the daemon's options followed by these
+ * 			FILE <name>					assemble "[name].as"
+ * 			SOURCE <name> <length>		followed by length bytes of source code assembled as "[name].as"
+ * 										(up to 64 MB, the connection ends on a longer source)
+ * 			END							no more jobs
+ * 		for every job the daemon answers:
+ * 			OUT <length> / ERR <length>	followed by length bytes of the job's standard output / error
+ * 			STATUS <name> <1|0>			1 if the job succeeded, 0 otherwise
+ * 		and after the last job:
+ * 			DONE
+ */
+#ifndef DAEMON_H
+#define DAEMON_H
+#include "options.h"
+
+/*
+ * Listens on options->daemonSocket and runs the received jobs on a pool of options->workers processes
+ * Returns when receiving SIGINT or SIGTERM
+ */
+int runDaemon(Options *options);
+
+/*
+ * Sends the command line files and options to the daemon listening on options->clientSocket,
+ * relaying the output of each job as if it were assembled locally
+ * Returns the exit status of the assembler running the same jobs
+ */
+int runClient(Options *options);
+
+#endif
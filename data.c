@@ -9,6 +9,7 @@
 #include "data.h"
 #include "constraints.h"
 #include "utilities.h"
+#include "diagnostics.h"
 
 #define NUM_OF_RESERVED_WORDS 24
 #define MAX_INSTRUCTION 8
@@ -97,7 +98,7 @@ int storeLabel(Symbol** head, char* labelName, int address, int externalStatus,
 			current->isExternal = ENTRY_SYM;
 			return 1;
 		}
-		fprintf(stderr,"Error detected in line [%d]: '%s' was previously defined.\n",lineNumber, labelName);
+		reportError(lineNumber, DUPLICATE_LABEL_DIAGNOSTIC, "'%s' was previously defined.", labelName);
 		return 0;
 	}
 	current = (Symbol*)malloc(sizeof(Symbol));
@@ -117,17 +118,17 @@ int storeDataType(char *line, int* dataArray, int* dc, int lineNumber){
 	char *decimalNumber;
 	int* startDc = dc;
 	if(!(*line)){
-		fprintf(stderr, "Error detected in line [%d]: missing numbers after .data\n", lineNumber);
+		reportError(lineNumber, MISSING_DATA_DIAGNOSTIC, "missing numbers after .data");
 		return 0;
 	}
 	if(*line == ','){
-		fprintf(stderr, "Error detected in line [%d]: illegal comma\n", lineNumber);
+		reportError(lineNumber, ILLEGAL_COMMA_DIAGNOSTIC, "illegal comma");
 		return 0;
 	}
 	decimalNumber = strtok(line, comma);
 	flag = customAtoi(decimalNumber, &num);
 	if(!flag){
-		fprintf(stderr, "Error detected in line [%d]: %s is not a number\n", lineNumber, decimalNumber);
+		reportError(lineNumber, INVALID_NUMBER_DIAGNOSTIC, "%s is not a number", decimalNumber);
 		return 0;
 	}
 	dataArray[(*dc)++] = num;
@@ -135,7 +136,7 @@ int storeDataType(char *line, int* dataArray, int* dc, int lineNumber){
 		flag = customAtoi(decimalNumber, &num);
 
 		if(!flag){
-			fprintf(stderr, "Error detected in line [%d]: %s is not a number\n", lineNumber, decimalNumber);
+			reportError(lineNumber, INVALID_NUMBER_DIAGNOSTIC, "%s is not a number", decimalNumber);
 			dc = startDc;
 			return 0;
 		}
@@ -155,7 +156,7 @@ int storeStringType(char *line, int* dataArray, int* dc, int lineNumber){
 		for(line++; *line && *line != '\"' ;(*dc)++, line++){
 			num = *line;
 			if(!isalpha(*line)){
-				fprintf(stderr, "Error detected in line [%d]: %c is not a character\n", lineNumber, *line);
+				reportError(lineNumber, INVALID_CHARACTER_DIAGNOSTIC, "%c is not a character", *line);
 				return 0;
 			}
 			dataArray[*dc] = num;
@@ -165,12 +166,12 @@ int storeStringType(char *line, int* dataArray, int* dc, int lineNumber){
 			return 1;
 		}
 		else{
-			fprintf(stderr, "Error detected in line [%d]: missing string\n", lineNumber);
+			reportError(lineNumber, MISSING_DATA_DIAGNOSTIC, "missing string");
 			dc = startDc;
 			return 0;
 		}
 	}
-	fprintf(stderr, "Error detected in line [%d]: missing string\n", lineNumber);
+	reportError(lineNumber, MISSING_DATA_DIAGNOSTIC, "missing string");
 	return 0;
 }
 
@@ -179,13 +180,13 @@ int storeStructType(char *line, int* dataArray, int* dc, int lineNumber){
 	char comma[2] = ",";
 	char *token;
 	if(!(*line)){
-		fprintf(stderr, "Error detected in line [%d]: missing information after .struct\n", lineNumber);
+		reportError(lineNumber, MISSING_DATA_DIAGNOSTIC, "missing information after .struct");
 		return 0;
 	}
 	token = strtok(line, comma);
 	flag = customAtoi(token, &num);
 	if(!flag){
-		fprintf(stderr, "Error detected in line [%d]: %s is not a number\n", lineNumber, token);
+		reportError(lineNumber, INVALID_NUMBER_DIAGNOSTIC, "%s is not a number", token);
 		return 0;
 	}	
 	dataArray[(*dc)++] = num;
@@ -193,7 +194,7 @@ int storeStructType(char *line, int* dataArray, int* dc, int lineNumber){
 	for(i++; token[i] && token[i] != '\"' ; i++){
 		num = token[i];
 		if(!isalpha(num)){
-			fprintf(stderr, "Error detected in line [%d]: %c is not a character\n", lineNumber, token[i]);
+			reportError(lineNumber, INVALID_CHARACTER_DIAGNOSTIC, "%c is not a character", token[i]);
 			return 0;
 		}
 		dataArray[(*dc)++] = num;
@@ -202,6 +203,47 @@ int storeStructType(char *line, int* dataArray, int* dc, int lineNumber){
 	return 1;
 }
 
+/*
+ * Counts the words a .data statement occupies without converting the numbers
+ * Returns -1 if the line holds no numbers
+ */
+int countDataWords(char *line){
+	int words = 1;
+	for( ; isspace(*line) ; line++){
+	}
+	if(!(*line))
+		return -1;
+	for( ; *line ; line++){
+		words += (*line == ',');
+	}
+	return words;
+}
+
+/*
+ * Counts the words a .string statement occupies (including the terminating 0) without validating the characters
+ * Returns -1 if the line holds no string
+ */
+int countStringWords(char *line){
+	char *end;
+	line = strchr(line, '\"');
+	if(!line || !(end = strchr(line + 1, '\"')))
+		return -1;
+	return end - line;
+}
+
+/*
+ * Counts the words a .struct statement occupies - the number followed by the string
+ * Returns -1 if the line is missing either of them
+ */
+int countStructWords(char *line){
+	int stringWords;
+	char *comma = strchr(line, ',');
+	if(!comma)
+		return -1;
+	stringWords = countStringWords(comma);
+	return (stringWords < 0)? -1 : stringWords + 1;
+}
+
 Symbol* findSymbolInTable (char* name, Symbol* symTable){
 	Symbol* ptr = symTable;
 
@@ -59,6 +59,24 @@ int storeStringType(char *line, int* dataArray, int* dc, int lineNumber);
  */
 int storeStructType(char *line, int* dataArray, int* dc, int lineNumber);
 
+/*
+ * Counts the words a .data statement occupies without converting the numbers
+ * Returns -1 if the line holds no numbers
+ */
+int countDataWords(char *line);
+
+/*
+ * Counts the words a .string statement occupies (including the terminating 0) without validating the characters
+ * Returns -1 if the line holds no string
+ */
+int countStringWords(char *line);
+
+/*
+ * Counts the words a .struct statement occupies - the number followed by the string
+ * Returns -1 if the line is missing either of them
+ */
+int countStructWords(char *line);
+
 /*
  * Searching for the symbol name in the symbol table 
  * returns the symbol pointer if found, otherwise returns NULL
@@ -0,0 +1,431 @@
+/*
+ * diagnostics.c
+ * 		module reports errors and warnings found in the source code
+ * 		either in the human readable form, in a stable machine readable form: "[file]:[line]: error: [message]"
+ * 		or as JSON records, one per line
+ *
+ * 		Diagnostics and progress messages are collected as records into a buffer - each record keeps the format
+ * 		it was reported with and a copy of its arguments (strings copied into a single growing text buffer) -
+ * 		and are only formatted and written when flushed (by the end of every file, or once the buffer holds
+ * 		DIAGNOSTICS_BUFFER_RECORDS records).
+ * 		Standard error is unbuffered, so what goes there is gathered into chunks written at once.
+ * 		Messages are cut at MAX_DIAGNOSTIC_LENGTH, since they may hold file paths of any length.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "diagnostics.h"
+#include "json.h"
+
+#define DIAGNOSTICS_BUFFER_RECORDS 4096
+#define INITIAL_TEXT_CAPACITY 4096
+#define ERROR_CHUNK_LENGTH 8192
+#define MAX_DIAGNOSTIC_PREFIX_LENGTH 64	/* the line number and severity written before a message */
+#define MAX_CONVERSION_LENGTH 16		/* a single conversion of a format, such as "%-12s" */
+#define CONVERSION_FLAGS "-+ #0123456789."
+
+enum recordKind { ERROR_RECORD, WARNING_RECORD, PROGRESS_RECORD, SUMMARY_RECORD };
+
+typedef struct DiagnosticRecord {
+	int kind;			/* enum recordKind */
+	int lineNumber;
+	int code;			/* enum diagnosticCodes */
+	size_t source;		/* offset of the file name in the text buffer */
+	char *format;		/* the format the message was reported with */
+	int arguments;		/* index of the first of its arguments in the argument buffer */
+} DiagnosticRecord;
+
+/* an argument of a format, copied when reported */
+typedef union DiagnosticArgument {
+	long integer;		/* %d, %i and %c */
+	double real;		/* %f */
+	size_t string;		/* %s - offset of the copied string in the text buffer */
+} DiagnosticArgument;
+
+static char *diagnosticNames[NUM_OF_DIAGNOSTIC_CODES] = {
+		"operand-count", "unknown-command", "incompatible-operand", "immediate-bounds", "struct-field",
+		"invalid-immediate", "unknown-size", "line-length", "directive-in-macro", "macro-length", "macro-name",
+		"unclosed-macro", "unclosed-conditional", "unmatched-conditional", "conditional-symbol", "conditional-depth",
+		"label-name", "ignored-label", "duplicate-label", "unknown-label", "undefined-entry", "library-name",
+		"unknown-library", "duplicate-macro", "library-content", "missing-data", "illegal-comma", "invalid-number",
+		"invalid-character", "memory-fit", "progress", "summary"
+};
+
+static int diagnosticsFormat = HUMAN_DIAGNOSTICS;
+static char *diagnosticsSource = "";
+static int errorCount = 0;
+static int maxErrors = 0;
+static int quiet = 0;
+static DiagnosticsHandler diagnosticsHandler = NULL;
+
+static DiagnosticRecord *records = NULL;
+static int recordCount = 0;
+static int recordCapacity = 0;
+static DiagnosticArgument *arguments = NULL;
+static int argumentCount = 0;
+static int argumentCapacity = 0;
+static char *text = NULL;
+static size_t textLength = 0;
+static size_t textCapacity = 0;
+static size_t sourceOffset = 0;		/* offset of the current file name in the text buffer */
+static int sourceStored = 0;		/* the current file name is in the text buffer */
+
+static char errorChunk[ERROR_CHUNK_LENGTH];
+static size_t errorChunkLength = 0;
+
+void reportDiagnostic(int isError, int lineNumber, int code, char *format, va_list args);
+void storeRecord(int kind, int lineNumber, int code, char *format, va_list args);
+void storeArguments(char *format, va_list args);
+void formatMessage(char *message, char *format, va_list args);
+void formatRecord(char *message, DiagnosticRecord *record);
+char* endOfConversion(char *conversion);
+size_t storeText(char *string);
+void writeRecord(DiagnosticRecord *record, FILE **lastStream);
+void writeToStream(FILE *stream, char *string);
+void writeError(char *string);
+void drainErrors(void);
+
+/*
+ * Sets the format of the reported diagnostics (using enum diagnosticsFormat)
+ */
+void setDiagnosticsFormat(int format){
+	diagnosticsFormat = format;
+}
+
+/*
+ * Sets the name of the file the following diagnostics refer to (the string is not copied)
+ */
+void setDiagnosticsSource(char *fileName){
+	diagnosticsSource = (fileName)? fileName : "";
+	sourceStored = 0;
+}
+
+/*
+ * Hands the following diagnostics to handler instead of printing them (NULL to print them again)
+ */
+void setDiagnosticsHandler(DiagnosticsHandler handler){
+	diagnosticsHandler = handler;
+}
+
+/*
+ * Sets the amount of errors after which isErrorLimitReached tells the passes to stop (0 for no limit)
+ */
+void setMaxErrors(int limit){
+	maxErrors = limit;
+}
+
+/*
+ * Sets whether progress messages are suppressed
+ */
+void setQuiet(int isQuiet){
+	quiet = isQuiet;
+}
+
+/*
+ * Reports an error of the code (enum diagnosticCodes) in the given line, the message is formatted like printf
+ * when flushed
+ */
+void reportError(int lineNumber, int code, char *format, ...){
+	va_list args;
+	va_start(args, format);
+	reportDiagnostic(1, lineNumber, code, format, args);
+	va_end(args);
+}
+
+/*
+ * Reports a warning of the code (enum diagnosticCodes) in the given line, formatted like the message of reportError
+ */
+void reportWarning(int lineNumber, int code, char *format, ...){
+	va_list args;
+	va_start(args, format);
+	reportDiagnostic(0, lineNumber, code, format, args);
+	va_end(args);
+}
+
+/*
+ * Reports the progress of the assembler (printed to stdout unless quiet or reporting JSON),
+ * formatted like the message of reportError
+ */
+void reportProgress(char *format, ...){
+	va_list args;
+	if(quiet || diagnosticsFormat == JSON_DIAGNOSTICS || diagnosticsHandler)
+		return;
+	va_start(args, format);
+	storeRecord(PROGRESS_RECORD, 0, PROGRESS_DIAGNOSTIC, format, args);
+	va_end(args);
+}
+
+/*
+ * Reports the outcome of a failed operation (printed to stderr even when quiet),
+ * formatted like the message of reportError
+ */
+void reportSummary(char *format, ...){
+	va_list args;
+	if(diagnosticsHandler)
+		return;
+	va_start(args, format);
+	storeRecord(SUMMARY_RECORD, 0, SUMMARY_DIAGNOSTIC, format, args);
+	va_end(args);
+}
+
+/*
+ * Collects a single diagnostic - once the error limit is reached the following diagnostics are dropped
+ * (diagnostics handed to a handler are never limited)
+ */
+void reportDiagnostic(int isError, int lineNumber, int code, char *format, va_list args){
+	char message[MAX_DIAGNOSTIC_LENGTH];
+	if(diagnosticsHandler){
+		formatMessage(message, format, args);
+		diagnosticsHandler(isError, lineNumber, message);
+		return;
+	}
+	if(isErrorLimitReached())
+		return;
+	if(isError)
+		errorCount++;
+	storeRecord((isError)? ERROR_RECORD : WARNING_RECORD, lineNumber, code, format, args);
+	if(isErrorLimitReached())
+		reportSummary("too many errors in %s, stopping after %d", (*diagnosticsSource)? diagnosticsSource : "the file", maxErrors);
+}
+
+/*
+ * Returns 1 if the amount of errors reached the limit set by setMaxErrors, otherwise 0
+ */
+int isErrorLimitReached(void){
+	return maxErrors > 0 && errorCount >= maxErrors;
+}
+
+/*
+ * Formats and writes every collected record, emptying the buffer
+ */
+void flushDiagnostics(void){
+	FILE *lastStream = NULL;
+	int i;
+	for(i = 0; i < recordCount; i++)
+		writeRecord(&records[i], &lastStream);
+	drainErrors();
+	recordCount = 0;
+	argumentCount = 0;
+	textLength = 0;
+	sourceStored = 0;
+}
+
+/*
+ * Returns the amount of errors reported since the last call to resetDiagnostics
+ */
+int getErrorCount(void){
+	return errorCount;
+}
+
+void resetDiagnostics(void){
+	errorCount = 0;
+}
+
+/*
+ * Adds a record with its format and a copy of its arguments to the buffer, flushing the buffer when it is full
+ */
+void storeRecord(int kind, int lineNumber, int code, char *format, va_list args){
+	DiagnosticRecord *record;
+
+	if(recordCount == recordCapacity){
+		recordCapacity = (recordCapacity)? recordCapacity * 2 : 64;
+		records = (DiagnosticRecord*)realloc(records, sizeof(DiagnosticRecord) * recordCapacity);
+	}
+	if(!sourceStored){
+		sourceOffset = storeText(diagnosticsSource);
+		sourceStored = 1;
+	}
+	record = &records[recordCount++];
+	record->kind = kind;
+	record->lineNumber = lineNumber;
+	record->code = code;
+	record->source = sourceOffset;
+	record->format = format;
+	record->arguments = argumentCount;
+	storeArguments(format, args);
+	if(recordCount >= DIAGNOSTICS_BUFFER_RECORDS)
+		flushDiagnostics();
+}
+
+/*
+ * Copies the arguments of every conversion of the format to the argument buffer
+ */
+void storeArguments(char *format, va_list args){
+	DiagnosticArgument argument;
+	char *conversion;
+
+	for(conversion = strchr(format, '%'); conversion; conversion = strchr(conversion + 1, '%')){
+		conversion = endOfConversion(conversion);
+		if(*conversion == 's')
+			argument.string = storeText(va_arg(args, char*));
+		else if(*conversion == 'f')
+			argument.real = va_arg(args, double);
+		else if(*conversion != '%')
+			argument.integer = (conversion[-1] == 'l')? va_arg(args, long) : va_arg(args, int);
+		else
+			continue;
+		if(argumentCount == argumentCapacity){
+			argumentCapacity = (argumentCapacity)? argumentCapacity * 2 : 64;
+			arguments = (DiagnosticArgument*)realloc(arguments, sizeof(DiagnosticArgument) * argumentCapacity);
+		}
+		arguments[argumentCount++] = argument;
+	}
+}
+
+/*
+ * Formats the message like printf into a buffer of MAX_DIAGNOSTIC_LENGTH characters,
+ * ending a message too long for it with "..."
+ */
+void formatMessage(char *message, char *format, va_list args){
+	if(vsnprintf(message, MAX_DIAGNOSTIC_LENGTH, format, args) >= MAX_DIAGNOSTIC_LENGTH)
+		strcpy(message + MAX_DIAGNOSTIC_LENGTH - 4, "...");
+}
+
+/*
+ * Formats the message of the record from its format and stored arguments, like formatMessage
+ */
+void formatRecord(char *message, DiagnosticRecord *record){
+	char conversion[MAX_CONVERSION_LENGTH];
+	char *running = record->format, *end;
+	DiagnosticArgument *argument = arguments + record->arguments;
+	size_t length = 0;
+	int written;
+
+	while(*running && length < MAX_DIAGNOSTIC_LENGTH){
+		if(*running != '%'){
+			message[length++] = *running++;
+			continue;
+		}
+		end = endOfConversion(running);
+		sprintf(conversion, "%.*s", (int)(end - running + 1), running);
+		if(*end == 's')
+			written = snprintf(message + length, MAX_DIAGNOSTIC_LENGTH - length, conversion, text + (argument++)->string);
+		else if(*end == 'f')
+			written = snprintf(message + length, MAX_DIAGNOSTIC_LENGTH - length, conversion, (argument++)->real);
+		else if(*end == '%')
+			written = snprintf(message + length, MAX_DIAGNOSTIC_LENGTH - length, "%%");
+		else if(end[-1] == 'l')
+			written = snprintf(message + length, MAX_DIAGNOSTIC_LENGTH - length, conversion, (argument++)->integer);
+		else
+			written = snprintf(message + length, MAX_DIAGNOSTIC_LENGTH - length, conversion, (int)(argument++)->integer);
+		length += written;
+		running = end + 1;
+	}
+	if(length >= MAX_DIAGNOSTIC_LENGTH)
+		strcpy(message + MAX_DIAGNOSTIC_LENGTH - 4, "...");
+	else
+		message[length] = '\0';
+}
+
+/*
+ * Returns the character ending the conversion starting at the '%'
+ */
+char* endOfConversion(char *conversion){
+	conversion += 1 + strspn(conversion + 1, CONVERSION_FLAGS);
+	return (*conversion == 'l')? conversion + 1 : conversion;
+}
+
+/*
+ * Copies the string to the end of the text buffer
+ * Returns its offset in the buffer
+ */
+size_t storeText(char *string){
+	size_t length = strlen(string) + 1, offset = textLength;
+	if(textLength + length > textCapacity){
+		textCapacity = (textCapacity)? textCapacity : INITIAL_TEXT_CAPACITY;
+		while(textLength + length > textCapacity)
+			textCapacity *= 2;
+		text = (char*)realloc(text, textCapacity);
+	}
+	memcpy(text + textLength, string, length);
+	textLength += length;
+	return offset;
+}
+
+/*
+ * Writes a single record in the configured format - errors and summaries of the human readable form go to stderr,
+ * summaries of the machine readable form go to stderr, everything else goes to stdout (keeping its order)
+ * an invalid immediate value was always reported to stdout, and still is
+ */
+void writeRecord(DiagnosticRecord *record, FILE **lastStream){
+	char prefix[MAX_DIAGNOSTIC_PREFIX_LENGTH], message[MAX_DIAGNOSTIC_LENGTH];
+	char *source = text + record->source;
+	FILE *stream = stdout;
+
+	formatRecord(message, record);
+	if(record->kind == SUMMARY_RECORD && diagnosticsFormat != JSON_DIAGNOSTICS)
+		stream = stderr;
+	else if(record->kind == ERROR_RECORD && diagnosticsFormat == HUMAN_DIAGNOSTICS && record->code != INVALID_IMMEDIATE_DIAGNOSTIC)
+		stream = stderr;
+	/* the streams are switched in order, so interleaved output still appears in order on a terminal */
+	if(*lastStream && stream != *lastStream){
+		if(*lastStream == stdout)
+			fflush(stdout);
+		else
+			drainErrors();
+	}
+	*lastStream = stream;
+
+	if(diagnosticsFormat == JSON_DIAGNOSTICS){
+		fputs("{\"file\":", stdout);
+		writeJsonString(stdout, source);
+		fprintf(stdout, ",\"line\":%d,\"severity\":\"%s\",\"code\":", record->lineNumber,
+				(record->kind == ERROR_RECORD)? "error" : (record->kind == WARNING_RECORD)? "warning" : "note");
+		writeJsonString(stdout, diagnosticNames[record->code]);
+		fputs(",\"message\":", stdout);
+		writeJsonString(stdout, message);
+		fputs("}\n", stdout);
+		return;
+	}
+	/* the source is written on its own, as a file path it may be of any length */
+	*prefix = '\0';
+	if(record->kind == ERROR_RECORD || record->kind == WARNING_RECORD){
+		if(diagnosticsFormat == MACHINE_DIAGNOSTICS){
+			writeToStream(stream, source);
+			sprintf(prefix, ":%d: %s: ", record->lineNumber, (record->kind == ERROR_RECORD)? "error" : "warning");
+		}
+		else if(record->kind == ERROR_RECORD)
+			sprintf(prefix, "Error detected in line [%d]: ", record->lineNumber);
+		else
+			sprintf(prefix, "Warning: in line [%d], ", record->lineNumber);
+	}
+	writeToStream(stream, prefix);
+	writeToStream(stream, message);
+	writeToStream(stream, "\n");
+}
+
+/*
+ * Writes the string to stdout, or adds it to the chunk written to stderr
+ */
+void writeToStream(FILE *stream, char *string){
+	if(stream == stderr)
+		writeError(string);
+	else
+		fputs(string, stdout);
+}
+
+/*
+ * Adds the string to the chunk written to stderr
+ */
+void writeError(char *string){
+	size_t length = strlen(string);
+	if(errorChunkLength + length > ERROR_CHUNK_LENGTH)
+		drainErrors();
+	if(length > ERROR_CHUNK_LENGTH){
+		fputs(string, stderr);
+		return;
+	}
+	memcpy(errorChunk + errorChunkLength, string, length);
+	errorChunkLength += length;
+}
+
+/*
+ * Writes the gathered chunk to stderr
+ */
+void drainErrors(void){
+	if(errorChunkLength)
+		fwrite(errorChunk, 1, errorChunkLength, stderr);
+	errorChunkLength = 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * diagnostics.h
+ * 		module reports errors and warnings found in the source code
+ * 		either in the human readable form, in a stable machine readable form: "[file]:[line]: error: [message]"
+ * 		or as JSON records, one per line
+ * 		diagnostics are collected into a buffer and only written when flushed
+ */
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#define MAX_DIAGNOSTIC_LENGTH 512
+
+enum diagnosticsFormat { HUMAN_DIAGNOSTICS, MACHINE_DIAGNOSTICS, JSON_DIAGNOSTICS };
+
+/* the stable codes identifying the kind of a diagnostic (written as the "code" of JSON records) */
+enum diagnosticCodes { OPERAND_COUNT_DIAGNOSTIC, UNKNOWN_COMMAND_DIAGNOSTIC, INCOMPATIBLE_OPERAND_DIAGNOSTIC,
+	IMMEDIATE_BOUNDS_DIAGNOSTIC, STRUCT_FIELD_DIAGNOSTIC, INVALID_IMMEDIATE_DIAGNOSTIC, UNKNOWN_SIZE_DIAGNOSTIC,
+	LINE_LENGTH_DIAGNOSTIC, DIRECTIVE_IN_MACRO_DIAGNOSTIC, MACRO_LENGTH_DIAGNOSTIC, MACRO_NAME_DIAGNOSTIC,
+	UNCLOSED_MACRO_DIAGNOSTIC, UNCLOSED_CONDITIONAL_DIAGNOSTIC, UNMATCHED_CONDITIONAL_DIAGNOSTIC,
+	CONDITIONAL_SYMBOL_DIAGNOSTIC, CONDITIONAL_DEPTH_DIAGNOSTIC, LABEL_NAME_DIAGNOSTIC, IGNORED_LABEL_DIAGNOSTIC,
+	DUPLICATE_LABEL_DIAGNOSTIC, UNKNOWN_LABEL_DIAGNOSTIC, UNDEFINED_ENTRY_DIAGNOSTIC, LIBRARY_NAME_DIAGNOSTIC,
+	UNKNOWN_LIBRARY_DIAGNOSTIC, DUPLICATE_MACRO_DIAGNOSTIC, LIBRARY_CONTENT_DIAGNOSTIC, MISSING_DATA_DIAGNOSTIC,
+	ILLEGAL_COMMA_DIAGNOSTIC, INVALID_NUMBER_DIAGNOSTIC, INVALID_CHARACTER_DIAGNOSTIC, MEMORY_FIT_DIAGNOSTIC,
+	PROGRESS_DIAGNOSTIC, SUMMARY_DIAGNOSTIC, NUM_OF_DIAGNOSTIC_CODES };
+
+/* receives the formatted diagnostics instead of them being printed */
+typedef void (*DiagnosticsHandler)(int isError, int lineNumber, char *message);
+
+/*
+ * Sets the format of the reported diagnostics (using enum diagnosticsFormat)
+ */
+void setDiagnosticsFormat(int format);
+
+/*
+ * Sets the name of the file the following diagnostics refer to (the string is not copied)
+ */
+void setDiagnosticsSource(char *fileName);
+
+/*
+ * Hands the following diagnostics to handler instead of printing them (NULL to print them again)
+ */
+void setDiagnosticsHandler(DiagnosticsHandler handler);
+
+/*
+ * Sets the amount of errors after which isErrorLimitReached tells the passes to stop (0 for no limit)
+ */
+void setMaxErrors(int limit);
+
+/*
+ * Sets whether progress messages are suppressed
+ */
+void setQuiet(int isQuiet);
+
+/*
+ * Reports an error of the code (enum diagnosticCodes) in the given line, the message is formatted like printf
+ * when flushed - the format must outlive the flush and only use %d, %i, %c, %s and %f (with flags, width,
+ * precision and l) and %%
+ */
+void reportError(int lineNumber, int code, char *format, ...);
+
+/*
+ * Reports a warning of the code (enum diagnosticCodes) in the given line, formatted like the message of reportError
+ */
+void reportWarning(int lineNumber, int code, char *format, ...);
+
+/*
+ * Reports the progress of the assembler (printed to stdout unless quiet or reporting JSON),
+ * formatted like the message of reportError
+ */
+void reportProgress(char *format, ...);
+
+/*
+ * Reports the outcome of a failed operation (printed to stderr even when quiet),
+ * formatted like the message of reportError
+ */
+void reportSummary(char *format, ...);
+
+/*
+ * Returns 1 if the amount of errors reached the limit set by setMaxErrors, otherwise 0
+ */
+int isErrorLimitReached(void);
+
+/*
+ * Formats and writes every collected record, emptying the buffer
+ */
+void flushDiagnostics(void);
+
+/*
+ * Returns the amount of errors reported since the last call to resetDiagnostics
+ */
+int getErrorCount(void);
+
+void resetDiagnostics(void);
+
+#endif
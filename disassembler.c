@@ -0,0 +1,84 @@
+/*
+ * disassembler.c
+ * 		the disassembler - writes assembled programs back as assembly (see disassembly.h)
+ *
+ * 		Usage: disassembler [--stats] [--memory N] [--load-address N] [--word-width N] program...
+ * 		Programs are given by the name of their files (without extension), their disassembly is written to the
+ * 		standard output one after the other. --stats reports the rate of reading the object files.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include "disassembly.h"
+#include "object.h"
+#include "geometry.h"
+#include "utilities.h"
+
+long getFileSize(char *name, char *extension);
+
+int main(int argc, char **argv){
+	ObjectModule *module;
+	Disassembly *disassembly;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, stats = 0, programs = 0, success = 1;
+	long bytes = 0;
+	clock_t start, reading = 0;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "--stats") == 0)
+			stats = 1;
+		else if(argv[i][0] == '-'){
+			fprintf(stderr,"Error: unknown option '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			programs++;
+	}
+	if(success && !programs){
+		fprintf(stderr,"Usage: disassembler [--stats] [--memory N] [--load-address N] [--word-width N] program...\n");
+		success = 0;
+	}
+	if(!success || !setGeometry(geometry[0], geometry[1], geometry[2]))
+		return 1;
+
+	for(i = 1; i < argc; i++){
+		if(argv[i][0] == '-'){
+			i += strcmp(argv[i], "--stats") != 0;
+			continue;
+		}
+		start = clock();
+		module = readObjectModule(argv[i]);
+		reading += clock() - start;
+		if(!module){
+			success = 0;
+			continue;
+		}
+		bytes += getFileSize(argv[i], "ob");
+		disassembly = createDisassembly(module);
+		writeDisassembly(disassembly, stdout);
+		destroyDisassembly(disassembly);
+		destroyObjectModule(module);
+	}
+	if(stats)
+		fprintf(stderr,"read %ld bytes of object files in %.3f seconds (%.1f megabytes per second)\n",bytes,
+				(double)reading / CLOCKS_PER_SEC,(reading)? bytes / 1e6 / ((double)reading / CLOCKS_PER_SEC) : 0.0);
+	return !success;
+}
+
+/*
+ * Returns the size of "[name].[extension]" in bytes, 0 if it can't be read
+ */
+long getFileSize(char *name, char *extension){
+	char *url = constructUrl(name, extension);
+	FILE *file = fopen(url, "r");
+	long size = 0;
+	if(file && fseek(file, 0, SEEK_END) == 0)
+		size = ftell(file);
+	if(file)
+		fclose(file);
+	free(url);
+	return size;
+}
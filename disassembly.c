@@ -0,0 +1,194 @@
+/*
+ * disassembly.c
+ * 		module renders assembled programs back to assembly - the instructions of the code with the names
+ * 		of the labels they reference, taken from the entries and extern references of the program
+ *
+ * 		A word referencing an extern is named by the extern reference of its address, a relocatable word by the
+ * 		entry at the address it holds - or "L[address]" for an address no entry names. The data segment doesn't
+ * 		record the statements it was assembled from, so it is written as .data statements (split at labels).
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "disassembly.h"
+#include "instruction.h"
+#include "geometry.h"
+
+#define DATA_PER_LINE 10
+
+void nameReferences(Disassembly *disassembly);
+void formatOperand(Disassembly *disassembly, int offset, DecodedOperand *operand, char *text);
+void writeEntries(FILE *file, ObjectSymbol *entries);
+
+/*
+ * Names the words of the module - entries by their names, other addresses the code references by "L[address]"
+ * Returns the disassembly of the module (which must outlive it)
+ */
+Disassembly* createDisassembly(ObjectModule *module){
+	Disassembly *disassembly = (Disassembly*)malloc(sizeof(Disassembly));
+	int length = module->codeLength + module->dataLength, offset;
+	ObjectSymbol *symbol;
+
+	disassembly->module = module;
+	disassembly->labels = (char(*)[MAX_LABEL_NAME_LENGTH])calloc(length + 1, MAX_LABEL_NAME_LENGTH);
+	disassembly->externs = (char**)calloc(length + 1, sizeof(char*));
+	for(symbol = module->entries; symbol; symbol = symbol->next){
+		if((offset = symbol->address - getLoadAddress()) >= 0 && offset < length)
+			strcpy(disassembly->labels[offset], symbol->name);
+	}
+	for(symbol = module->externs; symbol; symbol = symbol->next){
+		if((offset = symbol->address - getLoadAddress()) >= 0 && offset < length)
+			disassembly->externs[offset] = symbol->name;
+	}
+	nameReferences(disassembly);
+	return disassembly;
+}
+
+/*
+ * Names the addresses the operands of the code reference which no entry names
+ */
+void nameReferences(Disassembly *disassembly){
+	ObjectModule *module = disassembly->module;
+	int offset = 0, target, isDestination;
+	Instruction instruction;
+	DecodedOperand *operand;
+
+	while(offset < module->codeLength){
+		if(!decodeInstruction(module->words + offset, module->codeLength - offset, &instruction)){
+			offset++;
+			continue;
+		}
+		for(isDestination = (instruction.operandCount < 2); isDestination <= (instruction.operandCount > 0); isDestination++){
+			operand = (isDestination)? &instruction.dst : &instruction.src;
+			if((operand->mode != DIRECT_MODE && operand->mode != STRUCT_MODE)
+					|| (module->words[offset + operand->wordOffset] & ARE_MASK) != RELOCATABLE_ARE)
+				continue;
+			target = operand->value - getLoadAddress();
+			if(target >= 0 && target < module->codeLength + module->dataLength && !disassembly->labels[target][0])
+				sprintf(disassembly->labels[target], "L%d", operand->value);
+		}
+		offset += instruction.length;
+	}
+}
+
+/*
+ * Writes the instruction at the address to text (at least MAX_INSTRUCTION_TEXT characters), without its label
+ * Returns the amount of words of the instruction or 0 if the words at the address aren't an instruction
+ */
+int formatInstruction(Disassembly *disassembly, int address, char *text){
+	ObjectModule *module = disassembly->module;
+	int offset = address - getLoadAddress();
+	Instruction instruction;
+
+	if(offset < 0 || offset >= module->codeLength
+			|| !decodeInstruction(module->words + offset, module->codeLength - offset, &instruction))
+		return 0;
+	text += sprintf(text, "%s", getMnemonic(instruction.opCode));
+	if(instruction.operandCount == 2){
+		*text++ = ' ';
+		formatOperand(disassembly, offset, &instruction.src, text);
+		text += strlen(text);
+		*text++ = ',';
+	}
+	if(instruction.operandCount >= 1){
+		*text++ = ' ';
+		formatOperand(disassembly, offset, &instruction.dst, text);
+	}
+	return instruction.length;
+}
+
+/*
+ * Writes the operand of the instruction at offset of the module to text
+ */
+void formatOperand(Disassembly *disassembly, int offset, DecodedOperand *operand, char *text){
+	int wordOffset = offset + operand->wordOffset, target = operand->value - getLoadAddress();
+	char *name = NULL;
+
+	switch(operand->mode){
+		case IMMEDIATE_MODE:
+			sprintf(text, "#%d", operand->value);
+			return;
+		case REGISTER_MODE:
+			sprintf(text, "r%d", operand->value);
+			return;
+	}
+	if((disassembly->module->words[wordOffset] & ARE_MASK) == EXTERNAL_ARE)
+		name = (disassembly->externs[wordOffset])? disassembly->externs[wordOffset] : "?";
+	else if(target >= 0 && target < disassembly->module->codeLength + disassembly->module->dataLength)
+		name = disassembly->labels[target];
+	if(name)
+		text += sprintf(text, "%s", name);
+	else
+		text += sprintf(text, "L%d", operand->value);
+	if(operand->mode == STRUCT_MODE)
+		sprintf(text, ".%d", operand->field);
+}
+
+/*
+ * Writes the program as assembly - its entries and externs, a line per instruction and the data as .data statements
+ */
+void writeDisassembly(Disassembly *disassembly, FILE *file){
+	ObjectModule *module = disassembly->module;
+	int offset, length, start = 0, value, signBit = 1 << (getWordWidth() - 1);
+	char text[MAX_INSTRUCTION_TEXT];
+	ObjectSymbol *symbol, *previous;
+
+	fprintf(file,"; %s: %d code words, %d data words\n",module->name,module->codeLength,module->dataLength);
+	writeEntries(file, module->entries);
+	for(symbol = module->externs; symbol; symbol = symbol->next){
+		for(previous = module->externs; previous != symbol && strcmp(previous->name, symbol->name) != 0; previous = previous->next)
+			;
+		if(previous == symbol)
+			fprintf(file,".extern %s\n",symbol->name);
+	}
+
+	for(offset = 0; offset < module->codeLength; offset += (length)? length : 1){
+		if(disassembly->labels[offset][0])
+			fprintf(file,"%s: ",disassembly->labels[offset]);
+		else
+			fputc('\t', file);
+		if((length = formatInstruction(disassembly, getLoadAddress() + offset, text)) != 0)
+			fprintf(file,"%s\n",text);
+		else
+			fprintf(file,"; %d isn't an instruction\n",getLoadAddress() + offset);
+	}
+	/* data words are two's complement numbers of the width of the word */
+	for(; offset < module->codeLength + module->dataLength; offset++){
+		value = (module->words[offset] & signBit)? module->words[offset] - (signBit << 1) : module->words[offset];
+		if(offset == module->codeLength || disassembly->labels[offset][0] || offset - start == DATA_PER_LINE){
+			if(offset > module->codeLength)
+				fputc('\n', file);
+			if(disassembly->labels[offset][0])
+				fprintf(file,"%s: ",disassembly->labels[offset]);
+			else
+				fputc('\t', file);
+			fprintf(file,".data %d",value);
+			start = offset;
+		}
+		else
+			fprintf(file,", %d",value);
+	}
+	if(module->dataLength)
+		fputc('\n', file);
+}
+
+/*
+ * Writes the entries in reverse - the order the assembler writes them in is the reverse of their declarations
+ */
+void writeEntries(FILE *file, ObjectSymbol *entries){
+	if(!entries)
+		return;
+	writeEntries(file, entries->next);
+	fprintf(file,".entry %s\n",entries->name);
+}
+
+/*
+ * Frees space dynamically allocated to the disassembly
+ */
+void destroyDisassembly(Disassembly *disassembly){
+	if(!disassembly)
+		return;
+	free(disassembly->labels);
+	free(disassembly->externs);
+	free(disassembly);
+}
@@ -0,0 +1,42 @@
+/*
+ * disassembly.h
+ * 		module renders assembled programs back to assembly - the instructions of the code with the names
+ * 		of the labels they reference, taken from the entries and extern references of the program
+ */
+#ifndef DISASSEMBLY_H
+#define DISASSEMBLY_H
+#include <stdio.h>
+#include "object.h"
+#include "constraints.h"
+
+#define MAX_INSTRUCTION_TEXT (MAX_LABEL_NAME_LENGTH * 2 + 16)
+
+typedef struct Disassembly {
+	ObjectModule *module;
+	char (*labels)[MAX_LABEL_NAME_LENGTH];	/* the label of every word of the module, empty if none */
+	char **externs;							/* the name of the extern every word references, NULL if none */
+} Disassembly;
+
+/*
+ * Names the words of the module - entries by their names, other addresses the code references by "L[address]"
+ * Returns the disassembly of the module (which must outlive it)
+ */
+Disassembly* createDisassembly(ObjectModule *module);
+
+/*
+ * Writes the instruction at the address to text (at least MAX_INSTRUCTION_TEXT characters), without its label
+ * Returns the amount of words of the instruction or 0 if the words at the address aren't an instruction
+ */
+int formatInstruction(Disassembly *disassembly, int address, char *text);
+
+/*
+ * Writes the program as assembly - its entries and externs, a line per instruction and the data as .data statements
+ */
+void writeDisassembly(Disassembly *disassembly, FILE *file);
+
+/*
+ * Frees space dynamically allocated to the disassembly
+ */
+void destroyDisassembly(Disassembly *disassembly);
+
+#endif
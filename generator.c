@@ -0,0 +1,451 @@
+/*
+ * generator.c
+ * 		the generator - writes a synthetic assembler program, a deterministic one for every seed, to benchmark
+ * 		the assembler on (see bench.sh)
+ *
+ * 		Usage: generator [--lines N] [--labels P] [--macros P] [--data P] [--mix D,S,T] [--seed N]
+ * 				[--memory N] [--load-address N] [--word-width N] name
+ * 		Writes "[name].as" of exactly N lines (1000 by default): externs and entries, macro definitions, the code
+ * 		and then the data, with comments and blank lines in between. P percent of the statements are labelled
+ * 		(--labels, 20 by default), of the code statements invoke a macro (--macros, 10 by default) and of all
+ * 		the statements are data (--data, 25 by default) - .data, .string and .struct statements weighed by the
+ * 		mix (5,3,2 by default). The code jumps to the code labels and externs and works on the data labels and
+ * 		registers, so the program assembles for the given geometry - the generator fails if it needs more words
+ * 		than the memory has, leaving no file behind.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "object.h"
+#include "instruction.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+#define DEFAULT_LINES 1000
+#define DEFAULT_LABELS 20
+#define DEFAULT_MACROS 10
+#define DEFAULT_DATA 25
+#define COMMENT_RATE 4				/* percent of the lines which are comments */
+#define BLANK_RATE 2				/* percent of the lines which are blank */
+#define LINES_PER_DECLARATION 400	/* an extern and an entry are declared for every that many lines */
+#define LINES_PER_MACRO 1000		/* a macro is defined for every that many lines */
+#define MAX_MACROS 64
+#define MAX_MACRO_BODY 4			/* lines in the body of a macro (at least 2) */
+#define MAX_DATA_NUMBERS 6
+#define MAX_STRING_LENGTH 20
+
+enum generatedOperands { IMMEDIATE_OPERAND, LABEL_OPERAND, STRUCT_OPERAND, REGISTER_OPERAND };
+enum dataKinds { DATA_KIND, STRING_KIND, STRUCT_KIND, NUM_OF_DATA_KINDS };
+
+/* the instructions the code is made of, weighed by how common they are in programs */
+static char *generatedCommands[] = {
+		"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc",
+		"dec", "jmp", "bne", "get", "prn", "jsr", "rts"
+};
+static int commandWeights[] = { 25, 8, 8, 5, 2, 3, 4, 6, 5, 6, 8, 2, 5, 6, 3 };
+#define NUM_OF_GENERATED_COMMANDS 15
+
+static char *commentLines[] = { "; loop over the table", "; keep the counter in a register", "; check the result",
+		"; call the routine", "; move on to the next entry", "; restore the registers" };
+#define NUM_OF_COMMENTS 6
+
+/* what the program is made of */
+typedef struct Program {
+	long lines;
+	int labels, macros, data;
+	int mix[NUM_OF_DATA_KINDS];
+	int externs, entries;
+	int macroCount;
+	int macroLines[MAX_MACROS];		/* lines in the body of every macro */
+	int macroWords[MAX_MACROS];		/* words the expansion of every macro takes */
+	long codeStatements, dataStatements;
+	long codeLabels, dataLabels;
+	char *dataLabelKinds;			/* enum dataKinds of the statement every data label is on */
+	long comments, blanks;
+	long words;						/* words the program takes */
+	int limit;						/* largest number the immediates and data hold */
+} Program;
+
+static unsigned long generatorState;
+
+/* private functions declaration */
+
+int nextRandom(long bound);
+int parsePercent(char *option, char *value, int *percent);
+int parseMix(char *value, int *mix);
+int pickWeighted(int *weights, int count);
+long labelPosition(long label, long labels, long statements);
+void planProgram(Program *program);
+int writeProgram(Program *program, FILE *file);
+void writeFiller(Program *program, FILE *file, long statementsLeft);
+int writeInstruction(Program *program, FILE *file, char *indent);
+int writeOperand(Program *program, FILE *file, int kind);
+int writeJumpTarget(Program *program, FILE *file);
+int writeDataStatement(Program *program, FILE *file, int kind);
+
+int main(int argc, char **argv){
+	Program program;
+	FILE *file;
+	char *name = NULL, *url;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, value, seed = 1, success = 1;
+
+	program.lines = DEFAULT_LINES;
+	program.labels = DEFAULT_LABELS;
+	program.macros = DEFAULT_MACROS;
+	program.data = DEFAULT_DATA;
+	program.mix[DATA_KIND] = 5;
+	program.mix[STRING_KIND] = 3;
+	program.mix[STRUCT_KIND] = 2;
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(i + 1 < argc && strcmp(argv[i], "--lines") == 0){
+			if(!(success = customAtoi(argv[++i], &value) && value > 0))
+				fprintf(stderr,"Error: '%s' is not a valid amount of lines\n",argv[i]);
+			program.lines = value;
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "--labels") == 0){
+			success = parsePercent(argv[i], argv[i + 1], &program.labels);
+			i++;
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "--macros") == 0){
+			success = parsePercent(argv[i], argv[i + 1], &program.macros);
+			i++;
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "--data") == 0){
+			success = parsePercent(argv[i], argv[i + 1], &program.data);
+			i++;
+		}
+		else if(i + 1 < argc && strcmp(argv[i], "--mix") == 0)
+			success = parseMix(argv[++i], program.mix);
+		else if(i + 1 < argc && strcmp(argv[i], "--seed") == 0){
+			if(!(success = customAtoi(argv[++i], &seed)))
+				fprintf(stderr,"Error: '%s' is not a valid seed\n",argv[i]);
+		}
+		else if(argv[i][0] == '-' || name){
+			fprintf(stderr,"Error: unexpected parameter '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			name = argv[i];
+	}
+	if(success && !name){
+		fprintf(stderr,"Usage: generator [--lines N] [--labels P] [--macros P] [--data P] [--mix D,S,T] [--seed N] [--memory N] [--load-address N] [--word-width N] name\n");
+		success = 0;
+	}
+	if(!success || !setGeometry(geometry[0], geometry[1], geometry[2]))
+		return 1;
+
+	generatorState = (unsigned long)seed;
+	planProgram(&program);
+	url = constructUrl(name, "as");
+	if(!(file = fopen(url, "w"))){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		success = 0;
+	}
+	else{
+		if(!(success = writeProgram(&program, file)))
+			fprintf(stderr,"Error: couldn't write file %s\n",url);
+		fclose(file);
+	}
+	/* the words are counted as the program is written, so a program too big is removed once written */
+	if(success && getLoadAddress() + program.words > getMemoryLength()){
+		fprintf(stderr,"Error: %s takes %ld words, more than the %d words of the memory from the load address\n",
+				url, program.words, getMemoryLength() - getLoadAddress());
+		success = 0;
+	}
+	if(!success && file)
+		remove(url);
+	free(url);
+	free(program.dataLabelKinds);
+	return !success;
+}
+
+/*
+ * Returns the next number of the generator, from 0 up to (not including) bound -
+ * the same sequence on every system for the same seed
+ */
+int nextRandom(long bound){
+	unsigned long value;
+	generatorState = (generatorState * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+	value = generatorState >> 16; /* the low bits of the generator repeat too soon */
+	if(bound > 0x7FFF){
+		generatorState = (generatorState * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+		value = (value << 15) ^ (generatorState >> 17);
+	}
+	return (int)(value % bound);
+}
+
+/*
+ * Stores the percent given to the option in percent
+ * Returns 1 if succeeded or 0 if the value isn't a percent
+ */
+int parsePercent(char *option, char *value, int *percent){
+	if(!customAtoi(value, percent) || *percent < 0 || *percent > 100){
+		fprintf(stderr,"Error: option '%s' requires a percent, '%s' is not one\n",option,value);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Stores the weights of the .data, .string and .struct statements given as "D,S,T" in mix
+ * Returns 1 if succeeded or 0 if the value isn't a valid mix
+ */
+int parseMix(char *value, int *mix){
+	char *end = value;
+	int i;
+	for(i = 0; i < NUM_OF_DATA_KINDS; i++){
+		mix[i] = (int)strtol(end, &end, 10);
+		if(mix[i] < 0 || *end != ((i < NUM_OF_DATA_KINDS - 1)? ',' : '\0'))
+			break;
+		end++;
+	}
+	if(i < NUM_OF_DATA_KINDS || mix[DATA_KIND] + mix[STRING_KIND] + mix[STRUCT_KIND] == 0){
+		fprintf(stderr,"Error: '%s' is not a valid mix of data statements (D,S,T)\n",value);
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Returns an index into the weights, picked in proportion to them
+ */
+int pickWeighted(int *weights, int count){
+	int i, total = 0, pick;
+	for(i = 0; i < count; i++)
+		total += weights[i];
+	pick = nextRandom(total);
+	for(i = 0; pick >= weights[i]; i++)
+		pick -= weights[i];
+	return i;
+}
+
+/*
+ * Returns the statement the label is on, the labels being spread evenly over the statements
+ */
+long labelPosition(long label, long labels, long statements){
+	return (long)((double)label * statements / labels);
+}
+
+/*
+ * Divides the lines of the program between its parts and decides the kinds of the labelled data statements,
+ * so every label the code refers to is known to be defined
+ */
+void planProgram(Program *program){
+	long statements, i;
+	int j, bodyLines = 0;
+
+	program->externs = (int)(1 + program->lines / LINES_PER_DECLARATION);
+	program->entries = program->externs;
+	program->macroCount = (int)(1 + program->lines / LINES_PER_MACRO);
+	if(program->macroCount > MAX_MACROS)
+		program->macroCount = MAX_MACROS;
+	for(j = 0; j < program->macroCount; j++)
+		bodyLines += program->macroLines[j] = 2 + nextRandom(MAX_MACRO_BODY - 1);
+	/* a program too short for them is only made of statements */
+	if(program->lines < 4 * (program->externs + program->entries + 2 * program->macroCount + bodyLines)){
+		program->externs = program->entries = program->macroCount = 0;
+		bodyLines = 0;
+	}
+	statements = program->lines - program->externs - program->entries - 2 * program->macroCount - bodyLines;
+	program->comments = statements * COMMENT_RATE / 100;
+	program->blanks = statements * BLANK_RATE / 100;
+	statements -= program->comments + program->blanks;
+	program->dataStatements = statements * program->data / 100;
+	program->codeStatements = statements - program->dataStatements;
+	if(program->codeStatements == 0){
+		/* the program ends with hlt */
+		program->codeStatements = 1;
+		program->dataStatements--;
+	}
+	program->codeLabels = program->codeStatements * program->labels / 100;
+	program->dataLabels = program->dataStatements * program->labels / 100;
+	if(program->entries > program->codeLabels)
+		program->entries = (int)program->codeLabels;
+	program->dataLabelKinds = (char*)malloc(program->dataLabels + 1);
+	for(i = 0; i < program->dataLabels; i++)
+		program->dataLabelKinds[i] = (char)pickWeighted(program->mix, NUM_OF_DATA_KINDS);
+	program->words = 0;
+	program->limit = ((1 << (getWordWidth() - 3)) - 1) / 2;
+}
+
+/*
+ * Writes the whole program, counting the words it takes
+ * Returns 1 if succeeded or 0 if the file couldn't be written
+ */
+int writeProgram(Program *program, FILE *file){
+	long i, label, statementsLeft = program->codeStatements + program->dataStatements;
+	int j, line, labelled;
+
+	for(j = 0; j < program->externs; j++)
+		fprintf(file, ".extern X%d\n", j);
+	for(j = 0; j < program->entries; j++)
+		fprintf(file, ".entry C%ld\n", labelPosition(j, program->entries, program->codeLabels));
+	for(j = 0; j < program->macroCount; j++){
+		fprintf(file, "macro M%d\n", j);
+		for(program->macroWords[j] = 0, line = 0; line < program->macroLines[j]; line++)
+			program->macroWords[j] += writeInstruction(program, file, "\t");
+		fprintf(file, "endmacro\n");
+	}
+
+	for(label = 0, i = 0; i < program->codeStatements; i++, statementsLeft--){
+		writeFiller(program, file, statementsLeft);
+		labelled = label < program->codeLabels && labelPosition(label, program->codeLabels, program->codeStatements) == i;
+		if(labelled)
+			fprintf(file, "C%ld: ", label++);
+		if(i == program->codeStatements - 1){
+			fprintf(file, "\thlt\n");
+			program->words++;
+		}
+		else if(!labelled && program->macroCount && nextRandom(100) < program->macros){
+			/* a macro is only expanded on a line of its own */
+			j = nextRandom(program->macroCount);
+			fprintf(file, "\tM%d\n", j);
+			program->words += program->macroWords[j];
+		}
+		else
+			program->words += writeInstruction(program, file, (nextRandom(4))? "\t" : " ");
+	}
+	for(label = 0, i = 0; i < program->dataStatements; i++, statementsLeft--){
+		writeFiller(program, file, statementsLeft);
+		if(label < program->dataLabels && labelPosition(label, program->dataLabels, program->dataStatements) == i){
+			fprintf(file, "D%ld: ", label);
+			program->words += writeDataStatement(program, file, program->dataLabelKinds[label++]);
+		}
+		else
+			program->words += writeDataStatement(program, file, pickWeighted(program->mix, NUM_OF_DATA_KINDS));
+	}
+	writeFiller(program, file, 0);
+	return !ferror(file);
+}
+
+/*
+ * Writes the comments and blank lines before the next statement - those left are spread
+ * evenly over the statements left, and all written once none are left
+ */
+void writeFiller(Program *program, FILE *file, long statementsLeft){
+	long fillers;
+	while((fillers = program->comments + program->blanks) > 0 &&
+			(statementsLeft == 0 || nextRandom(fillers + statementsLeft) < fillers)){
+		if(nextRandom(fillers) < program->comments){
+			fprintf(file, "%s\n", commentLines[nextRandom(NUM_OF_COMMENTS)]);
+			program->comments--;
+		}
+		else{
+			fprintf(file, "\n");
+			program->blanks--;
+		}
+	}
+}
+
+/*
+ * Writes a random instruction (without a label) with operands fitting its opcode
+ * Returns the amount of words it takes
+ */
+int writeInstruction(Program *program, FILE *file, char *indent){
+	static int sourceWeights[] = { 25, 25, 10, 40 };		/* by enum generatedOperands */
+	static int targetWeights[] = { 0, 35, 15, 50 };
+	static int comparedWeights[] = { 15, 30, 10, 45 };	/* targets of cmp and prn */
+	int command = pickWeighted(commandWeights, NUM_OF_GENERATED_COMMANDS);
+	int source, target, words;
+
+	fprintf(file, "%s%s%s", indent, generatedCommands[command], (command == 14)? "" : " ");
+	switch(command){
+		case 0: case 1: case 2: case 3: /* mov, cmp, add, sub */
+			source = pickWeighted(sourceWeights, 4);
+			target = pickWeighted((command == 1)? comparedWeights : targetWeights, 4);
+			if(source == REGISTER_OPERAND && target == REGISTER_OPERAND){
+				/* both registers share a word */
+				fprintf(file, "r%d,%sr%d\n", nextRandom(NUM_OF_REGISTERS), (nextRandom(2))? " " : "", nextRandom(NUM_OF_REGISTERS));
+				return 2;
+			}
+			words = 1 + writeOperand(program, file, source);
+			fprintf(file, (nextRandom(2))? ", " : ",");
+			words += writeOperand(program, file, target);
+			break;
+		case 9: case 10: case 13: /* jmp, bne, jsr */
+			words = 1 + writeJumpTarget(program, file);
+			break;
+		case 12: /* prn */
+			words = 1 + writeOperand(program, file, pickWeighted(comparedWeights, 4));
+			break;
+		case 14: /* rts */
+			words = 1;
+			break;
+		default:
+			words = 1 + writeOperand(program, file, pickWeighted(targetWeights, 4));
+	}
+	fprintf(file, "\n");
+	return words;
+}
+
+/*
+ * Writes an operand of the kind (enum generatedOperands) - a register instead of a label
+ * when there is no data label, a plain label when a struct field refers to another statement
+ * Returns the amount of words it takes
+ */
+int writeOperand(Program *program, FILE *file, int kind){
+	long label;
+	if(kind == IMMEDIATE_OPERAND){
+		fprintf(file, "#%d", nextRandom(2 * program->limit + 1) - program->limit);
+		return 1;
+	}
+	if(kind == REGISTER_OPERAND || program->dataLabels == 0){
+		fprintf(file, "r%d", nextRandom(NUM_OF_REGISTERS));
+		return 1;
+	}
+	label = nextRandom(program->dataLabels);
+	if(kind == STRUCT_OPERAND && program->dataLabelKinds[label] == STRUCT_KIND){
+		fprintf(file, "D%ld.%d", label, 1 + nextRandom(2));
+		return 2;
+	}
+	fprintf(file, "D%ld", label);
+	return 1;
+}
+
+/*
+ * Writes the target of a jump - mostly a code label, sometimes an extern or a register
+ * Returns the amount of words it takes
+ */
+int writeJumpTarget(Program *program, FILE *file){
+	int pick = nextRandom(10);
+	if(pick == 0 && program->externs)
+		fprintf(file, "X%d", nextRandom(program->externs));
+	else if(pick > 1 && program->codeLabels)
+		fprintf(file, "C%ld", (long)nextRandom(program->codeLabels));
+	else
+		fprintf(file, "r%d", nextRandom(NUM_OF_REGISTERS));
+	return 1;
+}
+
+/*
+ * Writes the rest of a data statement of the kind (enum dataKinds)
+ * Returns the amount of words it takes
+ */
+int writeDataStatement(Program *program, FILE *file, int kind){
+	int i, length;
+	if(kind == DATA_KIND){
+		length = 1 + nextRandom(MAX_DATA_NUMBERS);
+		fprintf(file, ".data ");
+		for(i = 0; i < length; i++)
+			fprintf(file, "%s%d", (i == 0)? "" : (nextRandom(2))? ", " : ",", nextRandom(2 * program->limit + 1) - program->limit);
+		fprintf(file, "\n");
+		return length;
+	}
+	if(kind == STRUCT_KIND){
+		length = 1 + nextRandom(MAX_STRING_LENGTH / 2);
+		fprintf(file, ".struct %d, \"", nextRandom(2 * program->limit + 1) - program->limit);
+	}
+	else{
+		length = 1 + nextRandom(MAX_STRING_LENGTH);
+		fprintf(file, ".string \"");
+	}
+	for(i = 0; i < length; i++)
+		fputc('a' + nextRandom(26), file);
+	fprintf(file, "\"\n");
+	/* the string ends with a null word, a struct starts with its number */
+	return length + 1 + (kind == STRUCT_KIND);
+}
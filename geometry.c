@@ -0,0 +1,53 @@
+/*
+ * geometry.c
+ * 		module holds the geometry of the target machine the code is assembled for -
+ * 		the length of its memory, the address programs are loaded at and the width of its words
+ */
+#include <stdio.h>
+#include "geometry.h"
+#include "constraints.h"
+
+#define ARE_BITS 2 /* the least significant bits of an address word, leaving the rest for the address */
+
+static int memoryLength = DEFAULT_MEMORY_LENGTH;
+static int loadAddress = DEFAULT_LOAD_ADDRESS;
+static int wordWidth = DEFAULT_WORD_WIDTH;
+
+/*
+ * Sets the geometry of the target machine, returns 1 if it is valid or 0 if not (reporting why)
+ */
+int setGeometry(int newMemoryLength, int newLoadAddress, int newWordWidth){
+	if(newMemoryLength < 1 || newMemoryLength > MAX_MEMORY_LENGTH){
+		fprintf(stderr,"Error: memory length must be between 1 and %d words\n",MAX_MEMORY_LENGTH);
+		return 0;
+	}
+	if(newLoadAddress < 0 || newLoadAddress >= newMemoryLength){
+		fprintf(stderr,"Error: load address %d is outside the memory of %d words\n",newLoadAddress,newMemoryLength);
+		return 0;
+	}
+	if(newWordWidth < MIN_WORD_WIDTH || newWordWidth > MAX_WORD_WIDTH){
+		fprintf(stderr,"Error: word width must be between %d and %d bits\n",MIN_WORD_WIDTH,MAX_WORD_WIDTH);
+		return 0;
+	}
+	/* every address must fit in the address field of a word */
+	if((long)newMemoryLength > (1L << (newWordWidth - ARE_BITS))){
+		fprintf(stderr,"Error: a memory of %d words can't be addressed by %d bit words\n",newMemoryLength,newWordWidth);
+		return 0;
+	}
+	memoryLength = newMemoryLength;
+	loadAddress = newLoadAddress;
+	wordWidth = newWordWidth;
+	return 1;
+}
+
+int getMemoryLength(void){
+	return memoryLength;
+}
+
+int getLoadAddress(void){
+	return loadAddress;
+}
+
+int getWordWidth(void){
+	return wordWidth;
+}
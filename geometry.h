@@ -0,0 +1,30 @@
+/*
+ * geometry.h
+ * 		module holds the geometry of the target machine the code is assembled for -
+ * 		the length of its memory, the address programs are loaded at and the width of its words
+ * 		(set once from the command line, see --memory, --load-address and --word-width)
+ */
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+/*
+ * Sets the geometry of the target machine, returns 1 if it is valid or 0 if not (reporting why)
+ */
+int setGeometry(int memoryLength, int loadAddress, int wordWidth);
+
+/*
+ * Returns the amount of words in the memory of the target machine
+ */
+int getMemoryLength(void);
+
+/*
+ * Returns the address the first word of a program is loaded at
+ */
+int getLoadAddress(void);
+
+/*
+ * Returns the amount of bits in a word
+ */
+int getWordWidth(void);
+
+#endif
@@ -0,0 +1,440 @@
+/*
+ * harness.c
+ * 		the test harness - runs a suite of assembled programs in parallel, checking the state each one ends in
+ *
+ * 		Usage: harness [-j N] [--repeat N] [--max-steps N] [--list file] [--native] [--memory N] [--load-address N]
+ * 				[--word-width N] program...
+ * 		Programs are given by the name of their files (without extension), on the command line or a line each
+ * 		in the list file. The expectations of a program are read from "[program].exp", a line each:
+ * 			rN value			the value register N ends with
+ * 			address value		the value the word at the address ends with
+ * 			output value...		the values prn prints, in order
+ * 			input value...		the values get reads, in order
+ * 		(lines starting with ';' are comments). A program passes if it halts in the expected state.
+ *
+ * 		Every program is loaded and decoded once, into a machine serving as its snapshot (see machine.h).
+ * 		The programs are then run by N threads (a thread per core by default), each taking the next program
+ * 		to run - every run of a program (--repeat times) starts from a clone of the snapshot brought back to
+ * 		its state. The result of every program, the instructions executed and their rate are reported.
+ * 		With --native the code of every program is run from its translation (see translation.h) compiled into
+ * 		"[program].so" instead of the machine - the machine only holds the memory and the state it ends in.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include "machine.h"
+#include "translation.h"
+#include "object.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+#define DEFAULT_MAX_STEPS 10000000
+#define MAX_MESSAGE_LENGTH 128	/* holds the description of a trap (see machine.h) */
+
+enum expectationKinds { REGISTER_EXPECTATION, ADDRESS_EXPECTATION };
+
+typedef struct Expectation {
+	int kind;
+	int index;			/* the register or address */
+	int value;
+} Expectation;
+
+typedef struct TestProgram {
+	char *name;
+	Machine *snapshot;
+	Expectation *expectations;
+	int expectationCount;
+	int *input;
+	int inputCount;
+	int *output;		/* the values prn is expected to print, NULL if not checked */
+	int outputCount;
+	void *library;				/* the shared object of the translation (with --native), NULL if none */
+	TranslatedProgram native;
+	int passed;
+	long steps;			/* instructions executed by all runs */
+	char message[MAX_MESSAGE_LENGTH];
+} TestProgram;
+
+typedef struct Suite {
+	TestProgram *programs;
+	int count;
+	int next;			/* the next program to run */
+	int repeat;
+	long limit;
+	pthread_mutex_t lock;
+} Suite;
+
+int loadProgram(TestProgram *program, int native);
+int loadTranslation(TestProgram *program);
+int readExpectations(TestProgram *program);
+int readValues(char **values, int **array, int *count);
+char** readProgramList(char *url, char **names, int *count);
+void* runPrograms(void *suite);
+void runProgram(TestProgram *program, int repeat, long limit);
+void runTranslation(TestProgram *program, Machine *machine, long limit);
+void checkState(TestProgram *program, Machine *machine);
+double elapsedSeconds(struct timespec *start);
+void destroyProgram(TestProgram *program);
+
+int main(int argc, char **argv){
+	Suite suite;
+	TestProgram *programs;
+	pthread_t *threads;
+	struct timespec start;
+	char **names = (char**)malloc(sizeof(char*) * argc), *listUrl = NULL;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, value, count = 0, loaded = 0, native = 0, jobs = (int)sysconf(_SC_NPROCESSORS_ONLN), passed = 0, success = 1;
+	long steps = 0;
+	double seconds;
+
+	memset(&suite, 0, sizeof(suite));
+	suite.repeat = 1;
+	suite.limit = DEFAULT_MAX_STEPS;
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--repeat") == 0 || strcmp(argv[i], "--max-steps") == 0){
+			if(i + 1 >= argc || !customAtoi(argv[i + 1], &value) || value < 1){
+				fprintf(stderr,"Error: option '%s' requires a positive number\n",argv[i]);
+				success = 0;
+			}
+			else if(strcmp(argv[i++], "-j") == 0)
+				jobs = value;
+			else if(strcmp(argv[i - 1], "--repeat") == 0)
+				suite.repeat = value;
+			else
+				suite.limit = value;
+		}
+		else if(strcmp(argv[i], "--list") == 0){
+			if(i + 1 < argc)
+				listUrl = argv[++i];
+			else{
+				fprintf(stderr,"Error: option '--list' requires a file\n");
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i], "--native") == 0)
+			native = 1;
+		else if(argv[i][0] == '-'){
+			fprintf(stderr,"Error: unknown option '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			names[count++] = argv[i];
+	}
+	if(success && listUrl)
+		success = (names = readProgramList(listUrl, names, &count)) != NULL;
+	if(success && !count){
+		fprintf(stderr,"Usage: harness [-j N] [--repeat N] [--max-steps N] [--list file] [--native] [--memory N] [--load-address N] [--word-width N] program...\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+	if(!success){
+		free(names);
+		return 1;
+	}
+
+	programs = (TestProgram*)calloc(count, sizeof(TestProgram));
+	for(; success && loaded < count; loaded++){
+		programs[loaded].name = names[loaded];
+		success = loadProgram(&programs[loaded], native);
+	}
+	if(success){
+		suite.programs = programs;
+		suite.count = count;
+		jobs = (jobs < 1)? 1 : (jobs > count)? count : jobs;
+		threads = (pthread_t*)malloc(sizeof(pthread_t) * jobs);
+		pthread_mutex_init(&suite.lock, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i = 0; i < jobs; i++)
+			pthread_create(&threads[i], NULL, runPrograms, &suite);
+		for(i = 0; i < jobs; i++)
+			pthread_join(threads[i], NULL);
+		seconds = elapsedSeconds(&start);
+		pthread_mutex_destroy(&suite.lock);
+		free(threads);
+
+		for(i = 0; i < count; i++){
+			if(programs[i].passed)
+				printf("PASS %s (%ld instructions)\n",programs[i].name,programs[i].steps);
+			else
+				printf("FAIL %s: %s\n",programs[i].name,programs[i].message);
+			passed += programs[i].passed;
+			steps += programs[i].steps;
+		}
+		printf("%d passed, %d failed - %ld instructions in %.3f seconds on %d threads (%.1f million per second)\n",
+				passed,count - passed,steps,seconds,jobs,(seconds > 0)? steps / seconds / 1e6 : 0.0);
+		success = passed == count;
+	}
+
+	for(i = 0; i < loaded; i++)
+		destroyProgram(&programs[i]);
+	free(programs);
+	if(listUrl){
+		for(i = 0; i < count; i++)
+			free(names[i]);
+	}
+	free(names);
+	return !success;
+}
+
+/*
+ * Loads the program into its snapshot, along with its expectations (and its translation if native is set)
+ * Returns 1 if succeeded or 0 if the files of the program can't be read (reporting why)
+ */
+int loadProgram(TestProgram *program, int native){
+	ObjectModule *module = readObjectModule(program->name);
+	if(!module)
+		return 0;
+	program->snapshot = createMachine(module);
+	destroyObjectModule(module);
+	return program->snapshot && readExpectations(program) && (!native || loadTranslation(program));
+}
+
+/*
+ * Loads the translation of the program from "[program].so"
+ * Returns 1 if succeeded or 0 if it can't be loaded (reporting why)
+ */
+int loadTranslation(TestProgram *program){
+	char *url = constructUrl(program->name, "so");
+	char *path = (char*)malloc(strlen(url) + 3);
+
+	/* a path without a slash would be searched for in the directories of the system */
+	sprintf(path, "%s%s", (strchr(url, '/'))? "" : "./", url);
+	if(!(program->library = dlopen(path, RTLD_NOW)))
+		fprintf(stderr,"Error: couldn't load translation %s: %s\n",path,dlerror());
+	else if(!(*(void**)&program->native = dlsym(program->library, TRANSLATED_FUNCTION)))
+		fprintf(stderr,"Error: %s has no function %s\n",path,TRANSLATED_FUNCTION);
+	free(path);
+	free(url);
+	return program->native != NULL;
+}
+
+/*
+ * Reads the expectations of the program from "[program].exp" - a program without the file is only expected to halt
+ * Returns 1 if succeeded or 0 if the file is malformed (reporting why)
+ */
+int readExpectations(TestProgram *program){
+	char line[MAX_LINE_LENGTH * 4];
+	char *url = constructUrl(program->name, "exp"), *fields[2];
+	FILE *file = fopen(url, "r");
+	Expectation *expectation;
+	int lineNumber = 0, success = 1;
+
+	while(file && success && fgets(line, sizeof(line), file)){
+		lineNumber++;
+		if(!(fields[0] = strtok(line, " \t\n")) || fields[0][0] == ';')
+			continue;
+		if(strcmp(fields[0], "input") == 0)
+			success = readValues(fields, &program->input, &program->inputCount);
+		else if(strcmp(fields[0], "output") == 0)
+			success = readValues(fields, &program->output, &program->outputCount);
+		else{
+			program->expectations = (Expectation*)realloc(program->expectations, sizeof(Expectation) * (program->expectationCount + 1));
+			expectation = &program->expectations[program->expectationCount++];
+			expectation->kind = (fields[0][0] == 'r')? REGISTER_EXPECTATION : ADDRESS_EXPECTATION;
+			success = customAtoi(fields[0] + (expectation->kind == REGISTER_EXPECTATION), &expectation->index)
+					&& expectation->index >= 0
+					&& expectation->index < ((expectation->kind == REGISTER_EXPECTATION)? NUM_OF_REGISTERS : getMemoryLength())
+					&& (fields[1] = strtok(NULL, " \t\n")) && customAtoi(fields[1], &expectation->value)
+					&& !strtok(NULL, " \t\n");
+		}
+		if(!success)
+			fprintf(stderr,"Error: malformed expectation in line %d of %s\n",lineNumber,url);
+	}
+	if(file)
+		fclose(file);
+	free(url);
+	return success;
+}
+
+/*
+ * Reads the values following the first field of the line (already read by strtok) into a new array
+ * Returns 1 if succeeded or 0 if a value isn't a number
+ */
+int readValues(char **fields, int **array, int *count){
+	free(*array);
+	*array = (int*)malloc(sizeof(int));
+	for(*count = 0; (fields[1] = strtok(NULL, " \t\n")); (*count)++){
+		*array = (int*)realloc(*array, sizeof(int) * (*count + 1));
+		if(!customAtoi(fields[1], &(*array)[*count]))
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Adds the program names listed in the file (a line each) to the names, copying every name
+ * Returns the (reallocated) names or NULL if the file can't be read (reporting it)
+ */
+char** readProgramList(char *url, char **names, int *count){
+	char line[MAX_LINE_LENGTH * 4];
+	FILE *file = fopen(url, "r");
+	int i, capacity = *count;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't read program list %s\n",url);
+		free(names);
+		return NULL;
+	}
+	/* names given on the command line are copied as well, so every name is freed the same way */
+	for(i = 0; i < *count; i++)
+		names[i] = strcpy((char*)malloc(strlen(names[i]) + 1), names[i]);
+	while(fgets(line, sizeof(line), file)){
+		strTrim(line);
+		if(!*line)
+			continue;
+		if(*count == capacity){
+			capacity = capacity * 2 + 16;
+			names = (char**)realloc(names, sizeof(char*) * capacity);
+		}
+		names[(*count)++] = strcpy((char*)malloc(strlen(line) + 1), line);
+	}
+	fclose(file);
+	return names;
+}
+
+/*
+ * The work of a thread - runs the next program of the suite until every program ran
+ */
+void* runPrograms(void *suite){
+	Suite *programs = (Suite*)suite;
+	int next;
+	for(;;){
+		pthread_mutex_lock(&programs->lock);
+		next = programs->next++;
+		pthread_mutex_unlock(&programs->lock);
+		if(next >= programs->count)
+			return NULL;
+		runProgram(&programs->programs[next], programs->repeat, programs->limit);
+	}
+}
+
+/*
+ * Runs the program repeat times from its snapshot, checking the state of the last run
+ */
+void runProgram(TestProgram *program, int repeat, long limit){
+	Machine *machine = cloneMachine(program->snapshot);
+	int i;
+
+	machine->input = program->input;
+	machine->inputCount = program->inputCount;
+	machine->output = NULL;
+	for(i = 0; i < repeat; i++){
+		restoreMachine(machine, program->snapshot);
+		if(program->native)
+			runTranslation(program, machine, limit);
+		else
+			runMachine(machine, limit);
+		program->steps += machine->steps;
+	}
+	checkState(program, machine);
+	destroyMachine(machine);
+}
+
+/*
+ * Runs the translation of the program on the memory and state of the machine, leaving the machine in the state
+ * the run stopped in - as if the machine ran the program
+ */
+void runTranslation(TestProgram *program, Machine *machine, long limit){
+	NativeRun run;
+	int address;
+
+	memset(&run, 0, sizeof(NativeRun));
+	run.memory = machine->memory;
+	memcpy(run.registers, machine->registers, sizeof(run.registers));
+	run.zero = machine->zero;
+	run.stub = machine->stub;
+	run.input = machine->input;
+	run.inputCount = machine->inputCount;
+	run.collectOutput = 1;
+	run.printed = machine->printed;
+	run.printedCapacity = machine->printedCapacity;
+	run.limit = limit;
+	program->native(&run);
+
+	memcpy(machine->registers, run.registers, sizeof(run.registers));
+	machine->zero = run.zero;
+	machine->stub = run.stub;
+	machine->printed = run.printed;
+	machine->printedCount = run.printedCount;
+	machine->printedCapacity = run.printedCapacity;
+	machine->steps = run.steps;
+	machine->state = run.state;
+	machine->trap = (run.state == TRAPPED_STATE)? getTrapMessage(run.trap) : NULL;
+	/* the operation at the address, past the code the trap of running past it -
+	 * a jump to no instruction stops at the trap of jumping through a register, set as the machine would */
+	address = run.address;
+	if(run.state == TRAPPED_STATE && run.trap == NO_INSTRUCTION_TRAP)
+		machine->pc = jumpToNoInstruction(machine, &machine->operations[machine->operationIndex[address]], run.target)
+				- machine->operations;
+	else if(address >= 0 && address < getMemoryLength() && machine->operationIndex[address] >= 0)
+		machine->pc = machine->operationIndex[address];
+	else
+		machine->pc = machine->operationCount;
+}
+
+/*
+ * Sets whether the program passed according to the state the machine ended in, describing the first mismatch
+ */
+void checkState(TestProgram *program, Machine *machine){
+	Expectation *expectation;
+	int i, mask = (1 << getWordWidth()) - 1, actual;
+
+	program->passed = 0;
+	if(machine->state == TRAPPED_STATE){
+		describeTrap(machine, program->message);
+		return;
+	}
+	if(machine->state == LIMIT_STATE){
+		sprintf(program->message, "didn't halt within %ld steps", machine->steps);
+		return;
+	}
+	for(i = 0; i < program->expectationCount; i++){
+		expectation = &program->expectations[i];
+		actual = (expectation->kind == REGISTER_EXPECTATION)? machine->registers[expectation->index] : machine->memory[expectation->index];
+		if(actual != (expectation->value & mask)){
+			sprintf(program->message, "%s%d is %d, expected %d", (expectation->kind == REGISTER_EXPECTATION)? "r" : "word ",
+					expectation->index, actual, expectation->value & mask);
+			return;
+		}
+	}
+	for(i = 0; i < program->outputCount && i < machine->printedCount; i++){
+		if(machine->printed[i] != (program->output[i] & mask)){
+			sprintf(program->message, "printed value %d is %d, expected %d", i + 1, machine->printed[i], program->output[i] & mask);
+			return;
+		}
+	}
+	if(program->output && program->outputCount != machine->printedCount){
+		sprintf(program->message, "printed %d values, expected %d", machine->printedCount, program->outputCount);
+		return;
+	}
+	program->passed = 1;
+}
+
+/*
+ * Returns the seconds passed since start
+ */
+double elapsedSeconds(struct timespec *start){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Frees space dynamically allocated to the program (its name belongs to the caller)
+ */
+void destroyProgram(TestProgram *program){
+	destroyMachine(program->snapshot);
+	if(program->library)
+		dlclose(program->library);
+	free(program->expectations);
+	free(program->input);
+	free(program->output);
+}
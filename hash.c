@@ -0,0 +1,159 @@
+/*
+ * hash.c
+ * 		module computes SHA-256 digests, used to identify file contents
+ * 		Words are kept in unsigned long (at least 32 bits in ANSI C) and masked to 32 bits.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hash.h"
+
+#define HASH_READ_CHUNK 4096
+#define MASK32(x) ((x) & 0xFFFFFFFFUL)
+#define ROTR(x,n) MASK32(((x) >> (n)) | ((x) << (32 - (n))))
+
+static const unsigned long roundConstants[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL, 0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL, 0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL, 0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL, 0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL, 0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL, 0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL, 0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL, 0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+void hashBlock(Hash *hash, const unsigned char *block);
+
+/*
+ * Starts a new digest
+ */
+void hashInit(Hash *hash){
+	hash->state[0] = 0x6a09e667UL;
+	hash->state[1] = 0xbb67ae85UL;
+	hash->state[2] = 0x3c6ef372UL;
+	hash->state[3] = 0xa54ff53aUL;
+	hash->state[4] = 0x510e527fUL;
+	hash->state[5] = 0x9b05688cUL;
+	hash->state[6] = 0x1f83d9abUL;
+	hash->state[7] = 0x5be0cd19UL;
+	hash->bitCountHigh = 0;
+	hash->bitCountLow = 0;
+	hash->blockLength = 0;
+}
+
+/*
+ * Adds length bytes of data to the digest
+ */
+void hashUpdate(Hash *hash, const void *data, size_t length){
+	const unsigned char *bytes = (const unsigned char*)data;
+	size_t amount;
+
+	hash->bitCountLow = MASK32(hash->bitCountLow + ((unsigned long)length << 3));
+	if(hash->bitCountLow < MASK32((unsigned long)length << 3))
+		hash->bitCountHigh++;
+	hash->bitCountHigh = MASK32(hash->bitCountHigh + ((unsigned long)length >> 29));
+
+	/* completes a partial block first, then hashes whole blocks straight from the input */
+	if(hash->blockLength){
+		amount = 64 - hash->blockLength;
+		if(amount > length)
+			amount = length;
+		memcpy(hash->block + hash->blockLength, bytes, amount);
+		hash->blockLength += amount;
+		bytes += amount;
+		length -= amount;
+		if(hash->blockLength < 64)
+			return;
+		hashBlock(hash, hash->block);
+		hash->blockLength = 0;
+	}
+	for(; length >= 64; bytes += 64, length -= 64)
+		hashBlock(hash, bytes);
+	memcpy(hash->block, bytes, length);
+	hash->blockLength = length;
+}
+
+/*
+ * Completes the digest, storing it as a null terminated hexadecimal string in hex (HASH_HEX_LENGTH characters)
+ */
+void hashFinal(Hash *hash, char *hex){
+	unsigned char lengthBytes[8];
+	unsigned char padding = 0x80;
+	unsigned char zero = 0;
+	int i;
+
+	for(i = 0; i < 4; i++){
+		lengthBytes[i] = (unsigned char)(hash->bitCountHigh >> (24 - i*8));
+		lengthBytes[i+4] = (unsigned char)(hash->bitCountLow >> (24 - i*8));
+	}
+	hashUpdate(hash, &padding, 1);
+	while(hash->blockLength != 56)
+		hashUpdate(hash, &zero, 1);
+	/* the length is added to the last block directly, it isn't part of the message */
+	memcpy(hash->block + 56, lengthBytes, 8);
+	hashBlock(hash, hash->block);
+
+	for(i = 0; i < 8; i++)
+		sprintf(hex + i*8, "%08lx", hash->state[i]);
+	hex[HASH_HEX_LENGTH-1] = '\0';
+}
+
+/*
+ * Computes the digest of the file's content, storing it like hashFinal in hex
+ * Returns 1 if succeeded or 0 if the file can't be read
+ */
+int hashFile(char *url, char *hex){
+	unsigned char buffer[HASH_READ_CHUNK];
+	FILE *file = fopen(url, "rb");
+	size_t length;
+	Hash hash;
+
+	if(!file)
+		return 0;
+	hashInit(&hash);
+	while((length = fread(buffer, 1, HASH_READ_CHUNK, file)) > 0)
+		hashUpdate(&hash, buffer, length);
+	fclose(file);
+	hashFinal(&hash, hex);
+	return 1;
+}
+
+/*
+ * Processes a single 64 byte block
+ */
+void hashBlock(Hash *hash, const unsigned char *block){
+	unsigned long w[64];
+	unsigned long a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+	int i;
+
+	for(i = 0; i < 16; i++){
+		w[i] = ((unsigned long)block[i*4] << 24) | ((unsigned long)block[i*4+1] << 16) |
+				((unsigned long)block[i*4+2] << 8) | (unsigned long)block[i*4+3];
+	}
+	for(; i < 64; i++){
+		s0 = ROTR(w[i-15], 7) ^ ROTR(w[i-15], 18) ^ (w[i-15] >> 3);
+		s1 = ROTR(w[i-2], 17) ^ ROTR(w[i-2], 19) ^ (w[i-2] >> 10);
+		w[i] = MASK32(w[i-16] + s0 + w[i-7] + s1);
+	}
+
+	a = hash->state[0]; b = hash->state[1]; c = hash->state[2]; d = hash->state[3];
+	e = hash->state[4]; f = hash->state[5]; g = hash->state[6]; h = hash->state[7];
+	for(i = 0; i < 64; i++){
+		s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+		t1 = MASK32(h + s1 + ((e & f) ^ (~e & g)) + roundConstants[i] + w[i]);
+		s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+		t2 = MASK32(s0 + ((a & b) ^ (a & c) ^ (b & c)));
+		h = g; g = f; f = e;
+		e = MASK32(d + t1);
+		d = c; c = b; b = a;
+		a = MASK32(t1 + t2);
+	}
+	hash->state[0] = MASK32(hash->state[0] + a);
+	hash->state[1] = MASK32(hash->state[1] + b);
+	hash->state[2] = MASK32(hash->state[2] + c);
+	hash->state[3] = MASK32(hash->state[3] + d);
+	hash->state[4] = MASK32(hash->state[4] + e);
+	hash->state[5] = MASK32(hash->state[5] + f);
+	hash->state[6] = MASK32(hash->state[6] + g);
+	hash->state[7] = MASK32(hash->state[7] + h);
+}
@@ -0,0 +1,40 @@
+/*
+ * hash.h
+ * 		module computes SHA-256 digests, used to identify file contents
+ */
+#ifndef HASH_H
+#define HASH_H
+#include <stddef.h>
+
+#define HASH_DIGEST_LENGTH 32
+#define HASH_HEX_LENGTH (HASH_DIGEST_LENGTH*2 + 1)
+
+typedef struct Hash {
+	unsigned long state[8];
+	unsigned long bitCountHigh, bitCountLow;
+	unsigned char block[64];
+	int blockLength;
+} Hash;
+
+/*
+ * Starts a new digest
+ */
+void hashInit(Hash *hash);
+
+/*
+ * Adds length bytes of data to the digest
+ */
+void hashUpdate(Hash *hash, const void *data, size_t length);
+
+/*
+ * Completes the digest, storing it as a null terminated hexadecimal string in hex (HASH_HEX_LENGTH characters)
+ */
+void hashFinal(Hash *hash, char *hex);
+
+/*
+ * Computes the digest of the file's content, storing it like hashFinal in hex
+ * Returns 1 if succeeded or 0 if the file can't be read
+ */
+int hashFile(char *url, char *hex);
+
+#endif
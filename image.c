@@ -0,0 +1,91 @@
+/*
+ * image.c
+ * 		module holds the memory image of a program while it is assembled - the words of the code segment
+ * 		at their addresses and the values of the data segment
+ *
+ * 		The code segment is paged - only the pages a program actually uses are allocated, so a large memory
+ * 		doesn't enlarge the assembly of a small program. The data segment is contiguous and doubles as it grows.
+ */
+#include <stdlib.h>
+#include "image.h"
+#include "geometry.h"
+#include "object.h"
+
+#define INITIAL_DATA_CAPACITY 256
+
+/*
+ * Returns a new empty image covering the memory of the target machine
+ */
+Image* createImage(void){
+	Image *image = (Image*)malloc(sizeof(Image));
+	image->pageCount = (getMemoryLength() + IMAGE_PAGE_WORDS - 1) / IMAGE_PAGE_WORDS;
+	image->pages = (ImageWord**)calloc(image->pageCount, sizeof(ImageWord*));
+	image->dataCapacity = INITIAL_DATA_CAPACITY;
+	image->data = (int*)malloc(sizeof(int) * image->dataCapacity);
+	image->statements = NULL;
+	image->statementCount = 0;
+	image->statementCapacity = 0;
+	return image;
+}
+
+/*
+ * Returns the word at the address (an address within the memory of the target machine)
+ */
+char* getImageWord(Image *image, int address){
+	ImageWord **page = &image->pages[address / IMAGE_PAGE_WORDS];
+	if(!*page)
+		*page = (ImageWord*)calloc(IMAGE_PAGE_WORDS, sizeof(ImageWord));
+	return (*page)[address % IMAGE_PAGE_WORDS];
+}
+
+/*
+ * Returns the value of the word at the address - a word referencing a label (resolved only in the second pass)
+ * is read as a relocatable address
+ */
+int readImageWord(Image *image, int address){
+	char *word = getImageWord(image, address);
+	int value = 0;
+	if(*word != '0' && *word != '1')
+		return RELOCATABLE_ARE;
+	for(; *word == '0' || *word == '1'; word++)
+		value = (value << 1) | (*word - '0');
+	return value;
+}
+
+/*
+ * Makes room for count more values after the first dc values of the data segment
+ * Returns the data segment (moved when it grows)
+ */
+int* reserveImageData(Image *image, int dc, int count){
+	while(dc + count > image->dataCapacity){
+		image->dataCapacity *= 2;
+		image->data = (int*)realloc(image->data, sizeof(int) * image->dataCapacity);
+	}
+	return image->data;
+}
+
+/*
+ * Records that a data statement starts at offset dc of the data segment
+ */
+void addImageStatement(Image *image, int dc){
+	if(image->statementCount == image->statementCapacity){
+		image->statementCapacity = (image->statementCapacity)? image->statementCapacity * 2 : INITIAL_DATA_CAPACITY;
+		image->statements = (int*)realloc(image->statements, sizeof(int) * image->statementCapacity);
+	}
+	image->statements[image->statementCount++] = dc;
+}
+
+/*
+ * Frees space dynamically allocated to the image
+ */
+void destroyImage(Image *image){
+	int i;
+	if(!image)
+		return;
+	for(i = 0; i < image->pageCount; i++)
+		free(image->pages[i]);
+	free(image->pages);
+	free(image->data);
+	free(image->statements);
+	free(image);
+}
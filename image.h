@@ -0,0 +1,57 @@
+/*
+ * image.h
+ * 		module holds the memory image of a program while it is assembled - the words of the code segment
+ * 		at their addresses and the values of the data segment
+ */
+#ifndef IMAGE_H
+#define IMAGE_H
+#include "constraints.h"
+
+#define IMAGE_PAGE_WORDS 256
+#define IMAGE_WORD_LENGTH (MAX_LABEL_NAME_LENGTH + 16) /* an encoded word or "[label]|[line number]" */
+
+typedef char ImageWord[IMAGE_WORD_LENGTH];
+
+typedef struct Image {
+	ImageWord **pages;	/* covers the whole memory, a page is allocated when a word in it is first used */
+	int pageCount;
+	int *data;			/* values of the data segment */
+	int dataCapacity;
+	int *statements;	/* offset of every data statement in the data segment, in order */
+	int statementCount;
+	int statementCapacity;
+} Image;
+
+/*
+ * Returns a new empty image covering the memory of the target machine
+ */
+Image* createImage(void);
+
+/*
+ * Returns the word at the address (an address within the memory of the target machine)
+ */
+char* getImageWord(Image *image, int address);
+
+/*
+ * Returns the value of the word at the address - a word referencing a label (resolved only in the second pass)
+ * is read as a relocatable address
+ */
+int readImageWord(Image *image, int address);
+
+/*
+ * Makes room for count more values after the first dc values of the data segment
+ * Returns the data segment (moved when it grows)
+ */
+int* reserveImageData(Image *image, int dc, int count);
+
+/*
+ * Records that a data statement starts at offset dc of the data segment
+ */
+void addImageStatement(Image *image, int dc);
+
+/*
+ * Frees space dynamically allocated to the image
+ */
+void destroyImage(Image *image);
+
+#endif
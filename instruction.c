@@ -0,0 +1,122 @@
+/*
+ * instruction.c
+ * 		module decodes the machine instructions of assembled code - the words constructed by
+ * 		constructType1Binary (the instruction word) and constructType2Binary .. constructType4Binary (its operands)
+ *
+ * 		Fields keep their distance from the least significant bit at every word width (see output.c),
+ * 		so they are extracted with shifts - only the leftmost field (the opcode, the address or value,
+ * 		or the source register) grows with the width.
+ */
+#include <stdio.h>
+#include "instruction.h"
+#include "object.h"
+#include "geometry.h"
+
+#define OPCODE_SHIFT 6
+#define SRC_MODE_SHIFT 4
+#define DST_MODE_SHIFT 2
+#define MODE_MASK 3
+#define SRC_REGISTER_SHIFT 6
+#define DST_REGISTER_SHIFT 2
+#define REGISTER_MASK 15
+
+static char *mnemonics[NUM_OF_OPCODES] = {
+		"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc",
+		"dec", "jmp", "bne", "get", "prn", "jsr", "rts", "hlt"
+};
+static int operandCounts[NUM_OF_OPCODES] = {2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0 };
+static int destinationWrites[NUM_OF_OPCODES] = {1, 0, 1, 1, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 0, 0 };
+
+int decodeOperandWords(int *words, int count, int offset, int mode, int isSrc, DecodedOperand *operand);
+
+/*
+ * Decodes the instruction starting at words[0] (of the available count words)
+ * Returns 1 if succeeded or 0 if the words are not a valid instruction
+ */
+int decodeInstruction(int *words, int count, Instruction *instruction){
+	int srcMode, dstMode, offset = 1;
+
+	if(count < 1 || (words[0] & ARE_MASK) != LOCAL_ARE || (words[0] >> OPCODE_SHIFT) >= NUM_OF_OPCODES)
+		return 0;
+	instruction->opCode = words[0] >> OPCODE_SHIFT;
+	instruction->operandCount = operandCounts[instruction->opCode];
+	srcMode = (words[0] >> SRC_MODE_SHIFT) & MODE_MASK;
+	dstMode = (words[0] >> DST_MODE_SHIFT) & MODE_MASK;
+	/* an instruction with fewer operands leaves the unused modes 0 */
+	if((instruction->operandCount < 2 && srcMode) || (instruction->operandCount < 1 && dstMode))
+		return 0;
+
+	if(instruction->operandCount == 2){
+		if(!decodeOperandWords(words, count, offset, srcMode, 1, &instruction->src))
+			return 0;
+		/* two register operands share a single word */
+		if(srcMode == REGISTER_MODE && dstMode == REGISTER_MODE){
+			instruction->dst.mode = REGISTER_MODE;
+			instruction->dst.value = (words[offset] >> DST_REGISTER_SHIFT) & REGISTER_MASK;
+			instruction->dst.wordOffset = offset;
+			instruction->length = offset + 1;
+			return instruction->dst.value < NUM_OF_REGISTERS;
+		}
+		offset += (srcMode == STRUCT_MODE)? 2 : 1;
+	}
+	if(instruction->operandCount >= 1){
+		if(!decodeOperandWords(words, count, offset, dstMode, 0, &instruction->dst))
+			return 0;
+		offset += (dstMode == STRUCT_MODE)? 2 : 1;
+	}
+	instruction->length = offset;
+	return 1;
+}
+
+/*
+ * Decodes an operand of the given mode whose first word is words[offset]
+ * Returns 1 if succeeded or 0 if the words are not a valid operand
+ */
+int decodeOperandWords(int *words, int count, int offset, int mode, int isSrc, DecodedOperand *operand){
+	int signBit = 1 << (getWordWidth() - ARE_BITS - 1);
+	if(offset + ((mode == STRUCT_MODE)? 2 : 1) > count)
+		return 0;
+	operand->mode = mode;
+	operand->wordOffset = offset;
+	operand->field = 0;
+	switch(mode){
+		case IMMEDIATE_MODE:
+			operand->value = words[offset] >> ARE_BITS;
+			/* the value is a two's complement number of the width of the word without the ARE bits */
+			if(operand->value & signBit)
+				operand->value -= signBit << 1;
+			return (words[offset] & ARE_MASK) == LOCAL_ARE;
+		case STRUCT_MODE:
+			operand->field = words[offset + 1] >> ARE_BITS;
+			if(operand->field < 1 || operand->field > 2)
+				return 0;
+			/* the address word is decoded as a label */
+		case DIRECT_MODE:
+			operand->value = words[offset] >> ARE_BITS;
+			return (words[offset] & ARE_MASK) != LOCAL_ARE;
+		default:
+			operand->value = (isSrc)? words[offset] >> SRC_REGISTER_SHIFT : (words[offset] >> DST_REGISTER_SHIFT) & REGISTER_MASK;
+			return operand->value < NUM_OF_REGISTERS;
+	}
+}
+
+/*
+ * Returns the cycles the instruction takes each time it runs - a cycle for every word of it
+ */
+int instructionCycles(Instruction *instruction){
+	return instruction->length;
+}
+
+/*
+ * Returns the mnemonic of the opcode
+ */
+char* getMnemonic(int opCode){
+	return mnemonics[opCode];
+}
+
+/*
+ * Returns 1 if the instruction stores a value in its destination operand, otherwise 0
+ */
+int writesDestination(int opCode){
+	return destinationWrites[opCode];
+}
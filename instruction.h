@@ -0,0 +1,56 @@
+/*
+ * instruction.h
+ * 		module decodes the machine instructions of assembled code - the words constructed by
+ * 		constructType1Binary (the instruction word) and constructType2Binary .. constructType4Binary (its operands)
+ */
+#ifndef INSTRUCTION_H
+#define INSTRUCTION_H
+
+#define NUM_OF_OPCODES 16
+#define NUM_OF_REGISTERS 8
+#define MAX_INSTRUCTION_LENGTH 5
+#define NUM_OF_ADDRESSING_MODES 4
+
+/* the operand types of the assembler, in the order of their encoding */
+enum addressingModes { IMMEDIATE_MODE, DIRECT_MODE, STRUCT_MODE, REGISTER_MODE };
+
+enum opcodes { MOV_OP, CMP_OP, ADD_OP, SUB_OP, NOT_OP, CLR_OP, LEA_OP, INC_OP,
+	DEC_OP, JMP_OP, BNE_OP, GET_OP, PRN_OP, JSR_OP, RTS_OP, HLT_OP };
+
+typedef struct DecodedOperand {
+	int mode;			/* enum addressingModes */
+	int value;			/* the immediate value, the address (of a label or struct) or the register */
+	int field;			/* the field of a struct operand (1 or 2) */
+	int wordOffset;		/* offset of the operand's first word from the instruction word */
+} DecodedOperand;
+
+typedef struct Instruction {
+	int opCode;			/* enum opcodes */
+	int operandCount;	/* a single operand is the destination */
+	DecodedOperand src;
+	DecodedOperand dst;
+	int length;			/* amount of words, the instruction word included */
+} Instruction;
+
+/*
+ * Decodes the instruction starting at words[0] (of the available count words)
+ * Returns 1 if succeeded or 0 if the words are not a valid instruction
+ */
+int decodeInstruction(int *words, int count, Instruction *instruction);
+
+/*
+ * Returns the cycles the instruction takes each time it runs - a cycle for every word of it
+ */
+int instructionCycles(Instruction *instruction);
+
+/*
+ * Returns the mnemonic of the opcode
+ */
+char* getMnemonic(int opCode);
+
+/*
+ * Returns 1 if the instruction stores a value in its destination operand, otherwise 0
+ */
+int writesDestination(int opCode);
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ * json.c
+ * 		module parses JSON text into a tree of values and writes values back as JSON text
+ *
+ * 		The parser is a recursive descent over the text - each parse function receives a pointer to
+ * 		the current position, advances it over what it parsed and returns NULL on invalid text.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "json.h"
+
+#define MAX_JSON_DEPTH 64
+
+JsonValue* parseValue(char **text, int depth);
+JsonValue* parseContainer(char **text, int depth, int type);
+char* parseString(char **text);
+int parseHexDigits(char *text, unsigned long *codePoint);
+char* putUtf8(char *out, unsigned long codePoint);
+JsonValue* newValue(int type);
+void skipSpaces(char **text);
+
+/*
+ * Parses the JSON text
+ * Returns the root value or NULL if the text is not valid JSON
+ */
+JsonValue* parseJson(char *text){
+	JsonValue *value = parseValue(&text, 0);
+	skipSpaces(&text);
+	if(value && *text){
+		destroyJson(value);
+		return NULL;
+	}
+	return value;
+}
+
+/*
+ * Returns the member of object with the given key or NULL if object is not an object or has no such member
+ */
+JsonValue* getJsonMember(JsonValue *object, char *key){
+	JsonValue *member;
+	if(!object || object->type != JSON_OBJECT)
+		return NULL;
+	for(member = object->children; member; member = member->next){
+		if(strcmp(member->key, key) == 0)
+			return member;
+	}
+	return NULL;
+}
+
+/*
+ * Returns the string member of object with the given key or NULL if it is missing or not a string
+ */
+char* getJsonString(JsonValue *object, char *key){
+	JsonValue *member = getJsonMember(object, key);
+	return (member && member->type == JSON_STRING)? member->string : NULL;
+}
+
+/*
+ * Stores the number member of object with the given key in value
+ * Returns 1 if succeeded or 0 if it is missing or not a number
+ */
+int getJsonInt(JsonValue *object, char *key, int *value){
+	JsonValue *member = getJsonMember(object, key);
+	if(!member || member->type != JSON_NUMBER)
+		return 0;
+	*value = (int)member->number;
+	return 1;
+}
+
+/*
+ * Writes the value as JSON text
+ */
+void writeJsonValue(FILE *stream, JsonValue *value){
+	JsonValue *child;
+	switch(value->type){
+		case JSON_NULL: fputs("null", stream);
+			break;
+		case JSON_BOOLEAN: fputs((value->number)? "true" : "false", stream);
+			break;
+		case JSON_NUMBER:{
+			if(value->number == (long)value->number)
+				fprintf(stream, "%ld", (long)value->number);
+			else
+				fprintf(stream, "%.17g", value->number);
+		}
+			break;
+		case JSON_STRING: writeJsonString(stream, value->string);
+			break;
+		case JSON_ARRAY:
+		case JSON_OBJECT:{
+			fputc((value->type == JSON_ARRAY)? '[' : '{', stream);
+			for(child = value->children; child; child = child->next){
+				if(value->type == JSON_OBJECT){
+					writeJsonString(stream, child->key);
+					fputc(':', stream);
+				}
+				writeJsonValue(stream, child);
+				if(child->next)
+					fputc(',', stream);
+			}
+			fputc((value->type == JSON_ARRAY)? ']' : '}', stream);
+		}
+			break;
+	}
+}
+
+/*
+ * Writes the string as a quoted and escaped JSON string
+ */
+void writeJsonString(FILE *stream, char *string){
+	fputc('"', stream);
+	for(; *string; string++){
+		switch(*string){
+			case '"': fputs("\\\"", stream);
+				break;
+			case '\\': fputs("\\\\", stream);
+				break;
+			case '\n': fputs("\\n", stream);
+				break;
+			case '\r': fputs("\\r", stream);
+				break;
+			case '\t': fputs("\\t", stream);
+				break;
+			default:{
+				if((unsigned char)*string < 0x20)
+					fprintf(stream, "\\u%04x", (unsigned char)*string);
+				else
+					fputc(*string, stream);
+			}
+		}
+	}
+	fputc('"', stream);
+}
+
+/*
+ * Frees space dynamically allocated to the value and everything in it
+ */
+void destroyJson(JsonValue *value){
+	JsonValue *next;
+	for(; value; value = next){
+		next = value->next;
+		destroyJson(value->children);
+		free(value->key);
+		free(value->string);
+		free(value);
+	}
+}
+
+/*
+ * Parses a single value of any type
+ */
+JsonValue* parseValue(char **text, int depth){
+	JsonValue *value = NULL;
+	char *end;
+	skipSpaces(text);
+	if(depth > MAX_JSON_DEPTH)
+		return NULL;
+	switch(**text){
+		case '{': return parseContainer(text, depth, JSON_OBJECT);
+		case '[': return parseContainer(text, depth, JSON_ARRAY);
+		case '"':{
+			value = newValue(JSON_STRING);
+			if(!(value->string = parseString(text))){
+				free(value);
+				return NULL;
+			}
+			return value;
+		}
+	}
+	if(strncmp(*text, "null", 4) == 0){
+		*text += 4;
+		return newValue(JSON_NULL);
+	}
+	if(strncmp(*text, "true", 4) == 0 || strncmp(*text, "false", 5) == 0){
+		value = newValue(JSON_BOOLEAN);
+		value->number = (**text == 't');
+		*text += (**text == 't')? 4 : 5;
+		return value;
+	}
+	if(**text == '-' || isdigit((unsigned char)**text)){
+		value = newValue(JSON_NUMBER);
+		value->number = strtod(*text, &end);
+		*text = end;
+		return value;
+	}
+	return NULL;
+}
+
+/*
+ * Parses an array or an object (according to type) - the elements or members become its children
+ */
+JsonValue* parseContainer(char **text, int depth, int type){
+	JsonValue *container = newValue(type), *child, *last = NULL;
+	char *key = NULL;
+	char closing = (type == JSON_ARRAY)? ']' : '}';
+
+	(*text)++;
+	skipSpaces(text);
+	if(**text == closing){
+		(*text)++;
+		return container;
+	}
+	for(;;){
+		skipSpaces(text);
+		if(type == JSON_OBJECT){
+			if(**text != '"' || !(key = parseString(text)))
+				break;
+			skipSpaces(text);
+			if(**text != ':')
+				break;
+			(*text)++;
+		}
+		if(!(child = parseValue(text, depth + 1)))
+			break;
+		child->key = key;
+		key = NULL;
+		if(last)
+			last->next = child;
+		else
+			container->children = child;
+		last = child;
+		skipSpaces(text);
+		if(**text == closing){
+			(*text)++;
+			return container;
+		}
+		if(**text != ',')
+			break;
+		(*text)++;
+	}
+	free(key);
+	destroyJson(container);
+	return NULL;
+}
+
+/*
+ * Parses a quoted string, decoding its escapes (\u escapes into UTF-8)
+ * Returns a new string or NULL if the string is not valid
+ */
+char* parseString(char **text){
+	char *running = *text + 1, *string, *out;
+	unsigned long codePoint, low;
+
+	/* the decoded string is never longer than its quoted form */
+	string = out = (char*)malloc(strlen(running) + 1);
+	for(; *running != '"'; running++){
+		if(*running == '\0' || (unsigned char)*running < 0x20){
+			free(string);
+			return NULL;
+		}
+		if(*running != '\\'){
+			*out++ = *running;
+			continue;
+		}
+		switch(*++running){
+			case '"': case '\\': case '/': *out++ = *running;
+				break;
+			case 'b': *out++ = '\b';
+				break;
+			case 'f': *out++ = '\f';
+				break;
+			case 'n': *out++ = '\n';
+				break;
+			case 'r': *out++ = '\r';
+				break;
+			case 't': *out++ = '\t';
+				break;
+			case 'u':{
+				if(!parseHexDigits(running + 1, &codePoint)){
+					free(string);
+					return NULL;
+				}
+				running += 4;
+				/* a surrogate pair encodes a single code point beyond the basic plane */
+				if(codePoint >= 0xD800 && codePoint < 0xDC00 && running[1] == '\\' && running[2] == 'u'
+						&& parseHexDigits(running + 3, &low) && low >= 0xDC00 && low < 0xE000){
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					running += 6;
+				}
+				out = putUtf8(out, codePoint);
+			}
+				break;
+			default:{
+				free(string);
+				return NULL;
+			}
+		}
+	}
+	*out = '\0';
+	*text = running + 1;
+	return string;
+}
+
+/*
+ * Converts the 4 hexadecimal digits at text into codePoint
+ * returns 1 if succeeded or 0 if they are not 4 hexadecimal digits
+ */
+int parseHexDigits(char *text, unsigned long *codePoint){
+	int i;
+	*codePoint = 0;
+	for(i = 0; i < 4; i++){
+		if(!isxdigit((unsigned char)text[i]))
+			return 0;
+		*codePoint = *codePoint * 16 + (isdigit((unsigned char)text[i])? text[i] - '0' : tolower((unsigned char)text[i]) - 'a' + 10);
+	}
+	return 1;
+}
+
+/*
+ * Writes the code point in UTF-8 at out
+ * Returns the position following it
+ */
+char* putUtf8(char *out, unsigned long codePoint){
+	if(codePoint < 0x80)
+		*out++ = (char)codePoint;
+	else if(codePoint < 0x800){
+		*out++ = (char)(0xC0 | (codePoint >> 6));
+		*out++ = (char)(0x80 | (codePoint & 0x3F));
+	}
+	else if(codePoint < 0x10000){
+		*out++ = (char)(0xE0 | (codePoint >> 12));
+		*out++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		*out++ = (char)(0x80 | (codePoint & 0x3F));
+	}
+	else{
+		*out++ = (char)(0xF0 | (codePoint >> 18));
+		*out++ = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+		*out++ = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		*out++ = (char)(0x80 | (codePoint & 0x3F));
+	}
+	return out;
+}
+
+/*
+ * Creates a new value of the given type
+ */
+JsonValue* newValue(int type){
+	JsonValue *value = (JsonValue*)calloc(1, sizeof(JsonValue));
+	value->type = type;
+	return value;
+}
+
+/*
+ * Advances the position over white space
+ */
+void skipSpaces(char **text){
+	while(**text == ' ' || **text == '\t' || **text == '\n' || **text == '\r')
+		(*text)++;
+}
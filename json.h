@@ -0,0 +1,57 @@
+/*
+ * json.h
+ * 		module parses JSON text into a tree of values and writes values back as JSON text
+ */
+#ifndef JSON_H
+#define JSON_H
+#include <stdio.h>
+
+enum jsonType { JSON_NULL, JSON_BOOLEAN, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+typedef struct JsonValue {
+	int type;					/* enum jsonType */
+	char *key;					/* name of the member when the value is inside an object, otherwise NULL */
+	char *string;				/* content of a string */
+	double number;				/* value of a number or a boolean (0 or 1) */
+	struct JsonValue *children;	/* elements of an array or members of an object */
+	struct JsonValue *next;		/* next element or member of the same parent */
+} JsonValue;
+
+/*
+ * Parses the JSON text
+ * Returns the root value or NULL if the text is not valid JSON
+ */
+JsonValue* parseJson(char *text);
+
+/*
+ * Returns the member of object with the given key or NULL if object is not an object or has no such member
+ */
+JsonValue* getJsonMember(JsonValue *object, char *key);
+
+/*
+ * Returns the string member of object with the given key or NULL if it is missing or not a string
+ */
+char* getJsonString(JsonValue *object, char *key);
+
+/*
+ * Stores the number member of object with the given key in value
+ * Returns 1 if succeeded or 0 if it is missing or not a number
+ */
+int getJsonInt(JsonValue *object, char *key, int *value);
+
+/*
+ * Writes the value as JSON text
+ */
+void writeJsonValue(FILE *stream, JsonValue *value);
+
+/*
+ * Writes the string as a quoted and escaped JSON string
+ */
+void writeJsonString(FILE *stream, char *string);
+
+/*
+ * Frees space dynamically allocated to the value and everything in it
+ */
+void destroyJson(JsonValue *value);
+
+#endif
@@ -0,0 +1,372 @@
+/*
+ * library.c
+ * 		module reads and writes precompiled libraries - "[name].aml" files holding the already parsed macros
+ * 		and the .extern/.entry declarations of a library source "[name].as" - which are included with
+ * 		".include name"
+ *
+ * 		A precompiled library is laid out as a header, a table of macro records and a strings area, every
+ * 		offset being relative to the strings area, so it is used straight from its read-only mapping.
+ * 		Mapped libraries are kept in a registry identified by device, inode and modification time, so a
+ * 		library included by many files is mapped once, and a rebuilt library is mapped anew. The stale mapping
+ * 		is unmapped then, or once the file including it is expanded (macros of the file point into it).
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "library.h"
+#include "utilities.h"
+#include "constraints.h"
+
+#define LIBRARY_MAGIC_LENGTH 16
+#define LIBRARY_MAGIC "AML " ASSEMBLER_VERSION
+
+typedef struct LibraryHeader {
+	char magic[LIBRARY_MAGIC_LENGTH];	/* LIBRARY_MAGIC - libraries of other versions are rebuilt */
+	unsigned long macroCount;
+	unsigned long declarationsOffset;	/* offset of the declaration lines */
+	unsigned long stringsLength;		/* length of the strings area (including its last null) */
+} LibraryHeader;
+
+typedef struct LibraryMacro {
+	unsigned long nameOffset;
+	unsigned long textOffset;
+} LibraryMacro;
+
+struct Library {
+	char *name;					/* the name the library was last included by */
+	char *image;				/* the mapped file */
+	size_t size;
+	LibraryMacro *macros;
+	char *strings;
+	unsigned long macroCount;
+	dev_t device;
+	ino_t inode;
+	struct timespec modified;
+	unsigned long includedMask;	/* variants of the current file the library is included in */
+	int isStale;				/* a newer version is mapped - unmapped once the current file no longer uses it */
+	struct Library *next;
+};
+
+static Library *libraries = NULL;
+
+Library* mapLibrary(char *name, char *url, struct stat *status);
+void retireLibraries(Library *current);
+void unmapStaleLibraries(void);
+int isValidImage(char *image, size_t size);
+int isNewer(struct timespec *first, struct timespec *second);
+void writeDependencyTargets(FILE *file, char *name, Variant *variants, int variantCount);
+char* getLibrarySourceUrl(Library *library);
+
+/*
+ * Returns the precompiled library "[name].aml" (mapping it if it isn't mapped yet)
+ * or NULL if it doesn't exist, is invalid, or is older than its source "[name].as"
+ */
+Library* openLibrary(char *name){
+	struct stat status, sourceStatus;
+	char *url = constructUrl(name, "aml"), *sourceUrl = constructUrl(name, "as");
+	Library *library = NULL;
+
+	/* a library as old as its source may predate a change made within the same clock tick */
+	if(stat(url, &status) == 0 && !(stat(sourceUrl, &sourceStatus) == 0 && !isNewer(&status.st_mtim, &sourceStatus.st_mtim))){
+		for(library = libraries; library; library = library->next){
+			if(library->device == status.st_dev && library->inode == status.st_ino
+					&& !isNewer(&status.st_mtim, &library->modified) && !isNewer(&library->modified, &status.st_mtim))
+				break;
+		}
+		if(!library){
+			if((library = mapLibrary(name, url, &status)) != NULL)
+				retireLibraries(library);
+		}
+		else if(strcmp(library->name, name) != 0){
+			/* the same file included by another path (another working directory of the daemon) */
+			free(library->name);
+			library->name = (char*)malloc(strlen(name) + 1);
+			strcpy(library->name, name);
+		}
+	}
+	free(sourceUrl);
+	free(url);
+	return library;
+}
+
+/*
+ * Writes the precompiled library "[name].aml" from the parsed macros and the declaration lines
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int writeLibrary(char *name, char **macroNames, char **macroTexts, int macroCount, char *declarations){
+	LibraryHeader header;
+	LibraryMacro record;
+	char *url = constructUrl(name, "aml");
+	char *temporaryUrl = (char*)malloc(strlen(url) + 32);
+	unsigned long offset = 0;
+	int i, success = 1;
+	FILE *file;
+
+	/* written aside and renamed, so other processes never map a partly written library */
+	sprintf(temporaryUrl, "%s.%ld", url, (long)getpid());
+	file = fopen(temporaryUrl, "wb");
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s!\n",temporaryUrl);
+		free(temporaryUrl);
+		free(url);
+		return 0;
+	}
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, LIBRARY_MAGIC);
+	header.macroCount = macroCount;
+	for(i = 0; i < macroCount; i++)
+		offset += strlen(macroNames[i]) + strlen(macroTexts[i]) + 2;
+	header.declarationsOffset = offset;
+	header.stringsLength = offset + strlen(declarations) + 1;
+	fwrite(&header, sizeof(header), 1, file);
+	for(offset = 0, i = 0; i < macroCount; i++){
+		record.nameOffset = offset;
+		record.textOffset = offset + strlen(macroNames[i]) + 1;
+		offset = record.textOffset + strlen(macroTexts[i]) + 1;
+		fwrite(&record, sizeof(record), 1, file);
+	}
+	for(i = 0; i < macroCount; i++){
+		fwrite(macroNames[i], strlen(macroNames[i]) + 1, 1, file);
+		fwrite(macroTexts[i], strlen(macroTexts[i]) + 1, 1, file);
+	}
+	fwrite(declarations, strlen(declarations) + 1, 1, file);
+	if(ferror(file))
+		success = 0;
+	if(fclose(file) != 0)
+		success = 0;
+	if(success && rename(temporaryUrl, url) != 0)
+		success = 0;
+	if(!success){
+		fprintf(stderr,"Error: couldn't write file %s!\n",url);
+		remove(temporaryUrl);
+	}
+	free(temporaryUrl);
+	free(url);
+	return success;
+}
+
+/*
+ * Access the content of a library - the name and text of macro i and the declaration lines
+ */
+int getLibraryMacroCount(Library *library){
+	return (int)library->macroCount;
+}
+
+char* getLibraryMacroName(Library *library, int i){
+	return library->strings + library->macros[i].nameOffset;
+}
+
+char* getLibraryMacroText(Library *library, int i){
+	return library->strings + library->macros[i].textOffset;
+}
+
+char* getLibraryDeclarations(Library *library){
+	return library->strings + ((LibraryHeader*)library->image)->declarationsOffset;
+}
+
+/*
+ * Forgets which libraries were included, before a new file is expanded
+ */
+void resetLibraryUse(void){
+	Library *library;
+	for(library = libraries; library; library = library->next)
+		library->includedMask = 0;
+	unmapStaleLibraries();
+}
+
+/*
+ * Marks the library as included in the variants of variantMask
+ * Returns the mask of the variants it wasn't already included in
+ */
+unsigned long markLibraryUse(Library *library, unsigned long variantMask){
+	variantMask &= ~library->includedMask;
+	library->includedMask |= variantMask;
+	return variantMask;
+}
+
+/*
+ * Writes the make style dependency file "[name].d", listing the source and libraries
+ * the outputs of every variant were built from
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int writeDependencyFile(char *name, Variant *variants, int variantCount){
+	char *url = constructUrl(name, "d");
+	char *sourceUrl;
+	FILE *file = fopen(url, "w");
+	Library *library;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s!\n",url);
+		free(url);
+		return 0;
+	}
+	writeDependencyTargets(file, name, variants, variantCount);
+	fprintf(file, ": %s.as", name);
+	for(library = libraries; library; library = library->next){
+		if(library->includedMask){
+			sourceUrl = getLibrarySourceUrl(library);
+			fprintf(file, " \\\n  %s", sourceUrl);
+			free(sourceUrl);
+		}
+	}
+	fprintf(file, "\n");
+	/* an empty rule for every library keeps make going when a library is deleted */
+	for(library = libraries; library; library = library->next){
+		if(library->includedMask){
+			sourceUrl = getLibrarySourceUrl(library);
+			fprintf(file, "\n%s:\n", sourceUrl);
+			free(sourceUrl);
+		}
+	}
+	fclose(file);
+	free(url);
+	return 1;
+}
+
+/*
+ * Unmaps every library
+ */
+void closeLibraries(void){
+	Library *next;
+	for(; libraries; libraries = next){
+		next = libraries->next;
+		munmap(libraries->image, libraries->size);
+		free(libraries->name);
+		free(libraries);
+	}
+}
+
+/*
+ * Maps the precompiled library at url and adds it to the registry
+ * Returns the library or NULL if it can't be mapped or is invalid
+ */
+Library* mapLibrary(char *name, char *url, struct stat *status){
+	Library *library;
+	char *image;
+	int fd = open(url, O_RDONLY);
+
+	if(fd < 0)
+		return NULL;
+	image = (status->st_size > 0)? (char*)mmap(NULL, status->st_size, PROT_READ, MAP_SHARED, fd, 0) : (char*)MAP_FAILED;
+	close(fd); /* the mapping stays valid */
+	if(image == (char*)MAP_FAILED)
+		return NULL;
+	if(!isValidImage(image, status->st_size)){
+		munmap(image, status->st_size);
+		return NULL;
+	}
+	library = (Library*)malloc(sizeof(Library));
+	library->name = (char*)malloc(strlen(name) + 1);
+	strcpy(library->name, name);
+	library->image = image;
+	library->size = status->st_size;
+	library->macroCount = ((LibraryHeader*)image)->macroCount;
+	library->macros = (LibraryMacro*)(image + sizeof(LibraryHeader));
+	library->strings = image + sizeof(LibraryHeader) + library->macroCount * sizeof(LibraryMacro);
+	library->device = status->st_dev;
+	library->inode = status->st_ino;
+	library->modified = status->st_mtim;
+	library->includedMask = 0;
+	library->isStale = 0;
+	library->next = libraries;
+	libraries = library;
+	return library;
+}
+
+/*
+ * Marks the older versions of a newly mapped library as stale - those mapped from the same file
+ * (the same inode, or the same name, as a rebuilt library replaces the file) with an earlier modification time -
+ * and unmaps the ones the current file doesn't use
+ */
+void retireLibraries(Library *current){
+	Library *library;
+	for(library = current->next; library; library = library->next){
+		if(((library->device == current->device && library->inode == current->inode) || strcmp(library->name, current->name) == 0)
+				&& isNewer(&current->modified, &library->modified))
+			library->isStale = 1;
+	}
+	unmapStaleLibraries();
+}
+
+/*
+ * Unmaps the stale libraries the current file doesn't use and removes them from the registry
+ */
+void unmapStaleLibraries(void){
+	Library **link = &libraries, *library;
+	while((library = *link) != NULL){
+		if(library->isStale && !library->includedMask){
+			*link = library->next;
+			munmap(library->image, library->size);
+			free(library->name);
+			free(library);
+		}
+		else
+			link = &library->next;
+	}
+}
+
+/*
+ * Checks that a mapped file is a precompiled library of this version with every offset inside the file
+ * returns 1 for true 0 for false
+ */
+int isValidImage(char *image, size_t size){
+	LibraryHeader *header = (LibraryHeader*)image;
+	LibraryMacro *macros;
+	unsigned long i;
+
+	if(size < sizeof(LibraryHeader) || strncmp(header->magic, LIBRARY_MAGIC, LIBRARY_MAGIC_LENGTH) != 0)
+		return 0;
+	if(header->macroCount > (size - sizeof(LibraryHeader)) / sizeof(LibraryMacro))
+		return 0;
+	if(header->stringsLength == 0 || size != sizeof(LibraryHeader) + header->macroCount * sizeof(LibraryMacro) + header->stringsLength)
+		return 0;
+	if(image[size - 1] != '\0' || header->declarationsOffset >= header->stringsLength)
+		return 0;
+	macros = (LibraryMacro*)(image + sizeof(LibraryHeader));
+	for(i = 0; i < header->macroCount; i++){
+		if(macros[i].nameOffset >= header->stringsLength || macros[i].textOffset >= header->stringsLength)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Checks if the time first is later than the time second
+ * returns 1 for true 0 for false
+ */
+int isNewer(struct timespec *first, struct timespec *second){
+	if(first->tv_sec != second->tv_sec)
+		return first->tv_sec > second->tv_sec;
+	return first->tv_nsec > second->tv_nsec;
+}
+
+/*
+ * Writes the outputs of every variant as the targets of the dependency rule
+ */
+void writeDependencyTargets(FILE *file, char *name, Variant *variants, int variantCount){
+	char *variantName;
+	int i;
+	for(i = 0; i < variantCount; i++){
+		variantName = constructVariantName(name, &variants[i]);
+		fprintf(file, "%s%s.am %s.ob %s.ent %s.ext", (i)? " " : "", variantName, variantName, variantName, variantName);
+		free(variantName);
+	}
+}
+
+/*
+ * Returns the file a library is built from - its source if it exists, otherwise the precompiled library itself
+ */
+char* getLibrarySourceUrl(Library *library){
+	char *url = constructUrl(library->name, "as");
+	if(access(url, F_OK) != 0){
+		free(url);
+		url = constructUrl(library->name, "aml");
+	}
+	return url;
+}
@@ -0,0 +1,58 @@
+/*
+ * library.h
+ * 		module reads and writes precompiled libraries - "[name].aml" files holding the already parsed macros
+ * 		and the .extern/.entry declarations of a library source "[name].as" - which are included with
+ * 		".include name"
+ *
+ * 		libraries are mapped into memory read-only once and shared by every file assembled in the same run
+ */
+#ifndef LIBRARY_H
+#define LIBRARY_H
+#include "preprocessor.h"
+
+typedef struct Library Library;
+
+/*
+ * Returns the precompiled library "[name].aml" (mapping it if it isn't mapped yet)
+ * or NULL if it doesn't exist, is invalid, or is older than its source "[name].as"
+ */
+Library* openLibrary(char *name);
+
+/*
+ * Writes the precompiled library "[name].aml" from the parsed macros and the declaration lines
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int writeLibrary(char *name, char **macroNames, char **macroTexts, int macroCount, char *declarations);
+
+/*
+ * Access the content of a library - the name and text of macro i and the declaration lines
+ */
+int getLibraryMacroCount(Library *library);
+char* getLibraryMacroName(Library *library, int i);
+char* getLibraryMacroText(Library *library, int i);
+char* getLibraryDeclarations(Library *library);
+
+/*
+ * Forgets which libraries were included, before a new file is expanded
+ */
+void resetLibraryUse(void);
+
+/*
+ * Marks the library as included in the variants of variantMask
+ * Returns the mask of the variants it wasn't already included in
+ */
+unsigned long markLibraryUse(Library *library, unsigned long variantMask);
+
+/*
+ * Writes the make style dependency file "[name].d", listing the source and libraries
+ * the outputs of every variant were built from
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int writeDependencyFile(char *name, Variant *variants, int variantCount);
+
+/*
+ * Unmaps every library
+ */
+void closeLibraries(void);
+
+#endif
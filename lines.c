@@ -0,0 +1,237 @@
+/*
+ * lines.c
+ * 		module keeps the relation between addresses and source lines - the line table "[name].lin" written with --lines
+ *
+ * 		The preprocessor records where every line of the expanded source came from (a line of the source, or the
+ * 		invocation of a macro), and the first pass records the address of every statement. Each line of the table
+ * 		holds the first address of a statement (or of a label on a line of its own), the source line it came from,
+ * 		the macro it was expanded from and the label it defines ("-" if none), the numbers written in base 32.
+ * 		The code statements are written first, followed by the data statements, so the table is sorted by address.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "lines.h"
+#include "object.h"
+#include "output.h"
+#include "utilities.h"
+#include "preprocessor.h"
+
+#define INITIAL_CAPACITY 64
+
+/* the origin of every line of the expanded source of every variant */
+typedef struct LineOrigins {
+	int *sourceLines;
+	int *macros;		/* index of the name of the macro, -1 if none */
+	int count;
+	int capacity;
+} LineOrigins;
+
+static LineOrigins origins[MAX_VARIANTS];
+static char **macroNames = NULL;
+static int macroNameCount = 0;
+static int selectedVariant = 0;
+
+int findMacroName(char *macro);
+void writeLineEntry(FILE *file, int address, int line, char *macro, char *label);
+
+/*
+ * Forgets the origins recorded for the previous source, before it is expanded again
+ */
+void resetLineOrigins(void){
+	int i;
+	for(i = 0; i < MAX_VARIANTS; i++){
+		free(origins[i].sourceLines);
+		free(origins[i].macros);
+		memset(&origins[i], 0, sizeof(LineOrigins));
+	}
+	for(i = 0; i < macroNameCount; i++)
+		free(macroNames[i]);
+	free(macroNames);
+	macroNames = NULL;
+	macroNameCount = 0;
+}
+
+/*
+ * Records the origin of the lines of text written to the expanded source of a variant - the source line
+ * and the macro (NULL if none) they were expanded from
+ */
+void recordLineOrigins(int variant, int sourceLine, char *macro, char *text){
+	LineOrigins *variantOrigins = &origins[variant];
+	int macroIndex = (macro)? findMacroName(macro) : -1;
+	for(; *text; text = (strchr(text, '\n'))? strchr(text, '\n') + 1 : text + strlen(text)){
+		if(variantOrigins->count == variantOrigins->capacity){
+			variantOrigins->capacity = (variantOrigins->capacity)? variantOrigins->capacity * 2 : INITIAL_CAPACITY;
+			variantOrigins->sourceLines = (int*)realloc(variantOrigins->sourceLines, sizeof(int) * variantOrigins->capacity);
+			variantOrigins->macros = (int*)realloc(variantOrigins->macros, sizeof(int) * variantOrigins->capacity);
+		}
+		variantOrigins->sourceLines[variantOrigins->count] = sourceLine;
+		variantOrigins->macros[variantOrigins->count++] = macroIndex;
+	}
+}
+
+/*
+ * Returns the index of the name of the macro, adding the name if it is new
+ */
+int findMacroName(char *macro){
+	int i;
+	for(i = 0; i < macroNameCount && strcmp(macroNames[i], macro) != 0; i++)
+		;
+	if(i == macroNameCount){
+		macroNames = (char**)realloc(macroNames, sizeof(char*) * (macroNameCount + 1));
+		macroNames[i] = (char*)malloc(strlen(macro) + 1);
+		strcpy(macroNames[i], macro);
+		macroNameCount++;
+	}
+	return i;
+}
+
+/*
+ * Selects the variant whose origins the line tables written next translate lines by
+ */
+void selectLineOrigins(int variant){
+	selectedVariant = variant;
+}
+
+/*
+ * Returns the source line a line of the expanded source came from (by the origins of the selected variant),
+ * storing the name of the macro it was expanded from in macro (NO_NAME if none)
+ */
+int getLineOrigin(int line, char **macro){
+	LineOrigins *variantOrigins = &origins[selectedVariant];
+	/* a line the preprocessor didn't record keeps its line in the expanded source */
+	if(line < 1 || line > variantOrigins->count){
+		*macro = NO_NAME;
+		return line;
+	}
+	*macro = (variantOrigins->macros[line - 1] >= 0)? macroNames[variantOrigins->macros[line - 1]] : NO_NAME;
+	return variantOrigins->sourceLines[line - 1];
+}
+
+/*
+ * Returns a new empty line table
+ */
+LineTable* createLineTable(void){
+	return (LineTable*)calloc(1, sizeof(LineTable));
+}
+
+/*
+ * Adds the statement of a line of the expanded source, starting at the address (or data offset) and
+ * defining the label (NULL if none)
+ */
+void addLineEntry(LineTable *table, int address, int isData, int line, char *label){
+	LineEntry *entry;
+	if(table->count == table->capacity){
+		table->capacity = (table->capacity)? table->capacity * 2 : INITIAL_CAPACITY;
+		table->entries = (LineEntry*)realloc(table->entries, sizeof(LineEntry) * table->capacity);
+	}
+	entry = &table->entries[table->count++];
+	entry->address = address;
+	entry->isData = isData;
+	entry->line = line;
+	strcpy(entry->macro, NO_NAME);
+	strcpy(entry->label, (label && *label)? label : NO_NAME);
+}
+
+/*
+ * Writes the table to "[name].lin" - data entries moved by ic and every line translated to its origin
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeLineTable(char *name, LineTable *table, int ic){
+	char *url = constructUrl(name, "lin");
+	FILE *file = fopen(url, "w");
+	LineEntry *entry;
+	char *macro;
+	int i, isData, line;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	for(isData = 0; isData <= 1; isData++){
+		for(i = 0; i < table->count; i++){
+			entry = &table->entries[i];
+			if(entry->isData != isData)
+				continue;
+			line = getLineOrigin(entry->line, &macro);
+			writeLineEntry(file, entry->address + ((isData)? ic : 0), line, macro, entry->label);
+		}
+	}
+	fclose(file);
+	free(url);
+	return 1;
+}
+
+void writeLineEntry(FILE *file, int address, int line, char *macro, char *label){
+	char *address32 = convertDecimalBase32(address), *line32 = convertDecimalBase32(line);
+	fprintf(file,"%s %s %s %s\n",address32,line32,macro,label);
+	free(address32);
+	free(line32);
+}
+
+/*
+ * Reads the table of "[name].lin" into a new table
+ * Returns the table or NULL if the file can't be read or is malformed (reporting why)
+ */
+LineTable* readLineTable(char *name){
+	char line[MAX_LINE_LENGTH * 2];
+	char *url = constructUrl(name, "lin"), *fields[4];
+	FILE *file = fopen(url, "r");
+	LineTable *table;
+	int i, address, sourceLine, lineNumber = 0;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't read line table %s (assemble the program with --lines)\n",url);
+		free(url);
+		return NULL;
+	}
+	table = createLineTable();
+	while(table && fgets(line, sizeof(line), file)){
+		lineNumber++;
+		for(i = 0; i < 4 && (fields[i] = strtok((i)? NULL : line, " \t\n")); i++)
+			;
+		if(i == 0)
+			continue;
+		if(i < 4 || !parseBase32(fields[0], &address) || !parseBase32(fields[1], &sourceLine)
+				|| strlen(fields[2]) >= MAX_LINE_LENGTH || strlen(fields[3]) >= MAX_LABEL_NAME_LENGTH
+				|| (table->count && address < table->entries[table->count - 1].address)){
+			fprintf(stderr,"Error: malformed entry in line %d of %s\n",lineNumber,url);
+			destroyLineTable(table);
+			table = NULL;
+			continue;
+		}
+		addLineEntry(table, address, 0, sourceLine, fields[3]);
+		strcpy(table->entries[table->count - 1].macro, fields[2]);
+	}
+	fclose(file);
+	free(url);
+	return table;
+}
+
+/*
+ * Returns the entry of the statement holding the address, or NULL if there is none before it
+ */
+LineEntry* findLineEntry(LineTable *table, int address){
+	int first = 0, last = table->count - 1, middle;
+	if(!table->count || table->entries[0].address > address)
+		return NULL;
+	while(first < last){
+		middle = (first + last + 1) / 2;
+		if(table->entries[middle].address <= address)
+			first = middle;
+		else
+			last = middle - 1;
+	}
+	return &table->entries[first];
+}
+
+/*
+ * Frees space dynamically allocated to the table
+ */
+void destroyLineTable(LineTable *table){
+	if(!table)
+		return;
+	free(table->entries);
+	free(table);
+}
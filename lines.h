@@ -0,0 +1,85 @@
+/*
+ * lines.h
+ * 		module keeps the relation between addresses and source lines - the line table "[name].lin" written with --lines
+ *
+ * 		The preprocessor records where every line of the expanded source came from (a line of the source, or the
+ * 		invocation of a macro), and the first pass records the address of every statement. Each line of the table
+ * 		holds the first address of a statement (or of a label on a line of its own), the source line it came from,
+ * 		the macro it was expanded from and the label it defines ("-" if none), the numbers written in base 32.
+ */
+#ifndef LINES_H
+#define LINES_H
+#include "constraints.h"
+
+#define NO_NAME "-"
+
+typedef struct LineEntry {
+	int address;		/* the first address of the statement (an offset in the data segment until written) */
+	int line;			/* line of the expanded source, the source line once read from a table */
+	int isData;
+	char macro[MAX_LINE_LENGTH];		/* the macro the statement was expanded from, NO_NAME if none */
+	char label[MAX_LABEL_NAME_LENGTH];	/* the label the statement defines, NO_NAME if none */
+} LineEntry;
+
+typedef struct LineTable {
+	LineEntry *entries;
+	int count;
+	int capacity;
+} LineTable;
+
+/*
+ * Forgets the origins recorded for the previous source, before it is expanded again
+ */
+void resetLineOrigins(void);
+
+/*
+ * Records the origin of the lines of text written to the expanded source of a variant - the source line
+ * and the macro (NULL if none) they were expanded from
+ */
+void recordLineOrigins(int variant, int sourceLine, char *macro, char *text);
+
+/*
+ * Selects the variant whose origins the line tables written next translate lines by
+ */
+void selectLineOrigins(int variant);
+
+/*
+ * Returns the source line a line of the expanded source came from (by the origins of the selected variant),
+ * storing the name of the macro it was expanded from in macro (NO_NAME if none)
+ */
+int getLineOrigin(int line, char **macro);
+
+/*
+ * Returns a new empty line table
+ */
+LineTable* createLineTable(void);
+
+/*
+ * Adds the statement of a line of the expanded source, starting at the address (or data offset) and
+ * defining the label (NULL if none)
+ */
+void addLineEntry(LineTable *table, int address, int isData, int line, char *label);
+
+/*
+ * Writes the table to "[name].lin" - data entries moved by ic and every line translated to its origin
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeLineTable(char *name, LineTable *table, int ic);
+
+/*
+ * Reads the table of "[name].lin" into a new table
+ * Returns the table or NULL if the file can't be read or is malformed (reporting why)
+ */
+LineTable* readLineTable(char *name);
+
+/*
+ * Returns the entry of the statement holding the address, or NULL if there is none before it
+ */
+LineEntry* findLineEntry(LineTable *table, int address);
+
+/*
+ * Frees space dynamically allocated to the table
+ */
+void destroyLineTable(LineTable *table);
+
+#endif
@@ -0,0 +1,357 @@
+/*
+ * link.c
+ * 		the linker - combines separately assembled modules into a single program
+ *
+ * 		Usage: linker [-o name] [--reloc] [--memory N] [--load-address N] [--word-width N] module|archive...
+ * 		Each module is given by the name of its files (without extension) - "[module].ob" along with
+ * 		"[module].ent" and "[module].ext" when the module has entries or externs.
+ * 		Archives (".oar" files, see archive.h) only contribute the members defining symbols which the
+ * 		modules used so far leave undefined - found through the index of the archive.
+ *
+ * 		The code of every module is laid out contiguously from the load address, followed by the data of
+ * 		every module, so the program keeps the layout of a single assembled file. Relocatable words are moved
+ * 		along with the segment they address, and every extern use is resolved through an index of the entries
+ * 		of all modules - a hash table grown with the amount of entries, so resolution stays linear in the
+ * 		size of the program however many modules it has.
+ * 		The program is written to "[name].ob", along with its entries in "[name].ent"
+ * 		(and its relocatable words in "[name].rel" with --reloc, see rebase.c).
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "object.h"
+#include "archive.h"
+#include "geometry.h"
+#include "constraints.h"
+
+#define DEFAULT_OUTPUT_NAME "program"
+#define INITIAL_INDEX_BUCKETS 64
+
+typedef struct IndexedSymbol {
+	char *name;
+	int address;			/* address of the symbol in the linked program */
+	int module;				/* index of the module defining the symbol */
+	struct IndexedSymbol *next;
+} IndexedSymbol;
+
+typedef struct SymbolIndex {
+	IndexedSymbol **buckets;
+	int bucketCount;
+	int count;
+} SymbolIndex;
+
+ObjectModule** pullArchiveMembers(ObjectModule **modules, int *moduleCount, Archive **archives, int archiveCount);
+int linkModules(ObjectModule **modules, int moduleCount, char *outputName, int writeRelocations);
+int relocateAddress(ObjectModule *module, int address, int codeBase, int dataBase);
+int indexSymbol(SymbolIndex *index, char *name, int address, int module);
+IndexedSymbol* findIndexedSymbol(SymbolIndex *index, char *name);
+void growIndex(SymbolIndex *index);
+unsigned long hashSymbol(char *name);
+void destroyIndex(SymbolIndex *index);
+
+int main(int argc, char **argv){
+	ObjectModule **modules = (ObjectModule**)malloc(sizeof(ObjectModule*) * argc);
+	Archive **archives = (Archive**)malloc(sizeof(Archive*) * argc);
+	char *outputName = DEFAULT_OUTPUT_NAME;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, moduleCount = 0, readCount = 0, archiveCount = 0, openCount = 0, writeRelocations = 0, success = 1;
+	char **names = (char**)malloc(sizeof(char*) * argc), **archiveNames = (char**)malloc(sizeof(char*) * argc);
+	size_t length;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "-o") == 0){
+			if(i + 1 < argc)
+				outputName = argv[++i];
+			else{
+				fprintf(stderr,"Error: option '-o' requires a value\n");
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i], "--reloc") == 0)
+			writeRelocations = 1;
+		else if(argv[i][0] == '-'){
+			fprintf(stderr,"Error: unknown option '%s'\n",argv[i]);
+			success = 0;
+		}
+		else if((length = strlen(argv[i])) > strlen(ARCHIVE_EXTENSION)
+				&& strcmp(argv[i] + length - strlen(ARCHIVE_EXTENSION), ARCHIVE_EXTENSION) == 0)
+			archiveNames[archiveCount++] = argv[i];
+		else
+			names[moduleCount++] = argv[i];
+	}
+	if(success && !moduleCount){
+		fprintf(stderr,"Usage: linker [-o name] [--reloc] [--memory N] [--load-address N] [--word-width N] module...\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+	for(; success && readCount < moduleCount; readCount++)
+		success = (modules[readCount] = readObjectModule(names[readCount])) != NULL;
+	for(; success && openCount < archiveCount; openCount++)
+		success = (archives[openCount] = openArchive(archiveNames[openCount])) != NULL;
+	if(success){
+		modules = pullArchiveMembers(modules, &moduleCount, archives, archiveCount);
+		readCount = moduleCount;
+		success = linkModules(modules, moduleCount, outputName, writeRelocations);
+	}
+
+	for(i = 0; i < readCount; i++)
+		destroyObjectModule(modules[i]);
+	for(i = 0; i < openCount; i++)
+		closeArchive(archives[i]);
+	free(modules);
+	free(archives);
+	free(names);
+	free(archiveNames);
+	return !success;
+}
+
+/*
+ * Adds to the modules every archive member defining a symbol the modules use but don't define -
+ * the externs of an added member are resolved the same way, each symbol from the first archive defining it
+ * Returns the (reallocated) modules, moduleCount is updated
+ */
+ObjectModule** pullArchiveMembers(ObjectModule **modules, int *moduleCount, Archive **archives, int archiveCount){
+	SymbolIndex defined = {NULL, 0, 0};
+	ObjectSymbol *symbol, *entry;
+	char **pulled = (char**)malloc(sizeof(char*) * (archiveCount + 1));
+	int i, j, member, capacity = *moduleCount;
+
+	growIndex(&defined);
+	for(j = 0; j < archiveCount; j++)
+		pulled[j] = (char*)calloc(archives[j]->memberCount + 1, sizeof(char));
+	for(i = 0; i < *moduleCount; i++){
+		for(symbol = modules[i]->entries; symbol; symbol = symbol->next)
+			indexSymbol(&defined, symbol->name, 0, i);
+	}
+	/* modules pulled meanwhile are appended, so their externs are resolved by the same loop */
+	for(i = 0; i < *moduleCount; i++){
+		for(symbol = modules[i]->externs; symbol; symbol = symbol->next){
+			if(findIndexedSymbol(&defined, symbol->name))
+				continue;
+			for(j = 0; j < archiveCount && (member = findArchiveSymbol(archives[j], symbol->name)) < 0; j++)
+				;
+			if(j == archiveCount || pulled[j][member])
+				continue; /* left for linkModules to report */
+			pulled[j][member] = 1;
+			if(*moduleCount == capacity){
+				capacity = capacity * 2 + 1;
+				modules = (ObjectModule**)realloc(modules, sizeof(ObjectModule*) * capacity);
+			}
+			modules[*moduleCount] = extractArchiveMember(archives[j], member);
+			for(entry = modules[*moduleCount]->entries; entry; entry = entry->next)
+				indexSymbol(&defined, entry->name, 0, *moduleCount);
+			(*moduleCount)++;
+		}
+	}
+	for(j = 0; j < archiveCount; j++)
+		free(pulled[j]);
+	free(pulled);
+	destroyIndex(&defined);
+	return modules;
+}
+
+/*
+ * Lays out the modules, resolves their externs and writes the linked program to "[outputName].ob" and ".ent"
+ * (and ".rel" if writeRelocations is set)
+ * Returns 1 if succeeded or 0 if encountered errors (reporting them)
+ */
+int linkModules(ObjectModule **modules, int moduleCount, char *outputName, int writeRelocations){
+	SymbolIndex index = {NULL, 0, 0};
+	ObjectModule program;
+	ObjectSymbol *symbol, *entries = NULL, *entryTail = NULL;
+	IndexedSymbol *indexed;
+	int *codeBases = (int*)malloc(sizeof(int) * moduleCount), *dataBases = (int*)malloc(sizeof(int) * moduleCount);
+	int i, j, word, address, *words, *relocations, relocationCount = 0, success = 1;
+
+	memset(&program, 0, sizeof(program));
+	program.name = outputName;
+	for(i = 0; i < moduleCount; i++){
+		codeBases[i] = getLoadAddress() + program.codeLength;
+		program.codeLength += modules[i]->codeLength;
+	}
+	for(i = 0; i < moduleCount; i++){
+		dataBases[i] = getLoadAddress() + program.codeLength + program.dataLength;
+		program.dataLength += modules[i]->dataLength;
+	}
+	if(getLoadAddress() + program.codeLength + program.dataLength > getMemoryLength()){
+		fprintf(stderr,"Error: the linked program needs %d words but only %d are available\n",
+				program.codeLength + program.dataLength, getMemoryLength() - getLoadAddress());
+		free(codeBases);
+		free(dataBases);
+		return 0;
+	}
+
+	/* every entry is indexed at its address in the linked program */
+	growIndex(&index);
+	for(i = 0; i < moduleCount; i++){
+		for(symbol = modules[i]->entries; symbol; symbol = symbol->next){
+			if((word = relocateAddress(modules[i], symbol->address, codeBases[i], dataBases[i])) < 0){
+				fprintf(stderr,"Error: entry '%s' of %s is at %d, which is outside of the program\n",
+						symbol->name, modules[i]->name, symbol->address);
+				success = 0;
+			}
+			else if(!indexSymbol(&index, symbol->name, word, i)){
+				fprintf(stderr,"Error: symbol '%s' is an entry of both %s and %s\n",symbol->name,
+						modules[findIndexedSymbol(&index, symbol->name)->module]->name, modules[i]->name);
+				success = 0;
+			}
+		}
+	}
+
+	program.words = (int*)calloc(program.codeLength + program.dataLength + 1, sizeof(int));
+	for(i = 0; i < moduleCount; i++){
+		words = program.words + codeBases[i] - getLoadAddress();
+		for(j = 0; j < modules[i]->codeLength; j++){
+			word = modules[i]->words[j];
+			if((word & ARE_MASK) == RELOCATABLE_ARE){
+				if((address = relocateAddress(modules[i], word >> ARE_BITS, codeBases[i], dataBases[i])) < 0){
+					fprintf(stderr,"Error: %s references %d, which is outside of the program\n",modules[i]->name,word >> ARE_BITS);
+					success = 0;
+					continue;
+				}
+				word = (address << ARE_BITS) | RELOCATABLE_ARE;
+			}
+			words[j] = word;
+		}
+		/* data words hold plain values, only their place changes */
+		memcpy(program.words + dataBases[i] - getLoadAddress(), modules[i]->words + modules[i]->codeLength,
+				sizeof(int) * modules[i]->dataLength);
+		for(symbol = modules[i]->externs; symbol; symbol = symbol->next){
+			j = symbol->address - getLoadAddress();
+			if(j < 0 || j >= modules[i]->codeLength || (modules[i]->words[j] & ARE_MASK) != EXTERNAL_ARE){
+				fprintf(stderr,"Error: %s uses extern '%s' at %d, which isn't an extern word\n",
+						modules[i]->name, symbol->name, symbol->address);
+				success = 0;
+			}
+			else if(!(indexed = findIndexedSymbol(&index, symbol->name))){
+				fprintf(stderr,"Error: undefined symbol '%s' used by %s\n",symbol->name,modules[i]->name);
+				success = 0;
+			}
+			else
+				words[j] = (indexed->address << ARE_BITS) | RELOCATABLE_ARE;
+		}
+	}
+
+	/* the entries of the program keep the order of the modules */
+	for(i = 0; success && i < moduleCount; i++){
+		for(symbol = modules[i]->entries; symbol; symbol = symbol->next){
+			if(entryTail)
+				entryTail = entryTail->next = (ObjectSymbol*)malloc(sizeof(ObjectSymbol));
+			else
+				entries = entryTail = (ObjectSymbol*)malloc(sizeof(ObjectSymbol));
+			strcpy(entryTail->name, symbol->name);
+			entryTail->address = findIndexedSymbol(&index, symbol->name)->address;
+			entryTail->next = NULL;
+		}
+	}
+	if(success)
+		success = writeObjectFile(outputName, &program) && writeSymbolFile(outputName, "ent", entries);
+	if(success && writeRelocations){
+		/* every address word of the linked program is relocatable - resolved externs included */
+		relocations = (int*)malloc(sizeof(int) * (program.codeLength + 1));
+		for(j = 0; j < program.codeLength; j++){
+			if((program.words[j] & ARE_MASK) == RELOCATABLE_ARE)
+				relocations[relocationCount++] = getLoadAddress() + j;
+		}
+		success = writeRelocationFile(outputName, getLoadAddress(), relocations, relocationCount);
+		free(relocations);
+	}
+
+	destroyObjectSymbols(entries);
+	destroyIndex(&index);
+	free(program.words);
+	free(codeBases);
+	free(dataBases);
+	return success;
+}
+
+/*
+ * Returns the address in the linked program of an address in the module,
+ * moving it with the segment (code or data) it belongs to, or -1 if the address is outside of the module
+ */
+int relocateAddress(ObjectModule *module, int address, int codeBase, int dataBase){
+	int offset = address - getLoadAddress();
+	if(offset < 0 || offset >= module->codeLength + module->dataLength)
+		return -1;
+	if(offset < module->codeLength)
+		return codeBase + offset;
+	return dataBase + offset - module->codeLength;
+}
+
+/*
+ * Adds a symbol to the index, growing the index once it holds twice as many symbols as buckets
+ * Returns 1 if succeeded or 0 if the symbol is already indexed
+ */
+int indexSymbol(SymbolIndex *index, char *name, int address, int module){
+	IndexedSymbol *symbol;
+	unsigned long bucket;
+	if(findIndexedSymbol(index, name))
+		return 0;
+	if(index->count >= index->bucketCount * 2)
+		growIndex(index);
+	symbol = (IndexedSymbol*)malloc(sizeof(IndexedSymbol));
+	symbol->name = name;
+	symbol->address = address;
+	symbol->module = module;
+	bucket = hashSymbol(name) % index->bucketCount;
+	symbol->next = index->buckets[bucket];
+	index->buckets[bucket] = symbol;
+	index->count++;
+	return 1;
+}
+
+/*
+ * Returns the indexed symbol with the given name or NULL if there is none
+ */
+IndexedSymbol* findIndexedSymbol(SymbolIndex *index, char *name){
+	IndexedSymbol *symbol = index->buckets[hashSymbol(name) % index->bucketCount];
+	while(symbol && strcmp(symbol->name, name) != 0)
+		symbol = symbol->next;
+	return symbol;
+}
+
+/*
+ * Doubles the amount of buckets of the index (or creates its first buckets), moving the symbols to their new buckets
+ */
+void growIndex(SymbolIndex *index){
+	int i, bucketCount = (index->bucketCount)? index->bucketCount * 2 : INITIAL_INDEX_BUCKETS;
+	IndexedSymbol **buckets = (IndexedSymbol**)calloc(bucketCount, sizeof(IndexedSymbol*));
+	IndexedSymbol *symbol, *next;
+	unsigned long bucket;
+
+	for(i = 0; i < index->bucketCount; i++){
+		for(symbol = index->buckets[i]; symbol; symbol = next){
+			next = symbol->next;
+			bucket = hashSymbol(symbol->name) % bucketCount;
+			symbol->next = buckets[bucket];
+			buckets[bucket] = symbol;
+		}
+	}
+	free(index->buckets);
+	index->buckets = buckets;
+	index->bucketCount = bucketCount;
+}
+
+unsigned long hashSymbol(char *name){
+	unsigned long hash = 5381;
+	while(*name)
+		hash = hash * 33 + (unsigned char)*name++;
+	return hash;
+}
+
+/*
+ * Frees space dynamically allocated to the index (the names belong to the modules)
+ */
+void destroyIndex(SymbolIndex *index){
+	IndexedSymbol *symbol, *next;
+	int i;
+	for(i = 0; i < index->bucketCount; i++){
+		for(symbol = index->buckets[i]; symbol; symbol = next){
+			next = symbol->next;
+			free(symbol);
+		}
+	}
+	free(index->buckets);
+}
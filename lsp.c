@@ -0,0 +1,1347 @@
+/*
+ * lsp.c
+ * 		module runs the assembler as a language server, speaking the Language Server Protocol over stdin/stdout
+ * 		it reports diagnostics while a file is edited and answers go to definition and hover requests
+ *
+ * 		Every open document keeps its lines together with what decoding each of them produced: the words it
+ * 		occupies, the labels it defines, the labels it references and its own diagnostics. The macro table and
+ * 		a symbol table - mapping every label to the lines defining and referencing it - stay resident as well.
+ * 		An edit only decodes the lines it replaced, the word offsets of the following lines are recomputed by a
+ * 		running sum, and only the references to labels whose definitions changed are checked again.
+ * 		Edits touching macro definitions, conditional blocks or includes re-analyze the whole document, since
+ * 		they change how the following lines are expanded.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "lsp.h"
+#include "json.h"
+#include "preprocessor.h"
+#include "library.h"
+#include "assembly.h"
+#include "command.h"
+#include "data.h"
+#include "utilities.h"
+#include "diagnostics.h"
+#include "constraints.h"
+#include "geometry.h"
+
+#define SYMBOL_BUCKETS 1024
+#define MAX_HEADER_LENGTH 256
+#define MAX_MESSAGE_LENGTH (64L * 1024 * 1024)
+#define MAX_LSP_CONDITIONAL_DEPTH 32
+#define MAX_SOURCE_LINE_LENGTH (MAX_LINE_LENGTH - 2) /* the longest line fgets reads whole, besides its '\n' */
+#define EXTERN_SEGMENT 2 /* segment of labels declared with .extern (besides enum symbolSegments) */
+
+/* error codes of the protocol */
+#define PARSE_ERROR -32700
+#define INVALID_REQUEST -32600
+#define METHOD_NOT_FOUND -32601
+#define SERVER_NOT_INITIALIZED -32002
+
+enum lineKind { PLAIN_LINE, MACRO_LINE, CONDITIONAL_LINE, INCLUDE_LINE };
+
+typedef struct Message {
+	int isError;
+	char *text;
+	struct Message *next;
+} Message;
+
+typedef struct Definition {
+	char name[MAX_LABEL_NAME_LENGTH];
+	int segment;	/* enum symbolSegments or EXTERN_SEGMENT */
+	int offset;		/* words of the segment the line occupies before the label */
+	int duplicate;	/* the label is defined by more than one line */
+} Definition;
+
+typedef struct Reference {
+	char name[MAX_LABEL_NAME_LENGTH];
+	int isEntry;	/* referenced by .entry rather than by an operand */
+	int resolved;	/* the label is defined */
+} Reference;
+
+typedef struct Line {
+	char *text;
+	int index;
+	int kind;				/* enum lineKind */
+	int active;				/* the line is outside false conditional branches and macro definitions */
+	int activeAfter;		/* the lines following it are outside false conditional branches */
+	int inMacroAfter;		/* the lines following it belong to a macro definition */
+	int codeWords;			/* words the line (with its macro expansion) occupies */
+	int dataWords;
+	int codeOffset;			/* words the lines before it occupy */
+	int dataOffset;
+	Definition *definitions;
+	int definitionCount;
+	Reference *references;
+	int referenceCount;
+	Message *messages;		/* diagnostics of decoding the line */
+} Line;
+
+typedef struct DocumentMacro {
+	char name[MAX_LINE_LENGTH];
+	char *text;				/* the body, lines ending with '\n' - a copy for a library macro, as libraries may be unmapped */
+	Line *definedBy;		/* the macro line or the .include line */
+	struct DocumentMacro *next;
+} DocumentMacro;
+
+typedef struct SymbolEntry {
+	char name[MAX_LABEL_NAME_LENGTH];
+	Line **definers;		/* a line appears once for every definition it holds */
+	int definerCount;
+	int definerCapacity;
+	Line **referrers;		/* a line appears once for every reference it holds */
+	int referrerCount;
+	int referrerCapacity;
+	int changed;			/* the definitions changed since the references were last checked */
+	struct SymbolEntry *next;
+	struct SymbolEntry *nextChanged;
+} SymbolEntry;
+
+typedef struct Document {
+	char *uri;
+	Line **lines;
+	int lineCount;
+	int lineCapacity;
+	int codeWords;			/* words of the whole code segment */
+	DocumentMacro *macros;
+	SymbolEntry *symbols[SYMBOL_BUCKETS];
+	SymbolEntry *changedSymbols;
+	struct Document *next;
+} Document;
+
+typedef struct Server {
+	Document *documents;
+	Variant *variant;		/* the configuration conditional blocks are evaluated for */
+	int initialized;
+	int shutdown;
+	int exiting;
+} Server;
+
+/* a message being composed before it is sent with its length */
+typedef struct Outgoing {
+	FILE *stream;
+	char *buffer;
+	size_t length;
+} Outgoing;
+
+typedef struct LspConditional {
+	int parentActive;
+	int taken;
+	int inElse;
+	Line *line;
+} LspConditional;
+
+static Line *currentLine = NULL; /* the line receiving the diagnostics of the decoding functions */
+
+char* readMessage(FILE *input);
+void handleMessage(Server *server, JsonValue *message);
+void handleInitialize(JsonValue *id);
+void handleDidOpen(Server *server, JsonValue *params);
+void handleDidChange(Server *server, JsonValue *params);
+void handleDidClose(Server *server, JsonValue *params);
+void handleDefinition(Server *server, JsonValue *id, JsonValue *params);
+void handleHover(Server *server, JsonValue *id, JsonValue *params);
+void beginResponse(Outgoing *out, JsonValue *id);
+void beginNotification(Outgoing *out, char *method);
+void sendOutgoing(Outgoing *out);
+void sendError(JsonValue *id, int code, char *text);
+void writeRange(FILE *stream, int line, int start, int end);
+
+Document* findDocument(Server *server, char *uri);
+Line* getRequestLine(Server *server, JsonValue *params, Document **document, int *character);
+void setDocumentText(Document *document, char *text);
+void applyChange(Document *document, JsonValue *change, Variant *variant);
+void rebuildDocument(Document *document, Variant *variant);
+void analyzeLine(Document *document, Line *line);
+void analyzeStatement(Line *line, char *statement);
+void includeDocumentLibrary(Document *document, Line *line, char *name);
+int applyLspConditional(int directive, char *symbol, LspConditional *stack, int *depth, int active, Variant *variant, int lineNumber);
+int isStructuralLine(char *text);
+void computeOffsets(Document *document);
+void publishDiagnostics(Document *document);
+
+Line* newLine(char *text, int length);
+void clearLine(Line *line);
+void destroyLine(Line *line);
+void addDefinition(Line *line, char *name, int segment, int offset);
+void addReference(Line *line, char *name, int isEntry);
+void collectDiagnostic(int isError, int lineNumber, char *text);
+
+DocumentMacro* findDocumentMacro(Document *document, char *name);
+void addDocumentMacro(Document *document, char *name, char *text, int isIncluded, Line *definedBy);
+void destroyDocumentMacros(Document *document);
+
+SymbolEntry* findSymbolEntry(Document *document, char *name, int create);
+void addContributions(Document *document, Line *line);
+void removeContributions(Document *document, Line *line);
+void resolveLine(Document *document, Line *line);
+void resolveChanged(Document *document);
+void appendLinePointer(Line ***array, int *count, int *capacity, Line *line);
+void removeLinePointer(Line **array, int *count, Line *line);
+void markChanged(Document *document, SymbolEntry *entry);
+void destroySymbolEntries(Document *document);
+void destroyDocument(Document *document);
+
+int getLabelAddress(Document *document, Line *line, Definition *definition);
+int getWordAt(char *text, int character, char *word);
+
+/*
+ * Serves the language server protocol on stdin/stdout until the client sends "exit" or closes stdin
+ * conditional blocks are evaluated for the first variant of the options
+ * Returns the exit status - 0 if the client shut the server down before exiting, otherwise 1
+ */
+int runLanguageServer(Options *options){
+	Server server;
+	Document *next;
+	JsonValue *message;
+	char *body;
+
+	memset(&server, 0, sizeof(server));
+	server.variant = &options->variants[0];
+	setDiagnosticsHandler(collectDiagnostic);
+	while(!server.exiting && (body = readMessage(stdin))){
+		message = parseJson(body);
+		if(message)
+			handleMessage(&server, message);
+		else
+			sendError(NULL, PARSE_ERROR, "message is not valid JSON");
+		destroyJson(message);
+		free(body);
+	}
+	setDiagnosticsHandler(NULL);
+	for(; server.documents; server.documents = next){
+		next = server.documents->next;
+		destroyDocument(server.documents);
+	}
+	closeLibraries();
+	return !server.shutdown;
+}
+
+/*
+ * Reads a single message - headers ending with an empty line, followed by Content-Length bytes of content
+ * Returns the content (to be freed by the caller) or NULL when the input ends
+ */
+char* readMessage(FILE *input){
+	char header[MAX_HEADER_LENGTH];
+	char *body;
+	long length;
+
+	for(;;){
+		length = -1;
+		while(fgets(header, MAX_HEADER_LENGTH, input)){
+			if(strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0)
+				break;
+			if(strncmp(header, "Content-Length:", 15) == 0)
+				length = strtol(header + 15, NULL, 10);
+		}
+		if(feof(input) || ferror(input))
+			return NULL;
+		if(length < 0 || length > MAX_MESSAGE_LENGTH)
+			continue; /* a message without a valid length can't be skipped over - wait for the next headers */
+		body = (char*)malloc(length + 1);
+		if(fread(body, 1, length, input) != (size_t)length){
+			free(body);
+			return NULL;
+		}
+		body[length] = '\0';
+		return body;
+	}
+}
+
+/*
+ * Dispatches a request or a notification by its method
+ */
+void handleMessage(Server *server, JsonValue *message){
+	char *method = getJsonString(message, "method");
+	JsonValue *id = getJsonMember(message, "id");
+	JsonValue *params = getJsonMember(message, "params");
+	Outgoing out;
+
+	if(!method) /* a response - the server sends no requests */
+		return;
+	if(strcmp(method, "initialize") == 0){
+		server->initialized = 1;
+		handleInitialize(id);
+	}
+	else if(strcmp(method, "exit") == 0)
+		server->exiting = 1;
+	else if(!server->initialized){
+		if(id)
+			sendError(id, SERVER_NOT_INITIALIZED, "server is not initialized");
+	}
+	else if(strcmp(method, "shutdown") == 0){
+		server->shutdown = 1;
+		beginResponse(&out, id);
+		fputs("null", out.stream);
+		sendOutgoing(&out);
+	}
+	else if(server->shutdown){
+		if(id)
+			sendError(id, INVALID_REQUEST, "server is shutting down");
+	}
+	else if(strcmp(method, "textDocument/didOpen") == 0)
+		handleDidOpen(server, params);
+	else if(strcmp(method, "textDocument/didChange") == 0)
+		handleDidChange(server, params);
+	else if(strcmp(method, "textDocument/didClose") == 0)
+		handleDidClose(server, params);
+	else if(strcmp(method, "textDocument/definition") == 0)
+		handleDefinition(server, id, params);
+	else if(strcmp(method, "textDocument/hover") == 0)
+		handleHover(server, id, params);
+	else if(id)
+		sendError(id, METHOD_NOT_FOUND, "method is not supported");
+}
+
+/*
+ * Answers the initialize request with the capabilities of the server
+ */
+void handleInitialize(JsonValue *id){
+	Outgoing out;
+	beginResponse(&out, id);
+	fputs("{\"capabilities\":{\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+			"\"definitionProvider\":true,\"hoverProvider\":true},"
+			"\"serverInfo\":{\"name\":\"assembler\",\"version\":\"" ASSEMBLER_VERSION "\"}}", out.stream);
+	sendOutgoing(&out);
+}
+
+/*
+ * Opens a document, analyzes it whole and publishes its diagnostics
+ */
+void handleDidOpen(Server *server, JsonValue *params){
+	JsonValue *item = getJsonMember(params, "textDocument");
+	char *uri = getJsonString(item, "uri"), *text = getJsonString(item, "text");
+	Document *document;
+
+	if(!uri || !text)
+		return;
+	document = findDocument(server, uri);
+	if(!document){
+		document = (Document*)calloc(1, sizeof(Document));
+		document->uri = (char*)malloc(strlen(uri) + 1);
+		strcpy(document->uri, uri);
+		document->next = server->documents;
+		server->documents = document;
+	}
+	setDocumentText(document, text);
+	rebuildDocument(document, server->variant);
+	publishDiagnostics(document);
+}
+
+/*
+ * Applies the changes of an edit one after the other and publishes the updated diagnostics
+ */
+void handleDidChange(Server *server, JsonValue *params){
+	Document *document = findDocument(server, getJsonString(getJsonMember(params, "textDocument"), "uri"));
+	JsonValue *changes = getJsonMember(params, "contentChanges"), *change;
+
+	if(!document || !changes || changes->type != JSON_ARRAY)
+		return;
+	for(change = changes->children; change; change = change->next)
+		applyChange(document, change, server->variant);
+	publishDiagnostics(document);
+}
+
+/*
+ * Closes a document, clearing its diagnostics
+ */
+void handleDidClose(Server *server, JsonValue *params){
+	Document *document = findDocument(server, getJsonString(getJsonMember(params, "textDocument"), "uri"));
+	Document **link;
+	Outgoing out;
+
+	if(!document)
+		return;
+	for(link = &server->documents; *link != document; link = &(*link)->next){
+	}
+	*link = document->next;
+	beginNotification(&out, "textDocument/publishDiagnostics");
+	fputs("{\"uri\":", out.stream);
+	writeJsonString(out.stream, document->uri);
+	fputs(",\"diagnostics\":[]}", out.stream);
+	sendOutgoing(&out);
+	destroyDocument(document);
+}
+
+/*
+ * Answers with the line defining the label or macro at the position, or null
+ */
+void handleDefinition(Server *server, JsonValue *id, JsonValue *params){
+	Document *document;
+	Line *line, *target = NULL;
+	char word[MAX_LINE_LENGTH];
+	SymbolEntry *entry;
+	DocumentMacro *macro;
+	Outgoing out;
+	int character;
+
+	line = getRequestLine(server, params, &document, &character);
+	if(line && getWordAt(line->text, character, word)){
+		entry = findSymbolEntry(document, word, 0);
+		macro = findDocumentMacro(document, word);
+		if(entry && entry->definerCount)
+			target = entry->definers[0];
+		else if(macro)
+			target = macro->definedBy;
+	}
+	beginResponse(&out, id);
+	if(target){
+		fputs("{\"uri\":", out.stream);
+		writeJsonString(out.stream, document->uri);
+		fputs(",\"range\":", out.stream);
+		writeRange(out.stream, target->index, 0, strlen(target->text));
+		fputs("}", out.stream);
+	}
+	else
+		fputs("null", out.stream);
+	sendOutgoing(&out);
+}
+
+/*
+ * Answers with the address of the label at the position, or the address of the line itself
+ */
+void handleHover(Server *server, JsonValue *id, JsonValue *params){
+	Document *document;
+	Line *line, *definer;
+	char word[MAX_LINE_LENGTH], text[MAX_DIAGNOSTIC_LENGTH];
+	Definition *definition = NULL;
+	SymbolEntry *entry = NULL;
+	DocumentMacro *macro = NULL;
+	Outgoing out;
+	int i, character;
+
+	*text = '\0';
+	line = getRequestLine(server, params, &document, &character);
+	if(line && getWordAt(line->text, character, word)){
+		entry = findSymbolEntry(document, word, 0);
+		macro = findDocumentMacro(document, word);
+	}
+	if(entry && entry->definerCount){
+		definer = entry->definers[0];
+		for(i = 0; i < definer->definitionCount && !definition; i++){
+			if(strcmp(definer->definitions[i].name, word) == 0)
+				definition = &definer->definitions[i];
+		}
+		if(definition->segment == EXTERN_SEGMENT)
+			sprintf(text, "`%s` external label", word);
+		else
+			sprintf(text, "`%s` %s label at address %d", word, (definition->segment == DATA_SEGMENT)? "data" : "code",
+					getLabelAddress(document, definer, definition));
+		if(entry->definerCount > 1)
+			sprintf(text + strlen(text), " (defined %d times)", entry->definerCount);
+		sprintf(text + strlen(text), ", %d references", entry->referrerCount);
+	}
+	else if(macro)
+		sprintf(text, "`%s` macro defined in line %d", word, macro->definedBy->index + 1);
+	else if(line && line->active && line->codeWords)
+		sprintf(text, "code at address %d, %d words", getLoadAddress() + line->codeOffset, line->codeWords);
+	else if(line && line->active && line->dataWords)
+		sprintf(text, "data at address %d, %d words", getLoadAddress() + document->codeWords + line->dataOffset, line->dataWords);
+
+	beginResponse(&out, id);
+	if(*text){
+		fputs("{\"contents\":{\"kind\":\"markdown\",\"value\":", out.stream);
+		writeJsonString(out.stream, text);
+		fputs("}}", out.stream);
+	}
+	else
+		fputs("null", out.stream);
+	sendOutgoing(&out);
+}
+
+/*
+ * Starts a response to the request id, leaving the stream ready for the result
+ */
+void beginResponse(Outgoing *out, JsonValue *id){
+	out->stream = open_memstream(&out->buffer, &out->length);
+	fputs("{\"jsonrpc\":\"2.0\",\"id\":", out->stream);
+	if(id)
+		writeJsonValue(out->stream, id);
+	else
+		fputs("null", out->stream);
+	fputs(",\"result\":", out->stream);
+}
+
+/*
+ * Starts a notification, leaving the stream ready for the parameters
+ */
+void beginNotification(Outgoing *out, char *method){
+	out->stream = open_memstream(&out->buffer, &out->length);
+	fputs("{\"jsonrpc\":\"2.0\",\"method\":", out->stream);
+	writeJsonString(out->stream, method);
+	fputs(",\"params\":", out->stream);
+}
+
+/*
+ * Completes a message and sends it preceded by its length
+ */
+void sendOutgoing(Outgoing *out){
+	fputc('}', out->stream);
+	fclose(out->stream);
+	printf("Content-Length: %lu\r\n\r\n", (unsigned long)out->length);
+	fwrite(out->buffer, 1, out->length, stdout);
+	fflush(stdout);
+	free(out->buffer);
+}
+
+/*
+ * Sends an error response to the request id
+ */
+void sendError(JsonValue *id, int code, char *text){
+	Outgoing out;
+	out.stream = open_memstream(&out.buffer, &out.length);
+	fputs("{\"jsonrpc\":\"2.0\",\"id\":", out.stream);
+	if(id)
+		writeJsonValue(out.stream, id);
+	else
+		fputs("null", out.stream);
+	fprintf(out.stream, ",\"error\":{\"code\":%d,\"message\":", code);
+	writeJsonString(out.stream, text);
+	fputc('}', out.stream);
+	sendOutgoing(&out);
+}
+
+/*
+ * Writes a range within a single line
+ */
+void writeRange(FILE *stream, int line, int start, int end){
+	fprintf(stream, "{\"start\":{\"line\":%d,\"character\":%d},\"end\":{\"line\":%d,\"character\":%d}}", line, start, line, end);
+}
+
+/*
+ * Returns the open document with the given uri or NULL
+ */
+Document* findDocument(Server *server, char *uri){
+	Document *document;
+	if(!uri)
+		return NULL;
+	for(document = server->documents; document; document = document->next){
+		if(strcmp(document->uri, uri) == 0)
+			return document;
+	}
+	return NULL;
+}
+
+/*
+ * Returns the line of the position in the parameters of a request, storing its document and character
+ * or NULL if the document isn't open or the position is outside it
+ */
+Line* getRequestLine(Server *server, JsonValue *params, Document **document, int *character){
+	JsonValue *position = getJsonMember(params, "position");
+	int lineIndex;
+	*document = findDocument(server, getJsonString(getJsonMember(params, "textDocument"), "uri"));
+	if(!*document || !getJsonInt(position, "line", &lineIndex) || lineIndex < 0 || lineIndex >= (*document)->lineCount)
+		return NULL;
+	if(character && !getJsonInt(position, "character", character))
+		return NULL;
+	return (*document)->lines[lineIndex];
+}
+
+/*
+ * Replaces the lines of the document with the lines of text (without analyzing them)
+ */
+void setDocumentText(Document *document, char *text){
+	char *end;
+	int i;
+	for(i = 0; i < document->lineCount; i++)
+		destroyLine(document->lines[i]);
+	document->lineCount = 0;
+	for(;;){
+		end = strchr(text, '\n');
+		if(document->lineCount == document->lineCapacity){
+			document->lineCapacity = (document->lineCapacity)? document->lineCapacity * 2 : 256;
+			document->lines = (Line**)realloc(document->lines, sizeof(Line*) * document->lineCapacity);
+		}
+		document->lines[document->lineCount++] = newLine(text, (end)? end - text : (int)strlen(text));
+		if(!end)
+			break;
+		text = end + 1;
+	}
+}
+
+/*
+ * Applies a single change - a replaced range or the whole text - re-analyzing only the replaced lines
+ * unless the change affects how the following lines are expanded
+ */
+void applyChange(Document *document, JsonValue *change, Variant *variant){
+	JsonValue *range = getJsonMember(change, "range");
+	char *text = getJsonString(change, "text"), *combined, *running, *end;
+	int startLine, startCharacter, endLine, endCharacter, length, removed, added, i;
+	int needsRebuild = 0;
+	Line **replacement, *line;
+
+	if(!text)
+		return;
+	if(!range){
+		setDocumentText(document, text);
+		rebuildDocument(document, variant);
+		return;
+	}
+	if(!getJsonInt(getJsonMember(range, "start"), "line", &startLine) || !getJsonInt(getJsonMember(range, "start"), "character", &startCharacter)
+			|| !getJsonInt(getJsonMember(range, "end"), "line", &endLine) || !getJsonInt(getJsonMember(range, "end"), "character", &endCharacter))
+		return;
+	/* positions beyond the end of a line or of the document refer to its end */
+	if(startLine < 0 || endLine < startLine || (endLine == startLine && endCharacter < startCharacter))
+		return;
+	if(startLine >= document->lineCount){
+		startLine = document->lineCount - 1;
+		startCharacter = strlen(document->lines[startLine]->text);
+	}
+	if(endLine >= document->lineCount){
+		endLine = document->lineCount - 1;
+		endCharacter = strlen(document->lines[endLine]->text);
+	}
+	startCharacter = (startCharacter < 0)? 0 : startCharacter;
+	endCharacter = (endCharacter < 0)? 0 : endCharacter;
+	length = strlen(document->lines[startLine]->text);
+	startCharacter = (startCharacter > length)? length : startCharacter;
+	length = strlen(document->lines[endLine]->text);
+	endCharacter = (endCharacter > length)? length : endCharacter;
+
+	/* the text replacing the range, completed into whole lines */
+	combined = (char*)malloc(startCharacter + strlen(text) + length - endCharacter + 1);
+	strncpy(combined, document->lines[startLine]->text, startCharacter);
+	strcpy(combined + startCharacter, text);
+	strcat(combined, document->lines[endLine]->text + endCharacter);
+	for(added = 1, running = combined; *running; running++)
+		added += (*running == '\n');
+	replacement = (Line**)malloc(sizeof(Line*) * added);
+	for(i = 0, running = combined; i < added; i++, running = end + 1){
+		end = strchr(running, '\n');
+		if(!end)
+			end = running + strlen(running);
+		replacement[i] = newLine(running, end - running);
+		needsRebuild = needsRebuild || isStructuralLine(replacement[i]->text);
+	}
+	free(combined);
+
+	removed = endLine - startLine + 1;
+	for(i = startLine; i <= endLine; i++)
+		needsRebuild = needsRebuild || document->lines[i]->kind != PLAIN_LINE;
+	needsRebuild = needsRebuild || (startLine > 0 && document->lines[startLine - 1]->inMacroAfter);
+	for(i = startLine; i <= endLine; i++){
+		if(!needsRebuild)
+			removeContributions(document, document->lines[i]);
+		destroyLine(document->lines[i]);
+	}
+
+	/* splicing the new lines in place of the replaced ones */
+	if(document->lineCount - removed + added > document->lineCapacity){
+		document->lineCapacity = (document->lineCount - removed + added) * 2;
+		document->lines = (Line**)realloc(document->lines, sizeof(Line*) * document->lineCapacity);
+	}
+	memmove(document->lines + startLine + added, document->lines + endLine + 1, sizeof(Line*) * (document->lineCount - endLine - 1));
+	memcpy(document->lines + startLine, replacement, sizeof(Line*) * added);
+	document->lineCount += added - removed;
+	free(replacement);
+
+	if(needsRebuild){
+		rebuildDocument(document, variant);
+		return;
+	}
+	for(i = startLine; i < document->lineCount; i++)
+		document->lines[i]->index = i;
+	for(i = startLine; i < startLine + added; i++){
+		line = document->lines[i];
+		line->active = (i > 0)? document->lines[i - 1]->activeAfter : 1;
+		line->activeAfter = line->active;
+		currentLine = line;
+		if(strlen(line->text) > MAX_SOURCE_LINE_LENGTH)
+			reportError(i + 1, LINE_LENGTH_DIAGNOSTIC, "line is longer than %d characters", MAX_SOURCE_LINE_LENGTH);
+		else if(line->active)
+			analyzeLine(document, line);
+		addContributions(document, line);
+	}
+	resolveChanged(document);
+	for(i = startLine; i < startLine + added; i++)
+		resolveLine(document, document->lines[i]);
+	computeOffsets(document);
+}
+
+/*
+ * Analyzes the whole document from scratch - expands its macros and conditional blocks,
+ * decodes every line and builds the symbol table
+ */
+void rebuildDocument(Document *document, Variant *variant){
+	LspConditional stack[MAX_LSP_CONDITIONAL_DEPTH];
+	char symbol[MAX_LINE_LENGTH], name[MAX_LINE_LENGTH];
+	DocumentMacro *macro = NULL;
+	Line *line, *macroLine = NULL;
+	int i, directive, depth = 0, active = 1, inMacro = 0;
+
+	destroySymbolEntries(document);
+	destroyDocumentMacros(document);
+	resetLibraryUse();
+	for(i = 0; i < document->lineCount; i++){
+		line = document->lines[i];
+		line->index = i;
+		clearLine(line);
+		currentLine = line;
+		line->kind = (inMacro)? MACRO_LINE : PLAIN_LINE;
+		line->active = active && !inMacro;
+		if(strlen(line->text) > MAX_SOURCE_LINE_LENGTH)
+			reportError(i + 1, LINE_LENGTH_DIAGNOSTIC, "line is longer than %d characters", MAX_SOURCE_LINE_LENGTH);
+		else if(inMacro){
+			if(isMacroOrEndmacro(line->text, "endmacro"))
+				inMacro = 0;
+			else if(getConditionalDirective(line->text, symbol) != NOT_CONDITIONAL)
+				reportError(i + 1, DIRECTIVE_IN_MACRO_DIAGNOSTIC, "conditional directives are not allowed inside a macro");
+			else if(getIncludeName(line->text, symbol))
+				reportError(i + 1, DIRECTIVE_IN_MACRO_DIAGNOSTIC, ".include is not allowed inside a macro");
+			else if(macro && strlen(macro->text) + strlen(line->text) + 1 >= MAX_MACRO_LENGTH)
+				reportError(i + 1, MACRO_LENGTH_DIAGNOSTIC, "macro content is too long");
+			else if(macro){
+				strcat(macro->text, line->text);
+				strcat(macro->text, "\n");
+			}
+		}
+		else if((directive = getConditionalDirective(line->text, symbol)) != NOT_CONDITIONAL){
+			line->kind = CONDITIONAL_LINE;
+			active = applyLspConditional(directive, symbol, stack, &depth, active, variant, i + 1);
+		}
+		else if(!active)
+			;
+		else if(isMacroOrEndmacro(line->text, "macro")){
+			line->kind = MACRO_LINE;
+			line->active = 0;
+			getMacroName(line->text, name);
+			macro = NULL;
+			if(!isLegalMacroName(name) || findDocumentMacro(document, name))
+				reportError(i + 1, MACRO_NAME_DIAGNOSTIC, "macro name '%s' is not valid", name);
+			else{
+				addDocumentMacro(document, name, NULL, 0, line);
+				macro = document->macros;
+			}
+			inMacro = 1;
+			macroLine = line;
+		}
+		else if(getIncludeName(line->text, name)){
+			line->kind = INCLUDE_LINE;
+			includeDocumentLibrary(document, line, name);
+		}
+		else
+			analyzeLine(document, line);
+		line->activeAfter = active;
+		line->inMacroAfter = inMacro;
+	}
+	if(inMacro){
+		currentLine = macroLine;
+		reportError(macroLine->index + 1, UNCLOSED_MACRO_DIAGNOSTIC, "macro is never closed with endmacro");
+	}
+	if(depth > 0){
+		currentLine = stack[depth - 1].line;
+		reportError(currentLine->index + 1, UNCLOSED_CONDITIONAL_DIAGNOSTIC, "conditional block is never closed with .endif");
+	}
+
+	for(i = 0; i < document->lineCount; i++)
+		addContributions(document, document->lines[i]);
+	for(i = 0; i < document->lineCount; i++)
+		resolveLine(document, document->lines[i]);
+	resolveChanged(document); /* only clears the marks - every line was just resolved */
+	computeOffsets(document);
+}
+
+/*
+ * Decodes a line, decoding the body of the macro instead if the line invokes a macro defined before it
+ */
+void analyzeLine(Document *document, Line *line){
+	char word[MAX_LINE_LENGTH], statement[MAX_LINE_LENGTH];
+	char *running = line->text, *end;
+	DocumentMacro *macro;
+	int i;
+
+	for(; isspace((unsigned char)*running); running++){
+	}
+	for(i = 0; *running && !isspace((unsigned char)*running); running++, i++)
+		word[i] = *running;
+	word[i] = '\0';
+	macro = findDocumentMacro(document, word);
+	if(!macro || macro->definedBy->index >= line->index){
+		analyzeStatement(line, line->text);
+		return;
+	}
+	for(running = macro->text; *running; running = (*end)? end + 1 : end){
+		end = strchr(running, '\n');
+		if(!end)
+			end = running + strlen(running);
+		i = (end - running < MAX_LINE_LENGTH)? end - running : MAX_LINE_LENGTH - 1;
+		strncpy(statement, running, i);
+		statement[i] = '\0';
+		analyzeStatement(line, statement);
+	}
+}
+
+/*
+ * Decodes a single statement of a line (the line itself or a line of the macro it invokes) as the first pass does,
+ * adding the words, labels and references it holds to the line - errors reach the line through collectDiagnostic
+ */
+void analyzeStatement(Line *line, char *statement){
+	char buffer[MAX_LINE_LENGTH], copy[MAX_LINE_LENGTH], label[MAX_LABEL_NAME_LENGTH];
+	int dataArray[MAX_LINE_LENGTH]; /* a line holds less values than characters */
+	char *running, *separator;
+	int i, type, words, success, ic = 0, dc = 0, lineNumber = line->index + 1;
+	CompiledLine *decoded, *word;
+
+	strncpy(buffer, statement, MAX_LINE_LENGTH - 1);
+	buffer[MAX_LINE_LENGTH - 1] = '\0';
+	strTrim(buffer);
+	if(*buffer == '\0' || *buffer == ';')
+		return;
+	memset(label, '\0', MAX_LABEL_NAME_LENGTH);
+	i = getLabel(buffer, label);
+	if(i && !isValidLabelName(label)){
+		reportError(lineNumber, LABEL_NAME_DIAGNOSTIC, "'%s' is not a valid label name", label);
+		return;
+	}
+	running = buffer + i;
+	type = getStatementType(running);
+	switch(type){
+		case entryStatement:
+		case externStatement:{
+			if(i)
+				reportWarning(lineNumber, IGNORED_LABEL_DIAGNOSTIC, "ignored label '%s' before %s statement", label, (type == entryStatement)? ".entry" : ".extern");
+			running += (type == entryStatement)? ENTRY_LENGTH : EXTERN_LENGTH;
+			if(!isValidLabelName(running)){
+				reportError(lineNumber, LABEL_NAME_DIAGNOSTIC, "'%s' is not a valid label name", running);
+				return;
+			}
+			if(type == entryStatement)
+				addReference(line, running, 1);
+			else
+				addDefinition(line, running, EXTERN_SEGMENT, 0);
+		}
+			break;
+		case emptyStatement:{
+			if(i)
+				addDefinition(line, label, COMMAND_SEGMENT, line->codeWords);
+		}
+			break;
+		case commandStatement:{
+			if(i)
+				addDefinition(line, label, COMMAND_SEGMENT, line->codeWords);
+			strcpy(copy, running);
+			decoded = decodeCommandLine(running, &ic, lineNumber);
+			for(word = decoded; word; word = word->next){
+				separator = strchr(word->binaryStr, '|');
+				if(separator){
+					*separator = '\0';
+					addReference(line, word->binaryStr, 0);
+				}
+			}
+			destroyDecoded(decoded);
+			/* a command with errors still takes its words, so the addresses of the following lines stay put */
+			if(!decoded && (words = countCommandWords(copy)) > 0)
+				ic = words;
+			line->codeWords += ic;
+		}
+			break;
+		case dataStatement:
+		case stringStatement:
+		case structStatement:{
+			if(i)
+				addDefinition(line, label, DATA_SEGMENT, line->dataWords);
+			running += (type == dataStatement)? DATA_LENGTH : (type == stringStatement)? STRING_LENGTH : STRUCT_LENGTH;
+			strcpy(copy, running);
+			if(type == dataStatement)
+				success = storeDataType(running, dataArray, &dc, lineNumber);
+			else if(type == stringStatement)
+				success = storeStringType(running, dataArray, &dc, lineNumber);
+			else
+				success = storeStructType(running, dataArray, &dc, lineNumber);
+			if(!success){
+				words = (type == dataStatement)? countDataWords(copy) : (type == stringStatement)? countStringWords(copy) : countStructWords(copy);
+				dc = (words > 0)? words : 0;
+			}
+			line->dataWords += dc;
+		}
+			break;
+	}
+}
+
+/*
+ * Adds the macros of a library to the document and decodes its declarations as part of the .include line
+ */
+void includeDocumentLibrary(Document *document, Line *line, char *name){
+	Library *library;
+	char *declarations, *end;
+	char statement[MAX_LINE_LENGTH];
+	int i, length;
+
+	if(!*name){
+		reportError(line->index + 1, LIBRARY_NAME_DIAGNOSTIC, "missing library name after .include");
+		return;
+	}
+	library = loadLibrary(name);
+	if(!library){
+		reportError(line->index + 1, UNKNOWN_LIBRARY_DIAGNOSTIC, "couldn't load library '%s'", name);
+		return;
+	}
+	if(!markLibraryUse(library, 1UL)) /* already included */
+		return;
+	for(i = 0; i < getLibraryMacroCount(library); i++){
+		if(findDocumentMacro(document, getLibraryMacroName(library, i)))
+			reportError(line->index + 1, DUPLICATE_MACRO_DIAGNOSTIC, "macro '%s' of library '%s' is already defined", getLibraryMacroName(library, i), name);
+		else
+			addDocumentMacro(document, getLibraryMacroName(library, i), getLibraryMacroText(library, i), 1, line);
+	}
+	for(declarations = getLibraryDeclarations(library); *declarations; declarations = (*end)? end + 1 : end){
+		end = strchr(declarations, '\n');
+		if(!end)
+			end = declarations + strlen(declarations);
+		length = (end - declarations < MAX_LINE_LENGTH)? end - declarations : MAX_LINE_LENGTH - 1;
+		strncpy(statement, declarations, length);
+		statement[length] = '\0';
+		analyzeStatement(line, statement);
+	}
+}
+
+/*
+ * Opens, switches or closes a conditional block for the variant, as the preprocessor does
+ * returns whether the lines following the directive are active
+ */
+int applyLspConditional(int directive, char *symbol, LspConditional *stack, int *depth, int active, Variant *variant, int lineNumber){
+	LspConditional *block;
+	int i;
+	switch(directive){
+		case IFDEF_DIRECTIVE:
+		case IFNDEF_DIRECTIVE:{
+			if(!*symbol){
+				reportError(lineNumber, CONDITIONAL_SYMBOL_DIAGNOSTIC, "missing symbol name after conditional directive");
+				return active;
+			}
+			if(*depth == MAX_LSP_CONDITIONAL_DEPTH){
+				reportError(lineNumber, CONDITIONAL_DEPTH_DIAGNOSTIC, "conditional blocks are nested deeper than %d", MAX_LSP_CONDITIONAL_DEPTH);
+				return active;
+			}
+			block = &stack[(*depth)++];
+			block->parentActive = active;
+			block->taken = 0;
+			for(i = 0; i < variant->defineCount && !block->taken; i++)
+				block->taken = strcmp(variant->defines[i], symbol) == 0;
+			if(directive == IFNDEF_DIRECTIVE)
+				block->taken = !block->taken;
+			block->inElse = 0;
+			block->line = currentLine;
+			return active && block->taken;
+		}
+		case ELSE_DIRECTIVE:{
+			if(*depth == 0 || stack[*depth - 1].inElse){
+				reportError(lineNumber, UNMATCHED_CONDITIONAL_DIAGNOSTIC, ".else without a matching .ifdef");
+				return active;
+			}
+			block = &stack[*depth - 1];
+			block->inElse = 1;
+			return block->parentActive && !block->taken;
+		}
+		case ENDIF_DIRECTIVE:{
+			if(*depth == 0){
+				reportError(lineNumber, UNMATCHED_CONDITIONAL_DIAGNOSTIC, ".endif without a matching .ifdef");
+				return active;
+			}
+			return stack[--(*depth)].parentActive;
+		}
+	}
+	return active;
+}
+
+/*
+ * Checks if a line affects how the lines following it are expanded -
+ * a macro definition boundary, a conditional directive or an .include
+ * returns 1 for true 0 for false
+ */
+int isStructuralLine(char *text){
+	char symbol[MAX_LINE_LENGTH];
+	if(strlen(text) > MAX_SOURCE_LINE_LENGTH)
+		return 0;
+	return isMacroOrEndmacro(text, "macro") || isMacroOrEndmacro(text, "endmacro")
+			|| getConditionalDirective(text, symbol) != NOT_CONDITIONAL || getIncludeName(text, symbol);
+}
+
+/*
+ * Recomputes the words the lines before each line occupy - edits shift the addresses of every following line
+ */
+void computeOffsets(Document *document){
+	int i, code = 0, data = 0;
+	Line *line;
+	for(i = 0; i < document->lineCount; i++){
+		line = document->lines[i];
+		line->codeOffset = code;
+		line->dataOffset = data;
+		code += line->codeWords;
+		data += line->dataWords;
+	}
+	document->codeWords = code;
+}
+
+/*
+ * Sends every diagnostic of the document - the diagnostics of decoding each line,
+ * unknown labels and labels defined more than once
+ */
+void publishDiagnostics(Document *document){
+	Outgoing out;
+	Line *line;
+	Message *message;
+	char text[MAX_DIAGNOSTIC_LENGTH];
+	int i, j, start, end, first = 1;
+
+	beginNotification(&out, "textDocument/publishDiagnostics");
+	fputs("{\"uri\":", out.stream);
+	writeJsonString(out.stream, document->uri);
+	fputs(",\"diagnostics\":[", out.stream);
+	for(i = 0; i < document->lineCount; i++){
+		line = document->lines[i];
+		for(start = 0; isspace((unsigned char)line->text[start]); start++){
+		}
+		end = strlen(line->text);
+		for(message = line->messages; message; message = message->next){
+			fprintf(out.stream, "%s{\"range\":", (first)? "" : ",");
+			writeRange(out.stream, i, start, end);
+			fprintf(out.stream, ",\"severity\":%d,\"source\":\"assembler\",\"message\":", (message->isError)? 1 : 2);
+			writeJsonString(out.stream, message->text);
+			fputc('}', out.stream);
+			first = 0;
+		}
+		for(j = 0; j < line->referenceCount; j++){
+			if(line->references[j].resolved)
+				continue;
+			if(line->references[j].isEntry)
+				sprintf(text, "label '%s' is declared as entry but never defined", line->references[j].name);
+			else
+				sprintf(text, "unknown label '%s'", line->references[j].name);
+			fprintf(out.stream, "%s{\"range\":", (first)? "" : ",");
+			writeRange(out.stream, i, start, end);
+			fputs(",\"severity\":1,\"source\":\"assembler\",\"message\":", out.stream);
+			writeJsonString(out.stream, text);
+			fputc('}', out.stream);
+			first = 0;
+		}
+		for(j = 0; j < line->definitionCount; j++){
+			if(!line->definitions[j].duplicate)
+				continue;
+			sprintf(text, "'%s' was previously defined.", line->definitions[j].name);
+			fprintf(out.stream, "%s{\"range\":", (first)? "" : ",");
+			writeRange(out.stream, i, start, end);
+			fputs(",\"severity\":1,\"source\":\"assembler\",\"message\":", out.stream);
+			writeJsonString(out.stream, text);
+			fputc('}', out.stream);
+			first = 0;
+		}
+	}
+	fputs("]}", out.stream);
+	sendOutgoing(&out);
+}
+
+/*
+ * Creates a line from the first length characters of text (a trailing '\r' is dropped)
+ */
+Line* newLine(char *text, int length){
+	Line *line = (Line*)calloc(1, sizeof(Line));
+	if(length > 0 && text[length - 1] == '\r')
+		length--;
+	line->text = (char*)malloc(length + 1);
+	strncpy(line->text, text, length);
+	line->text[length] = '\0';
+	line->active = 1;
+	line->activeAfter = 1;
+	return line;
+}
+
+/*
+ * Forgets the results of decoding the line
+ */
+void clearLine(Line *line){
+	Message *next;
+	for(; line->messages; line->messages = next){
+		next = line->messages->next;
+		free(line->messages->text);
+		free(line->messages);
+	}
+	free(line->definitions);
+	free(line->references);
+	line->definitions = NULL;
+	line->definitionCount = 0;
+	line->references = NULL;
+	line->referenceCount = 0;
+	line->codeWords = 0;
+	line->dataWords = 0;
+}
+
+void destroyLine(Line *line){
+	clearLine(line);
+	free(line->text);
+	free(line);
+}
+
+/*
+ * Adds a label defined by the line
+ */
+void addDefinition(Line *line, char *name, int segment, int offset){
+	Definition *definition;
+	line->definitions = (Definition*)realloc(line->definitions, sizeof(Definition) * (line->definitionCount + 1));
+	definition = &line->definitions[line->definitionCount++];
+	strncpy(definition->name, name, MAX_LABEL_NAME_LENGTH - 1);
+	definition->name[MAX_LABEL_NAME_LENGTH - 1] = '\0';
+	definition->segment = segment;
+	definition->offset = offset;
+	definition->duplicate = 0;
+}
+
+/*
+ * Adds a label referenced by the line
+ */
+void addReference(Line *line, char *name, int isEntry){
+	Reference *reference;
+	line->references = (Reference*)realloc(line->references, sizeof(Reference) * (line->referenceCount + 1));
+	reference = &line->references[line->referenceCount++];
+	strncpy(reference->name, name, MAX_LABEL_NAME_LENGTH - 1);
+	reference->name[MAX_LABEL_NAME_LENGTH - 1] = '\0';
+	reference->isEntry = isEntry;
+	reference->resolved = 0;
+}
+
+/*
+ * Receives the diagnostics reported while decoding, attaching them to the line being decoded
+ */
+void collectDiagnostic(int isError, int lineNumber, char *text){
+	Message *message, **last;
+	if(!currentLine)
+		return;
+	message = (Message*)malloc(sizeof(Message));
+	message->isError = isError;
+	message->text = (char*)malloc(strlen(text) + 1);
+	strcpy(message->text, text);
+	message->next = NULL;
+	for(last = &currentLine->messages; *last; last = &(*last)->next){
+	}
+	*last = message;
+}
+
+/*
+ * Returns the macro with the given name or NULL
+ */
+DocumentMacro* findDocumentMacro(Document *document, char *name){
+	DocumentMacro *macro;
+	for(macro = document->macros; macro; macro = macro->next){
+		if(strcmp(macro->name, name) == 0)
+			return macro;
+	}
+	return NULL;
+}
+
+/*
+ * Adds a macro to the document - a macro of the document starts empty and its body is appended line by line,
+ * the text of a library macro is copied, since a library is unmapped once it is rebuilt
+ */
+void addDocumentMacro(Document *document, char *name, char *text, int isIncluded, Line *definedBy){
+	DocumentMacro *macro = (DocumentMacro*)malloc(sizeof(DocumentMacro));
+	strcpy(macro->name, name);
+	if(isIncluded){
+		macro->text = (char*)malloc(strlen(text) + 1);
+		strcpy(macro->text, text);
+	}
+	else{
+		macro->text = (char*)malloc(MAX_MACRO_LENGTH);
+		*macro->text = '\0';
+	}
+	macro->definedBy = definedBy;
+	macro->next = document->macros;
+	document->macros = macro;
+}
+
+void destroyDocumentMacros(Document *document){
+	DocumentMacro *next;
+	for(; document->macros; document->macros = next){
+		next = document->macros->next;
+		free(document->macros->text);
+		free(document->macros);
+	}
+}
+
+/*
+ * Returns the symbol table entry of a label, creating it if it doesn't exist and create is set
+ */
+SymbolEntry* findSymbolEntry(Document *document, char *name, int create){
+	unsigned long hash = 5381;
+	char *running;
+	SymbolEntry *entry;
+
+	for(running = name; *running; running++)
+		hash = hash * 33 + (unsigned char)*running;
+	hash %= SYMBOL_BUCKETS;
+	for(entry = document->symbols[hash]; entry; entry = entry->next){
+		if(strcmp(entry->name, name) == 0)
+			return entry;
+	}
+	if(!create)
+		return NULL;
+	entry = (SymbolEntry*)calloc(1, sizeof(SymbolEntry));
+	strncpy(entry->name, name, MAX_LABEL_NAME_LENGTH - 1);
+	entry->next = document->symbols[hash];
+	document->symbols[hash] = entry;
+	return entry;
+}
+
+/*
+ * Adds the labels the line defines and references to the symbol table
+ */
+void addContributions(Document *document, Line *line){
+	SymbolEntry *entry;
+	int i;
+	for(i = 0; i < line->definitionCount; i++){
+		entry = findSymbolEntry(document, line->definitions[i].name, 1);
+		appendLinePointer(&entry->definers, &entry->definerCount, &entry->definerCapacity, line);
+		markChanged(document, entry);
+	}
+	for(i = 0; i < line->referenceCount; i++){
+		entry = findSymbolEntry(document, line->references[i].name, 1);
+		appendLinePointer(&entry->referrers, &entry->referrerCount, &entry->referrerCapacity, line);
+	}
+}
+
+/*
+ * Removes the labels the line defines and references from the symbol table
+ */
+void removeContributions(Document *document, Line *line){
+	SymbolEntry *entry;
+	int i;
+	for(i = 0; i < line->definitionCount; i++){
+		entry = findSymbolEntry(document, line->definitions[i].name, 0);
+		removeLinePointer(entry->definers, &entry->definerCount, line);
+		markChanged(document, entry);
+	}
+	for(i = 0; i < line->referenceCount; i++){
+		entry = findSymbolEntry(document, line->references[i].name, 0);
+		removeLinePointer(entry->referrers, &entry->referrerCount, line);
+	}
+}
+
+/*
+ * Checks the references and definitions of a single line against the symbol table
+ */
+void resolveLine(Document *document, Line *line){
+	SymbolEntry *entry;
+	int i;
+	for(i = 0; i < line->referenceCount; i++){
+		entry = findSymbolEntry(document, line->references[i].name, 0);
+		line->references[i].resolved = entry && entry->definerCount > 0;
+	}
+	for(i = 0; i < line->definitionCount; i++){
+		entry = findSymbolEntry(document, line->definitions[i].name, 0);
+		line->definitions[i].duplicate = entry && entry->definerCount > 1;
+	}
+}
+
+/*
+ * Checks again only the references and definitions of the labels whose definitions changed
+ */
+void resolveChanged(Document *document){
+	SymbolEntry *entry, *next;
+	Line *line;
+	int i, j;
+	for(entry = document->changedSymbols; entry; entry = next){
+		next = entry->nextChanged;
+		entry->changed = 0;
+		entry->nextChanged = NULL;
+		for(i = 0; i < entry->referrerCount; i++){
+			line = entry->referrers[i];
+			for(j = 0; j < line->referenceCount; j++){
+				if(strcmp(line->references[j].name, entry->name) == 0)
+					line->references[j].resolved = entry->definerCount > 0;
+			}
+		}
+		for(i = 0; i < entry->definerCount; i++){
+			line = entry->definers[i];
+			for(j = 0; j < line->definitionCount; j++){
+				if(strcmp(line->definitions[j].name, entry->name) == 0)
+					line->definitions[j].duplicate = entry->definerCount > 1;
+			}
+		}
+	}
+	document->changedSymbols = NULL;
+}
+
+void appendLinePointer(Line ***array, int *count, int *capacity, Line *line){
+	if(*count == *capacity){
+		*capacity = (*capacity)? *capacity * 2 : 4;
+		*array = (Line**)realloc(*array, sizeof(Line*) * (*capacity));
+	}
+	(*array)[(*count)++] = line;
+}
+
+/*
+ * Removes a single appearance of the line (the order of the array is not kept)
+ */
+void removeLinePointer(Line **array, int *count, Line *line){
+	int i;
+	for(i = 0; i < *count; i++){
+		if(array[i] == line){
+			array[i] = array[--(*count)];
+			return;
+		}
+	}
+}
+
+void markChanged(Document *document, SymbolEntry *entry){
+	if(entry->changed)
+		return;
+	entry->changed = 1;
+	entry->nextChanged = document->changedSymbols;
+	document->changedSymbols = entry;
+}
+
+void destroySymbolEntries(Document *document){
+	SymbolEntry *entry, *next;
+	int i;
+	for(i = 0; i < SYMBOL_BUCKETS; i++){
+		for(entry = document->symbols[i]; entry; entry = next){
+			next = entry->next;
+			free(entry->definers);
+			free(entry->referrers);
+			free(entry);
+		}
+		document->symbols[i] = NULL;
+	}
+	document->changedSymbols = NULL;
+}
+
+void destroyDocument(Document *document){
+	int i;
+	for(i = 0; i < document->lineCount; i++)
+		destroyLine(document->lines[i]);
+	free(document->lines);
+	destroySymbolEntries(document);
+	destroyDocumentMacros(document);
+	free(document->uri);
+	free(document);
+}
+
+/*
+ * Returns the address of a label defined by the line
+ */
+int getLabelAddress(Document *document, Line *line, Definition *definition){
+	if(definition->segment == DATA_SEGMENT)
+		return getLoadAddress() + document->codeWords + line->dataOffset + definition->offset;
+	return getLoadAddress() + line->codeOffset + definition->offset;
+}
+
+/*
+ * Stores the name (letters, digits and '_') at or right before the character in word
+ * returns 1 if found a name 0 if not
+ */
+int getWordAt(char *text, int character, char *word){
+	int start, end, length = strlen(text);
+	if(character < 0 || character > length)
+		return 0;
+	for(start = character; start > 0 && (isalnum((unsigned char)text[start - 1]) || text[start - 1] == '_'); start--){
+	}
+	for(end = character; end < length && (isalnum((unsigned char)text[end]) || text[end] == '_'); end++){
+	}
+	if(end == start || end - start >= MAX_LINE_LENGTH)
+		return 0;
+	strncpy(word, text + start, end - start);
+	word[end - start] = '\0';
+	return 1;
+}
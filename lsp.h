@@ -0,0 +1,17 @@
+/*
+ * lsp.h
+ * 		module runs the assembler as a language server, speaking the Language Server Protocol over stdin/stdout
+ * 		it reports diagnostics while a file is edited and answers go to definition and hover requests
+ */
+#ifndef LSP_H
+#define LSP_H
+#include "options.h"
+
+/*
+ * Serves the language server protocol on stdin/stdout until the client sends "exit" or closes stdin
+ * conditional blocks are evaluated for the first variant of the options
+ * Returns the exit status - 0 if the client shut the server down before exiting, otherwise 1
+ */
+int runLanguageServer(Options *options);
+
+#endif
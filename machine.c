@@ -0,0 +1,451 @@
+/*
+ * machine.c
+ * 		module executes assembled programs on a model of the target machine - 16 opcodes, 8 registers,
+ * 		a memory and word width of the configured geometry (see geometry.h) and a stack for jsr and rts
+ *
+ * 		The code is decoded once, when the program is loaded, into an array of operations. Every operand is
+ * 		resolved to the word it reads and writes - a register, a word of the memory (the field of a struct
+ * 		included) or a word of the operation holding an immediate value - and every jump to the index of the
+ * 		operation it leads to, so executing an operation is a single step with no decoding.
+ * 		Operations are dispatched through a table of label addresses when compiled by GCC (or a compatible
+ * 		compiler) - every operation jumping directly to the next - and through a switch otherwise
+ * 		(or when compiled with -DSWITCH_DISPATCH).
+ *
+ * 		Registers and words hold values of the width of a word, calculations wrap around it.
+ * 		cmp sets the zero flag if its operands are equal and bne jumps if it isn't set, jsr and rts
+ * 		call and return through the stack, get reads a number from the standard input into its operand
+ * 		and prn prints its operand. lea, which takes a single operand, loads the address of it into r0.
+ * 		Externs are stubs: their uses read and write a single scratch word and calling one returns at once.
+ * 		Code is executed as decoded when the program is loaded - storing into code doesn't change it.
+ */
+#if defined(__GNUC__) && !defined(SWITCH_DISPATCH)
+#define THREADED_DISPATCH
+/* the addresses of labels are an extension of GCC */
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "geometry.h"
+
+static char *traps[NUM_OF_TRAPS] = {
+		"ran past the end of the code", "jumped to an address holding no instruction", "jumped to an extern",
+		"jumped to an immediate value", "loaded the address of a register", "overflowed the stack",
+		"returned with an empty stack", "found no number to get"
+};
+
+int decodeOperation(Machine *machine, int *words, int count, Operation *operation);
+int* resolveOperand(Machine *machine, DecodedOperand *operand, int *words, int *immediate);
+void decodeJump(DecodedOperand *operand, int *words, Operation *operation);
+void setTrap(Operation *operation, int trap);
+int toSigned(int word);
+int* movePointer(int *pointer, Machine *from, Machine *to);
+void addWord(Machine *machine, int word);
+
+/*
+ * Loads the module into a new machine, decoding its code into operations
+ * Returns the machine or NULL if the code can't be decoded (reporting why)
+ */
+Machine* createMachine(ObjectModule *module){
+	Machine *machine = (Machine*)calloc(1, sizeof(Machine));
+	Operation *operation, *trap;
+	int i, offset, length = module->codeLength + module->dataLength;
+
+	machine->memory = (int*)calloc(getMemoryLength(), sizeof(int));
+	machine->operationIndex = (int*)malloc(sizeof(int) * getMemoryLength());
+	/* at most an operation per word, and the traps for running past the code and jumping to no instruction -
+	 * a jump leading to an address takes two words, so it leaves room for its own trap */
+	machine->operations = (Operation*)calloc(module->codeLength + 2, sizeof(Operation));
+	machine->output = stdout;
+	machine->firstWord = getLoadAddress();
+	machine->lastWord = getLoadAddress() + length - 1;
+	memcpy(machine->memory + getLoadAddress(), module->words, sizeof(int) * length);
+	for(i = 0; i < getMemoryLength(); i++)
+		machine->operationIndex[i] = -1;
+
+	for(offset = 0; offset < module->codeLength; offset += operation->length){
+		operation = &machine->operations[machine->operationCount];
+		operation->address = getLoadAddress() + offset;
+		if(!decodeOperation(machine, module->words + offset, module->codeLength - offset, operation)){
+			fprintf(stderr,"Error: %s has no valid instruction at %d\n",module->name,operation->address);
+			destroyMachine(machine);
+			return NULL;
+		}
+		machine->operationIndex[operation->address] = machine->operationCount++;
+	}
+	setTrap(&machine->operations[machine->operationCount], END_OF_CODE_TRAP);
+	setTrap(&machine->operations[machine->operationCount + 1], NO_INSTRUCTION_TRAP);
+	machine->operations[machine->operationCount].address = getLoadAddress() + module->codeLength;
+	/* a jump through a register sets the address of its trap and the target when it jumps */
+	machine->operations[machine->operationCount + 1].address = -1;
+	machine->operations[machine->operationCount + 1].jumpTarget = -1;
+
+	/* jumps lead to addresses until every operation is indexed - a jump to no instruction gets a trap of its own,
+	 * which tells where it jumped from and to */
+	for(i = 0; i < machine->operationCount; i++){
+		operation = &machine->operations[i];
+		if(operation->opCode == JMP_OP || operation->opCode == BNE_OP || operation->opCode == JSR_OP){
+			if(operation->target < 0 || operation->target >= getMemoryLength() || machine->operationIndex[operation->target] < 0){
+				trap = &machine->operations[machine->operationCount + 2 + machine->jumpTrapCount];
+				setTrap(trap, NO_INSTRUCTION_TRAP);
+				trap->address = operation->address;
+				trap->jumpTarget = operation->target;
+				operation->target = machine->operationCount + 2 + machine->jumpTrapCount++;
+			}
+			else
+				operation->target = machine->operationIndex[operation->target];
+		}
+	}
+	return machine;
+}
+
+/*
+ * Decodes the instruction starting at words[0] into the operation
+ * Returns 1 if succeeded or 0 if the words are not a valid instruction
+ */
+int decodeOperation(Machine *machine, int *words, int count, Operation *operation){
+	Instruction instruction;
+
+	if(!decodeInstruction(words, count, &instruction))
+		return 0;
+	operation->opCode = instruction.opCode;
+	operation->length = instruction.length;
+	operation->cycles = instructionCycles(&instruction);
+	if(instruction.operandCount == 2 && !(operation->src = resolveOperand(machine, &instruction.src, words, &operation->srcImmediate)))
+		return 0;
+	if(instruction.operandCount >= 1 && !(operation->dst = resolveOperand(machine, &instruction.dst, words, &operation->dstImmediate)))
+		return 0;
+
+	if(instruction.opCode == JMP_OP || instruction.opCode == BNE_OP || instruction.opCode == JSR_OP)
+		decodeJump(&instruction.dst, words, operation);
+	else if(instruction.opCode == LEA_OP && instruction.dst.mode == REGISTER_MODE)
+		setTrap(operation, REGISTER_LEA_TRAP);
+	else if(instruction.opCode == LEA_OP)
+		operation->target = ((words[instruction.dst.wordOffset] & ARE_MASK) == EXTERNAL_ARE)? 0
+				: instruction.dst.value + ((instruction.dst.mode == STRUCT_MODE)? instruction.dst.field - 1 : 0);
+	return 1;
+}
+
+/*
+ * Returns the word the operand reads and writes - the immediate word of the operation for an immediate value -
+ * or NULL if the operand addresses a word outside of the memory (reporting it)
+ */
+int* resolveOperand(Machine *machine, DecodedOperand *operand, int *words, int *immediate){
+	int address;
+	switch(operand->mode){
+		case IMMEDIATE_MODE:
+			*immediate = operand->value & ((1 << getWordWidth()) - 1);
+			return immediate;
+		case REGISTER_MODE:
+			return &machine->registers[operand->value];
+		default:
+			if((words[operand->wordOffset] & ARE_MASK) == EXTERNAL_ARE)
+				return &machine->stub;
+			address = operand->value + ((operand->mode == STRUCT_MODE)? operand->field - 1 : 0);
+			if(address >= getMemoryLength()){
+				fprintf(stderr,"Error: address %d is outside the memory of %d words\n",address,getMemoryLength());
+				return NULL;
+			}
+			machine->firstWord = (address < machine->firstWord)? address : machine->firstWord;
+			machine->lastWord = (address > machine->lastWord)? address : machine->lastWord;
+			return &machine->memory[address];
+	}
+}
+
+/*
+ * Sets the target of a jump, jsr or bne to the address it leads to, or chooses the operation
+ * jumping through a register, calling a stub or trapping instead
+ */
+void decodeJump(DecodedOperand *operand, int *words, Operation *operation){
+	if(operand->mode == IMMEDIATE_MODE)
+		setTrap(operation, IMMEDIATE_JUMP_TRAP);
+	else if(operand->mode == REGISTER_MODE)
+		operation->opCode = (operation->opCode == JMP_OP)? JMP_REGISTER_OP : (operation->opCode == BNE_OP)? BNE_REGISTER_OP : JSR_REGISTER_OP;
+	else if((words[operand->wordOffset] & ARE_MASK) == EXTERNAL_ARE && operation->opCode == JSR_OP)
+		operation->opCode = STUB_CALL_OP;
+	else if((words[operand->wordOffset] & ARE_MASK) == EXTERNAL_ARE)
+		setTrap(operation, EXTERN_JUMP_TRAP);
+	else
+		operation->target = operand->value + ((operand->mode == STRUCT_MODE)? operand->field - 1 : 0);
+}
+
+void setTrap(Operation *operation, int trap){
+	operation->opCode = TRAP_OP;
+	operation->target = trap;
+}
+
+/*
+ * Returns the trap of jumping through a register to no instruction, set to the jump and the address it led to
+ * (the harness stops a machine there as well, once a translation trapped at a jump to no instruction)
+ */
+Operation* jumpToNoInstruction(Machine *machine, Operation *jump, int target){
+	Operation *trap = &machine->operations[machine->operationCount + 1];
+	trap->address = jump->address;
+	trap->jumpTarget = target;
+	return trap;
+}
+
+/*
+ * Executes the program until it halts, traps or has executed limit operations (this run)
+ * Returns the state the machine stopped in
+ */
+int runMachine(Machine *machine, long limit){
+	Operation *operations = machine->operations, *operation = operations + machine->pc;
+	int *registers = machine->registers, *index = machine->operationIndex;
+	int mask = (1 << getWordWidth()) - 1, memoryLength = getMemoryLength();
+	long steps = 0;
+	int target;
+#ifdef THREADED_DISPATCH
+	static void *handlers[] = { &&doMov, &&doCmp, &&doAdd, &&doSub, &&doNot, &&doClr, &&doLea, &&doInc,
+		&&doDec, &&doJmp, &&doBne, &&doGet, &&doPrn, &&doJsr, &&doRts, &&doHlt,
+		&&doJmpRegister, &&doBneRegister, &&doJsrRegister, &&doStubCall, &&doTrap };
+/* every operation dispatches the next itself */
+#define DISPATCH if(++steps > limit) goto stopped; operation->executions++; goto *handlers[operation->opCode];
+#define OPERATION(label, opCode) label:
+#define NEXT DISPATCH
+#else
+#define DISPATCH for(;;){ if(++steps > limit) goto stopped; operation->executions++; switch(operation->opCode){
+#define OPERATION(label, opCode) case opCode:
+#define NEXT continue
+#endif
+
+	machine->state = RUNNING_STATE;
+	DISPATCH
+	OPERATION(doMov, MOV_OP)
+		*operation->dst = *operation->src;
+		operation++;
+		NEXT;
+	OPERATION(doCmp, CMP_OP)
+		machine->zero = *operation->src == *operation->dst;
+		operation++;
+		NEXT;
+	OPERATION(doAdd, ADD_OP)
+		*operation->dst = (*operation->dst + *operation->src) & mask;
+		operation++;
+		NEXT;
+	OPERATION(doSub, SUB_OP)
+		*operation->dst = (*operation->dst - *operation->src) & mask;
+		operation++;
+		NEXT;
+	OPERATION(doNot, NOT_OP)
+		*operation->dst = ~*operation->dst & mask;
+		operation++;
+		NEXT;
+	OPERATION(doClr, CLR_OP)
+		*operation->dst = 0;
+		operation++;
+		NEXT;
+	OPERATION(doLea, LEA_OP)
+		registers[0] = operation->target;
+		operation++;
+		NEXT;
+	OPERATION(doInc, INC_OP)
+		*operation->dst = (*operation->dst + 1) & mask;
+		operation++;
+		NEXT;
+	OPERATION(doDec, DEC_OP)
+		*operation->dst = (*operation->dst - 1) & mask;
+		operation++;
+		NEXT;
+	OPERATION(doJmp, JMP_OP)
+		operation = operations + operation->target;
+		NEXT;
+	OPERATION(doBne, BNE_OP)
+		operation = (machine->zero)? operation + 1 : operations + operation->target;
+		NEXT;
+	OPERATION(doGet, GET_OP)
+		if(machine->input && machine->inputPosition < machine->inputCount)
+			target = machine->input[machine->inputPosition++];
+		else if(machine->input || scanf("%d", &target) != 1){
+			machine->trap = traps[NO_INPUT_TRAP];
+			machine->state = TRAPPED_STATE;
+			goto stopped;
+		}
+		*operation->dst = target & mask;
+		operation++;
+		NEXT;
+	OPERATION(doPrn, PRN_OP)
+		if(machine->output)
+			fprintf(machine->output,"%d\n",toSigned(*operation->dst));
+		else
+			addWord(machine, *operation->dst);
+		operation++;
+		NEXT;
+	OPERATION(doJsr, JSR_OP)
+		if(machine->stackDepth == STACK_DEPTH){
+			machine->trap = traps[STACK_OVERFLOW_TRAP];
+			machine->state = TRAPPED_STATE;
+			goto stopped;
+		}
+		machine->stack[machine->stackDepth++] = (int)(operation - operations) + 1;
+		operation = operations + operation->target;
+		NEXT;
+	OPERATION(doRts, RTS_OP)
+		if(machine->stackDepth == 0){
+			machine->trap = traps[STACK_UNDERFLOW_TRAP];
+			machine->state = TRAPPED_STATE;
+			goto stopped;
+		}
+		operation = operations + machine->stack[--machine->stackDepth];
+		NEXT;
+	OPERATION(doHlt, HLT_OP)
+		machine->state = HALTED_STATE;
+		goto stopped;
+	OPERATION(doJmpRegister, JMP_REGISTER_OP)
+		target = *operation->dst;
+		operation = (target < memoryLength && index[target] >= 0)? operations + index[target] : jumpToNoInstruction(machine, operation, target);
+		NEXT;
+	OPERATION(doBneRegister, BNE_REGISTER_OP)
+		target = *operation->dst;
+		if(machine->zero)
+			operation++;
+		else
+			operation = (target < memoryLength && index[target] >= 0)? operations + index[target] : jumpToNoInstruction(machine, operation, target);
+		NEXT;
+	OPERATION(doJsrRegister, JSR_REGISTER_OP)
+		if(machine->stackDepth == STACK_DEPTH){
+			machine->trap = traps[STACK_OVERFLOW_TRAP];
+			machine->state = TRAPPED_STATE;
+			goto stopped;
+		}
+		machine->stack[machine->stackDepth++] = (int)(operation - operations) + 1;
+		target = *operation->dst;
+		operation = (target < memoryLength && index[target] >= 0)? operations + index[target] : jumpToNoInstruction(machine, operation, target);
+		NEXT;
+	OPERATION(doStubCall, STUB_CALL_OP)
+		operation++;
+		NEXT;
+	OPERATION(doTrap, TRAP_OP)
+		machine->trap = traps[operation->target];
+		machine->state = TRAPPED_STATE;
+		goto stopped;
+#ifndef THREADED_DISPATCH
+	}}
+#endif
+
+stopped:
+	/* an operation which stopped the machine isn't done, so it is executed again when the machine resumes */
+	if(machine->state == RUNNING_STATE){
+		machine->state = LIMIT_STATE;
+		steps--;
+	}
+	else if(machine->state == HALTED_STATE)
+		operation++;
+	machine->steps += steps;
+	machine->pc = (int)(operation - operations);
+	return machine->state;
+}
+
+/*
+ * Returns the description of the trap (using enum traps)
+ */
+char* getTrapMessage(int trap){
+	return traps[trap];
+}
+
+/*
+ * Writes the trap the machine stopped at, and where, to text (of MAX_TRAP_DESCRIPTION characters) -
+ * a jump to no instruction is described by the address of the jump and the address it led to
+ * Returns text
+ */
+char* describeTrap(Machine *machine, char *text){
+	Operation *operation = &machine->operations[machine->pc];
+	if(operation->opCode == TRAP_OP && operation->target == NO_INSTRUCTION_TRAP)
+		sprintf(text, "%s (at %d, jumping to %d)", machine->trap, operation->address, operation->jumpTarget);
+	else
+		sprintf(text, "%s (at %d)", machine->trap, operation->address);
+	return text;
+}
+
+/*
+ * Adds a value printed by prn to the values collected by the machine
+ */
+void addWord(Machine *machine, int word){
+	if(machine->printedCount == machine->printedCapacity){
+		machine->printedCapacity = (machine->printedCapacity)? machine->printedCapacity * 2 : 16;
+		machine->printed = (int*)realloc(machine->printed, sizeof(int) * machine->printedCapacity);
+	}
+	machine->printed[machine->printedCount++] = word;
+}
+
+/*
+ * Returns a new machine running the program of the snapshot (which must outlive it), in the state of the snapshot
+ */
+Machine* cloneMachine(Machine *snapshot){
+	Machine *machine = (Machine*)malloc(sizeof(Machine));
+	int i, operationBytes = sizeof(Operation) * (snapshot->operationCount + 2 + snapshot->jumpTrapCount);
+
+	memcpy(machine, snapshot, sizeof(Machine));
+	machine->isClone = 1;
+	machine->printed = NULL;
+	machine->printedCount = machine->printedCapacity = 0;
+	machine->memory = (int*)malloc(sizeof(int) * getMemoryLength());
+	memcpy(machine->memory, snapshot->memory, sizeof(int) * getMemoryLength());
+	machine->operations = (Operation*)malloc(operationBytes);
+	memcpy(machine->operations, snapshot->operations, operationBytes);
+	/* the operands of the copied operations still point to the words of the snapshot */
+	for(i = 0; i < machine->operationCount; i++){
+		machine->operations[i].src = movePointer(snapshot->operations[i].src, snapshot, machine);
+		machine->operations[i].dst = movePointer(snapshot->operations[i].dst, snapshot, machine);
+	}
+	return machine;
+}
+
+/*
+ * Returns the word of a machine corresponding to a word of another machine running the same program
+ */
+int* movePointer(int *pointer, Machine *from, Machine *to){
+	char *operations = (char*)from->operations;
+	if(!pointer)
+		return NULL;
+	if(pointer >= from->memory && pointer < from->memory + getMemoryLength())
+		return to->memory + (pointer - from->memory);
+	if(pointer >= from->registers && pointer < from->registers + NUM_OF_REGISTERS)
+		return to->registers + (pointer - from->registers);
+	if(pointer == &from->stub)
+		return &to->stub;
+	/* the immediate words of an operation */
+	return (int*)((char*)to->operations + ((char*)pointer - operations));
+}
+
+/*
+ * Brings a clone back to the state of the snapshot it was cloned from, before running the program again
+ */
+void restoreMachine(Machine *machine, Machine *snapshot){
+	/* only the words the program holds or addresses can have changed */
+	memcpy(machine->memory + snapshot->firstWord, snapshot->memory + snapshot->firstWord,
+			sizeof(int) * (snapshot->lastWord - snapshot->firstWord + 1));
+	memcpy(machine->registers, snapshot->registers, sizeof(machine->registers));
+	machine->zero = snapshot->zero;
+	machine->stackDepth = snapshot->stackDepth;
+	machine->stub = snapshot->stub;
+	machine->pc = snapshot->pc;
+	machine->state = snapshot->state;
+	machine->trap = snapshot->trap;
+	machine->steps = 0;
+	machine->inputPosition = 0;
+	machine->printedCount = 0;
+}
+
+/*
+ * Returns the value of a word as a two's complement number
+ */
+int toSigned(int word){
+	int signBit = 1 << (getWordWidth() - 1);
+	return (word & signBit)? word - (signBit << 1) : word;
+}
+
+/*
+ * Frees space dynamically allocated to the machine
+ */
+void destroyMachine(Machine *machine){
+	if(!machine)
+		return;
+	free(machine->operations);
+	if(!machine->isClone)
+		free(machine->operationIndex);
+	free(machine->memory);
+	free(machine->printed);
+	free(machine);
+}
@@ -0,0 +1,117 @@
+/*
+ * machine.h
+ * 		module executes assembled programs on a model of the target machine - 16 opcodes, 8 registers,
+ * 		a memory and word width of the configured geometry (see geometry.h) and a stack for jsr and rts
+ *
+ * 		The code is decoded once, when the program is loaded, into an array of operations - one per
+ * 		instruction, its operands resolved to the words they read and write - which is then executed.
+ * 		A loaded machine serves as a snapshot: clones of it run the program again and again, each run
+ * 		starting from the state of the snapshot without decoding the program again.
+ */
+#ifndef MACHINE_H
+#define MACHINE_H
+#include <stdio.h>
+#include "object.h"
+#include "instruction.h"
+
+#define STACK_DEPTH 1024
+#define MAX_TRAP_DESCRIPTION 128
+
+/* the reason the machine stopped */
+enum machineStates { RUNNING_STATE, HALTED_STATE, TRAPPED_STATE, LIMIT_STATE };
+
+/* operations beyond the opcodes of the machine, chosen when the code is loaded */
+enum operations { JMP_REGISTER_OP = NUM_OF_OPCODES, BNE_REGISTER_OP, JSR_REGISTER_OP, STUB_CALL_OP, TRAP_OP };
+
+/* the reasons of a trap */
+enum traps { END_OF_CODE_TRAP, NO_INSTRUCTION_TRAP, EXTERN_JUMP_TRAP, IMMEDIATE_JUMP_TRAP, REGISTER_LEA_TRAP,
+	STACK_OVERFLOW_TRAP, STACK_UNDERFLOW_TRAP, NO_INPUT_TRAP, NUM_OF_TRAPS };
+
+typedef struct Operation {
+	int opCode;			/* enum opcodes, or one of the operations of machine.c */
+	int address;		/* address of the instruction */
+	int length;			/* amount of words of the instruction */
+	int cycles;			/* cycles the instruction takes each time it runs (see instructionCycles) */
+	int *src;			/* the word the source operand reads */
+	int *dst;			/* the word the destination operand reads and writes */
+	int target;			/* index of the operation a jump leads to, or the value an instruction uses */
+	int srcImmediate;	/* the words immediate operands read */
+	int dstImmediate;
+	int jumpTarget;		/* for the trap of a jump to no instruction - the address the jump led to */
+	long executions;	/* amount of times the operation was executed */
+} Operation;
+
+typedef struct Machine {
+	Operation *operations;	/* an operation per instruction, followed by the traps for running past the code,
+							 * for jumping through a register to no instruction, and for every jump to no instruction */
+	int operationCount;
+	int jumpTrapCount;		/* the traps of the jumps to no instruction */
+	int *operationIndex;	/* index of the operation at every address of the memory, -1 if no instruction starts there */
+	int isClone;			/* the operation index belongs to the snapshot the machine was cloned from */
+	int *memory;
+	int firstWord;			/* the words of the memory the program holds or addresses - the rest stay 0 */
+	int lastWord;
+	int registers[NUM_OF_REGISTERS];
+	int zero;				/* the flag set by cmp */
+	int stack[STACK_DEPTH];
+	int stackDepth;
+	int stub;				/* the word every use of an extern reads and writes */
+	int pc;					/* index of the next operation */
+	int state;				/* enum machineStates */
+	char *trap;				/* the reason of a trap */
+	long steps;				/* amount of operations executed */
+	int *input;				/* numbers get reads, NULL to read the standard input */
+	int inputCount;
+	int inputPosition;
+	FILE *output;			/* stream prn prints to, NULL to collect the printed values */
+	int *printed;			/* values prn printed while output is NULL */
+	int printedCount;
+	int printedCapacity;
+} Machine;
+
+/*
+ * Loads the module into a new machine, decoding its code into operations
+ * Returns the machine or NULL if the code can't be decoded (reporting why)
+ */
+Machine* createMachine(ObjectModule *module);
+
+/*
+ * Returns a new machine running the program of the snapshot (which must outlive it), in the state of the snapshot
+ */
+Machine* cloneMachine(Machine *snapshot);
+
+/*
+ * Brings a clone back to the state of the snapshot it was cloned from, before running the program again
+ */
+void restoreMachine(Machine *machine, Machine *snapshot);
+
+/*
+ * Executes the program until it halts, traps or has executed limit operations (this run)
+ * Returns the state the machine stopped in
+ */
+int runMachine(Machine *machine, long limit);
+
+/*
+ * Returns the description of the trap (using enum traps)
+ */
+char* getTrapMessage(int trap);
+
+/*
+ * Returns the trap of jumping through a register to no instruction, set to the jump and the address it led to
+ * (the harness stops a machine there as well, once a translation trapped at a jump to no instruction)
+ */
+Operation* jumpToNoInstruction(Machine *machine, Operation *jump, int target);
+
+/*
+ * Writes the trap the machine stopped at, and where, to text (of MAX_TRAP_DESCRIPTION characters) -
+ * a jump to no instruction is described by the address of the jump and the address it led to
+ * Returns text
+ */
+char* describeTrap(Machine *machine, char *text);
+
+/*
+ * Frees space dynamically allocated to the machine
+ */
+void destroyMachine(Machine *machine);
+
+#endif
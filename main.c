@@ -2,36 +2,146 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "data.h"
-
-extern int assemble(char *name);
-extern void preprocessor(char *name, int *success);
-
-void assembleFile(char *filename);
+#include "main.h"
+#include "daemon.h"
+#include "size.h"
+#include "check.h"
+#include "cache.h"
+#include "library.h"
+#include "lsp.h"
+#include "watch.h"
+#include "diagnostics.h"
+#include "utilities.h"
+#include "lines.h"
+#include "timings.h"
 
 int main(int argc, char **argv){
-	int i=1;
-	if (argc < 2)
+	int i=0, success;
+	Options options;
+	if(!parseOptions(argc, argv, &options)){
+		destroyOptions(&options);
+		return 1;
+	}
+	if(options.lsp){
+		i = runLanguageServer(&options);
+		destroyOptions(&options);
+		return i;
+	}
+	if(options.daemonSocket){
+		i = runDaemon(&options);
+		destroyOptions(&options);
+		return i;
+	}
+	if(options.clientSocket){
+		i = runClient(&options);
+		destroyOptions(&options);
+		return i;
+	}
+	if (options.fileCount < 1)
 		printf("No command line parameters found.\nProgram requires files to compile and assemble.\nPlease enter .as file names (without extension) as command line parameters.\n");
-	for(; i<argc; i++){
-		printf("Begin operation on %s.as\n",argv[i]);
-		assembleFile(argv[i]);
-		printf("-------------\n");
+	else if(options.watch){
+		i = runWatch(&options);
+		destroyOptions(&options);
+		return i;
+	}
+	if(options.checkOnly){
+		/* a hook needs to tell from the exit status whether every file is valid */
+		for(success = 1; i<options.fileCount; i++)
+			success = checkFile(options.files[i], NULL, &options) && success;
+		destroyOptions(&options);
+		return !success;
 	}
+	for(; options.sizeOnly && i<options.fileCount; i++)
+		sizeFile(options.files[i], NULL, &options);
+	for(; i<options.fileCount; i++){
+		reportProgress("Begin operation on %s.as",options.files[i]);
+		assembleFile(options.files[i], &options);
+		reportProgress("-------------");
+		flushDiagnostics();
+	}
+	if(options.timingsFile && !options.sizeOnly && !options.checkOnly){
+		writeTimings(options.timingsFile);
+		flushDiagnostics();
+	}
+	finishCache(&options);
+	closeLibraries();
+	destroyOptions(&options);
 	return 1;
 }
 
-void assembleFile(char *filename){
-	int success=1;
-	printf("Performing pre processor\n");
-	preprocessor(filename, &success);
+/*
+ * Runs the whole assembly process (pre processor and assembly) on "[filename].as"
+ * for every variant in the options
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int assembleFile(char *filename, Options *options){
+	if(options->cacheDir && !options->sizeOnly && !options->checkOnly)
+		return cachedAssembleFile(filename, options);
+	return assembleSource(filename, NULL, options);
+}
+
+/*
+ * Same as assembleFile, but reads the source code from the given stream instead of "[filename].as"
+ * output files are still named after filename
+ */
+int assembleSource(char *filename, FILE *source, Options *options){
+	int i, success=1, variantSuccess;
+	char *variantName, *url;
+	SourceStream *stream;
+	clock_t start;
+	if(options->sizeOnly)
+		return sizeFile(filename, source, options);
+	if(options->checkOnly)
+		return checkFile(filename, source, options);
+	resetDiagnostics();
+	url = constructUrl(filename, "as");
+	setDiagnosticsSource(url);
+	reportProgress("Performing pre processor");
+	stream = createSourceStream();
+	start = startPhase();
+	if(source)
+		preprocessStream(source, filename, options->variants, options->variantCount, stream, &success);
+	else
+		preprocessor(filename, options->variants, options->variantCount, stream, &success);
+	endPhase(PREPROCESSOR_PHASE, start, (source)? NULL : url);
 	if(!success){
-		printf("Encountered error during preprocessor - aborting operation\n");
-		return;
+		reportProgress("Encountered error during preprocessor - aborting operation");
+		flushDiagnostics();
+		setDiagnosticsSource(NULL);
+		destroySourceStream(stream);
+		free(url);
+		return success;
 	}
-	printf("Beginning work on expanded file %s.am\n",filename);
-	success = assemble(filename);
-	if(success)
-		printf("Finished Assembly Process on %s successfully\n",filename);
-	else
-		fprintf(stderr,"Program encountered errors while assembling file %s.am, aborting operation.\n",filename);
+	setDiagnosticsSource(NULL);
+	free(url);
+	if(options->writeDependencies)
+		writeDependencyFile(filename, options->variants, options->variantCount);
+	/* the source was expanded once for all variants, and its lines are decoded once -
+	 * each variant then lays the lines it holds out on its own (the decoding counts as a run of the first pass) */
+	start = startPhase();
+	decodeStream(stream);
+	endPhase(FIRST_PASS_PHASE, start, NULL);
+	for(i = 0; i < options->variantCount; i++){
+		variantName = constructVariantName(filename, &options->variants[i]);
+		url = constructUrl(variantName, "am");
+		setDiagnosticsSource(url);
+		reportProgress("Beginning work on expanded file %s.am",variantName);
+		/* every variant gets the whole error limit */
+		resetDiagnostics();
+		selectLineOrigins(i);
+		variantSuccess = assemble(variantName, options->writeRelocations, options->writeLineTable, options->optimize, options->poolData, options->collectGarbage, options->mapFormat, stream, i);
+		if(variantSuccess)
+			reportProgress("Finished Assembly Process on %s successfully",variantName);
+		else
+			reportSummary("Program encountered errors while assembling file %s.am, aborting operation.",variantName);
+		success = success && variantSuccess;
+		/* the records hold a copy of the file name, so it can be freed before they are written */
+		setDiagnosticsSource(NULL);
+		free(url);
+		free(variantName);
+	}
+	countTemplates(stream->templates->hits, stream->templates->misses);
+	destroySourceStream(stream);
+	flushDiagnostics();
+	return success;
 }
@@ -1,8 +1,19 @@
+#include <stdio.h>
 #include "preprocessor.h"
 #include "assembly.h"
-
-extern int assemble(char *name);
-extern void preprocessor(char *name, int *success);
+#include "options.h"
 
 int main(int argc, char **argv);
 
+/*
+ * Runs the whole assembly process (pre processor and assembly) on "[filename].as"
+ * for every variant in the options
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int assembleFile(char *filename, Options *options);
+
+/*
+ * Same as assembleFile, but reads the source code from the given stream instead of "[filename].as"
+ * output files are still named after filename
+ */
+int assembleSource(char *filename, FILE *source, Options *options);
@@ -0,0 +1,286 @@
+/*
+ * map.c
+ * 		module writes the memory map of a program "[name].map" (with --map) - where its words go: every label
+ * 		with its segment, address and size, the words of every macro expansion, the addressing modes of
+ * 		every opcode and the space left in the memory of the target machine
+ *
+ * 		The size of a label is the amount of words from it up to the next label of its segment (or the end of
+ * 		the segment), the words of a statement are those up to the next statement of its segment. The map is
+ * 		written in human readable text, or as a single JSON object for tools tracking the size of programs.
+ * 		It is written before the second pass, so a program which doesn't fit in the memory still has one - only
+ * 		the instructions of the code within the memory are counted then.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "map.h"
+#include "instruction.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "json.h"
+
+/* a label of the program and the words following it */
+typedef struct MapLabel {
+	Symbol *symbol;
+	int address;
+	int size;
+} MapLabel;
+
+/* the words of an invocation of a macro */
+typedef struct MapExpansion {
+	char *macro;
+	int line;			/* the source line the macro was invoked in */
+	int codeWords;
+	int dataWords;
+} MapExpansion;
+
+typedef struct MemoryMap {
+	MapLabel *labels;
+	int labelCount;
+	MapExpansion *expansions;
+	int expansionCount;
+	int sourceCodeWords;	/* words of the statements expanded from no macro */
+	int sourceDataWords;
+	int instructions[NUM_OF_OPCODES];
+	int modes[NUM_OF_OPCODES][NUM_OF_ADDRESSING_MODES];	/* operands of every opcode by their addressing mode */
+	int decodedWords;		/* code words the instructions counted cover */
+} MemoryMap;
+
+static char *modeNames[NUM_OF_ADDRESSING_MODES] = { "immediate", "direct", "struct", "register" };
+
+void mapLabels(MemoryMap *map, int ic, int dc, Symbol *symTable);
+void mapExpansions(MemoryMap *map, int ic, int dc, LineTable *lines);
+void mapInstructions(MemoryMap *map, Image *image, int ic);
+void writeHumanMap(FILE *file, char *name, MemoryMap *map, int ic, int dc, Symbol *symTable);
+void writeJsonMap(FILE *file, char *name, MemoryMap *map, int ic, int dc, Symbol *symTable);
+int compareMapLabels(const void *first, const void *second);
+
+/*
+ * Writes the map of the program laid out in the image (up to ic, followed by dc data words) to "[name].map"
+ * in the format (using enum mapFormat) - the data labels and the data entries of lines still being offsets
+ * in the data segment, as they are between the passes
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeMemoryMap(char *name, int format, Image *image, int ic, int dc, Symbol *symTable, LineTable *lines){
+	char *url = constructUrl(name, "map");
+	FILE *file = fopen(url, "w");
+	MemoryMap map;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	memset(&map, 0, sizeof(MemoryMap));
+	mapLabels(&map, ic, dc, symTable);
+	mapExpansions(&map, ic, dc, lines);
+	mapInstructions(&map, image, ic);
+	if(format == JSON_MAP)
+		writeJsonMap(file, name, &map, ic, dc, symTable);
+	else
+		writeHumanMap(file, name, &map, ic, dc, symTable);
+	free(map.labels);
+	free(map.expansions);
+	fclose(file);
+	free(url);
+	return 1;
+}
+
+/*
+ * Fills the labels of the map, sorted by segment and address, with the words up to the next label of their segment
+ */
+void mapLabels(MemoryMap *map, int ic, int dc, Symbol *symTable){
+	Symbol *symbol;
+	int i, j, end;
+
+	for(symbol = symTable; symbol; symbol = symbol->next)
+		map->labelCount++;
+	map->labels = (MapLabel*)malloc(sizeof(MapLabel) * (map->labelCount + 1));
+	for(map->labelCount = 0, symbol = symTable; symbol; symbol = symbol->next){
+		/* externs take no words and an entry never defined has no address */
+		if(symbol->isExternal == EXTERNAL_SYM || symbol->isExternal == ENTRY_AWAITING_ADDRESS_SYM)
+			continue;
+		map->labels[map->labelCount].symbol = symbol;
+		map->labels[map->labelCount++].address = symbol->address + ((symbol->segment == DATA_SEGMENT)? ic : 0);
+	}
+	qsort(map->labels, map->labelCount, sizeof(MapLabel), compareMapLabels);
+	for(i = 0; i < map->labelCount; i++){
+		end = (map->labels[i].symbol->segment == DATA_SEGMENT)? ic + dc : ic;
+		for(j = i + 1; j < map->labelCount && map->labels[j].symbol->segment == map->labels[i].symbol->segment; j++){
+			if(map->labels[j].address > map->labels[i].address){
+				end = map->labels[j].address;
+				break;
+			}
+		}
+		map->labels[i].size = end - map->labels[i].address;
+	}
+}
+
+int compareMapLabels(const void *first, const void *second){
+	MapLabel *firstLabel = (MapLabel*)first, *secondLabel = (MapLabel*)second;
+	if(firstLabel->symbol->segment != secondLabel->symbol->segment)
+		return firstLabel->symbol->segment - secondLabel->symbol->segment;
+	if(firstLabel->address != secondLabel->address)
+		return firstLabel->address - secondLabel->address;
+	return strcmp(firstLabel->symbol->name, secondLabel->symbol->name);
+}
+
+/*
+ * Fills the words of every macro expansion (and of the statements expanded from none) in the order of the source
+ */
+void mapExpansions(MemoryMap *map, int ic, int dc, LineTable *lines){
+	int i, line, *sizes, next[2];
+	MapExpansion *expansion;
+	char *macro;
+
+	if(!lines)
+		return;
+	sizes = (int*)malloc(sizeof(int) * (lines->count + 1));
+	map->expansions = (MapExpansion*)malloc(sizeof(MapExpansion) * (lines->count + 1));
+	/* a statement ends where the next statement of its segment starts */
+	next[0] = ic;
+	next[1] = dc;
+	for(i = lines->count - 1; i >= 0; i--){
+		sizes[i] = next[lines->entries[i].isData] - lines->entries[i].address;
+		if(sizes[i] < 0)
+			sizes[i] = 0;
+		next[lines->entries[i].isData] = lines->entries[i].address;
+	}
+	for(i = 0; i < lines->count; i++){
+		line = getLineOrigin(lines->entries[i].line, &macro);
+		if(strcmp(macro, NO_NAME) == 0){
+			*((lines->entries[i].isData)? &map->sourceDataWords : &map->sourceCodeWords) += sizes[i];
+			continue;
+		}
+		/* the lines of an expansion follow each other in the expanded source */
+		expansion = (map->expansionCount)? &map->expansions[map->expansionCount - 1] : NULL;
+		if(!expansion || expansion->line != line || strcmp(expansion->macro, macro) != 0){
+			expansion = &map->expansions[map->expansionCount++];
+			expansion->macro = macro;
+			expansion->line = line;
+			expansion->codeWords = 0;
+			expansion->dataWords = 0;
+		}
+		*((lines->entries[i].isData)? &expansion->dataWords : &expansion->codeWords) += sizes[i];
+	}
+	free(sizes);
+}
+
+/*
+ * Counts the instructions of the code in the image and their operands by opcode and addressing mode,
+ * up to the first words which are not an instruction (the code beyond the memory was never stored)
+ */
+void mapInstructions(MemoryMap *map, Image *image, int ic){
+	int length = ((ic < getMemoryLength())? ic : getMemoryLength()) - getLoadAddress(), offset;
+	int *words = (int*)malloc(sizeof(int) * (length + 1));
+	Instruction instruction;
+
+	for(offset = 0; offset < length; offset++)
+		words[offset] = readImageWord(image, getLoadAddress() + offset);
+	for(offset = 0; offset < length && decodeInstruction(words + offset, length - offset, &instruction); offset += instruction.length){
+		map->instructions[instruction.opCode]++;
+		if(instruction.operandCount == 2)
+			map->modes[instruction.opCode][instruction.src.mode]++;
+		if(instruction.operandCount >= 1)
+			map->modes[instruction.opCode][instruction.dst.mode]++;
+	}
+	map->decodedWords = offset;
+	free(words);
+}
+
+/*
+ * Writes the map as text - a table for the labels, the macro expansions and the instructions, then the totals
+ */
+void writeHumanMap(FILE *file, char *name, MemoryMap *map, int ic, int dc, Symbol *symTable){
+	int i, mode, codeWords = ic - getLoadAddress(), freeWords = getMemoryLength() - ic - dc;
+	Symbol *symbol;
+
+	fprintf(file,"Memory map of %s (memory of %d words, loaded at %d)\n",name,getMemoryLength(),getLoadAddress());
+	fprintf(file,"\nLabels:\n%-32s%-9s%-9s%s\n","Name","Segment","Address","Size");
+	for(i = 0; i < map->labelCount; i++)
+		fprintf(file,"%-32s%-9s%-9d%d%s\n",map->labels[i].symbol->name,
+				(map->labels[i].symbol->segment == DATA_SEGMENT)? "data" : "code",map->labels[i].address,map->labels[i].size,
+				(map->labels[i].symbol->isExternal == ENTRY_SYM)? " (entry)" : "");
+	for(symbol = symTable; symbol; symbol = symbol->next){
+		if(symbol->isExternal == EXTERNAL_SYM)
+			fprintf(file,"%-32s%-9s%-9s%d\n",symbol->name,"extern","-",0);
+	}
+
+	fprintf(file,"\nMacro expansions:\n%-32s%-9s%-9s%s\n","Macro","Line","Code","Data");
+	for(i = 0; i < map->expansionCount; i++)
+		fprintf(file,"%-32s%-9d%-9d%d\n",map->expansions[i].macro,map->expansions[i].line,
+				map->expansions[i].codeWords,map->expansions[i].dataWords);
+	fprintf(file,"%-32s%-9s%-9d%d\n","(no macro)","-",map->sourceCodeWords,map->sourceDataWords);
+
+	fprintf(file,"\nInstructions:\n%-9s%-9s","Opcode","Count");
+	for(mode = 0; mode < NUM_OF_ADDRESSING_MODES; mode++)
+		fprintf(file,(mode + 1 < NUM_OF_ADDRESSING_MODES)? "%-10s" : "%s\n",modeNames[mode]);
+	for(i = 0; i < NUM_OF_OPCODES; i++){
+		if(!map->instructions[i])
+			continue;
+		fprintf(file,"%-9s%-9d",getMnemonic(i),map->instructions[i]);
+		for(mode = 0; mode < NUM_OF_ADDRESSING_MODES; mode++)
+			fprintf(file,(mode + 1 < NUM_OF_ADDRESSING_MODES)? "%-10d" : "%d\n",map->modes[i][mode]);
+	}
+	if(map->decodedWords < codeWords)
+		fprintf(file,"(only the first %d of the %d code words are counted)\n",map->decodedWords,codeWords);
+
+	fprintf(file,"\nCode: %d words, data: %d words, total: %d words\n",codeWords,dc,codeWords + dc);
+	if(freeWords >= 0)
+		fprintf(file,"Free: %d words of %d\n",freeWords,getMemoryLength() - getLoadAddress());
+	else
+		fprintf(file,"Doesn't fit: %d words beyond the memory of %d words\n",-freeWords,getMemoryLength());
+}
+
+/*
+ * Writes the map as a JSON object
+ */
+void writeJsonMap(FILE *file, char *name, MemoryMap *map, int ic, int dc, Symbol *symTable){
+	int i, mode, first;
+	Symbol *symbol;
+
+	fputs("{\"name\":", file);
+	writeJsonString(file, name);
+	fprintf(file,",\"memory\":%d,\"loadAddress\":%d,\"code\":%d,\"data\":%d,\"free\":%d,\"fits\":%s",
+			getMemoryLength(),getLoadAddress(),ic - getLoadAddress(),dc,getMemoryLength() - ic - dc,
+			(ic + dc <= getMemoryLength())? "true" : "false");
+
+	fputs(",\"labels\":[", file);
+	for(i = 0; i < map->labelCount; i++){
+		fputs((i)? ",{\"name\":" : "{\"name\":", file);
+		writeJsonString(file, map->labels[i].symbol->name);
+		fprintf(file,",\"segment\":\"%s\",\"address\":%d,\"size\":%d,\"entry\":%s}",
+				(map->labels[i].symbol->segment == DATA_SEGMENT)? "data" : "code",map->labels[i].address,map->labels[i].size,
+				(map->labels[i].symbol->isExternal == ENTRY_SYM)? "true" : "false");
+	}
+	fputs("],\"externs\":[", file);
+	for(first = 1, symbol = symTable; symbol; symbol = symbol->next){
+		if(symbol->isExternal != EXTERNAL_SYM)
+			continue;
+		if(!first)
+			fputc(',', file);
+		writeJsonString(file, symbol->name);
+		first = 0;
+	}
+
+	fputs("],\"expansions\":[", file);
+	for(i = 0; i < map->expansionCount; i++){
+		fputs((i)? ",{\"macro\":" : "{\"macro\":", file);
+		writeJsonString(file, map->expansions[i].macro);
+		fprintf(file,",\"line\":%d,\"code\":%d,\"data\":%d}",map->expansions[i].line,
+				map->expansions[i].codeWords,map->expansions[i].dataWords);
+	}
+	fprintf(file,"],\"noMacro\":{\"code\":%d,\"data\":%d}",map->sourceCodeWords,map->sourceDataWords);
+
+	fputs(",\"instructions\":[", file);
+	for(first = 1, i = 0; i < NUM_OF_OPCODES; i++){
+		if(!map->instructions[i])
+			continue;
+		fprintf(file,"%s{\"opcode\":\"%s\",\"count\":%d",(first)? "" : ",",getMnemonic(i),map->instructions[i]);
+		for(mode = 0; mode < NUM_OF_ADDRESSING_MODES; mode++)
+			fprintf(file,",\"%s\":%d",modeNames[mode],map->modes[i][mode]);
+		fputc('}', file);
+		first = 0;
+	}
+	fprintf(file,"],\"countedCode\":%d}\n",map->decodedWords);
+}
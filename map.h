@@ -0,0 +1,23 @@
+/*
+ * map.h
+ * 		module writes the memory map of a program "[name].map" (with --map) - where its words go: every label
+ * 		with its segment, address and size, the words of every macro expansion, the addressing modes of
+ * 		every opcode and the space left in the memory of the target machine
+ */
+#ifndef MAP_H
+#define MAP_H
+#include "image.h"
+#include "data.h"
+#include "lines.h"
+
+enum mapFormat { NO_MAP, HUMAN_MAP, JSON_MAP };
+
+/*
+ * Writes the map of the program laid out in the image (up to ic, followed by dc data words) to "[name].map"
+ * in the format (using enum mapFormat) - the data labels and the data entries of lines still being offsets
+ * in the data segment, as they are between the passes
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeMemoryMap(char *name, int format, Image *image, int ic, int dc, Symbol *symTable, LineTable *lines);
+
+#endif
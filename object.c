@@ -0,0 +1,387 @@
+/*
+ * object.c
+ * 		module reads and writes the outputs of the assembler - the object file "[name].ob" along with its
+ * 		entries "[name].ent" and extern references "[name].ext" - so other tools can work on assembled programs
+ * 		also reads and writes the relocation file "[name].rel" written with --reloc
+ *
+ * 		Every number in these files is written in the special base 32. An object file starts with the amount of
+ * 		code and data words, followed by a line per word holding its address and its value.
+ * 		Object files are read whole and decoded in a single scan, every digit looked up in a table of the
+ * 		value of every character - tools verifying many programs spend little on reading them.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "object.h"
+#include "output.h"
+#include "geometry.h"
+#include "utilities.h"
+
+#define BASE_32_DIGIT_BITS 5
+
+/* the value of every character as a digit of the special base 32 ("!@#$%^&*<>abcdefghijklmnopqrstuv"), -1 if none */
+static const signed char digitValues[256] = {
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, 0, -1, 2, 3, 4, 6, -1, -1, -1, 7, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, -1, 9, -1,
+		1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 5, -1,
+		-1, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+		25, 26, 27, 28, 29, 30, 31, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+int readObjectWords(FILE *obFile, char *url, ObjectModule *module);
+char* scanBase32(char *text, char *end, int *value);
+char* skipBlanks(char *text, char *end);
+int readSymbolFile(char *name, char *extension, ObjectSymbol **symbols);
+
+/*
+ * Reads "[name].ob" along with "[name].ent" and "[name].ext" (which only exist if the program has entries or externs)
+ * Returns the module or NULL if the files can't be read (reporting why)
+ */
+ObjectModule* readObjectModule(char *name){
+	ObjectModule *module = (ObjectModule*)calloc(1, sizeof(ObjectModule));
+	char *url = constructUrl(name, "ob");
+	FILE *obFile = fopen(url, "r");
+	int success;
+
+	module->name = (char*)malloc(strlen(name) + 1);
+	strcpy(module->name, name);
+	if(!obFile){
+		fprintf(stderr,"Error: couldn't read object file %s\n",url);
+		free(url);
+		destroyObjectModule(module);
+		return NULL;
+	}
+	success = readObjectWords(obFile, url, module);
+	fclose(obFile);
+	free(url);
+	success = success && readSymbolFile(name, "ent", &module->entries);
+	success = success && readSymbolFile(name, "ext", &module->externs);
+	if(!success){
+		destroyObjectModule(module);
+		return NULL;
+	}
+	return module;
+}
+
+/*
+ * Reads the whole object file and decodes it into the module
+ * Returns 1 if succeeded or 0 if the file is malformed (reporting why)
+ */
+int readObjectWords(FILE *obFile, char *url, ObjectModule *module){
+	long length;
+	char *text;
+	int success;
+
+	if(fseek(obFile, 0, SEEK_END) != 0 || (length = ftell(obFile)) < 0){
+		fprintf(stderr,"Error: couldn't read object file %s\n",url);
+		return 0;
+	}
+	rewind(obFile);
+	text = (char*)malloc(length + 1);
+	length = (long)fread(text, 1, length, obFile);
+	success = decodeObjectText(text, length, url, module);
+	free(text);
+	return success;
+}
+
+/*
+ * Decodes the text of an object file (length characters, not necessarily terminated) into the words of the module -
+ * the amount of code and data words and an array of the words (see ObjectModule)
+ * Returns 1 if succeeded or 0 if the text is malformed (reporting why, as the text of the file url)
+ */
+int decodeObjectText(char *text, long length, char *url, ObjectModule *module){
+	char *end = text + length;
+	int address, word, lineNumber = 1, loadAddress = getLoadAddress(), wordCount, wordLimit = 1 << getWordWidth();
+
+	if(!(text = scanBase32(skipBlanks(text, end), end, &module->codeLength))
+			|| !(text = scanBase32(skipBlanks(text, end), end, &module->dataLength))
+			|| ((text = skipBlanks(text, end)) < end && *text != '\n')){
+		fprintf(stderr,"Error: %s doesn't start with the amount of code and data words\n",url);
+		return 0;
+	}
+	wordCount = module->codeLength + module->dataLength;
+	if(loadAddress + wordCount > getMemoryLength()){
+		fprintf(stderr,"Error: %s doesn't fit in the memory of %d words\n",url,getMemoryLength());
+		return 0;
+	}
+	free(module->words);
+	module->words = (int*)calloc(wordCount + 1, sizeof(int));
+	/* every iteration starts at the end of a line */
+	while(text < end){
+		lineNumber++;
+		text = skipBlanks(text + 1, end);
+		if(text == end || *text == '\n')
+			continue;
+		if(!(text = scanBase32(text, end, &address)) || !(text = scanBase32(skipBlanks(text, end), end, &word))
+				|| ((text = skipBlanks(text, end)) < end && *text != '\n')
+				|| address < loadAddress || address >= loadAddress + wordCount || word >= wordLimit){
+			fprintf(stderr,"Error: malformed word in line %d of %s\n",lineNumber,url);
+			return 0;
+		}
+		module->words[address - loadAddress] = word;
+	}
+	return 1;
+}
+
+/*
+ * Reads the base 32 number at the start of the text (ending before end), storing it in value
+ * Returns the text following the number or NULL if the text doesn't start with a number (or the number is too big)
+ */
+char* scanBase32(char *text, char *end, int *value){
+	char *start = text;
+	int digit;
+	for(*value = 0; text < end && (digit = digitValues[(unsigned char)*text]) >= 0; text++){
+		if(*value > (INT_MAX >> BASE_32_DIGIT_BITS))
+			return NULL;
+		*value = (*value << BASE_32_DIGIT_BITS) | digit;
+	}
+	return (text > start)? text : NULL;
+}
+
+/*
+ * Returns the text following the spaces and tabs at its start (ending before end)
+ */
+char* skipBlanks(char *text, char *end){
+	for(; text < end && (*text == ' ' || *text == '\t' || *text == '\r'); text++)
+		;
+	return text;
+}
+
+/*
+ * Reads the symbols of "[name].[extension]" in order, a missing file holds no symbols
+ * Returns 1 if succeeded or 0 if the file is malformed (reporting why)
+ */
+int readSymbolFile(char *name, char *extension, ObjectSymbol **symbols){
+	char line[MAX_LINE_LENGTH];
+	char *url = constructUrl(name, extension), *label, *address32;
+	FILE *file = fopen(url, "r");
+	ObjectSymbol *symbol, *tail = NULL;
+	int lineNumber = 0, success = 1;
+
+	*symbols = NULL;
+	while(file && success && fgets(line, MAX_LINE_LENGTH, file)){
+		lineNumber++;
+		if(!(label = strtok(line, " \t\n")))
+			continue;
+		address32 = strtok(NULL, " \t\n");
+		if(strlen(label) >= MAX_LABEL_NAME_LENGTH || !address32){
+			fprintf(stderr,"Error: malformed symbol in line %d of %s\n",lineNumber,url);
+			success = 0;
+			continue;
+		}
+		symbol = (ObjectSymbol*)malloc(sizeof(ObjectSymbol));
+		strcpy(symbol->name, label);
+		symbol->next = NULL;
+		if(!parseBase32(address32, &symbol->address)){
+			fprintf(stderr,"Error: malformed address in line %d of %s\n",lineNumber,url);
+			success = 0;
+		}
+		if(tail)
+			tail->next = symbol;
+		else
+			*symbols = symbol;
+		tail = symbol;
+	}
+	if(file)
+		fclose(file);
+	free(url);
+	return success;
+}
+
+/*
+ * Writes the words of the module to "[name].ob"
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeObjectFile(char *name, ObjectModule *module){
+	char *url = constructUrl(name, "ob"), *outputLine, *binary;
+	FILE *obFile = fopen(url, "w");
+	int i;
+
+	if(!obFile){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	outputLine = constructObjectFileFirstLine(module->codeLength, module->dataLength);
+	fprintf(obFile,"%s\n",outputLine);
+	free(outputLine);
+	for(i = 0; i < module->codeLength + module->dataLength; i++){
+		/* a whole word is written as a single data member would be */
+		binary = constructType3Binary(module->words[i]);
+		outputLine = constructObjectFileLine(getLoadAddress() + i, binary);
+		fprintf(obFile,"%s\n",outputLine);
+		free(outputLine);
+		free(binary);
+	}
+	fclose(obFile);
+	free(url);
+	return 1;
+}
+
+/*
+ * Writes the symbols to "[name].[extension]", removing the file if there are none
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeSymbolFile(char *name, char *extension, ObjectSymbol *symbols){
+	char *url = constructUrl(name, extension), *outputLine;
+	FILE *file;
+
+	if(!symbols){
+		remove(url);
+		free(url);
+		return 1;
+	}
+	if(!(file = fopen(url, "w"))){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	for(; symbols; symbols = symbols->next){
+		outputLine = constructEntExtFileLine(symbols->name, symbols->address);
+		fprintf(file,"%s\n",outputLine);
+		free(outputLine);
+	}
+	fclose(file);
+	free(url);
+	return 1;
+}
+
+/*
+ * Reads "[name].rel" - the load address the object was placed at, then the address of every relocatable word
+ * storing the addresses in a new array
+ * Returns the amount of addresses or -1 if the file can't be read or is malformed (reporting why)
+ */
+int readRelocationFile(char *name, int *loadAddress, int **addresses){
+	char line[MAX_LINE_LENGTH];
+	char *url = constructUrl(name, "rel"), *number;
+	FILE *file = fopen(url, "r");
+	int count = 0, capacity = 16, lineNumber = 0, loadRead = 0;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't read relocation file %s\n",url);
+		free(url);
+		return -1;
+	}
+	*addresses = (int*)malloc(sizeof(int) * capacity);
+	while(count >= 0 && fgets(line, MAX_LINE_LENGTH, file)){
+		lineNumber++;
+		if(!(number = strtok(line, " \t\n")))
+			continue;
+		if(count == capacity){
+			capacity *= 2;
+			*addresses = (int*)realloc(*addresses, sizeof(int) * capacity);
+		}
+		/* the first number is the load address */
+		if(!parseBase32(number, (loadRead)? &(*addresses)[count] : loadAddress)){
+			fprintf(stderr,"Error: malformed address in line %d of %s\n",lineNumber,url);
+			count = -1;
+		}
+		else if(loadRead)
+			count++;
+		loadRead = 1;
+	}
+	if(count >= 0 && !loadRead){
+		fprintf(stderr,"Error: %s doesn't start with the load address\n",url);
+		count = -1;
+	}
+	if(count < 0){
+		free(*addresses);
+		*addresses = NULL;
+	}
+	fclose(file);
+	free(url);
+	return count;
+}
+
+/*
+ * Writes the load address and the addresses of the relocatable words to "[name].rel"
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeRelocationFile(char *name, int loadAddress, int *addresses, int count){
+	char *url = constructUrl(name, "rel"), *number;
+	FILE *file = fopen(url, "w");
+	int i;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	for(i = -1; i < count; i++){
+		number = convertDecimalBase32((i < 0)? loadAddress : addresses[i]);
+		fprintf(file,"%s\n",number);
+		free(number);
+	}
+	fclose(file);
+	free(url);
+	return 1;
+}
+
+/*
+ * Converts a number written in the special base 32, storing it in value
+ * returns 1 if succeeded or 0 if the string isn't a base 32 number
+ */
+int parseBase32(char *digits, int *value){
+	char *end = digits + strlen(digits);
+	return scanBase32(digits, end, value) == end;
+}
+
+/*
+ * Handles a geometry option of a tool's command line at index (--memory, --load-address or --word-width),
+ * storing its value in geometry (memory length, load address and word width) and advancing the index beyond it
+ * Returns 1 if handled, 0 if the parameter isn't a geometry option or -1 if its value is invalid (reporting why)
+ */
+int parseGeometryOption(int argc, char **argv, int *index, int *geometry){
+	char *options[3] = {"--memory", "--load-address", "--word-width"};
+	int i;
+	for(i = 0; i < 3 && strcmp(argv[*index], options[i]) != 0; i++)
+		;
+	if(i == 3)
+		return 0;
+	if(*index + 1 >= argc){
+		fprintf(stderr,"Error: option '%s' requires a value\n",argv[*index]);
+		return -1;
+	}
+	(*index)++;
+	if(!customAtoi(argv[*index], &geometry[i])){
+		fprintf(stderr,"Error: '%s' is not a valid value for %s\n",argv[*index],options[i]);
+		return -1;
+	}
+	return 1;
+}
+
+/*
+ * Frees space dynamically allocated to the module
+ */
+void destroyObjectModule(ObjectModule *module){
+	if(!module)
+		return;
+	destroyObjectSymbols(module->entries);
+	destroyObjectSymbols(module->externs);
+	free(module->words);
+	free(module->name);
+	free(module);
+}
+
+/*
+ * Frees space dynamically allocated to a list of symbols
+ */
+void destroyObjectSymbols(ObjectSymbol *symbols){
+	ObjectSymbol *next;
+	for(; symbols; symbols = next){
+		next = symbols->next;
+		free(symbols);
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ * object.h
+ * 		module reads and writes the outputs of the assembler - the object file "[name].ob" along with its
+ * 		entries "[name].ent" and extern references "[name].ext" - so other tools can work on assembled programs
+ * 		also reads and writes the relocation file "[name].rel" written with --reloc
+ */
+#ifndef OBJECT_H
+#define OBJECT_H
+#include "constraints.h"
+
+#define ARE_BITS 2
+#define ARE_MASK 3
+
+/* the least significant bits of a word referencing an address */
+enum ARE { LOCAL_ARE, EXTERNAL_ARE, RELOCATABLE_ARE };
+
+typedef struct ObjectSymbol {
+	char name[MAX_LABEL_NAME_LENGTH];
+	int address;			/* address of an entry, or of a word using an extern */
+	struct ObjectSymbol *next;
+} ObjectSymbol;
+
+typedef struct ObjectModule {
+	char *name;				/* name of the files (without extension) */
+	int codeLength;
+	int dataLength;
+	int *words;				/* code words followed by data words, the first of them at the load address */
+	ObjectSymbol *entries;
+	ObjectSymbol *externs;	/* every use of an extern label */
+} ObjectModule;
+
+/*
+ * Reads "[name].ob" along with "[name].ent" and "[name].ext" (which only exist if the program has entries or externs)
+ * Returns the module or NULL if the files can't be read (reporting why)
+ */
+ObjectModule* readObjectModule(char *name);
+
+/*
+ * Decodes the text of an object file (length characters, not necessarily terminated) into the words of the module -
+ * the amount of code and data words and an array of the words (see ObjectModule)
+ * Returns 1 if succeeded or 0 if the text is malformed (reporting why, as the text of the file url)
+ */
+int decodeObjectText(char *text, long length, char *url, ObjectModule *module);
+
+/*
+ * Writes the words of the module to "[name].ob"
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeObjectFile(char *name, ObjectModule *module);
+
+/*
+ * Writes the symbols to "[name].[extension]", removing the file if there are none
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeSymbolFile(char *name, char *extension, ObjectSymbol *symbols);
+
+/*
+ * Reads "[name].rel" - the load address the object was placed at, then the address of every relocatable word
+ * storing the addresses in a new array
+ * Returns the amount of addresses or -1 if the file can't be read or is malformed (reporting why)
+ */
+int readRelocationFile(char *name, int *loadAddress, int **addresses);
+
+/*
+ * Writes the load address and the addresses of the relocatable words to "[name].rel"
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeRelocationFile(char *name, int loadAddress, int *addresses, int count);
+
+/*
+ * Converts a number written in the special base 32, storing it in value
+ * returns 1 if succeeded or 0 if the string isn't a base 32 number
+ */
+int parseBase32(char *digits, int *value);
+
+/*
+ * Handles a geometry option of a tool's command line at index (--memory, --load-address or --word-width),
+ * storing its value in geometry (memory length, load address and word width) and advancing the index beyond it
+ * Returns 1 if handled, 0 if the parameter isn't a geometry option or -1 if its value is invalid (reporting why)
+ */
+int parseGeometryOption(int argc, char **argv, int *index, int *geometry);
+
+/*
+ * Frees space dynamically allocated to the module
+ */
+void destroyObjectModule(ObjectModule *module);
+
+/*
+ * Frees space dynamically allocated to a list of symbols
+ */
+void destroyObjectSymbols(ObjectSymbol *symbols);
+
+#endif
@@ -0,0 +1,356 @@
+/*
+ * options.c
+ * 		module parses the command line parameters into the run settings of the assembler
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "options.h"
+#include "utilities.h"
+#include "diagnostics.h"
+#include "geometry.h"
+#include "map.h"
+#include "timings.h"
+#include "constraints.h"
+
+char* getOptionValue(int argc, char **argv, int *index);
+int buildVariants(Options *options, char **variantSpecs, int specCount);
+int isValidSymbolName(char *name);
+
+/*
+ * Fills the options according to the command line parameters
+ * Every parameter which is not an option is treated as a file name
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int parseOptions(int argc, char **argv, Options *options){
+	int i = 1, start, specCount = 0, success, limit;
+	char *value;
+	char **variantSpecs = (char**)malloc(sizeof(char*) * argc);
+
+	options->files = (char**)malloc(sizeof(char*) * argc);
+	options->fileCount = 0;
+	options->arguments = (char**)malloc(sizeof(char*) * argc);
+	options->argumentCount = 0;
+	options->daemonSocket = NULL;
+	options->clientSocket = NULL;
+	options->workers = DEFAULT_DAEMON_WORKERS;
+	options->defines = (char**)malloc(sizeof(char*) * argc);
+	options->defineCount = 0;
+	options->variants = NULL;
+	options->variantCount = 0;
+	options->sizeOnly = 0;
+	options->checkOnly = 0;
+	options->cacheDir = NULL;
+	options->cacheLimit = DEFAULT_CACHE_LIMIT_KB * 1024L;
+	options->cacheStats = 0;
+	options->cacheSkipAm = 0;
+	options->writeDependencies = 0;
+	options->writeRelocations = 0;
+	options->writeLineTable = 0;
+	options->optimize = 0;
+	options->poolData = 0;
+	options->collectGarbage = 0;
+	options->mapFormat = NO_MAP;
+	options->timingsFile = NULL;
+	options->lsp = 0;
+	options->watch = 0;
+	options->memoryLength = DEFAULT_MEMORY_LENGTH;
+	options->loadAddress = DEFAULT_LOAD_ADDRESS;
+	options->wordWidth = DEFAULT_WORD_WIDTH;
+	options->quiet = 0;
+	options->maxErrors = 0;
+	options->diagnosticsFormat = -1;
+
+	for(success = 1; success && i < argc; i++){
+		start = i;
+		if(strcmp(argv[i],"--daemon")==0){
+			success = (options->daemonSocket = getOptionValue(argc, argv, &i)) != NULL;
+		}
+		else if(strcmp(argv[i],"--client")==0){
+			success = (options->clientSocket = getOptionValue(argc, argv, &i)) != NULL;
+		}
+		else if(strcmp(argv[i],"--workers")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(!customAtoi(value, &options->workers) || options->workers < 1){
+				fprintf(stderr,"Error: '%s' is not a valid amount of workers\n",value);
+				success = 0;
+			}
+		}
+		else if(strncmp(argv[i],"-D",2)==0){
+			/* accepts both "-D NAME" and "-DNAME" */
+			value = (argv[i][2])? argv[i] + 2 : getOptionValue(argc, argv, &i);
+			if(value && !isValidSymbolName(value)){
+				fprintf(stderr,"Error: '%s' is not a valid symbol name\n",value);
+				value = NULL;
+			}
+			if(!(success = value != NULL))
+				continue;
+			options->defines[options->defineCount++] = value;
+		}
+		else if(strcmp(argv[i],"--size-only")==0){
+			options->sizeOnly = 1;
+		}
+		else if(strcmp(argv[i],"--check")==0){
+			options->checkOnly = 1;
+		}
+		else if(strcmp(argv[i],"-q")==0 || strcmp(argv[i],"--quiet")==0){
+			options->quiet = 1;
+		}
+		else if(strcmp(argv[i],"--max-errors")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(!customAtoi(value, &options->maxErrors) || options->maxErrors < 0){
+				fprintf(stderr,"Error: '%s' is not a valid amount of errors\n",value);
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i],"--diagnostics")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(strcmp(value,"human")==0)
+				options->diagnosticsFormat = HUMAN_DIAGNOSTICS;
+			else if(strcmp(value,"machine")==0)
+				options->diagnosticsFormat = MACHINE_DIAGNOSTICS;
+			else if(strcmp(value,"json")==0)
+				options->diagnosticsFormat = JSON_DIAGNOSTICS;
+			else{
+				fprintf(stderr,"Error: '%s' is not a diagnostics format (human, machine or json)\n",value);
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i],"--variant")==0){
+			success = (variantSpecs[specCount++] = getOptionValue(argc, argv, &i)) != NULL;
+		}
+		else if(strcmp(argv[i],"--cache")==0){
+			success = (options->cacheDir = getOptionValue(argc, argv, &i)) != NULL;
+		}
+		else if(strcmp(argv[i],"--cache-size")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(!customAtoi(value, &limit) || limit < 0){
+				fprintf(stderr,"Error: '%s' is not a valid cache size in kilobytes\n",value);
+				success = 0;
+			}
+			else
+				options->cacheLimit = limit * 1024L;
+		}
+		else if(strcmp(argv[i],"--cache-stats")==0){
+			options->cacheStats = 1;
+		}
+		else if(strcmp(argv[i],"--cache-skip-am")==0){
+			options->cacheSkipAm = 1;
+		}
+		else if(strcmp(argv[i],"--deps")==0){
+			options->writeDependencies = 1;
+		}
+		else if(strcmp(argv[i],"--reloc")==0){
+			options->writeRelocations = 1;
+		}
+		else if(strcmp(argv[i],"--lines")==0){
+			options->writeLineTable = 1;
+		}
+		else if(strcmp(argv[i],"-O")==0){
+			options->optimize = 1;
+		}
+		else if(strcmp(argv[i],"--pool-data")==0){
+			options->poolData = 1;
+		}
+		else if(strcmp(argv[i],"--gc")==0){
+			options->collectGarbage = 1;
+		}
+		else if(strcmp(argv[i],"--map")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(strcmp(value,"human")==0)
+				options->mapFormat = HUMAN_MAP;
+			else if(strcmp(value,"json")==0)
+				options->mapFormat = JSON_MAP;
+			else{
+				fprintf(stderr,"Error: '%s' is not a map format (human or json)\n",value);
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i],"--timings")==0){
+			success = (options->timingsFile = getOptionValue(argc, argv, &i)) != NULL;
+		}
+		else if(strcmp(argv[i],"--lsp")==0){
+			options->lsp = 1;
+		}
+		else if(strcmp(argv[i],"--watch")==0){
+			options->watch = 1;
+		}
+		else if(strcmp(argv[i],"--memory")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(!customAtoi(value, &options->memoryLength)){
+				fprintf(stderr,"Error: '%s' is not a valid memory length\n",value);
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i],"--load-address")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(!customAtoi(value, &options->loadAddress)){
+				fprintf(stderr,"Error: '%s' is not a valid load address\n",value);
+				success = 0;
+			}
+		}
+		else if(strcmp(argv[i],"--word-width")==0){
+			if(!(value = getOptionValue(argc, argv, &i)))
+				success = 0;
+			else if(!customAtoi(value, &options->wordWidth)){
+				fprintf(stderr,"Error: '%s' is not a valid word width\n",value);
+				success = 0;
+			}
+		}
+		else if(argv[i][0] == '-' && argv[i][1] == '-'){
+			fprintf(stderr,"Error: unknown option '%s'\n",argv[i]);
+			success = 0;
+		}
+		else{
+			options->files[options->fileCount++] = argv[i];
+			continue;
+		}
+		for(; start <= i; start++)
+			options->arguments[options->argumentCount++] = argv[start];
+	}
+	if(success && options->daemonSocket && options->clientSocket){
+		fprintf(stderr,"Error: --daemon and --client can't be used together\n");
+		success = 0;
+	}
+	if(success && options->lsp && (options->daemonSocket || options->clientSocket)){
+		fprintf(stderr,"Error: --lsp can't be used together with --daemon or --client\n");
+		success = 0;
+	}
+	if(success && options->watch && (options->lsp || options->daemonSocket || options->clientSocket)){
+		fprintf(stderr,"Error: --watch can't be used together with --lsp, --daemon or --client\n");
+		success = 0;
+	}
+	if(success && options->timingsFile && (options->lsp || options->watch || options->daemonSocket || options->clientSocket)){
+		fprintf(stderr,"Error: --timings can't be used together with --lsp, --watch, --daemon or --client\n");
+		success = 0;
+	}
+	if(success && options->sizeOnly && options->checkOnly){
+		fprintf(stderr,"Error: --size-only and --check can't be used together\n");
+		success = 0;
+	}
+	/* --check reports machine readable diagnostics unless told otherwise */
+	if(options->diagnosticsFormat < 0)
+		options->diagnosticsFormat = (options->checkOnly)? MACHINE_DIAGNOSTICS : HUMAN_DIAGNOSTICS;
+	setDiagnosticsFormat(options->diagnosticsFormat);
+	setMaxErrors(options->maxErrors);
+	setQuiet(options->quiet);
+	if(options->timingsFile)
+		enableTimings();
+	if(success)
+		success = setGeometry(options->memoryLength, options->loadAddress, options->wordWidth);
+	if(success)
+		success = buildVariants(options, variantSpecs, specCount);
+	free(variantSpecs);
+	return success;
+}
+
+/*
+ * Returns the parameter following the option at index (advancing the index beyond it)
+ * or NULL if the option is the last parameter
+ */
+char* getOptionValue(int argc, char **argv, int *index){
+	if(*index + 1 >= argc){
+		fprintf(stderr,"Error: option '%s' requires a value\n",argv[*index]);
+		return NULL;
+	}
+	return argv[++(*index)];
+}
+
+/*
+ * Constructs the variants from the "NAME[:SYMBOL,SYMBOL...]" specifications of the --variant options
+ * Every variant also defines the -D symbols, without any specification a single default variant is built
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int buildVariants(Options *options, char **variantSpecs, int specCount){
+	int i, j, count, symbolCount;
+	char *symbols, *token;
+	Variant *variant;
+
+	if(specCount > MAX_VARIANTS){
+		fprintf(stderr,"Error: at most %d variants are supported\n",MAX_VARIANTS);
+		return 0;
+	}
+	count = (specCount)? specCount : 1;
+	options->variants = (Variant*)calloc(count, sizeof(Variant));
+	for(i = 0; i < count; i++){
+		variant = &options->variants[i];
+		/* a specification holds at most one more symbol than it has commas */
+		for(symbolCount = 1, token = (specCount)? variantSpecs[i] : ""; *token; token++)
+			symbolCount += (*token == ',');
+		variant->defines = (char**)malloc(sizeof(char*) * (options->defineCount + symbolCount));
+		for(j = 0; j < options->defineCount; j++)
+			variant->defines[variant->defineCount++] = options->defines[j];
+		options->variantCount++;
+		if(!specCount)
+			continue;
+
+		variant->name = (char*)malloc(strlen(variantSpecs[i]) + 1);
+		strcpy(variant->name, variantSpecs[i]);
+		symbols = strchr(variant->name, ':');
+		if(symbols)
+			*symbols++ = '\0';
+		if(!isValidSymbolName(variant->name)){
+			fprintf(stderr,"Error: '%s' is not a valid variant name\n",variant->name);
+			return 0;
+		}
+		for(j = 0; j < i; j++){
+			if(strcmp(options->variants[j].name, variant->name) == 0){
+				fprintf(stderr,"Error: variant '%s' is defined more than once\n",variant->name);
+				return 0;
+			}
+		}
+		for(token = (symbols)? strtok(symbols, ",") : NULL; token; token = strtok(NULL, ",")){
+			if(!isValidSymbolName(token)){
+				fprintf(stderr,"Error: '%s' is not a valid symbol name\n",token);
+				return 0;
+			}
+			variant->defines[variant->defineCount++] = token;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Checks if a symbol or variant name is valid - a letter followed by letters, numbers or '_'
+ * returns 1 for true 0 for false
+ */
+int isValidSymbolName(char *name){
+	if(!isalpha(*name))
+		return 0;
+	for(name++; *name; name++){
+		if(!isalnum(*name) && *name != '_')
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Frees space dynamically allocated by parseOptions
+ */
+void destroyOptions(Options *options){
+	int i;
+	for(i = 0; i < options->variantCount; i++){
+		free(options->variants[i].name);
+		free(options->variants[i].defines);
+	}
+	free(options->variants);
+	free(options->defines);
+	free(options->files);
+	free(options->arguments);
+	options->variants = NULL;
+	options->variantCount = 0;
+	options->defines = NULL;
+	options->defineCount = 0;
+	options->files = NULL;
+	options->fileCount = 0;
+	options->arguments = NULL;
+	options->argumentCount = 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * options.h
+ * 		module parses the command line parameters into the run settings of the assembler
+ */
+#ifndef OPTIONS_H
+#define OPTIONS_H
+#include "preprocessor.h"
+
+#define DEFAULT_DAEMON_WORKERS 4
+#define DEFAULT_CACHE_LIMIT_KB 65536
+
+typedef struct Options {
+	char **files;			/* source file names (without extension) given on the command line */
+	int fileCount;
+	char **arguments;		/* the command line besides the file names - every option with its value */
+	int argumentCount;
+	char *daemonSocket;		/* when set the assembler serves jobs on this unix socket */
+	char *clientSocket;		/* when set the files are sent to a daemon listening on this socket */
+	int workers;			/* amount of worker processes started by the daemon */
+	char **defines;			/* symbols defined with -D for every variant */
+	int defineCount;
+	Variant *variants;		/* configurations each file is assembled for (at least one) */
+	int variantCount;
+	int sizeOnly;			/* only report the code and data sizes of each file */
+	int checkOnly;			/* only validate each file, reporting machine readable diagnostics */
+	char *cacheDir;			/* when set assembled outputs are stored in and restored from this directory */
+	long cacheLimit;		/* size in bytes the cache is trimmed to after every run (0 for no limit) */
+	int cacheStats;			/* print the cache statistics after every run */
+	int cacheSkipAm;		/* don't restore the expanded source files on cache hits */
+	int writeDependencies;	/* write a make style "[file].d" dependency file for every file */
+	int writeRelocations;	/* write the addresses of relocatable words to "[file].rel" (see rebase.c) */
+	int writeLineTable;		/* write the source line of every address to "[file].lin" (see lines.h) */
+	int optimize;			/* remove redundant instructions between the passes (see peephole.h) */
+	int poolData;			/* share the words of identical data statements between the passes (see pool.h) */
+	int collectGarbage;		/* remove the code and data never reached between the passes (see collect.h) */
+	int mapFormat;			/* format of the memory map written to "[file].map" (enum mapFormat), NO_MAP for none */
+	char *timingsFile;		/* when set the throughput of every phase is written to this file (see timings.h) */
+	int lsp;				/* serve the language server protocol on stdin/stdout instead of assembling files */
+	int watch;				/* keep running, assembling the files again whenever they change */
+	int memoryLength;		/* geometry of the target machine (see geometry.h) */
+	int loadAddress;
+	int wordWidth;
+	int quiet;				/* suppress the progress messages */
+	int maxErrors;			/* errors after which a file stops being processed (0 for no limit) */
+	int diagnosticsFormat;	/* format of the diagnostics (enum diagnosticsFormat), -1 for the default of the mode */
+} Options;
+
+/*
+ * Fills the options according to the command line parameters
+ * Every parameter which is not an option is treated as a file name
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int parseOptions(int argc, char **argv, Options *options);
+
+/*
+ * Frees space dynamically allocated by parseOptions
+ */
+void destroyOptions(Options *options);
+
+#endif
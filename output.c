@@ -5,12 +5,23 @@
  *
  */
 #include "output.h"
+#include "geometry.h"
 #include <stdlib.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
 #define BINARY_STRING_LENGTH 11
 #define BASE_32_STRING_LENGTH 3
+#define BASE_32_NUMBER_LENGTH 8 /* digits of the largest int and a null */
+#define BASE_32_DIGIT_BITS 5
+
+/*
+ * The encoders below have constant field positions for the default 10 bit word.
+ * Other word widths go through constructWideWord: the fields keep their distance from the least significant bit
+ * and the extra bits widen the leftmost field (the opcode, the address or value, or the source register)
+ */
+char* constructWideWord (int fieldCount, int* values, int* ends);
+char* convertWideBinaryToBase32 (char* binary, int width);
 
 /*
  *  Puts the binary representation of given value starting at a given index
@@ -45,8 +56,18 @@ void fillBinaryBits (char* string, int value, int start){
  * 	Formats a machine code instruction in binary
  */
 char* constructType1Binary (int opCode, int typeOpSrc, int typeOpDst, int are){
-	char* out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
+	char* out;
 	int ind = 0;
+	int values[4], ends[4] = {3, 5, 7, 9};
+
+	if(getWordWidth() != DEFAULT_WORD_WIDTH){
+		values[0] = opCode;
+		values[1] = typeOpSrc;
+		values[2] = typeOpDst;
+		values[3] = are;
+		return constructWideWord(4, values, ends);
+	}
+	out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
 
 	for(;ind < BINARY_STRING_LENGTH; ind++){
 		out[ind]='0';
@@ -66,8 +87,16 @@ char* constructType1Binary (int opCode, int typeOpSrc, int typeOpDst, int are){
  * Formats the added word needed for Immediate values or Labels
  */
 char* constructType2Binary (int value, int are){
-	char* out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
+	char* out;
 	int ind = 0;
+	int values[2], ends[2] = {7, 9};
+
+	if(getWordWidth() != DEFAULT_WORD_WIDTH){
+		values[0] = value;
+		values[1] = are;
+		return constructWideWord(2, values, ends);
+	}
+	out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
 
 	for(;ind < BINARY_STRING_LENGTH; ind++){
 		out[ind]='0';
@@ -85,8 +114,13 @@ char* constructType2Binary (int value, int are){
  * Formats the added word needed for data members
  */
 char* constructType3Binary (int value){
-	char* out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
+	char* out;
 	int ind = 0;
+	int ends[1] = {9};
+
+	if(getWordWidth() != DEFAULT_WORD_WIDTH)
+		return constructWideWord(1, &value, ends);
+	out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
 	for(;ind < BINARY_STRING_LENGTH; ind++){
 		out[ind]='0';
 	}
@@ -102,8 +136,16 @@ char* constructType3Binary (int value){
  *	unused register should pass 0
  */
 char* constructType4Binary (int regSrc, int regDst){
-	char* out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
+	char* out;
 	int ind = 0;
+	int values[2], ends[2] = {3, 7};
+
+	if(getWordWidth() != DEFAULT_WORD_WIDTH){
+		values[0] = regSrc;
+		values[1] = regDst;
+		return constructWideWord(2, values, ends);
+	}
+	out = (char*)malloc(sizeof(char)*BINARY_STRING_LENGTH);
 	for(;ind < BINARY_STRING_LENGTH; ind++){
 		out[ind]='0';
 	}
@@ -117,6 +159,21 @@ char* constructType4Binary (int regSrc, int regDst){
 }
 
 
+/*
+ * Formats a word of the configured width - each value is placed ending at its position in a 10 bit word,
+ * shifted by the extra bits
+ */
+char* constructWideWord (int fieldCount, int* values, int* ends){
+	int width = getWordWidth(), i;
+	char* out = (char*)malloc(sizeof(char)*(width+1));
+
+	memset(out, '0', width);
+	out[width] = '\0';
+	for(i = 0; i < fieldCount; i++)
+		fillBinaryBits(out, values[i], ends[i] + width - DEFAULT_WORD_WIDTH);
+	return out;
+}
+
 /*
  * Receives a string of a binary sequence and converts the subsequence [start,end] to an Integer
  */
@@ -133,24 +190,44 @@ int binaryAtoi (char* binary, int start, int end){
 }
 
 /*
- * Receives a string of a 10 bit binary sequence and returns a converted base 32 string
+ * Receives a string of a binary word (of the configured width) and returns a converted base 32 string
  */
 char* convertBinaryStringtoBase32 (char* binary){
 	char* b32 = "!@#$%^&*<>abcdefghijklmnopqrstuv";
-	char* outP = (char*)malloc(sizeof(char)*BASE_32_STRING_LENGTH);
+	char* outP;
+	if(getWordWidth() != DEFAULT_WORD_WIDTH)
+		return convertWideBinaryToBase32(binary, getWordWidth());
+	outP = (char*)malloc(sizeof(char)*BASE_32_STRING_LENGTH);
 	outP[0] = b32[binaryAtoi(binary,0,4)];
 	outP[1] = b32[binaryAtoi(binary,5,9)];
 	outP[2] = '\0';
 	return outP;
 }
 
+/*
+ * Receives a binary sequence of the given width and returns a converted base 32 string,
+ * the first digit holding the bits left over from whole 5 bit digits
+ */
+char* convertWideBinaryToBase32 (char* binary, int width){
+	char* b32 = "!@#$%^&*<>abcdefghijklmnopqrstuv";
+	int digits = (width + BASE_32_DIGIT_BITS - 1) / BASE_32_DIGIT_BITS, i, start;
+	char* outP = (char*)malloc(sizeof(char)*(digits+1));
+
+	start = width - (digits - 1) * BASE_32_DIGIT_BITS;
+	outP[0] = b32[binaryAtoi(binary, 0, start - 1)];
+	for(i = 1; i < digits; i++, start += BASE_32_DIGIT_BITS)
+		outP[i] = b32[binaryAtoi(binary, start, start + BASE_32_DIGIT_BITS - 1)];
+	outP[digits] = '\0';
+	return outP;
+}
+
 /*
  * Receives a decimal integer and returns a converted base 32 string
  */
 char* convertDecimalBase32(int decimalNum){
 	int i = 0, j;
 	char temp;
-	char *toSpecial = (char*)malloc(sizeof(char)*BASE_32_STRING_LENGTH);
+	char *toSpecial = (char*)malloc(sizeof(char)*BASE_32_NUMBER_LENGTH);
 	char *b32 = "!@#$%^&*<>abcdefghijklmnopqrstuv";
 	if(!decimalNum){
 		toSpecial[i++] = b32[0];
@@ -163,7 +240,7 @@ char* convertDecimalBase32(int decimalNum){
 	}
 	toSpecial[i] = '\0';
 	j = i - 1;
-	for(i = 0; i < j ; i++){
+	for(i = 0; i < j ; i++, j--){
 		temp = toSpecial[j];
 		toSpecial[j] = toSpecial[i];
 		toSpecial[i] = temp;
@@ -172,10 +249,10 @@ char* convertDecimalBase32(int decimalNum){
 }
 
 char* constructObjectFileFirstLine (int ic, int dc){
-	char* out = (char*)malloc(sizeof(char)*5);
 	char* l1 = convertDecimalBase32 (ic);
 	char* l2 = convertDecimalBase32 (dc);
-	memset(out,'\0',BASE_32_STRING_LENGTH*2);
+	char* out = (char*)malloc(sizeof(char)*(strlen(l1)+strlen(l2)+3));
+	*out = '\0';
 	strcat(out," ");
 	strcat(out,l1);
 	strcat(out," ");
@@ -186,10 +263,10 @@ char* constructObjectFileFirstLine (int ic, int dc){
 }
 
 char* constructObjectFileLine (int address, char* binary){
-	char* out = (char*)malloc(sizeof(char)*BASE_32_STRING_LENGTH*2);
 	char* address32 = convertDecimalBase32 (address);
 	char* binary32 = convertBinaryStringtoBase32(binary);
-	memset(out,'\0',BASE_32_STRING_LENGTH*2);
+	char* out = (char*)malloc(sizeof(char)*(strlen(address32)+strlen(binary32)+2));
+	*out = '\0';
 	strcat(out,address32);
 	strcat(out," ");
 	strcat(out,binary32);
@@ -199,7 +276,7 @@ char* constructObjectFileLine (int address, char* binary){
 }
 
 char* constructEntExtFileLine (char* labelName, int address){
-	char* out = (char*)malloc(sizeof(char)*MAX_LABEL_NAME_LENGTH+5);
+	char* out = (char*)malloc(sizeof(char)*(MAX_LABEL_NAME_LENGTH+BASE_32_NUMBER_LENGTH));
 	char* num32 = convertDecimalBase32(address);
 	memset(out,'\0',BASE_32_STRING_LENGTH*2);
 	strcpy(out,labelName);
@@ -29,7 +29,7 @@ char* constructType3Binary (int value);
 char* constructType4Binary (int regSrc, int regDst);
 
 /*
- * Receives a string of a 10 bit binary sequence and returns a converted base 32 string
+ * Receives a string of a binary word (of the configured width) and returns a converted base 32 string
  */
 char* convertBinaryStringtoBase32 (char* binary);
 
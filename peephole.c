@@ -0,0 +1,287 @@
+/*
+ * peephole.c
+ * 		module optimizes the code of a program between the first and the second pass (with -O) - it decodes
+ * 		the instructions of the image, removes redundant ones and lays out the code and its labels again
+ *
+ * 		Words referencing labels are still labels at this point, so removing code only moves the code labels
+ * 		(the data follows ic in the second pass). Removed are:
+ * 			mov X, X				- moving an operand to itself
+ * 			inc X / dec X			- back to back (either way) on the same operand, unless a label leads to the second
+ * 			jmp L / bne L			- where L is the instruction following the jump
+ * 			cmp X, Y				- when the code following it sets the zero flag again or halts before bne reads it
+ * 									  (a jump, call or return is assumed to lead to a bne)
+ * 		Removing an instruction may make another redundant (a jmp over removed code), so the code is scanned
+ * 		until nothing more is removed. Addresses computed without labels (an immediate jmp target) are not followed.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "peephole.h"
+#include "instruction.h"
+#include "geometry.h"
+
+/* an instruction of the code and where it was assembled */
+typedef struct CodeInstruction {
+	Instruction instruction;
+	int address;
+	int removed;
+} CodeInstruction;
+
+CodeInstruction* decodeCode(Image *image, int ic, int *count);
+int removeRedundant(Image *image, CodeInstruction *code, int count, Symbol *symTable, PeepholeReport *report);
+int isSelfMove(Image *image, CodeInstruction *instruction);
+int isCancellingPair(Image *image, CodeInstruction *first, CodeInstruction *second, Symbol *symTable);
+int isJumpToNext(Image *image, CodeInstruction *code, int count, int index, Symbol *symTable);
+int isUnusedCompare(CodeInstruction *code, int count, int index);
+int isSameOperand(Image *image, CodeInstruction *first, DecodedOperand *firstOperand, CodeInstruction *second, DecodedOperand *secondOperand);
+int isSameWord(char *first, char *second);
+int isCodeLabel(Symbol *symbol);
+int nextInstruction(CodeInstruction *code, int count, int index);
+int findInstruction(CodeInstruction *code, int count, int address);
+int instructionAt(CodeInstruction *code, int count, int address);
+void relayoutCode(Image *image, CodeInstruction *code, int count, int *ic, Symbol *symTable, LineTable *lines);
+
+/*
+ * Removes the redundant instructions of the code in the image (from the load address up to ic), moving the code
+ * following them down - ic, the addresses of the code labels and the code entries of lines (unless NULL) follow
+ * Returns 1 if succeeded or 0 if the code can't be decoded (leaving it as it is)
+ */
+int optimizeCode(Image *image, int *ic, Symbol *symTable, LineTable *lines, PeepholeReport *report){
+	CodeInstruction *code;
+	int i, count;
+
+	memset(report, 0, sizeof(PeepholeReport));
+	if(!(code = decodeCode(image, *ic, &count)))
+		return 0;
+	while(removeRedundant(image, code, count, symTable, report))
+		;
+	for(i = 0; i < count; i++){
+		if(code[i].removed){
+			report->instructions++;
+			report->words += code[i].instruction.length;
+			report->cycles += instructionCycles(&code[i].instruction);
+		}
+	}
+	if(report->instructions)
+		relayoutCode(image, code, count, ic, symTable, lines);
+	free(code);
+	return 1;
+}
+
+/*
+ * Decodes the instructions of the code in the image into a new array
+ * Returns the array or NULL if the words are not a sequence of instructions
+ */
+CodeInstruction* decodeCode(Image *image, int ic, int *count){
+	int length = ic - getLoadAddress(), offset;
+	int *words = (int*)malloc(sizeof(int) * (length + 1));
+	CodeInstruction *code = (CodeInstruction*)malloc(sizeof(CodeInstruction) * (length + 1));
+
+	for(offset = 0; offset < length; offset++)
+		words[offset] = readImageWord(image, getLoadAddress() + offset);
+	for(*count = 0, offset = 0; offset < length; offset += code[(*count)++].instruction.length){
+		code[*count].address = getLoadAddress() + offset;
+		code[*count].removed = 0;
+		if(!decodeInstruction(words + offset, length - offset, &code[*count].instruction)){
+			free(code);
+			code = NULL;
+			break;
+		}
+	}
+	free(words);
+	return code;
+}
+
+/*
+ * Marks the instructions found redundant in a scan of the code, counting them in the report
+ * Returns 1 if an instruction was removed or 0 if none was
+ */
+int removeRedundant(Image *image, CodeInstruction *code, int count, Symbol *symTable, PeepholeReport *report){
+	int i, next, removed = 0;
+	for(i = 0; i < count; i++){
+		if(code[i].removed)
+			continue;
+		next = nextInstruction(code, count, i);
+		if(isSelfMove(image, &code[i]))
+			report->moves++;
+		else if(next < count && isCancellingPair(image, &code[i], &code[next], symTable)){
+			code[next].removed = 1;
+			report->pairs++;
+		}
+		else if(isJumpToNext(image, code, count, i, symTable))
+			report->jumps++;
+		else if(isUnusedCompare(code, count, i))
+			report->compares++;
+		else
+			continue;
+		code[i].removed = 1;
+		removed = 1;
+	}
+	return removed;
+}
+
+/*
+ * Returns 1 if the instruction is a mov of an operand to itself, otherwise 0
+ */
+int isSelfMove(Image *image, CodeInstruction *instruction){
+	return instruction->instruction.opCode == MOV_OP
+			&& isSameOperand(image, instruction, &instruction->instruction.src, instruction, &instruction->instruction.dst);
+}
+
+/*
+ * Returns 1 if the instructions are an inc and a dec (either way) of the same operand and no label leads
+ * to the second of them, otherwise 0
+ */
+int isCancellingPair(Image *image, CodeInstruction *first, CodeInstruction *second, Symbol *symTable){
+	int firstCode = first->instruction.opCode, secondCode = second->instruction.opCode;
+	if(!((firstCode == INC_OP && secondCode == DEC_OP) || (firstCode == DEC_OP && secondCode == INC_OP))
+			|| !isSameOperand(image, first, &first->instruction.dst, second, &second->instruction.dst))
+		return 0;
+	/* a label of an instruction removed in between leads to the second as well */
+	for(; symTable; symTable = symTable->next){
+		if(isCodeLabel(symTable) && symTable->address > first->address && symTable->address <= second->address)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Returns 1 if the instruction at index is a jmp or bne to the label of the instruction following it, otherwise 0
+ */
+int isJumpToNext(Image *image, CodeInstruction *code, int count, int index, Symbol *symTable){
+	Instruction *instruction = &code[index].instruction;
+	char label[IMAGE_WORD_LENGTH];
+	Symbol *symbol;
+
+	if((instruction->opCode != JMP_OP && instruction->opCode != BNE_OP) || instruction->dst.mode != DIRECT_MODE)
+		return 0;
+	strcpy(label, getImageWord(image, code[index].address + instruction->dst.wordOffset));
+	label[strcspn(label, "|")] = '\0';
+	symbol = findSymbolInTable(label, symTable);
+	return symbol && isCodeLabel(symbol) && instructionAt(code, count, symbol->address) == nextInstruction(code, count, index);
+}
+
+/*
+ * Returns 1 if the instruction at index is a cmp whose result is never read, otherwise 0
+ */
+int isUnusedCompare(CodeInstruction *code, int count, int index){
+	int i;
+	if(code[index].instruction.opCode != CMP_OP)
+		return 0;
+	for(i = nextInstruction(code, count, index); i < count; i = nextInstruction(code, count, i)){
+		switch(code[i].instruction.opCode){
+			case CMP_OP:
+			case HLT_OP:
+				return 1;
+			case BNE_OP:
+			case JMP_OP:
+			case JSR_OP:
+			case RTS_OP:
+				return 0;
+		}
+	}
+	/* running past the code is left as it is */
+	return 0;
+}
+
+/*
+ * Returns 1 if the operands (of the same or of different instructions) are the same operand, otherwise 0
+ */
+int isSameOperand(Image *image, CodeInstruction *first, DecodedOperand *firstOperand, CodeInstruction *second, DecodedOperand *secondOperand){
+	if(firstOperand->mode != secondOperand->mode)
+		return 0;
+	if(firstOperand->mode == IMMEDIATE_MODE || firstOperand->mode == REGISTER_MODE)
+		return firstOperand->value == secondOperand->value;
+	return firstOperand->field == secondOperand->field
+			&& isSameWord(getImageWord(image, first->address + firstOperand->wordOffset),
+					getImageWord(image, second->address + secondOperand->wordOffset));
+}
+
+/*
+ * Returns 1 if the words of the image are the same (words referencing the same label from different lines are),
+ * otherwise 0
+ */
+int isSameWord(char *first, char *second){
+	int length = strcspn(first, "|");
+	return length == (int)strcspn(second, "|") && strncmp(first, second, length) == 0;
+}
+
+/*
+ * Returns 1 if the symbol is a label defined in the code, otherwise 0
+ */
+int isCodeLabel(Symbol *symbol){
+	return symbol->segment == COMMAND_SEGMENT && (symbol->isExternal == REGULAR_LABEL_SYM || symbol->isExternal == ENTRY_SYM);
+}
+
+/*
+ * Returns the index of the instruction left after the one at index, or count if there is none
+ */
+int nextInstruction(CodeInstruction *code, int count, int index){
+	for(index++; index < count && code[index].removed; index++)
+		;
+	return index;
+}
+
+/*
+ * Returns the index of the first instruction (removed or not) at or after the address, or count if there is none
+ */
+int findInstruction(CodeInstruction *code, int count, int address){
+	int first = 0, last = count, middle;
+	while(first < last){
+		middle = (first + last) / 2;
+		if(code[middle].address < address)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+/*
+ * Returns the index of the instruction left at or after the address - where a label of the address leads
+ * once the code is laid out again - or count if there is none
+ */
+int instructionAt(CodeInstruction *code, int count, int address){
+	int index = findInstruction(code, count, address);
+	return (index < count && code[index].removed)? nextInstruction(code, count, index) : index;
+}
+
+/*
+ * Moves the instructions left down over the removed ones, along with ic, the code labels and the code entries of lines
+ */
+void relayoutCode(Image *image, CodeInstruction *code, int count, int *ic, Symbol *symTable, LineTable *lines){
+	int loadAddress = getLoadAddress(), length = *ic - loadAddress, removed = 0, i, j, index;
+	int *removedBefore = (int*)malloc(sizeof(int) * (length + 1)); /* words removed before every address */
+	LineEntry *entry;
+
+	for(i = 0; i < count; i++){
+		for(j = 0; j < code[i].instruction.length; j++){
+			removedBefore[code[i].address - loadAddress + j] = removed;
+			if(removed && !code[i].removed)
+				strcpy(getImageWord(image, code[i].address + j - removed), getImageWord(image, code[i].address + j));
+		}
+		if(code[i].removed)
+			removed += code[i].instruction.length;
+	}
+	removedBefore[length] = removed;
+
+	for(; symTable; symTable = symTable->next){
+		if(isCodeLabel(symTable) && symTable->address >= loadAddress && symTable->address <= *ic)
+			symTable->address -= removedBefore[symTable->address - loadAddress];
+	}
+	/* the entry of a removed statement goes away, unless it names the code following it */
+	for(i = 0, j = 0; lines && i < lines->count; i++){
+		entry = &lines->entries[i];
+		if(!entry->isData && entry->address >= loadAddress && entry->address <= *ic){
+			index = findInstruction(code, count, entry->address);
+			if(index < count && code[index].address == entry->address && code[index].removed && strcmp(entry->label, NO_NAME) == 0)
+				continue;
+			entry->address -= removedBefore[entry->address - loadAddress];
+		}
+		lines->entries[j++] = *entry;
+	}
+	if(lines)
+		lines->count = j;
+	*ic -= removed;
+	free(removedBefore);
+}
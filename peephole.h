@@ -0,0 +1,30 @@
+/*
+ * peephole.h
+ * 		module optimizes the code of a program between the first and the second pass (with -O) - it decodes
+ * 		the instructions of the image, removes redundant ones and lays out the code and its labels again
+ */
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+#include "image.h"
+#include "data.h"
+#include "lines.h"
+
+/* what the optimization removed */
+typedef struct PeepholeReport {
+	int moves;			/* mov of an operand to itself */
+	int pairs;			/* inc followed by dec of the same operand (or the other way around) */
+	int jumps;			/* jmp to the instruction following it */
+	int compares;		/* cmp whose result no bne reads */
+	int instructions;
+	int words;
+	int cycles;			/* cycles saved each time the removed code would have run */
+} PeepholeReport;
+
+/*
+ * Removes the redundant instructions of the code in the image (from the load address up to ic), moving the code
+ * following them down - ic, the addresses of the code labels and the code entries of lines (unless NULL) follow
+ * Returns 1 if succeeded or 0 if the code can't be decoded (leaving it as it is)
+ */
+int optimizeCode(Image *image, int *ic, Symbol *symTable, LineTable *lines, PeepholeReport *report);
+
+#endif
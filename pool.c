@@ -0,0 +1,227 @@
+/*
+ * pool.c
+ * 		module pools the data segment of a program between the first and the second pass (with --pool-data) -
+ * 		a statement whose words another statement already holds (as a whole, or as the tail of it) shares them
+ *
+ * 		The code reaches the data only through labels - a label reads its own word, or the word following it as
+ * 		the second field of a struct - so a labelled statement may share the words of another as long as the
+ * 		shared words are never written. A statement is kept in place (and lends its words to no other) if the
+ * 		code writes to it, if it is an entry (another module may write to it) or if the code reaches it past the
+ * 		end of the statement before it. Statements are matched longest first, so every shared statement points
+ * 		into one which keeps its words, and the first of identical statements is the one kept.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pool.h"
+#include "instruction.h"
+#include "geometry.h"
+
+/* a statement of the data segment */
+typedef struct DataStatement {
+	int start;			/* offset of its words in the data segment */
+	int length;
+	int canShare;		/* may give up its words for the words of another */
+	int canLend;		/* may lend its words to others */
+	int host;			/* index of the statement holding its words, -1 if it keeps its own */
+	int newStart;
+} DataStatement;
+
+int findDataUses(Image *image, int ic, Symbol *symTable, DataStatement *statements, int count);
+void markDataUse(DataStatement *statements, int count, Symbol *symbol, int field, int isWritten);
+int findStatement(DataStatement *statements, int count, int offset);
+void shareStatements(int *data, DataStatement *statements, int count);
+int compareLengths(const void *first, const void *second);
+int compactData(Image *image, DataStatement *statements, int count, Symbol *symTable, LineTable *lines);
+
+/*
+ * Removes the data statements of the image whose words another statement holds, pointing their labels at the
+ * shared words - dc, the data labels and the data entries of lines (unless NULL) follow. Statements the code
+ * writes to, entry statements and statements reached past the end of another through a struct field are kept
+ * Returns 1 if succeeded or 0 if the code can't be decoded (leaving the data as it is)
+ */
+int poolData(Image *image, int ic, int *dc, Symbol *symTable, LineTable *lines, PoolReport *report){
+	DataStatement *statements = (DataStatement*)malloc(sizeof(DataStatement) * (image->statementCount + 1));
+	int i, count = image->statementCount, index, newDc;
+	Symbol *symbol;
+
+	memset(report, 0, sizeof(PoolReport));
+	for(i = 0; i < count; i++){
+		statements[i].start = image->statements[i];
+		statements[i].length = ((i + 1 < count)? image->statements[i + 1] : *dc) - statements[i].start;
+		statements[i].canShare = 0;
+		statements[i].canLend = 1;
+		statements[i].host = -1;
+	}
+	/* only a statement with a label of its own is reached at all */
+	for(symbol = symTable; symbol; symbol = symbol->next){
+		if(symbol->segment != DATA_SEGMENT || (index = findStatement(statements, count, symbol->address)) < 0
+				|| statements[index].start != symbol->address)
+			continue;
+		statements[index].canShare = symbol->isExternal != ENTRY_SYM;
+		statements[index].canLend = symbol->isExternal != ENTRY_SYM;
+	}
+	if(!findDataUses(image, ic, symTable, statements, count)){
+		free(statements);
+		return 0;
+	}
+
+	shareStatements(image->data, statements, count);
+	newDc = compactData(image, statements, count, symTable, lines);
+	for(i = 0; i < count; i++)
+		report->statements += statements[i].host >= 0;
+	report->words = *dc - newDc;
+	*dc = newDc;
+	free(statements);
+	return 1;
+}
+
+/*
+ * Goes over the operands of the code referencing data labels, keeping the statements written or reached past
+ * the end of another in place
+ * Returns 1 if succeeded or 0 if the code can't be decoded
+ */
+int findDataUses(Image *image, int ic, Symbol *symTable, DataStatement *statements, int count){
+	int words[MAX_INSTRUCTION_LENGTH], address, i, isDestination;
+	char label[IMAGE_WORD_LENGTH];
+	Instruction instruction;
+	DecodedOperand *operand;
+	Symbol *symbol;
+
+	for(address = getLoadAddress(); address < ic; address += instruction.length){
+		for(i = 0; i < MAX_INSTRUCTION_LENGTH && address + i < ic; i++)
+			words[i] = readImageWord(image, address + i);
+		if(!decodeInstruction(words, i, &instruction))
+			return 0;
+		for(isDestination = (instruction.operandCount < 2); isDestination <= (instruction.operandCount > 0); isDestination++){
+			operand = (isDestination)? &instruction.dst : &instruction.src;
+			if(operand->mode != DIRECT_MODE && operand->mode != STRUCT_MODE)
+				continue;
+			strcpy(label, getImageWord(image, address + operand->wordOffset));
+			label[strcspn(label, "|")] = '\0';
+			symbol = findSymbolInTable(label, symTable);
+			if(symbol && symbol->segment == DATA_SEGMENT)
+				markDataUse(statements, count, symbol, operand->field, isDestination && writesDestination(instruction.opCode));
+		}
+	}
+	return 1;
+}
+
+/*
+ * Marks the use of the data label (through a field of it, 0 if not a struct operand) - a statement written can
+ * neither share nor lend its words, a statement reached past the end of the label's statement stays where it is
+ */
+void markDataUse(DataStatement *statements, int count, Symbol *symbol, int field, int isWritten){
+	int labelled = findStatement(statements, count, symbol->address);
+	int reached = findStatement(statements, count, symbol->address + ((field == 2)? 1 : 0));
+	if(reached < 0)
+		return;
+	if(isWritten)
+		statements[reached].canLend = 0;
+	if(isWritten || reached != labelled){
+		statements[reached].canShare = 0;
+		if(labelled >= 0)
+			statements[labelled].canShare = 0;
+	}
+}
+
+/*
+ * Returns the index of the statement holding the offset of the data segment, or -1 if none does
+ */
+int findStatement(DataStatement *statements, int count, int offset){
+	int first = 0, last = count - 1, middle;
+	if(!count || offset < statements[0].start || offset >= statements[last].start + statements[last].length)
+		return -1;
+	while(first < last){
+		middle = (first + last + 1) / 2;
+		if(statements[middle].start <= offset)
+			first = middle;
+		else
+			last = middle - 1;
+	}
+	return first;
+}
+
+/*
+ * Sets the host of every statement whose words are the tail of (or the same as) the words of a statement
+ * keeping its own
+ */
+void shareStatements(int *data, DataStatement *statements, int count){
+	DataStatement **order = (DataStatement**)malloc(sizeof(DataStatement*) * (count + 1)), **lenders;
+	DataStatement *statement, *lender;
+	int i, j, lenderCount = 0;
+
+	for(i = 0; i < count; i++)
+		order[i] = &statements[i];
+	if(count)
+		qsort(order, count, sizeof(DataStatement*), compareLengths);
+	lenders = (DataStatement**)malloc(sizeof(DataStatement*) * (count + 1));
+	for(i = 0; i < count; i++){
+		statement = order[i];
+		for(j = 0; statement->canShare && j < lenderCount; j++){
+			lender = lenders[j];
+			if(memcmp(data + lender->start + lender->length - statement->length, data + statement->start,
+					sizeof(int) * statement->length) == 0){
+				statement->host = (int)(lender - statements);
+				break;
+			}
+		}
+		if(statement->host < 0 && statement->canLend)
+			lenders[lenderCount++] = statement;
+	}
+	free(order);
+	free(lenders);
+}
+
+/* longest first, statements of the same length in their order */
+int compareLengths(const void *first, const void *second){
+	DataStatement *firstStatement = *(DataStatement**)first, *secondStatement = *(DataStatement**)second;
+	if(firstStatement->length != secondStatement->length)
+		return secondStatement->length - firstStatement->length;
+	return firstStatement->start - secondStatement->start;
+}
+
+/*
+ * Moves the statements keeping their words down over the shared ones, along with the data labels and the data
+ * entries of lines (the entry of a shared statement goes away)
+ * Returns the new size of the data segment
+ */
+int compactData(Image *image, DataStatement *statements, int count, Symbol *symTable, LineTable *lines){
+	LineEntry *entry;
+	int i, j, index, dc = 0;
+
+	for(i = 0; i < count; i++){
+		if(statements[i].host >= 0)
+			continue;
+		statements[i].newStart = dc;
+		memmove(image->data + dc, image->data + statements[i].start, sizeof(int) * statements[i].length);
+		dc += statements[i].length;
+	}
+	/* a shared statement starts where its words are in the tail of its host */
+	for(i = 0; i < count; i++){
+		if(statements[i].host >= 0)
+			statements[i].newStart = statements[statements[i].host].newStart
+					+ statements[statements[i].host].length - statements[i].length;
+	}
+	for(; symTable; symTable = symTable->next){
+		if(symTable->segment == DATA_SEGMENT && (index = findStatement(statements, count, symTable->address)) >= 0)
+			symTable->address += statements[index].newStart - statements[index].start;
+	}
+	for(i = 0, j = 0; lines && i < lines->count; i++){
+		entry = &lines->entries[i];
+		if(entry->isData && (index = findStatement(statements, count, entry->address)) >= 0){
+			if(statements[index].host >= 0)
+				continue;
+			entry->address += statements[index].newStart - statements[index].start;
+		}
+		lines->entries[j++] = *entry;
+	}
+	if(lines)
+		lines->count = j;
+	for(i = 0, j = 0; i < count; i++){
+		if(statements[i].host < 0)
+			image->statements[j++] = statements[i].newStart;
+	}
+	image->statementCount = j;
+	return dc;
+}
@@ -0,0 +1,26 @@
+/*
+ * pool.h
+ * 		module pools the data segment of a program between the first and the second pass (with --pool-data) -
+ * 		a statement whose words another statement already holds (as a whole, or as the tail of it) shares them
+ */
+#ifndef POOL_H
+#define POOL_H
+#include "image.h"
+#include "data.h"
+#include "lines.h"
+
+/* what the pooling saved */
+typedef struct PoolReport {
+	int statements;		/* statements sharing the words of another */
+	int words;
+} PoolReport;
+
+/*
+ * Removes the data statements of the image whose words another statement holds, pointing their labels at the
+ * shared words - dc, the data labels and the data entries of lines (unless NULL) follow. Statements the code
+ * writes to, entry statements and statements reached past the end of another through a struct field are kept
+ * Returns 1 if succeeded or 0 if the code can't be decoded (leaving the data as it is)
+ */
+int poolData(Image *image, int ic, int *dc, Symbol *symTable, LineTable *lines, PoolReport *report);
+
+#endif
@@ -2,91 +2,219 @@
  * preprocessor.c
  * 		module is in charge of initially reading the .as file and replacing macro statements saving
  * 		the code to .am file
+ * 		".include name" adds the macros and declarations of the library "[name].as", precompiling it
+ * 		into "[name].aml" the first time (or whenever the library source is newer)
  */
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
 #include "utilities.h"
+#include "diagnostics.h"
 #include "constraints.h"
 #include "preprocessor.h"
+#include "library.h"
+#include "lines.h"
 
 #define MACRO 6
 #define ENDMACRO 8
 #define NUM_OF_RESERVED_WORDS 21
+#define MAX_DIRECTIVE_LENGTH 7
+#define INCLUDE_LENGTH 8
+#define MAX_CONDITIONAL_DEPTH 32
+#define ALL_VARIANTS_MASK(count) (((count) >= MAX_VARIANTS)? ~0UL : ((1UL << (count)) - 1))
 
 typedef struct Macro{
 	char name[MAX_LINE_LENGTH];
-	char text[TARGET_MACHINE_MEMORY_LENGTH];
+	char *text;
+	int isIncluded; /* the text belongs to a mapped library and is not freed*/
+	unsigned long variantMask; /* bit i is set if the macro is defined in variant i*/
 	struct Macro* next;
 } Macro;
 
-void getMacroName(char* line, char* macroName);
-int isValidMacroName (Macro* head, char* macroName);
-Macro* newMacro(char* macroName, char* macroContent);
-void storeMacro(Macro **head, char* macroName, char* macroContent);
-void getMacroContent(char* line, char* macroContent, FILE *f1);
-int isMacroOrEndmacro(char* line, char* macroOrEndmacro);
-int putMacro(Macro* head, char* line, FILE *f2);
+/* an open .ifdef/.ifndef block */
+typedef struct Conditional{
+	unsigned long parentMask; /* variants active around the block*/
+	unsigned long branchMask; /* variants for which the condition held*/
+	int inElse;
+	int lineNumber;
+} Conditional;
+
+int isValidMacroName (Macro* head, char* macroName, unsigned long variantMask);
+Macro* newMacro(char* macroName, char* macroContent, unsigned long variantMask, int isIncluded);
+void storeMacro(Macro **head, char* macroName, char* macroContent, unsigned long variantMask, int isIncluded);
+int getMacroContent(char* line, char* macroContent, FILE *f1, int *lineNumber);
+Macro* findMacro(Macro* head, char* name, unsigned long variantBit);
+void putLine(Macro* head, char* line, FILE **amFiles, int variantCount, SourceStream* stream, unsigned long activeMask, int lineNumber);
+int applyConditional(int directive, char* symbol, Conditional* stack, int* depth, unsigned long* activeMask, Variant* variants, int variantCount, int lineNumber);
+unsigned long getDefinedMask(char* symbol, Variant* variants, int variantCount);
+int includeLibrary(char* name, Macro** head, FILE **amFiles, int variantCount, SourceStream* stream, unsigned long activeMask, int lineNumber);
+int precompileLibrary(char* name);
+int isDeclaration(char* line);
 void destroy(Macro* head);
 
 /*
- * Tries to read the file "[name].as", treats macro declarations
- * and saves the completed file as file "[name].am"
+ * Tries to read the file "[name].as", treats macro declarations and conditional blocks
+ * and saves the completed file of every variant as file "[name].am" (or "[name].[variant].am")
+ * the expanded lines are also added to the source stream (unless NULL), once for the variants sharing them
  */
-void preprocessor(char *name, int *success){
-	FILE *asFile, *amFile;
-	char *inputUrl, *outputUrl;
-	char *buffer = NULL;
-	Macro *head = NULL;
-	char* isMacro = "macro";
-	buffer = (char*)malloc(MAX_LINE_LENGTH * sizeof(char));
-	inputUrl = constructUrl(name,"as");
-	asFile = fopen(inputUrl, "r");
-
+void preprocessor(char *name, Variant *variants, int variantCount, SourceStream *stream, int *success){
+	FILE *asFile = openSourceFile(name);
 	if(asFile == NULL){
-		fprintf(stderr,"Error: couldn't read file %s!\n\t\tMake sure file name is correct.\n",inputUrl);
-		free(buffer);
-		free(inputUrl);
 		*success = 0;
 		return;
 	}
-	outputUrl = constructUrl(name,"am");
-	amFile = fopen(outputUrl, "w");
-	if(amFile == NULL){
-		fprintf(stderr,"Error: couldn't create file %s!\n\n",outputUrl);
-		fclose(asFile);
-		remove(outputUrl);
-		free(buffer);
-		*success =0;
-		return;
+	preprocessStream(asFile, name, variants, variantCount, stream, success);
+	fclose(asFile);
+}
+
+/*
+ * Opens "[name].as" for reading, reporting an error if it can't be read
+ * Returns the stream or NULL
+ */
+FILE* openSourceFile(char *name){
+	FILE *asFile;
+	char *inputUrl;
+	inputUrl = constructUrl(name,"as");
+	asFile = fopen(inputUrl, "r");
+	if(asFile == NULL)
+		reportSummary("Error: couldn't read file %s!\n\t\tMake sure file name is correct.",inputUrl);
+	free(inputUrl);
+	return asFile;
+}
+
+/*
+ * Same as preprocessor, but reads the source code from an already opened stream (the stream is not closed)
+ */
+void preprocessStream(FILE *asFile, char *name, Variant *variants, int variantCount, SourceStream *stream, int *success){
+	FILE *amFiles[MAX_VARIANTS];
+	char *outputUrls[MAX_VARIANTS];
+	char *variantName;
+	int i;
+
+	for(i = 0; i < variantCount; i++){
+		variantName = constructVariantName(name, &variants[i]);
+		outputUrls[i] = constructUrl(variantName,"am");
+		free(variantName);
+		amFiles[i] = fopen(outputUrls[i], "w");
+		if(amFiles[i] == NULL){
+			reportSummary("Error: couldn't create file %s!\n",outputUrls[i]);
+			free(outputUrls[i]);
+			variantCount = i;
+			*success = 0;
+		}
 	}
-	while(fgets(buffer, MAX_LINE_LENGTH, asFile)){ /* reading a line from source file */
+	if(*success)
+		expandSource(asFile, name, amFiles, variants, variantCount, stream, success);
+	for(i = 0; i < variantCount; i++){
+		fclose(amFiles[i]);
+		if(!*success)
+			remove(outputUrls[i]);
+		free(outputUrls[i]);
+	}
+}
+
+/*
+ * Expands the source code read from asFile in memory - buffers[i] receives the expanded code of variant i
+ * (to be freed by the caller) and lengths[i] its length
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int expandToMemory(FILE *asFile, char *name, Variant *variants, int variantCount, char **buffers, size_t *lengths){
+	FILE *amFiles[MAX_VARIANTS];
+	int i, success = 1;
+	for(i = 0; i < variantCount; i++)
+		amFiles[i] = open_memstream(&buffers[i], &lengths[i]);
+	expandSource(asFile, name, amFiles, variants, variantCount, NULL, &success);
+	for(i = 0; i < variantCount; i++)
+		fclose(amFiles[i]);
+	return success;
+}
+
+/*
+ * Opens an expanded buffer (as returned by expandToMemory) as a stream for reading
+ */
+FILE* openExpandedBuffer(char *buffer, size_t length){
+	/* the terminating null is included so an empty buffer can be opened as well */
+	return fmemopen(buffer, length + 1, "r");
+}
+
+/*
+ * Expands the source code read from asFile into amFiles[i] for every variant i (and into stream unless NULL)
+ * The source is read once - each line is written to the expanded stream of every variant it is active in
+ */
+void expandSource(FILE *asFile, char *name, FILE **amFiles, Variant *variants, int variantCount, SourceStream *stream, int *success){
+	char *buffer = NULL;
+	char symbol[MAX_LINE_LENGTH];
+	Macro *head = NULL;
+	Conditional stack[MAX_CONDITIONAL_DEPTH];
+	int directive, depth = 0, lineNumber = 0;
+	unsigned long activeMask = ALL_VARIANTS_MASK(variantCount);
+	char* isMacro = "macro";
+
+	buffer = (char*)malloc(MAX_LINE_LENGTH * sizeof(char));
+	resetLibraryUse();
+	resetLineOrigins();
+	while(*success && fgets(buffer, MAX_LINE_LENGTH, asFile)){ /* reading a line from source file */
+		lineNumber++;
+		directive = getConditionalDirective(buffer, symbol);
+		if(directive != NOT_CONDITIONAL){
+			*success = applyConditional(directive, symbol, stack, &depth, &activeMask, variants, variantCount, lineNumber);
+			continue;
+		}
+		if(!activeMask) /* line is excluded from every variant */
+			continue;
+		if(getIncludeName(buffer, symbol)){
+			*success = includeLibrary(symbol, &head, amFiles, variantCount, stream, activeMask, lineNumber);
+			continue;
+		}
 		if(isMacroOrEndmacro(buffer, isMacro)){ /* if the first word in the line is "macro" and macro name is legal - it stores the macro in a linked list */
 			char macroName[MAX_LINE_LENGTH];
-			char macroContent[MAX_LINE_LENGTH];
+			char macroContent[MAX_MACRO_LENGTH];
 			getMacroName(buffer, macroName);
-			if(!isValidMacroName(head, macroName)){
-				if(!remove(outputUrl)){
-					printf("Error detected: macro name '%s' is not valid. Failed to create an expanded source file from %s.\n", macroName,inputUrl);
-					*success = 0;
-				}
+			if(!isValidMacroName(head, macroName, activeMask)){
+				reportError(lineNumber, MACRO_NAME_DIAGNOSTIC, "macro name '%s' is not valid. Failed to create an expanded source file from %s.as.", macroName,name);
+				*success = 0;
+				break;
+			}
+			if(!getMacroContent(buffer,macroContent, asFile, &lineNumber)){
+				*success = 0;
 				break;
 			}
-			getMacroContent(buffer,macroContent, asFile);
-			storeMacro(&head, macroName, macroContent);
+			storeMacro(&head, macroName, macroContent, activeMask, 0);
 		}
- 		else if(!putMacro(head, buffer, amFile))
-			fputs(buffer, amFile);
+		else
+			putLine(head, buffer, amFiles, variantCount, stream, activeMask, lineNumber);
+	}
+	if(*success && depth > 0){
+		reportError(stack[depth-1].lineNumber, UNCLOSED_CONDITIONAL_DIAGNOSTIC, "conditional block is never closed with .endif");
+		*success = 0;
 	}
-	fclose(asFile);
-	fclose(amFile);
 	destroy(head);
 	free(buffer);
 	return;
 }	
 
+/*
+ * Returns a new string with the name used for the files of the given variant - "[name]" or "[name].[variant]"
+ */
+char* constructVariantName(char *name, Variant *variant){
+	char *variantName;
+	if(!variant || !variant->name){
+		variantName = (char*)malloc(strlen(name) + 1);
+		strcpy(variantName, name);
+		return variantName;
+	}
+	variantName = (char*)malloc(strlen(name) + strlen(variant->name) + 2);
+	strcpy(variantName, name);
+	strcat(variantName, ".");
+	strcat(variantName, variant->name);
+	return variantName;
+}
 
+/*
+ * Stores the name following "macro" in macroName
+ */
 void getMacroName(char* line, char* macroName){
 	int i = 0;
 	char* findMacro = strstr(line, "macro");
@@ -101,10 +229,26 @@ void getMacroName(char* line, char* macroName){
 }
 
 /*
- * Checks if a macro name is valid
+ * Checks if a macro name is valid and not defined yet in any of the variants of variantMask
+ * returns 1 for true 0 for false
+ */
+int isValidMacroName (Macro* head, char* macroName, unsigned long variantMask){
+	if(!isLegalMacroName(macroName))
+		return 0;
+	while(head){ /* checks if there is a macro with the same name in one of the same variants */
+		if(!strcmp(head->name, macroName) && (head->variantMask & variantMask)){
+			return 0;
+		}
+		head = head->next;
+	}
+	return 1;
+}
+
+/*
+ * Checks if a macro name is legal - not a reserved word, a letter followed by letters or numbers
  * returns 1 for true 0 for false
  */
-int isValidMacroName (Macro* head, char* macroName){
+int isLegalMacroName (char* macroName){
 	int j = 0;
 	char *reservedWords[] = {
 			"mov", "cmp", "add", "sub", "not", "clr", "lea", "inc",
@@ -119,12 +263,6 @@ int isValidMacroName (Macro* head, char* macroName){
 		if(!strcmp(macroName, *(reservedWords + j)))
 			return 0;
 	}
-	while(head){ /* checks if there is a macro with the same name */
-		if(!strcmp(head->name, macroName)){
-			return 0;
-		}
-		head = head->next;
-	}
 	if(!isalpha(*macroName)){ /* checking first character is a letter */
 		return 0;
 	}
@@ -138,27 +276,53 @@ int isValidMacroName (Macro* head, char* macroName){
 }
 
 /* 
- * Saves the content of the macro
+ * Saves the content of the macro, advancing lineNumber over the lines read
+ * returns 1 if succeeded or 0 if encountered errors
  */
-void getMacroContent(char* line, char* macroContent, FILE *f1){
+int getMacroContent(char* line, char* macroContent, FILE *f1, int *lineNumber){
 	char* isEndmacro = "endmacro";
-	memset(macroContent, '\0', MAX_LINE_LENGTH);
-	fgets(line, MAX_LINE_LENGTH, f1);
-	for(; !isMacroOrEndmacro(line, isEndmacro); fgets(line, MAX_LINE_LENGTH, f1)){
+	char symbol[MAX_LINE_LENGTH];
+	int macroLine = *lineNumber;
+	memset(macroContent, '\0', MAX_MACRO_LENGTH);
+	for(; fgets(line, MAX_LINE_LENGTH, f1) ; ){
+		(*lineNumber)++;
+		if(isMacroOrEndmacro(line, isEndmacro))
+			return 1;
+		if(getConditionalDirective(line, symbol) != NOT_CONDITIONAL){
+			reportError(*lineNumber, DIRECTIVE_IN_MACRO_DIAGNOSTIC, "conditional directives are not allowed inside a macro");
+			return 0;
+		}
+		if(getIncludeName(line, symbol)){
+			reportError(*lineNumber, DIRECTIVE_IN_MACRO_DIAGNOSTIC, ".include is not allowed inside a macro");
+			return 0;
+		}
+		if(strlen(macroContent) + strlen(line) >= MAX_MACRO_LENGTH){
+			reportError(*lineNumber, MACRO_LENGTH_DIAGNOSTIC, "macro content is too long");
+			return 0;
+		}
 		strcat(macroContent, line);
 	}
+	reportError(macroLine, UNCLOSED_MACRO_DIAGNOSTIC, "macro is never closed with endmacro");
+	return 0;
 }
 
 /*
- * Creates a new macro
+ * Creates a new macro, the content of an included macro is used in place rather than copied
  * returns the macro
  */
-Macro* newMacro(char* macroName, char* macroContent){
+Macro* newMacro(char* macroName, char* macroContent, unsigned long variantMask, int isIncluded){
 	Macro* current = NULL;	
 	current = (Macro*)malloc(sizeof(Macro));
 	if(current != NULL){
 		strcpy(current->name, macroName);
-		strcpy(current->text, macroContent);
+		current->isIncluded = isIncluded;
+		if(isIncluded)
+			current->text = macroContent;
+		else{
+			current->text = (char*)malloc(strlen(macroContent) + 1);
+			strcpy(current->text, macroContent);
+		}
+		current->variantMask = variantMask;
 		current->next = NULL;
 	}
 	return current;
@@ -167,9 +331,9 @@ Macro* newMacro(char* macroName, char* macroContent){
 /*
  * Adds the macro to a linked list of labels 
  */	
-void storeMacro(Macro **head, char* macroName, char* macroContent){
+void storeMacro(Macro **head, char* macroName, char* macroContent, unsigned long variantMask, int isIncluded){
 	Macro* current;	
-	current = newMacro(macroName, macroContent);
+	current = newMacro(macroName, macroContent, variantMask, isIncluded);
 	if(current != NULL){
 		current->next = *head; 
 		*head = current;
@@ -196,27 +360,298 @@ int isMacroOrEndmacro(char* line, char* macroOrEndmacro){
 }
 
 /*
- * Writes the content of the macro in the expanded source file instead of macro name
- * returns 1 if line starts with a macro name 0 if not
+ * Searches for a macro with the given name which is defined in the variant of variantBit
+ * returns the macro if found, otherwise returns NULL
  */
-int putMacro(Macro* head, char* line, FILE *f2){ 
-	int i = 0;	
+Macro* findMacro(Macro* head, char* name, unsigned long variantBit){
+	while(head){
+		if((head->variantMask & variantBit) && !strcmp(head->name, name))
+			return head;
+		head = head->next;
+	}
+	return NULL;
+}
+
+/*
+ * Writes the line to the expanded source file of every active variant,
+ * writing the content of the macro instead of a macro name (and recording where the written lines came from)
+ * the stream (unless NULL) receives each distinct text once, for all the variants it was written to
+ */
+void putLine(Macro* head, char* line, FILE **amFiles, int variantCount, SourceStream* stream, unsigned long activeMask, int lineNumber){ 
+	int i = 0, j;	
 	char* running = line;
 	char nameBuf[MAX_LINE_LENGTH];
+	char* texts[MAX_VARIANTS];
+	unsigned long mask;
+	Macro* macro;
 	for( ; isspace(*running) ; running++){
 	} /* skips tabs and spaces at the beginning of the line */	
 	for(; *running && !isspace(*running) ; running++, i++){
 		nameBuf[i] = *running;
 	}
 	nameBuf[i] = '\0';
-	while(head){
-		if(!strcmp(head->name, nameBuf)){
-			fputs(head->text, f2);
-			return 1;
+	for(i = 0; i < variantCount; i++){
+		if(!(activeMask & (1UL << i)))
+			continue;
+		macro = findMacro(head, nameBuf, 1UL << i);
+		texts[i] = macro? macro->text : line;
+		fputs(texts[i], amFiles[i]);
+		recordLineOrigins(i, lineNumber, macro? macro->name : NULL, texts[i]);
+	}
+	for(i = 0; stream && i < variantCount; i++){
+		if(!(activeMask & (1UL << i)))
+			continue;
+		/* the variants expanding the line to the same text share it, the first of them adds it */
+		for(mask = 0, j = i; j < variantCount; j++){
+			if((activeMask & (1UL << j)) && texts[j] == texts[i])
+				mask |= 1UL << j;
 		}
-		head = head->next;
+		activeMask &= ~mask;
+		appendStreamText(stream, texts[i], mask);
 	}
-	return 0;
+}
+
+/*
+ * Checks if the line is one of the conditional directives .ifdef, .ifndef, .else or .endif
+ * storing the symbol following .ifdef/.ifndef in symbol
+ * returns the directive (using enum conditionalDirective)
+ */
+int getConditionalDirective(char* line, char* symbol){
+	int i = 0;
+	char word[MAX_DIRECTIVE_LENGTH + 1];
+	char* running = line;
+	*symbol = '\0';
+	for( ; isspace(*running) ; running++){
+	} /* skips tabs and spaces at the beginning of the line */
+	if(*running != '.')
+		return NOT_CONDITIONAL;
+	for(; *running && i < MAX_DIRECTIVE_LENGTH && !isspace(*running) ; running++, i++){
+		word[i] = *running;
+	}
+	word[i] = '\0';
+	if(*running && !isspace(*running))
+		return NOT_CONDITIONAL;
+	for( ; isspace(*running) ; running++){
+	}
+	for(i = 0; *running && !isspace(*running) ; running++, i++){
+		symbol[i] = *running;
+	}
+	symbol[i] = '\0';
+	if(strcmp(word, ".ifdef") == 0) return IFDEF_DIRECTIVE;
+	if(strcmp(word, ".ifndef") == 0) return IFNDEF_DIRECTIVE;
+	if(strcmp(word, ".else") == 0) return ELSE_DIRECTIVE;
+	if(strcmp(word, ".endif") == 0) return ENDIF_DIRECTIVE;
+	return NOT_CONDITIONAL;
+}
+
+/*
+ * Opens, switches or closes a conditional block, updating the mask of variants the following lines are active in
+ * returns 1 if succeeded or 0 if encountered errors
+ */
+int applyConditional(int directive, char* symbol, Conditional* stack, int* depth, unsigned long* activeMask, Variant* variants, int variantCount, int lineNumber){
+	Conditional *block;
+	switch(directive){
+		case IFDEF_DIRECTIVE:
+		case IFNDEF_DIRECTIVE:{
+			if(!*symbol){
+				reportError(lineNumber, CONDITIONAL_SYMBOL_DIAGNOSTIC, "missing symbol name after conditional directive");
+				return 0;
+			}
+			if(*depth == MAX_CONDITIONAL_DEPTH){
+				reportError(lineNumber, CONDITIONAL_DEPTH_DIAGNOSTIC, "conditional blocks are nested deeper than %d",MAX_CONDITIONAL_DEPTH);
+				return 0;
+			}
+			block = &stack[(*depth)++];
+			block->parentMask = *activeMask;
+			block->branchMask = getDefinedMask(symbol, variants, variantCount);
+			if(directive == IFNDEF_DIRECTIVE)
+				block->branchMask = ~block->branchMask & ALL_VARIANTS_MASK(variantCount);
+			block->inElse = 0;
+			block->lineNumber = lineNumber;
+			*activeMask = block->parentMask & block->branchMask;
+		}
+			break;
+		case ELSE_DIRECTIVE:{
+			if(*depth == 0 || stack[*depth-1].inElse){
+				reportError(lineNumber, UNMATCHED_CONDITIONAL_DIAGNOSTIC, ".else without a matching .ifdef");
+				return 0;
+			}
+			block = &stack[*depth-1];
+			block->inElse = 1;
+			*activeMask = block->parentMask & ~block->branchMask;
+		}
+			break;
+		case ENDIF_DIRECTIVE:{
+			if(*depth == 0){
+				reportError(lineNumber, UNMATCHED_CONDITIONAL_DIAGNOSTIC, ".endif without a matching .ifdef");
+				return 0;
+			}
+			*activeMask = stack[--(*depth)].parentMask;
+		}
+			break;
+	}
+	return 1;
+}
+
+/*
+ * Returns a mask of the variants in which symbol is defined
+ */
+unsigned long getDefinedMask(char* symbol, Variant* variants, int variantCount){
+	unsigned long mask = 0;
+	int i, j;
+	for(i = 0; i < variantCount; i++){
+		for(j = 0; j < variants[i].defineCount; j++){
+			if(strcmp(variants[i].defines[j], symbol) == 0){
+				mask |= 1UL << i;
+				break;
+			}
+		}
+	}
+	return mask;
+}
+
+/*
+ * Checks if the line is an ".include name" directive, storing the name in name
+ * returns 1 for true 0 for false
+ */
+int getIncludeName(char *line, char *name){
+	int i = 0;
+	char* running = line;
+	*name = '\0';
+	for( ; isspace(*running) ; running++){
+	} /* skips tabs and spaces at the beginning of the line */
+	if(strncmp(running, ".include", INCLUDE_LENGTH) != 0 || (running[INCLUDE_LENGTH] && !isspace(running[INCLUDE_LENGTH])))
+		return 0;
+	for(running += INCLUDE_LENGTH; isspace(*running) ; running++){
+	}
+	for(; *running && !isspace(*running) ; running++, i++){
+		name[i] = *running;
+	}
+	name[i] = '\0';
+	return 1;
+}
+
+/*
+ * Adds the macros of the library to the macros of the active variants (once per variant)
+ * and writes its declarations to their expanded files (and once to the stream unless NULL), precompiling the library if needed
+ * returns 1 if succeeded or 0 if encountered errors
+ */
+int includeLibrary(char* name, Macro** head, FILE **amFiles, int variantCount, SourceStream* stream, unsigned long activeMask, int lineNumber){
+	Library *library;
+	unsigned long mask;
+	int i;
+	if(!*name){
+		reportError(lineNumber, LIBRARY_NAME_DIAGNOSTIC, "missing library name after .include");
+		return 0;
+	}
+	library = loadLibrary(name);
+	if(!library){
+		reportError(lineNumber, UNKNOWN_LIBRARY_DIAGNOSTIC, "couldn't load library '%s'", name);
+		return 0;
+	}
+	mask = markLibraryUse(library, activeMask);
+	if(!mask) /* already included in every active variant */
+		return 1;
+	for(i = 0; i < getLibraryMacroCount(library); i++){
+		if(findMacro(*head, getLibraryMacroName(library, i), mask)){
+			reportError(lineNumber, DUPLICATE_MACRO_DIAGNOSTIC, "macro '%s' of library '%s' is already defined", getLibraryMacroName(library, i), name);
+			return 0;
+		}
+		storeMacro(head, getLibraryMacroName(library, i), getLibraryMacroText(library, i), mask, 1);
+	}
+	for(i = 0; i < variantCount; i++){
+		if(mask & (1UL << i)){
+			fputs(getLibraryDeclarations(library), amFiles[i]);
+			recordLineOrigins(i, lineNumber, NULL, getLibraryDeclarations(library));
+		}
+	}
+	if(stream)
+		appendStreamText(stream, getLibraryDeclarations(library), mask);
+	return 1;
+}
+
+/*
+ * Returns the precompiled library "[name]", precompiling it first if it is missing or older than its source
+ * or NULL if encountered errors
+ */
+Library* loadLibrary(char *name){
+	Library *library = openLibrary(name);
+	if(!library && precompileLibrary(name))
+		library = openLibrary(name);
+	return library;
+}
+
+/*
+ * Parses the library "[name].as" - which holds only macros and .extern/.entry declarations -
+ * and writes it precompiled as "[name].aml"
+ * returns 1 if succeeded or 0 if encountered errors
+ */
+int precompileLibrary(char* name){
+	FILE *libraryFile = openSourceFile(name), *declarationStream;
+	char line[MAX_LINE_LENGTH], macroName[MAX_LINE_LENGTH];
+	char macroContent[MAX_MACRO_LENGTH];
+	char *declarations = NULL, *running;
+	char **macroNames, **macroTexts;
+	size_t declarationsLength = 0;
+	Macro *head = NULL, *macro;
+	int count = 0, lineNumber = 0, success = 1;
+
+	if(!libraryFile)
+		return 0;
+	declarationStream = open_memstream(&declarations, &declarationsLength);
+	while(success && fgets(line, MAX_LINE_LENGTH, libraryFile)){
+		lineNumber++;
+		for(running = line; isspace(*running) ; running++){
+		}
+		if(!*running || *running == ';')
+			continue;
+		if(isMacroOrEndmacro(line, "macro")){
+			getMacroName(line, macroName);
+			if(!isValidMacroName(head, macroName, 1UL)){
+				reportError(lineNumber, MACRO_NAME_DIAGNOSTIC, "macro name '%s' is not valid. Failed to precompile library %s.as.", macroName, name);
+				success = 0;
+			}
+			else if((success = getMacroContent(line, macroContent, libraryFile, &lineNumber))){
+				storeMacro(&head, macroName, macroContent, 1UL, 0);
+				count++;
+			}
+		}
+		else if(isDeclaration(running)){
+			fputs(line, declarationStream);
+			if(line[strlen(line) - 1] != '\n')
+				fputc('\n', declarationStream);
+		}
+		else{
+			reportError(lineNumber, LIBRARY_CONTENT_DIAGNOSTIC, "only macros and .extern/.entry declarations are allowed in library %s.as", name);
+			success = 0;
+		}
+	}
+	fclose(declarationStream);
+	fclose(libraryFile);
+	if(success){
+		macroNames = (char**)malloc(sizeof(char*) * (count + 1));
+		macroTexts = (char**)malloc(sizeof(char*) * (count + 1));
+		for(count = 0, macro = head; macro; macro = macro->next, count++){
+			macroNames[count] = macro->name;
+			macroTexts[count] = macro->text;
+		}
+		success = writeLibrary(name, macroNames, macroTexts, count, declarations);
+		free(macroNames);
+		free(macroTexts);
+	}
+	free(declarations);
+	destroy(head);
+	return success;
+}
+
+/*
+ * Checks if the line (without leading spaces) is an .extern or .entry statement
+ * returns 1 for true 0 for false
+ */
+int isDeclaration(char* line){
+	if(strncmp(line, ".extern", 7) == 0 && isspace(line[7]))
+		return 1;
+	return strncmp(line, ".entry", 6) == 0 && isspace(line[6]);
 }
 
 void destroy(Macro* head){
@@ -225,5 +660,7 @@ void destroy(Macro* head){
 		return;
 	}
 	destroy(head->next);
+	if(!head->isIncluded)
+		free(head->text);
 	free(head);
 }
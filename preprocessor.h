@@ -2,14 +2,102 @@
  * preprocessor.h
  * 		module is in charge of initially reading the .as file and replacing macro statements saving
  * 		the code to .am file
+ * 		lines between .ifdef/.ifndef SYMBOL, .else and .endif are kept only in the variants the condition holds for
+ * 		".include name" adds the macros and .extern/.entry declarations of the library "[name].as"
  */
 #ifndef PREPROCESSOR_H
 #define PREPROCESSOR_H
+#include <stdio.h>
+#include "stream.h"
+
+#define MAX_VARIANTS 32
+
+/* a configuration the source is expanded for*/
+typedef struct Variant {
+	char *name;			/* appended to the output file names, NULL for the default variant*/
+	char **defines;		/* symbols considered defined by .ifdef */
+	int defineCount;
+} Variant;
+
+/*
+ * Tries to read the file "[name].as", treats macro declarations and conditional blocks
+ * and saves the completed file of every variant as file "[name].am" (or "[name].[variant].am")
+ * the expanded lines are also added to the source stream (unless NULL), once for the variants sharing them
+ */
+void preprocessor(char *name, Variant *variants, int variantCount, SourceStream *stream, int *success);
+
+/*
+ * Same as preprocessor, but reads the source code from an already opened stream (the stream is not closed)
+ */
+void preprocessStream(FILE *asFile, char *name, Variant *variants, int variantCount, SourceStream *stream, int *success);
+
+/*
+ * Expands the source code read from asFile into amFiles[i] for every variant i (and into stream unless NULL)
+ * The source is read once - each line is written to the expanded stream of every variant it is active in
+ */
+void expandSource(FILE *asFile, char *name, FILE **amFiles, Variant *variants, int variantCount, SourceStream *stream, int *success);
+
+/*
+ * Expands the source code read from asFile in memory - buffers[i] receives the expanded code of variant i
+ * (to be freed by the caller) and lengths[i] its length
+ * Returns 1 if succeeded or 0 if encountered errors
+ */
+int expandToMemory(FILE *asFile, char *name, Variant *variants, int variantCount, char **buffers, size_t *lengths);
+
+/*
+ * Opens an expanded buffer (as returned by expandToMemory) as a stream for reading
+ */
+FILE* openExpandedBuffer(char *buffer, size_t length);
+
+/*
+ * Opens "[name].as" for reading, reporting an error if it can't be read
+ * Returns the stream or NULL
+ */
+FILE* openSourceFile(char *name);
+
+/*
+ * Returns a new string with the name used for the files of the given variant - "[name]" or "[name].[variant]"
+ */
+char* constructVariantName(char *name, Variant *variant);
+
+/*
+ * Checks if the line is an ".include name" directive, storing the name in name
+ * returns 1 for true 0 for false
+ */
+int getIncludeName(char *line, char *name);
+
+/*
+ * Returns the precompiled library "[name]", precompiling it first if it is missing or older than its source
+ * or NULL if encountered errors
+ */
+struct Library* loadLibrary(char *name);
+
+/* lexing helpers shared with the language server */
+
+enum conditionalDirective { NOT_CONDITIONAL, IFDEF_DIRECTIVE, IFNDEF_DIRECTIVE, ELSE_DIRECTIVE, ENDIF_DIRECTIVE };
+
+/*
+ * Checks if the line is one of the conditional directives .ifdef, .ifndef, .else or .endif
+ * storing the symbol following .ifdef/.ifndef in symbol
+ * returns the directive (using enum conditionalDirective)
+ */
+int getConditionalDirective(char* line, char* symbol);
+
+/*
+ * Checks if the line starts with "macro" or "endmacro" (given in macroOrEndmacro)
+ * returns 1 for true 0 for false
+ */
+int isMacroOrEndmacro(char* line, char* macroOrEndmacro);
+
+/*
+ * Stores the name following "macro" in macroName
+ */
+void getMacroName(char* line, char* macroName);
 
 /*
- * Tries to read the file "[name].as", treats macro declarations
- * and saves the completed file as file "[name].am"
+ * Checks if a macro name is legal - not a reserved word, a letter followed by letters or numbers
+ * returns 1 for true 0 for false
  */
-void preprocessor(char *name, int *success);
+int isLegalMacroName (char* macroName);
 
 #endif
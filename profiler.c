@@ -0,0 +1,294 @@
+/*
+ * profiler.c
+ * 		the profiler - executes an assembled program (see machine.h) and reports where its time goes
+ *
+ * 		Usage: profiler [--max-steps N] [--memory N] [--load-address N] [--word-width N] program
+ * 		The program must have been assembled with --lines, whose "[program].lin" relates its addresses to
+ * 		source lines, macros and labels (see lines.h). An instruction takes a cycle for every word of it (see instructionCycles).
+ * 		The cycles are written to "[program].prof" per source line (an expanded macro counted at the line
+ * 		invoking it), per label (an instruction belongs to the last code label before it) and per macro, and
+ * 		per call stack to "[program].folded" - a line per stack of labels called through jsr, in the folded
+ * 		format flame graph tools read.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "machine.h"
+#include "lines.h"
+#include "object.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+#define INITIAL_CAPACITY 64
+
+/* the cycles spent under a stack of calls */
+typedef struct CallNode {
+	char *name;			/* label of the called subroutine */
+	int parent;			/* index of the caller's node, -1 for the root */
+	int firstChild;
+	int nextSibling;
+	long cycles;		/* cycles spent in the subroutine itself (not in the ones it called) */
+} CallNode;
+
+/* a line of a report */
+typedef struct ProfileRow {
+	char name[MAX_LINE_LENGTH];
+	long cycles;
+	long executions;
+} ProfileRow;
+
+long profileProgram(Machine *machine, LineTable *lines, CallNode **nodes, int *nodeCount, long limit);
+int enterCall(CallNode **nodes, int *nodeCount, int *capacity, int parent, char *name);
+char* labelAt(LineTable *lines, int address);
+int writeProfile(char *name, Machine *machine, LineTable *lines, long cycles);
+int addCycles(ProfileRow **rows, int *count, char *name, long cycles, long executions, int isContiguous);
+void writeRows(FILE *file, char *title, ProfileRow *rows, int count, long cycles);
+int compareRows(const void *first, const void *second);
+int writeFoldedStacks(char *name, CallNode *nodes, int nodeCount);
+void writeStack(FILE *file, CallNode *nodes, int node);
+
+int main(int argc, char **argv){
+	ObjectModule *module = NULL;
+	Machine *machine = NULL;
+	LineTable *lines = NULL;
+	CallNode *nodes = NULL;
+	char *name = NULL, trap[MAX_TRAP_DESCRIPTION];
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, maxSteps = -1, nodeCount = 0, success = 1;
+	long cycles;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "--max-steps") == 0){
+			if(i + 1 >= argc || !customAtoi(argv[++i], &maxSteps) || maxSteps < 0){
+				fprintf(stderr,"Error: option '--max-steps' requires an amount of steps\n");
+				success = 0;
+			}
+		}
+		else if(argv[i][0] == '-' || name){
+			fprintf(stderr,"Error: unexpected parameter '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			name = argv[i];
+	}
+	if(success && !name){
+		fprintf(stderr,"Usage: profiler [--max-steps N] [--memory N] [--load-address N] [--word-width N] program\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+	success = success && (module = readObjectModule(name)) != NULL;
+	success = success && (lines = readLineTable(name)) != NULL;
+	success = success && (machine = createMachine(module)) != NULL;
+	if(success){
+		cycles = profileProgram(machine, lines, &nodes, &nodeCount, (maxSteps < 0)? LONG_MAX : maxSteps);
+		fflush(stdout);
+		if(machine->state == TRAPPED_STATE)
+			fprintf(stderr,"Error: %s %s\n",name,describeTrap(machine, trap));
+		else if(machine->state == LIMIT_STATE)
+			fprintf(stderr,"Error: %s didn't halt within %d steps\n",name,maxSteps);
+		/* a program which didn't halt is still worth a profile */
+		success = writeProfile(name, machine, lines, cycles) && writeFoldedStacks(name, nodes, nodeCount);
+		if(success)
+			fprintf(stderr,"%ld instructions, %ld cycles - profile written to %s.prof and %s.folded\n",
+					machine->steps,cycles,name,name);
+		success = success && machine->state == HALTED_STATE;
+	}
+	for(i = 0; i < nodeCount; i++)
+		free(nodes[i].name);
+	free(nodes);
+	destroyMachine(machine);
+	destroyLineTable(lines);
+	destroyObjectModule(module);
+	return !success;
+}
+
+/*
+ * Executes the program an instruction at a time, following its calls to build the tree of call stacks
+ * Returns the amount of cycles executed
+ */
+long profileProgram(Machine *machine, LineTable *lines, CallNode **nodes, int *nodeCount, long limit){
+	Operation *operation;
+	int node, depth, capacity = 0;
+	long cycles = 0, steps;
+
+	node = enterCall(nodes, nodeCount, &capacity, -1, labelAt(lines, machine->operations[machine->pc].address));
+	for(steps = 0; steps < limit; steps++){
+		operation = &machine->operations[machine->pc];
+		depth = machine->stackDepth;
+		if(runMachine(machine, 1) != LIMIT_STATE && machine->state != HALTED_STATE)
+			break;
+		(*nodes)[node].cycles += operation->cycles;
+		cycles += operation->cycles;
+		if(machine->state == HALTED_STATE)
+			break;
+		if(machine->stackDepth > depth)
+			node = enterCall(nodes, nodeCount, &capacity, node, labelAt(lines, machine->operations[machine->pc].address));
+		else if(machine->stackDepth < depth && (*nodes)[node].parent >= 0)
+			node = (*nodes)[node].parent;
+	}
+	if(steps == limit)
+		machine->state = LIMIT_STATE;
+	return cycles;
+}
+
+/*
+ * Returns the index of the node of a call from the parent to the named subroutine, adding the node if it is new
+ */
+int enterCall(CallNode **nodes, int *nodeCount, int *capacity, int parent, char *name){
+	int child = (parent >= 0)? (*nodes)[parent].firstChild : -1;
+	for(; child >= 0 && strcmp((*nodes)[child].name, name) != 0; child = (*nodes)[child].nextSibling)
+		;
+	if(child >= 0)
+		return child;
+	if(*nodeCount == *capacity){
+		*capacity = (*capacity)? *capacity * 2 : INITIAL_CAPACITY;
+		*nodes = (CallNode*)realloc(*nodes, sizeof(CallNode) * (*capacity));
+	}
+	child = (*nodeCount)++;
+	(*nodes)[child].name = (char*)malloc(strlen(name) + 1);
+	strcpy((*nodes)[child].name, name);
+	(*nodes)[child].parent = parent;
+	(*nodes)[child].firstChild = -1;
+	(*nodes)[child].cycles = 0;
+	(*nodes)[child].nextSibling = (parent >= 0)? (*nodes)[parent].firstChild : -1;
+	if(parent >= 0)
+		(*nodes)[parent].firstChild = child;
+	return child;
+}
+
+/*
+ * Returns the label of the code holding the address - the last label defined at or before it
+ */
+char* labelAt(LineTable *lines, int address){
+	LineEntry *entry = findLineEntry(lines, address);
+	int i;
+	for(i = (entry)? (int)(entry - lines->entries) : -1; i >= 0; i--){
+		if(strcmp(lines->entries[i].label, NO_NAME) != 0)
+			return lines->entries[i].label;
+	}
+	return "(start)";
+}
+
+/*
+ * Writes the cycles of every source line, label and macro to "[name].prof"
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeProfile(char *name, Machine *machine, LineTable *lines, long cycles){
+	ProfileRow *lineRows = NULL, *labelRows = NULL, *macroRows = NULL;
+	int lineCount = 0, labelCount = 0, macroCount = 0, i;
+	char *url = constructUrl(name, "prof"), lineName[MAX_LINE_LENGTH * 2];
+	FILE *file = fopen(url, "w");
+	Operation *operation;
+	LineEntry *entry;
+	long operationCycles;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	for(i = 0; i < machine->operationCount; i++){
+		operation = &machine->operations[i];
+		if(!operation->executions || !(entry = findLineEntry(lines, operation->address)))
+			continue;
+		operationCycles = operation->executions * operation->cycles;
+		if(strcmp(entry->macro, NO_NAME) != 0){
+			sprintf(lineName, "line %d (%s)", entry->line, entry->macro);
+			addCycles(&macroRows, &macroCount, entry->macro, operationCycles, operation->executions, 0);
+		}
+		else
+			sprintf(lineName, "line %d", entry->line);
+		/* the code of a source line, as the code of a label, is contiguous */
+		addCycles(&lineRows, &lineCount, lineName, operationCycles, operation->executions, 1);
+		addCycles(&labelRows, &labelCount, labelAt(lines, operation->address), operationCycles, operation->executions, 1);
+	}
+	fprintf(file,"profile of %s: %ld instructions, %ld cycles\n",name,machine->steps,cycles);
+	writeRows(file, "line", lineRows, lineCount, cycles);
+	writeRows(file, "label", labelRows, labelCount, cycles);
+	writeRows(file, "macro", macroRows, macroCount, cycles);
+	fclose(file);
+	free(url);
+	free(lineRows);
+	free(labelRows);
+	free(macroRows);
+	return 1;
+}
+
+/*
+ * Adds cycles and executions to the row of the name, adding the row if it is new -
+ * if isContiguous is set the rows are added in order, so only the last row can be the row of the name
+ * Returns the index of the row
+ */
+int addCycles(ProfileRow **rows, int *count, char *name, long cycles, long executions, int isContiguous){
+	int i = (isContiguous && *count)? *count - 1 : 0;
+	for(; i < *count && strcmp((*rows)[i].name, name) != 0; i++)
+		;
+	if(i == *count){
+		if(!(*count & (*count - 1)))
+			*rows = (ProfileRow*)realloc(*rows, sizeof(ProfileRow) * (*count ? *count * 2 : 1));
+		strncpy((*rows)[i].name, name, MAX_LINE_LENGTH - 1);
+		(*rows)[i].name[MAX_LINE_LENGTH - 1] = '\0';
+		(*rows)[i].cycles = 0;
+		(*rows)[i].executions = 0;
+		(*count)++;
+	}
+	(*rows)[i].cycles += cycles;
+	(*rows)[i].executions += executions;
+	return i;
+}
+
+/*
+ * Writes the rows sorted by their cycles, along with their share of all cycles
+ */
+void writeRows(FILE *file, char *title, ProfileRow *rows, int count, long cycles){
+	int i;
+	if(count)
+		qsort(rows, count, sizeof(ProfileRow), compareRows);
+	fprintf(file,"\n%12s %7s %12s  %s\n","cycles","share","executions",title);
+	for(i = 0; i < count; i++)
+		fprintf(file,"%12ld %6.2f%% %12ld  %s\n",rows[i].cycles,(cycles)? 100.0 * rows[i].cycles / cycles : 0.0,
+				rows[i].executions,rows[i].name);
+}
+
+int compareRows(const void *first, const void *second){
+	long difference = ((ProfileRow*)second)->cycles - ((ProfileRow*)first)->cycles;
+	return (difference > 0) - (difference < 0);
+}
+
+/*
+ * Writes a line per stack of calls that spent cycles to "[name].folded" - the labels from the start of the program
+ * separated by ';', followed by the cycles
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeFoldedStacks(char *name, CallNode *nodes, int nodeCount){
+	char *url = constructUrl(name, "folded");
+	FILE *file = fopen(url, "w");
+	int i;
+
+	if(!file){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		free(url);
+		return 0;
+	}
+	for(i = 0; i < nodeCount; i++){
+		if(!nodes[i].cycles)
+			continue;
+		writeStack(file, nodes, i);
+		fprintf(file," %ld\n",nodes[i].cycles);
+	}
+	fclose(file);
+	free(url);
+	return 1;
+}
+
+void writeStack(FILE *file, CallNode *nodes, int node){
+	if(nodes[node].parent >= 0){
+		writeStack(file, nodes, nodes[node].parent);
+		fputc(';', file);
+	}
+	fputs(nodes[node].name, file);
+}
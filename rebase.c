@@ -0,0 +1,102 @@
+/*
+ * rebase.c
+ * 		the rebase tool - moves an assembled program to another load address without assembling it again
+ *
+ * 		Usage: rebase --to N [-o name] [--memory N] [--word-width N] program
+ * 		The program is given by the name of its files (without extension) and must have been assembled with
+ * 		--reloc, whose "[program].rel" names the address the program is placed at and every relocatable word.
+ * 		Only those words are patched - every other word is moved as is - and the entries, extern uses and
+ * 		relocations move along, so the result can be linked or rebased again.
+ * 		The program is written to "[name].ob", ".ent", ".ext" and ".rel" (in place unless -o is given).
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "object.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+int rebaseModule(ObjectModule *module, int from, int to, int *relocations, int relocationCount);
+void moveSymbols(ObjectSymbol *symbols, int delta);
+
+int main(int argc, char **argv){
+	ObjectModule *module = NULL;
+	char *name = NULL, *outputName = NULL;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, to = -1, from = 0, relocationCount = -1, success = 1;
+	int *relocations = NULL;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "--to") == 0 || strcmp(argv[i], "-o") == 0){
+			if(i + 1 >= argc){
+				fprintf(stderr,"Error: option '%s' requires a value\n",argv[i]);
+				success = 0;
+			}
+			else if(strcmp(argv[i++], "-o") == 0)
+				outputName = argv[i];
+			else if(!customAtoi(argv[i], &to)){
+				fprintf(stderr,"Error: '%s' is not a valid load address\n",argv[i]);
+				success = 0;
+			}
+		}
+		else if(argv[i][0] == '-' || name){
+			fprintf(stderr,"Error: unexpected parameter '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			name = argv[i];
+	}
+	if(success && (!name || to < 0)){
+		fprintf(stderr,"Usage: rebase --to N [-o name] [--memory N] [--word-width N] program\n");
+		success = 0;
+	}
+
+	/* the program is read at the address it was placed at, and written at the new one */
+	success = success && (relocationCount = readRelocationFile(name, &from, &relocations)) >= 0;
+	success = success && setGeometry(geometry[0], from, geometry[2]);
+	success = success && (module = readObjectModule(name)) != NULL;
+	success = success && setGeometry(geometry[0], to, geometry[2]);
+	success = success && rebaseModule(module, from, to, relocations, relocationCount);
+	if(success){
+		outputName = (outputName)? outputName : name;
+		success = writeObjectFile(outputName, module) && writeSymbolFile(outputName, "ent", module->entries)
+				&& writeSymbolFile(outputName, "ext", module->externs)
+				&& writeRelocationFile(outputName, to, relocations, relocationCount);
+	}
+	destroyObjectModule(module);
+	free(relocations);
+	return !success;
+}
+
+/*
+ * Moves the program from one load address to another - patching the address of every relocatable word
+ * and moving its symbols and the relocations themselves
+ * Returns 1 if succeeded or 0 if the program doesn't fit or a relocation isn't a relocatable word (reporting it)
+ */
+int rebaseModule(ObjectModule *module, int from, int to, int *relocations, int relocationCount){
+	int i, offset, word;
+	if(to + module->codeLength + module->dataLength > getMemoryLength()){
+		fprintf(stderr,"Error: %s doesn't fit in the memory of %d words at address %d\n",module->name,getMemoryLength(),to);
+		return 0;
+	}
+	for(i = 0; i < relocationCount; i++){
+		offset = relocations[i] - from;
+		if(offset < 0 || offset >= module->codeLength || ((word = module->words[offset]) & ARE_MASK) != RELOCATABLE_ARE){
+			fprintf(stderr,"Error: relocation %d of %s isn't a relocatable word of the program\n",relocations[i],module->name);
+			return 0;
+		}
+		module->words[offset] = (((word >> ARE_BITS) + to - from) << ARE_BITS) | RELOCATABLE_ARE;
+		relocations[i] += to - from;
+	}
+	moveSymbols(module->entries, to - from);
+	moveSymbols(module->externs, to - from);
+	return 1;
+}
+
+void moveSymbols(ObjectSymbol *symbols, int delta){
+	for(; symbols; symbols = symbols->next)
+		symbols->address += delta;
+}
@@ -0,0 +1,329 @@
+/*
+ * rompack.c
+ * 		the ROM packer - places many assembled programs into a single image, sharing their identical constants
+ *
+ * 		Usage: rompack [-o name] [--size N] [--memory N] [--load-address N] [--word-width N] program...
+ * 		Each program is given by the name of its files (without extension) and must be complete - a program
+ * 		using externs is linked first (see link.c).
+ *
+ * 		The code of every program is laid out contiguously from the load address, followed by a pool holding
+ * 		the data of every program. The data of a program is split into blocks - a block starts at every address
+ * 		the code references and runs up to the next one. A block which no instruction stores into is read only,
+ * 		and is shared by every program holding the same words: identical blocks are placed once, and a block
+ * 		which is the tail of another is placed at the end of it. Every relocatable word is then moved to the
+ * 		new address of the code or block it references.
+ * 		The image is written to "[name].ob", along with the start of every program in "[name].ent" (under the
+ * 		name of the program), and the memory used by every program and by the whole image is reported.
+ * 		The image is as long as the programs need unless --size is given, in which case it is padded to the
+ * 		size (with 0 words) and packing fails if the programs don't fit in it.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "object.h"
+#include "instruction.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+#define DEFAULT_OUTPUT_NAME "rom"
+
+/* flags of a data word */
+#define BLOCK_START 1
+#define WRITTEN 2
+
+typedef struct DataBlock {
+	int program;		/* index of the program the block belongs to */
+	int start;			/* offset of the block in the data of the program */
+	int length;
+	int *words;
+	int isPrivate;		/* an instruction stores into the block */
+	int host;			/* index of the block holding the words of this one (itself if not shared) */
+	int address;		/* address of the block in the image */
+} DataBlock;
+
+int packPrograms(ObjectModule **modules, int moduleCount, char *outputName, int size);
+int findBlocks(ObjectModule *module, int program, DataBlock **blocks, int *blockCount, int *capacity);
+void shareBlocks(DataBlock *blocks, int blockCount);
+int compareReversed(const void *first, const void *second);
+int isTail(DataBlock *tail, DataBlock *block);
+int findBlock(DataBlock *blocks, int first, int last, int offset);
+char* programLabel(char *name);
+
+int main(int argc, char **argv){
+	ObjectModule **modules = (ObjectModule**)malloc(sizeof(ObjectModule*) * argc);
+	char **names = (char**)malloc(sizeof(char*) * argc);
+	char *outputName = DEFAULT_OUTPUT_NAME;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, moduleCount = 0, readCount = 0, size = -1, success = 1;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--size") == 0){
+			if(i + 1 >= argc){
+				fprintf(stderr,"Error: option '%s' requires a value\n",argv[i]);
+				success = 0;
+			}
+			else if(strcmp(argv[i++], "-o") == 0)
+				outputName = argv[i];
+			else if(!customAtoi(argv[i], &size)){
+				fprintf(stderr,"Error: '%s' is not a valid image size\n",argv[i]);
+				success = 0;
+			}
+		}
+		else if(argv[i][0] == '-'){
+			fprintf(stderr,"Error: unknown option '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			names[moduleCount++] = argv[i];
+	}
+	if(success && !moduleCount){
+		fprintf(stderr,"Usage: rompack [-o name] [--size N] [--memory N] [--load-address N] [--word-width N] program...\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+	if(success && size > getMemoryLength() - getLoadAddress()){
+		fprintf(stderr,"Error: requested size %d exceeds the %d words of memory from load address %d\n",
+				size, getMemoryLength() - getLoadAddress(), getLoadAddress());
+		success = 0;
+	}
+	for(; success && readCount < moduleCount; readCount++){
+		if((modules[readCount] = readObjectModule(names[readCount])) && modules[readCount]->externs){
+			fprintf(stderr,"Error: %s uses extern '%s' - link it before packing\n",names[readCount],
+					modules[readCount]->externs->name);
+			success = 0;
+		}
+		else
+			success = modules[readCount] != NULL;
+	}
+	success = success && packPrograms(modules, moduleCount, outputName, size);
+
+	for(i = 0; i < readCount; i++)
+		destroyObjectModule(modules[i]);
+	free(modules);
+	free(names);
+	return !success;
+}
+
+/*
+ * Lays out the programs, sharing their read only data, and writes the image to "[outputName].ob" and ".ent"
+ * Returns 1 if succeeded or 0 if encountered errors (reporting them)
+ */
+int packPrograms(ObjectModule **modules, int moduleCount, char *outputName, int size){
+	ObjectModule image;
+	ObjectSymbol *starts = NULL, *tail = NULL;
+	DataBlock *blocks = NULL, *block;
+	int *firstBlocks = (int*)malloc(sizeof(int) * (moduleCount + 1)), *codeBases = (int*)malloc(sizeof(int) * moduleCount);
+	int i, j, offset, word, blockCount = 0, capacity = 0, totalLength = 0, saved, success = 1;
+
+	memset(&image, 0, sizeof(image));
+	for(i = 0; success && i < moduleCount; i++){
+		firstBlocks[i] = blockCount;
+		codeBases[i] = getLoadAddress() + image.codeLength;
+		image.codeLength += modules[i]->codeLength;
+		totalLength += modules[i]->codeLength + modules[i]->dataLength;
+		success = findBlocks(modules[i], i, &blocks, &blockCount, &capacity);
+	}
+	firstBlocks[moduleCount] = blockCount;
+	if(!success){
+		free(blocks);
+		free(firstBlocks);
+		free(codeBases);
+		return 0;
+	}
+
+	/* blocks sharing a host are placed by it, so the pool holds every other block in the order of the programs */
+	shareBlocks(blocks, blockCount);
+	for(i = 0; i < blockCount; i++){
+		if(blocks[i].host == i){
+			blocks[i].address = getLoadAddress() + image.codeLength + image.dataLength;
+			image.dataLength += blocks[i].length;
+		}
+	}
+	for(i = 0; i < blockCount; i++)
+		blocks[i].address = blocks[blocks[i].host].address + blocks[blocks[i].host].length - blocks[i].length;
+	saved = totalLength - image.codeLength - image.dataLength;
+
+	if(size < 0)
+		size = image.codeLength + image.dataLength;
+	if(image.codeLength + image.dataLength > size || getLoadAddress() + size > getMemoryLength()){
+		fprintf(stderr,"Error: the image needs %d words but only %d are available\n", image.codeLength + image.dataLength,
+				(getLoadAddress() + size > getMemoryLength())? getMemoryLength() - getLoadAddress() : size);
+		free(blocks);
+		free(firstBlocks);
+		free(codeBases);
+		return 0;
+	}
+	image.words = (int*)calloc(size + 1, sizeof(int));
+	for(i = 0; i < moduleCount; i++){
+		for(j = 0; j < modules[i]->codeLength; j++){
+			word = modules[i]->words[j];
+			offset = (word >> ARE_BITS) - getLoadAddress();
+			if((word & ARE_MASK) == RELOCATABLE_ARE && offset < modules[i]->codeLength)
+				word = ((codeBases[i] + offset) << ARE_BITS) | RELOCATABLE_ARE;
+			else if((word & ARE_MASK) == RELOCATABLE_ARE){
+				/* every referenced data word starts a block, the offset keeps the word within it */
+				if((offset -= modules[i]->codeLength) >= modules[i]->dataLength){
+					fprintf(stderr,"Error: %s references %d, which is outside of the program\n",modules[i]->name,word >> ARE_BITS);
+					success = 0;
+					continue;
+				}
+				block = &blocks[findBlock(blocks, firstBlocks[i], firstBlocks[i + 1] - 1, offset)];
+				word = ((block->address + offset - block->start) << ARE_BITS) | RELOCATABLE_ARE;
+			}
+			image.words[codeBases[i] - getLoadAddress() + j] = word;
+		}
+	}
+	for(i = 0; i < blockCount; i++){
+		if(blocks[i].host == i)
+			memcpy(image.words + blocks[i].address - getLoadAddress(), blocks[i].words, sizeof(int) * blocks[i].length);
+	}
+	/* padding belongs to the data, so the image is loaded as a single program */
+	image.dataLength = size - image.codeLength;
+
+	for(i = 0; i < moduleCount; i++){
+		if(tail)
+			tail = tail->next = (ObjectSymbol*)malloc(sizeof(ObjectSymbol));
+		else
+			starts = tail = (ObjectSymbol*)malloc(sizeof(ObjectSymbol));
+		strncpy(tail->name, programLabel(modules[i]->name), MAX_LABEL_NAME_LENGTH - 1);
+		tail->name[MAX_LABEL_NAME_LENGTH - 1] = '\0';
+		tail->address = codeBases[i];
+		tail->next = NULL;
+
+		for(j = firstBlocks[i], offset = 0; j < firstBlocks[i + 1]; j++)
+			offset += (blocks[j].host != j)? blocks[j].length : 0;
+		printf("%s: %d code words, %d data words (%d shared), starts at %d\n",modules[i]->name,
+				modules[i]->codeLength, modules[i]->dataLength, offset, codeBases[i]);
+	}
+	printf("%s: %d of %d words used, %d words saved by sharing data\n",outputName,totalLength - saved,size,saved);
+	success = success && writeObjectFile(outputName, &image) && writeSymbolFile(outputName, "ent", starts);
+
+	destroyObjectSymbols(starts);
+	free(image.words);
+	free(blocks);
+	free(firstBlocks);
+	free(codeBases);
+	return success;
+}
+
+/*
+ * Splits the data of the program into blocks - starting at every data word referenced by the code -
+ * and appends them to the blocks, marking those an instruction stores into as private
+ * Returns 1 if succeeded or 0 if the code of the program can't be decoded (reporting it)
+ */
+int findBlocks(ObjectModule *module, int program, DataBlock **blocks, int *blockCount, int *capacity){
+	char *flags = (char*)calloc(module->dataLength + 1, sizeof(char));
+	Instruction instruction;
+	DecodedOperand *operand;
+	int i, offset, *data = module->words + module->codeLength;
+
+	flags[0] = BLOCK_START;
+	for(i = 0; i < module->codeLength; i++){
+		offset = (module->words[i] >> ARE_BITS) - getLoadAddress() - module->codeLength;
+		if((module->words[i] & ARE_MASK) == RELOCATABLE_ARE && offset >= 0 && offset < module->dataLength)
+			flags[offset] |= BLOCK_START;
+	}
+	for(i = 0; i < module->codeLength; i += instruction.length){
+		if(!decodeInstruction(module->words + i, module->codeLength - i, &instruction)){
+			fprintf(stderr,"Error: %s has no valid instruction at %d\n",module->name,getLoadAddress() + i);
+			free(flags);
+			return 0;
+		}
+		operand = &instruction.dst;
+		offset = operand->value - getLoadAddress() - module->codeLength + ((operand->mode == STRUCT_MODE)? operand->field - 1 : 0);
+		if(instruction.operandCount >= 1 && writesDestination(instruction.opCode)
+				&& (operand->mode == DIRECT_MODE || operand->mode == STRUCT_MODE) && offset >= 0 && offset < module->dataLength)
+			flags[offset] |= WRITTEN;
+	}
+
+	for(i = 0; i < module->dataLength; i++){
+		if(flags[i] & BLOCK_START){
+			if(*blockCount == *capacity){
+				*capacity = *capacity * 2 + 16;
+				*blocks = (DataBlock*)realloc(*blocks, sizeof(DataBlock) * (*capacity));
+			}
+			memset(&(*blocks)[*blockCount], 0, sizeof(DataBlock));
+			(*blocks)[*blockCount].program = program;
+			(*blocks)[*blockCount].start = i;
+			(*blocks)[*blockCount].words = data + i;
+			(*blocks)[*blockCount].host = *blockCount;
+			(*blockCount)++;
+		}
+		(*blocks)[*blockCount - 1].length++;
+		if(flags[i] & WRITTEN)
+			(*blocks)[*blockCount - 1].isPrivate = 1;
+	}
+	free(flags);
+	return 1;
+}
+
+/*
+ * Sets the host of every read only block which is the tail of another read only block (an identical block included)
+ * Sorted by their words read backwards, the blocks a block is the tail of directly follow it - so every block is
+ * hosted by the host of the next one, if it's the tail of it
+ */
+void shareBlocks(DataBlock *blocks, int blockCount){
+	DataBlock **sorted = (DataBlock**)malloc(sizeof(DataBlock*) * (blockCount + 1));
+	int i, count = 0;
+
+	for(i = 0; i < blockCount; i++){
+		if(!blocks[i].isPrivate)
+			sorted[count++] = &blocks[i];
+	}
+	qsort(sorted, count, sizeof(DataBlock*), compareReversed);
+	for(i = count - 2; i >= 0; i--){
+		if(isTail(sorted[i], sorted[i + 1]))
+			sorted[i]->host = sorted[i + 1]->host;
+	}
+	free(sorted);
+}
+
+/*
+ * Compares two blocks by their words read backwards - a block which is the tail of another comes first
+ */
+int compareReversed(const void *first, const void *second){
+	DataBlock *a = *(DataBlock**)first, *b = *(DataBlock**)second;
+	int i;
+	for(i = 1; i <= a->length && i <= b->length; i++){
+		if(a->words[a->length - i] != b->words[b->length - i])
+			return (a->words[a->length - i] < b->words[b->length - i])? -1 : 1;
+	}
+	if(a->length != b->length)
+		return a->length - b->length;
+	/* of identical blocks the one of the first program comes last, so it hosts the others */
+	return (a > b)? -1 : (a < b);
+}
+
+/*
+ * Returns 1 if the words of tail end the words of block, otherwise 0
+ */
+int isTail(DataBlock *tail, DataBlock *block){
+	return tail->length <= block->length
+			&& memcmp(tail->words, block->words + block->length - tail->length, sizeof(int) * tail->length) == 0;
+}
+
+/*
+ * Returns the index of the block (between first and last, sorted by their start) holding the data word at offset
+ */
+int findBlock(DataBlock *blocks, int first, int last, int offset){
+	int middle;
+	while(first < last){
+		middle = (first + last + 1) / 2;
+		if(blocks[middle].start <= offset)
+			first = middle;
+		else
+			last = middle - 1;
+	}
+	return first;
+}
+
+/*
+ * Returns the name a program is listed under - the name of its files without the directory
+ */
+char* programLabel(char *name){
+	char *slash = strrchr(name, '/');
+	return (slash)? slash + 1 : name;
+}
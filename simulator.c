@@ -0,0 +1,74 @@
+/*
+ * simulator.c
+ * 		the simulator - executes an assembled program (see machine.h)
+ *
+ * 		Usage: simulator [--max-steps N] [--stats] [--memory N] [--load-address N] [--word-width N] program
+ * 		The program is given by the name of its files (without extension) and starts at its first instruction.
+ * 		Externs it uses are stubbed, so a module can be executed without linking it.
+ * 		get reads from the standard input and prn prints to the standard output, the simulator exits
+ * 		successfully only if the program halts. --stats reports the amount of executed instructions and
+ * 		the rate of executing them.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include "machine.h"
+#include "object.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+int main(int argc, char **argv){
+	ObjectModule *module = NULL;
+	Machine *machine = NULL;
+	char *name = NULL, trap[MAX_TRAP_DESCRIPTION];
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, maxSteps = -1, stats = 0, success = 1;
+	clock_t start;
+	double seconds;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "--stats") == 0)
+			stats = 1;
+		else if(strcmp(argv[i], "--max-steps") == 0){
+			if(i + 1 >= argc || !customAtoi(argv[++i], &maxSteps) || maxSteps < 0){
+				fprintf(stderr,"Error: option '--max-steps' requires an amount of steps\n");
+				success = 0;
+			}
+		}
+		else if(argv[i][0] == '-' || name){
+			fprintf(stderr,"Error: unexpected parameter '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			name = argv[i];
+	}
+	if(success && !name){
+		fprintf(stderr,"Usage: simulator [--max-steps N] [--stats] [--memory N] [--load-address N] [--word-width N] program\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+	success = success && (module = readObjectModule(name)) != NULL;
+	success = success && (machine = createMachine(module)) != NULL;
+	if(success){
+		start = clock();
+		runMachine(machine, (maxSteps < 0)? LONG_MAX : maxSteps);
+		seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+		fflush(stdout);
+		if(machine->state == TRAPPED_STATE)
+			fprintf(stderr,"Error: %s %s\n",name,describeTrap(machine, trap));
+		else if(machine->state == LIMIT_STATE)
+			fprintf(stderr,"Error: %s didn't halt within %d steps\n",name,maxSteps);
+		if(stats)
+			fprintf(stderr,"%ld instructions in %.3f seconds (%.1f million per second)\n",machine->steps,seconds,
+					(seconds > 0)? machine->steps / seconds / 1e6 : 0.0);
+		success = machine->state == HALTED_STATE;
+	}
+	destroyMachine(machine);
+	destroyObjectModule(module);
+	return !success;
+}
@@ -0,0 +1,164 @@
+/*
+ * size.c
+ * 		module computes the code and data sizes of a program without encoding it or resolving its labels
+ * 		Word counts are derived from the statement type alone: the mnemonic and operand kinds of commands,
+ * 		and the amount of numbers and characters of data statements.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "size.h"
+#include "assembly.h"
+#include "command.h"
+#include "data.h"
+#include "utilities.h"
+#include "diagnostics.h"
+#include "constraints.h"
+#include "geometry.h"
+
+typedef struct SizedLabel {
+	char name[MAX_LABEL_NAME_LENGTH];
+	int segment;	/* enum symbolSegments */
+	int offset;		/* offset of the label within its segment */
+	int size;		/* words until the next label of the segment (or the segment's end) */
+	struct SizedLabel *next;
+} SizedLabel;
+
+int sizeExpanded (FILE *amFile, char *name);
+int countStatementWords (char *line, int lineType);
+void reportSizes (char *name, int ic, int dc, SizedLabel *labels);
+
+/*
+ * Expands "[filename].as" (or the given source stream) in memory and reports the IC, DC and total words
+ * of every variant, along with the size of the section following each label
+ * Returns 1 if succeeded or 0 if encountered errors or the program doesn't fit in the machine memory
+ */
+int sizeFile(char *filename, FILE *source, Options *options){
+	FILE *asFile = (source)? source : openSourceFile(filename), *expanded;
+	char *buffers[MAX_VARIANTS];
+	size_t lengths[MAX_VARIANTS];
+	char *variantName;
+	int i, success;
+
+	if(!asFile){
+		flushDiagnostics();
+		return 0;
+	}
+	resetDiagnostics();
+	success = expandToMemory(asFile, filename, options->variants, options->variantCount, buffers, lengths);
+	if(!source)
+		fclose(asFile);
+
+	for(i = 0; i < options->variantCount; i++){
+		if(success){
+			variantName = constructVariantName(filename, &options->variants[i]);
+			expanded = openExpandedBuffer(buffers[i], lengths[i]);
+			success = sizeExpanded(expanded, variantName) && success;
+			fclose(expanded);
+			free(variantName);
+		}
+		free(buffers[i]);
+	}
+	return success;
+}
+
+/*
+ * Goes over the expanded source counting words per statement and per label
+ * returns 0 if encountered an error otherwise returns 1
+ */
+int sizeExpanded (FILE *amFile, char *name){
+	int i, words, lineType, lineNumber = 0, ic = 0, dc = 0, success = 1;
+	char buffer[MAX_LINE_LENGTH];
+	char potentialLabel[MAX_LABEL_NAME_LENGTH];
+	char *running;
+	SizedLabel *labels = NULL, *tail = NULL, *label, *last[2] = {NULL, NULL};
+
+	resetDiagnostics();
+	while(!isErrorLimitReached() && fgets(buffer, MAX_LINE_LENGTH, amFile)){
+		lineNumber++;
+		strTrim(buffer);
+		if(*buffer == '\0' || *buffer == ';')
+			continue;
+
+		i = getLabel(buffer, potentialLabel);
+		running = buffer + i;
+		lineType = getStatementType(running);
+		if(lineType == entryStatement || lineType == externStatement)
+			continue;
+
+		words = countStatementWords(running, lineType);
+		if(words < 0){
+			reportError(lineNumber, UNKNOWN_SIZE_DIAGNOSTIC, "couldn't determine the size of '%s'",running);
+			success = 0;
+			continue;
+		}
+
+		if(i){
+			label = (SizedLabel*)malloc(sizeof(SizedLabel));
+			strcpy(label->name, potentialLabel);
+			label->segment = (lineType == commandStatement || lineType == emptyStatement)? COMMAND_SEGMENT : DATA_SEGMENT;
+			label->offset = (label->segment == COMMAND_SEGMENT)? ic : dc;
+			label->size = 0;
+			label->next = NULL;
+			/* the previous label of the segment ends where this one begins */
+			if(last[label->segment])
+				last[label->segment]->size = label->offset - last[label->segment]->offset;
+			last[label->segment] = label;
+			if(tail)
+				tail->next = label;
+			else
+				labels = label;
+			tail = label;
+		}
+		if(lineType == commandStatement)
+			ic += words;
+		else
+			dc += words;
+	}
+	if(last[COMMAND_SEGMENT])
+		last[COMMAND_SEGMENT]->size = ic - last[COMMAND_SEGMENT]->offset;
+	if(last[DATA_SEGMENT])
+		last[DATA_SEGMENT]->size = dc - last[DATA_SEGMENT]->offset;
+
+	/* the sizes are printed directly, so the warnings reported so far are written before them */
+	flushDiagnostics();
+	if(success){
+		reportSizes(name, ic, dc, labels);
+		if(getLoadAddress() + ic + dc > getMemoryLength()){
+			reportSummary("Error: %s needs %d words but only %d are available",name,ic+dc,getMemoryLength()-getLoadAddress());
+			flushDiagnostics();
+			success = 0;
+		}
+	}
+	while(labels){
+		label = labels->next;
+		free(labels);
+		labels = label;
+	}
+	return success;
+}
+
+/*
+ * Returns the amount of words the statement (without a label declaration) occupies, or -1 if it can't be determined
+ */
+int countStatementWords (char *line, int lineType){
+	switch(lineType){
+		case commandStatement: return countCommandWords(line);
+		case dataStatement: return countDataWords(line + DATA_LENGTH);
+		case stringStatement: return countStringWords(line + STRING_LENGTH);
+		case structStatement: return countStructWords(line + STRUCT_LENGTH);
+	}
+	return 0;
+}
+
+/*
+ * Prints the sizes of the program followed by a line per label: name, segment, address and size in words
+ */
+void reportSizes (char *name, int ic, int dc, SizedLabel *labels){
+	printf("%s: IC %d DC %d total %d words (%d of %d free)\n", name, ic, dc, ic+dc,
+			getMemoryLength() - getLoadAddress() - (ic+dc), getMemoryLength() - getLoadAddress());
+	for(; labels; labels = labels->next){
+		printf("\t%s\t%s\t%d\t%d\n", labels->name, (labels->segment == COMMAND_SEGMENT)? "code":"data",
+				getLoadAddress() + labels->offset + ((labels->segment == DATA_SEGMENT)? ic:0), labels->size);
+	}
+}
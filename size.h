@@ -0,0 +1,17 @@
+/*
+ * size.h
+ * 		module computes the code and data sizes of a program without encoding it or resolving its labels
+ */
+#ifndef SIZE_H
+#define SIZE_H
+#include <stdio.h>
+#include "options.h"
+
+/*
+ * Expands "[filename].as" (or the given source stream) in memory and reports the IC, DC and total words
+ * of every variant, along with the size of the section following each label
+ * Returns 1 if succeeded or 0 if encountered errors or the program doesn't fit in the machine memory
+ */
+int sizeFile(char *filename, FILE *source, Options *options);
+
+#endif
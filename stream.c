@@ -0,0 +1,75 @@
+/*
+ * stream.c
+ * 		module keeps the expanded source of every variant as a single stream of lines, each tagged with the
+ * 		variants it belongs to - a line the variants have in common is kept (and decoded) once, and every variant
+ * 		lays the lines it holds out at its own addresses (see decodeStream in assembly.h)
+ *
+ * 		The preprocessor adds every expanded line once, tagged with the variants it was written for - a line
+ * 		expanded to different macros in different variants is added once per macro.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "stream.h"
+
+#define INITIAL_STREAM_CAPACITY 256
+
+void addStreamLine(SourceStream *stream, char *text, int length, unsigned long variantMask);
+
+/*
+ * Returns a new empty stream
+ */
+SourceStream* createSourceStream(void){
+	SourceStream *stream = (SourceStream*)calloc(1, sizeof(SourceStream));
+	stream->templates = createTemplateCache();
+	return stream;
+}
+
+/*
+ * Adds the lines of text to the stream as lines of the variants in variantMask - split where fgets reading the
+ * expanded file would split them (at a newline, or once a line fills MAX_LINE_LENGTH)
+ */
+void appendStreamText(SourceStream *stream, char *text, unsigned long variantMask){
+	int length;
+	while(*text){
+		for(length = 0; length < MAX_LINE_LENGTH - 1 && text[length] && text[length] != '\n'; length++)
+			;
+		if(text[length] == '\n' && length < MAX_LINE_LENGTH - 1)
+			length++;
+		addStreamLine(stream, text, length, variantMask);
+		text += length;
+	}
+}
+
+/*
+ * Adds a single line of the given length to the stream
+ */
+void addStreamLine(SourceStream *stream, char *text, int length, unsigned long variantMask){
+	StreamLine *line;
+	if(stream->count == stream->capacity){
+		stream->capacity = (stream->capacity)? stream->capacity * 2 : INITIAL_STREAM_CAPACITY;
+		stream->lines = (StreamLine*)realloc(stream->lines, sizeof(StreamLine) * stream->capacity);
+	}
+	line = &stream->lines[stream->count++];
+	memset(line, 0, sizeof(StreamLine));
+	line->text = (char*)malloc(length + 1);
+	memcpy(line->text, text, length);
+	line->text[length] = '\0';
+	line->variantMask = variantMask;
+}
+
+/*
+ * Frees space dynamically allocated to the stream, its lines and its templates
+ */
+void destroySourceStream(SourceStream *stream){
+	int i;
+	if(!stream)
+		return;
+	for(i = 0; i < stream->count; i++){
+		free(stream->lines[i].text);
+		free(stream->lines[i].data);
+	}
+	free(stream->lines);
+	destroyTemplateCache(stream->templates);
+	free(stream);
+}
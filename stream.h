@@ -0,0 +1,50 @@
+/*
+ * stream.h
+ * 		module keeps the expanded source of every variant as a single stream of lines, each tagged with the
+ * 		variants it belongs to - a line the variants have in common is kept (and decoded) once, and every variant
+ * 		lays the lines it holds out at its own addresses (see decodeStream in assembly.h)
+ */
+#ifndef STREAM_H
+#define STREAM_H
+#include "template.h"
+#include "constraints.h"
+
+#define BLANK_STATEMENT -1	/* the type of an empty or comment line */
+
+/* a line of the expanded source, lexed and validated once for all the variants holding it */
+typedef struct StreamLine {
+	char *text;						/* the line, trimmed once decoded */
+	unsigned long variantMask;		/* bit i is set if the line belongs to variant i */
+	int isDecoded;					/* the line has no errors - otherwise every variant handles it on its own */
+	int type;						/* enum statementType, or BLANK_STATEMENT */
+	int labelLength;				/* offset of the statement following the label, 0 if there is none */
+	char label[MAX_LABEL_NAME_LENGTH];
+	Template *template;				/* the words of a command */
+	int *data;						/* the values of a .data, .string or .struct statement */
+	int dataCount;
+} StreamLine;
+
+typedef struct SourceStream {
+	StreamLine *lines;
+	int count;
+	int capacity;
+	TemplateCache *templates;		/* the commands decoded for the lines */
+} SourceStream;
+
+/*
+ * Returns a new empty stream
+ */
+SourceStream* createSourceStream(void);
+
+/*
+ * Adds the lines of text to the stream as lines of the variants in variantMask - split where fgets reading the
+ * expanded file would split them (at a newline, or once a line fills MAX_LINE_LENGTH)
+ */
+void appendStreamText(SourceStream *stream, char *text, unsigned long variantMask);
+
+/*
+ * Frees space dynamically allocated to the stream, its lines and its templates
+ */
+void destroySourceStream(SourceStream *stream);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * template.c
+ * 		module keeps the commands already decoded during a first pass as relocatable word templates,
+ * 		so a command repeated by macro expansions is tokenized and validated only the first time it appears
+ *
+ * 		The words of a command don't depend on its address - only label words do, through the line number
+ * 		they report errors with - so a template is copied to the current ic and its label words are
+ * 		completed with the line number of the invocation.
+ * 		Commands with errors are never stored, so each of their occurrences is still reported.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "template.h"
+#include "utilities.h"
+#include "geometry.h"
+
+unsigned int hashLine(char *line);
+CompiledLine* constructWord(char *word, int isLabel, int address, int lineNumber);
+
+/*
+ * Returns a new empty template cache
+ */
+TemplateCache* createTemplateCache(void){
+	return (TemplateCache*)calloc(1, sizeof(TemplateCache));
+}
+
+/*
+ * Returns the template of the command in the line, or NULL if the command wasn't decoded before
+ */
+Template* findTemplate(TemplateCache *cache, char *line){
+	Template *template = cache->buckets[hashLine(line)];
+	while(template && strcmp(template->line, line) != 0)
+		template = template->next;
+	if(template)
+		cache->hits++;
+	else
+		cache->misses++;
+	return template;
+}
+
+/*
+ * Constructs the words of the command in the line from its template, as decodeCommandLine would, placed at ic
+ * label words are attributed to lineNumber, ic is advanced over the words
+ * Returns NULL if the command wasn't decoded before
+ */
+CompiledLine* instantiateTemplate(TemplateCache *cache, char *line, int *ic, int lineNumber){
+	Template *template = findTemplate(cache, line);
+	CompiledLine *head = NULL, *tail = NULL, *word;
+	int i;
+
+	if(!template)
+		return NULL;
+	for(i = 0; i < template->wordCount; i++){
+		word = constructWord(template->words[i], template->isLabel[i], (*ic)++, lineNumber);
+		if(tail)
+			tail->next = word;
+		else
+			head = word;
+		tail = word;
+	}
+	return head;
+}
+
+/*
+ * Stores the words decodeCommandLine constructed for the command in the line, the first of them placed at address
+ * Returns the stored template
+ */
+Template* storeTemplate(TemplateCache *cache, char *line, CompiledLine *decoded, int address){
+	Template *template = (Template*)malloc(sizeof(Template));
+	unsigned int bucket = hashLine(line);
+	CompiledLine *word;
+	char *separator;
+	int offset;
+
+	for(template->wordCount = 0, word = decoded; word; word = word->next)
+		template->wordCount++;
+	template->line = (char*)malloc(strlen(line) + 1);
+	strcpy(template->line, line);
+	template->words = (char**)malloc(sizeof(char*) * template->wordCount);
+	template->isLabel = (int*)malloc(sizeof(int) * template->wordCount);
+	/* the decoded list isn't ordered by address - the offset of each word places it in the template */
+	for(word = decoded; word; word = word->next){
+		offset = word->address - address;
+		separator = strchr(word->binaryStr, '|');
+		template->isLabel[offset] = separator != NULL;
+		template->words[offset] = (char*)malloc(strlen(word->binaryStr) + 1);
+		strcpy(template->words[offset], word->binaryStr);
+		if(separator)
+			template->words[offset][separator - word->binaryStr] = '\0';
+	}
+	template->next = cache->buckets[bucket];
+	cache->buckets[bucket] = template;
+	return template;
+}
+
+/*
+ * Writes the words of the template to the image at ic, as instantiateTemplate constructs them
+ * (words beyond the memory are dropped), advancing ic over them
+ */
+void writeTemplate(Template *template, Image *image, int *ic, int lineNumber){
+	int i;
+	for(i = 0; i < template->wordCount; i++, (*ic)++){
+		if(*ic >= getMemoryLength())
+			continue;
+		if(template->isLabel[i])
+			sprintf(getImageWord(image, *ic), "%s|%d", template->words[i], lineNumber);
+		else
+			strcpy(getImageWord(image, *ic), template->words[i]);
+	}
+}
+
+/*
+ * Frees space dynamically allocated to the cache and its templates
+ */
+void destroyTemplateCache(TemplateCache *cache){
+	Template *template, *next;
+	int i, j;
+	if(!cache)
+		return;
+	for(i = 0; i < TEMPLATE_BUCKETS; i++){
+		for(template = cache->buckets[i]; template; template = next){
+			next = template->next;
+			for(j = 0; j < template->wordCount; j++)
+				free(template->words[j]);
+			free(template->words);
+			free(template->isLabel);
+			free(template->line);
+			free(template);
+		}
+	}
+	free(cache);
+}
+
+/*
+ * Returns the bucket of a command line (djb2 string hash)
+ */
+unsigned int hashLine(char *line){
+	unsigned long hash = 5381;
+	while(*line)
+		hash = hash * 33 + (unsigned char)*line++;
+	return hash % TEMPLATE_BUCKETS;
+}
+
+/*
+ * Constructs a single word of an instantiated template
+ * a label word is completed with the line number (used in the second pass for printing errors)
+ */
+CompiledLine* constructWord(char *word, int isLabel, int address, int lineNumber){
+	CompiledLine *comp = (CompiledLine*)malloc(sizeof(CompiledLine));
+	char *lineNumberString = NULL;
+
+	if(isLabel){
+		lineNumberString = customItoa(lineNumber);
+		comp->binaryStr = (char*)malloc(strlen(word) + strlen(lineNumberString) + 2);
+		strcpy(comp->binaryStr, word);
+		strcat(comp->binaryStr, "|");
+		strcat(comp->binaryStr, lineNumberString);
+		free(lineNumberString);
+	}
+	else{
+		comp->binaryStr = (char*)malloc(strlen(word) + 1);
+		strcpy(comp->binaryStr, word);
+	}
+	comp->address = address;
+	comp->next = NULL;
+	return comp;
+}
@@ -0,0 +1,61 @@
+/*
+ * template.h
+ * 		module keeps the commands already decoded during a first pass as relocatable word templates,
+ * 		so a command repeated by macro expansions is tokenized and validated only the first time it appears
+ */
+#ifndef TEMPLATE_H
+#define TEMPLATE_H
+#include "command.h"
+#include "image.h"
+
+#define TEMPLATE_BUCKETS 256
+
+typedef struct Template {
+	char *line;				/* the command text the template was decoded from */
+	char **words;			/* encoded words, or the label name of words resolved in the second pass */
+	int *isLabel;			/* marks the words holding a label name */
+	int wordCount;
+	struct Template *next;	/* next template in the same bucket */
+} Template;
+
+typedef struct TemplateCache {
+	Template *buckets[TEMPLATE_BUCKETS];
+	int hits;				/* commands constructed from a template - counted with --timings (see timings.h) */
+	int misses;				/* commands decoded since no template held them */
+} TemplateCache;
+
+/*
+ * Returns a new empty template cache
+ */
+TemplateCache* createTemplateCache(void);
+
+/*
+ * Returns the template of the command in the line, or NULL if the command wasn't decoded before
+ */
+Template* findTemplate(TemplateCache *cache, char *line);
+
+/*
+ * Constructs the words of the command in the line from its template, as decodeCommandLine would, placed at ic
+ * label words are attributed to lineNumber, ic is advanced over the words
+ * Returns NULL if the command wasn't decoded before
+ */
+CompiledLine* instantiateTemplate(TemplateCache *cache, char *line, int *ic, int lineNumber);
+
+/*
+ * Stores the words decodeCommandLine constructed for the command in the line, the first of them placed at address
+ * Returns the stored template
+ */
+Template* storeTemplate(TemplateCache *cache, char *line, CompiledLine *decoded, int address);
+
+/*
+ * Writes the words of the template to the image at ic, as instantiateTemplate constructs them
+ * (words beyond the memory are dropped), advancing ic over them
+ */
+void writeTemplate(Template *template, Image *image, int *ic, int lineNumber);
+
+/*
+ * Frees space dynamically allocated to the cache and its templates
+ */
+void destroyTemplateCache(TemplateCache *cache);
+
+#endif
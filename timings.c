@@ -0,0 +1,114 @@
+/*
+ * timings.c
+ * 		module measures the phases of the assembler (with --timings) - the time every phase took over all the
+ * 		files of a run along with the lines and bytes it read, to tell the throughput of each phase, and how
+ * 		many commands of the first pass were constructed from templates (see template.h)
+ */
+#include <stdio.h>
+#include "timings.h"
+#include "diagnostics.h"
+
+static char *phaseNames[NUM_OF_PHASES] = { "preprocessor", "firstPass", "secondPass" };
+
+static int timingsEnabled = 0;
+static clock_t phaseTicks[NUM_OF_PHASES];
+static long phaseLines[NUM_OF_PHASES];
+static long phaseBytes[NUM_OF_PHASES];
+static int phaseRuns[NUM_OF_PHASES];
+static long templateHits = 0;
+static long templateMisses = 0;
+
+/* private functions declaration */
+
+void countFile(char *url, long *lines, long *bytes);
+double phaseRate(double amount, int phase);
+
+/*
+ * Starts measuring the phases (until then startPhase and endPhase do nothing)
+ */
+void enableTimings(void){
+	timingsEnabled = 1;
+}
+
+/*
+ * Returns the time a phase starts at, to be given to endPhase
+ */
+clock_t startPhase(void){
+	return (timingsEnabled)? clock() : 0;
+}
+
+/*
+ * Adds the time since start to the phase, along with the lines and bytes of the file it read (none if url is NULL)
+ */
+void endPhase(int phase, clock_t start, char *url){
+	if(!timingsEnabled)
+		return;
+	/* the file is counted once the clock stopped, so reading it again isn't part of the phase */
+	phaseTicks[phase] += clock() - start;
+	phaseRuns[phase]++;
+	if(url)
+		countFile(url, &phaseLines[phase], &phaseBytes[phase]);
+}
+
+/*
+ * Adds the commands the first pass of a file constructed from templates (hits) and decoded itself (misses)
+ */
+void countTemplates(int hits, int misses){
+	if(!timingsEnabled)
+		return;
+	templateHits += hits;
+	templateMisses += misses;
+}
+
+/*
+ * Reports the throughput of every phase as progress (see diagnostics.h) and writes it as a JSON object to the file
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeTimings(char *url){
+	FILE *file;
+	int i;
+
+	for(i = 0; i < NUM_OF_PHASES; i++)
+		reportProgress("Timings: %-12s %6d runs %10ld lines %12ld bytes %9.3f s %12.0f lines/s %9.2f MB/s",
+				phaseNames[i], phaseRuns[i], phaseLines[i], phaseBytes[i], (double)phaseTicks[i] / CLOCKS_PER_SEC,
+				phaseRate(phaseLines[i], i), phaseRate(phaseBytes[i] / 1e6, i));
+	reportProgress("Timings: %-12s %10ld hits %10ld misses %8.1f%% of the commands", "templates", templateHits, templateMisses,
+			(templateHits + templateMisses)? 100.0 * templateHits / (templateHits + templateMisses) : 0.0);
+	if(!(file = fopen(url, "w"))){
+		fprintf(stderr,"Error: couldn't create file %s\n",url);
+		return 0;
+	}
+	fprintf(file, "{");
+	for(i = 0; i < NUM_OF_PHASES; i++)
+		fprintf(file, "%s\"%s\": {\"runs\": %d, \"lines\": %ld, \"bytes\": %ld, \"seconds\": %.6f, \"linesPerSecond\": %.0f, \"megabytesPerSecond\": %.3f}",
+				(i)? ", " : "", phaseNames[i], phaseRuns[i], phaseLines[i], phaseBytes[i],
+				(double)phaseTicks[i] / CLOCKS_PER_SEC, phaseRate(phaseLines[i], i), phaseRate(phaseBytes[i] / 1e6, i));
+	fprintf(file, ", \"templates\": {\"hits\": %ld, \"misses\": %ld}}\n", templateHits, templateMisses);
+	fclose(file);
+	return 1;
+}
+
+/*
+ * Adds the amount of lines and bytes in the file to lines and bytes
+ */
+void countFile(char *url, long *lines, long *bytes){
+	char buffer[BUFSIZ];
+	size_t length, i;
+	FILE *file = fopen(url, "r");
+
+	if(!file)
+		return;
+	while((length = fread(buffer, 1, sizeof(buffer), file)) > 0){
+		*bytes += length;
+		for(i = 0; i < length; i++)
+			*lines += buffer[i] == '\n';
+	}
+	fclose(file);
+}
+
+/*
+ * Returns the amount the phase handled every second (0 if it took no measurable time)
+ */
+double phaseRate(double amount, int phase){
+	return (phaseTicks[phase])? amount / ((double)phaseTicks[phase] / CLOCKS_PER_SEC) : 0.0;
+}
@@ -0,0 +1,39 @@
+/*
+ * timings.h
+ * 		module measures the phases of the assembler (with --timings) - the time every phase took over all the
+ * 		files of a run along with the lines and bytes it read, to tell the throughput of each phase, and how
+ * 		many commands of the first pass were constructed from templates (see template.h)
+ */
+#ifndef TIMINGS_H
+#define TIMINGS_H
+#include <time.h>
+
+enum phases { PREPROCESSOR_PHASE, FIRST_PASS_PHASE, SECOND_PASS_PHASE, NUM_OF_PHASES };
+
+/*
+ * Starts measuring the phases (until then startPhase and endPhase do nothing)
+ */
+void enableTimings(void);
+
+/*
+ * Returns the time a phase starts at, to be given to endPhase
+ */
+clock_t startPhase(void);
+
+/*
+ * Adds the time since start to the phase, along with the lines and bytes of the file it read (none if url is NULL)
+ */
+void endPhase(int phase, clock_t start, char *url);
+
+/*
+ * Adds the commands the first pass of a file constructed from templates (hits) and decoded itself (misses)
+ */
+void countTemplates(int hits, int misses);
+
+/*
+ * Reports the throughput of every phase as progress (see diagnostics.h) and writes it as a JSON object to the file
+ * Returns 1 if succeeded or 0 if the file can't be written
+ */
+int writeTimings(char *url);
+
+#endif
@@ -0,0 +1,432 @@
+/*
+ * translation.c
+ * 		module translates assembled programs to C - the operations of the program loaded into a machine
+ * 		(see machine.h) are written as a function the system compiler turns into native code, either a program
+ * 		of its own (behaving like the simulator) or a shared object the harness runs instead of the machine
+ *
+ * 		The translation follows the operations the machine decoded, so it keeps the semantics of the machine:
+ * 		registers, the zero flag and the stub word become locals of the function, operands become the words of
+ * 		the memory at constant indexes or constants, every operation a jump or a return leads to is a C label
+ * 		and jumps are gotos. Returns go through a switch over the operations following a jsr, jumps
+ * 		through registers (when the program has any) through a switch over the addresses of every instruction.
+ * 		Every operation counts a step and the run stops at the limit, as the machine does.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "translation.h"
+#include "disassembly.h"
+#include "geometry.h"
+
+/* what the operations of the program need from the translation */
+typedef struct Translation {
+	Machine *machine;
+	Disassembly *disassembly;
+	char *labelled;			/* every operation (and the end of the code) a jump or a return leads to */
+	int *returnPoints;		/* the operation every jsr returns to, by the order of the jsr operations */
+	int returnCount;
+	int returnsWritten;
+	int jumpsThroughRegister;
+	int reachesNoInstruction;
+	int usesMemory;
+	int usesInput;
+	int usesOutput;
+	int returns;
+	int halts;
+} Translation;
+
+/* the definition of NativeRun (see translation.h) every translation holds */
+static char *nativeRunDefinition =
+		"typedef struct NativeRun {\n"
+		"\tint *memory;\n"
+		"\tint registers[%d];\n"
+		"\tint zero;\n"
+		"\tint stub;\n"
+		"\tint *input;\n"
+		"\tint inputCount;\n"
+		"\tint inputPosition;\n"
+		"\tint collectOutput;\n"
+		"\tint *printed;\n"
+		"\tint printedCount;\n"
+		"\tint printedCapacity;\n"
+		"\tlong limit;\n"
+		"\tlong steps;\n"
+		"\tint state;\n"
+		"\tint trap;\n"
+		"\tint address;\n"
+		"\tint target;\n"
+		"} NativeRun;\n\n";
+
+void scanOperations(Translation *translation);
+void writePrelude(ObjectModule *module, Translation *translation, FILE *file);
+void writeOperation(Translation *translation, int index, FILE *file);
+void writeJump(Translation *translation, int index, char *condition, FILE *file);
+void writeSwitches(Translation *translation, FILE *file);
+void writeMain(ObjectModule *module, FILE *file);
+char* formatOperandExpression(Translation *translation, Operation *operation, int *word, char *text);
+int isWrittenImmediate(Operation *operation);
+int isJumpOrLea(int opCode);
+void writeLabel(Translation *translation, int index, FILE *file);
+void writeCString(char *text, FILE *file);
+
+/*
+ * Writes the C translation of the module (loaded into the machine) to the file
+ */
+void writeTranslation(ObjectModule *module, Machine *machine, FILE *file){
+	Translation translation;
+	int i;
+
+	memset(&translation, 0, sizeof(Translation));
+	translation.machine = machine;
+	translation.disassembly = createDisassembly(module);
+	translation.labelled = (char*)calloc(machine->operationCount + 2, sizeof(char));
+	translation.returnPoints = (int*)malloc(sizeof(int) * (machine->operationCount + 1));
+	scanOperations(&translation);
+
+	writePrelude(module, &translation, file);
+	for(i = 0; i < machine->operationCount; i++)
+		writeOperation(&translation, i, file);
+	/* running past the code and jumping to no instruction are operations of the machine as well */
+	if(translation.labelled[machine->operationCount])
+		fprintf(file,"endOfCode:\n");
+	fprintf(file,"\tSTEP(%d);\n\tTRAP(%d, %d);\n",machine->operations[machine->operationCount].address,
+			machine->operations[machine->operationCount].address,END_OF_CODE_TRAP);
+	/* a jump through a register keeps its address in pc */
+	if(translation.reachesNoInstruction)
+		fprintf(file,"noInstruction:\n\tSTEP(pc);\n\tJUMP_TRAP(pc, target);\n");
+	writeSwitches(&translation, file);
+
+	if(translation.halts)
+		fprintf(file,"halted:\n\trun->state = %d;\n\tgoto stopped;\n",HALTED_STATE);
+	fprintf(file,"limited:\n\trun->state = %d;\n\tgoto stopped;\n",LIMIT_STATE);
+	fprintf(file,"trapped:\n\trun->state = %d;\n\trun->trap = trap;\n\trun->target = jumpTarget;\n",TRAPPED_STATE);
+	fprintf(file,"stopped:\n");
+	for(i = 0; i < NUM_OF_REGISTERS; i++)
+		fprintf(file,"\trun->registers[%d] = r%d;\n",i,i);
+	fprintf(file,"\trun->zero = zero;\n\trun->stub = stub;\n\trun->steps = steps;\n\trun->address = pc;\n\treturn run->state;\n}\n\n");
+	writeMain(module, file);
+
+	free(translation.labelled);
+	free(translation.returnPoints);
+	destroyDisassembly(translation.disassembly);
+}
+
+/*
+ * Finds the operations jumps and returns lead to and what else the operations of the program need
+ */
+void scanOperations(Translation *translation){
+	Machine *machine = translation->machine;
+	Operation *operation;
+	int i;
+
+	for(i = 0; i < machine->operationCount; i++){
+		operation = &machine->operations[i];
+		switch(operation->opCode){
+			case JMP_OP:
+			case BNE_OP:
+			case JSR_OP:
+				/* a jump to no instruction traps in place (see writeJump) */
+				if(operation->target <= machine->operationCount)
+					translation->labelled[operation->target] = 1;
+				break;
+			case JMP_REGISTER_OP:
+			case BNE_REGISTER_OP:
+			case JSR_REGISTER_OP:
+				translation->jumpsThroughRegister = 1;
+				break;
+			case GET_OP:
+				translation->usesInput = 1;
+				break;
+			case PRN_OP:
+				translation->usesOutput = 1;
+				break;
+			case RTS_OP:
+				translation->returns = 1;
+				break;
+			case HLT_OP:
+				translation->halts = 1;
+				break;
+		}
+		if(operation->opCode == JSR_OP || operation->opCode == JSR_REGISTER_OP)
+			translation->returnPoints[translation->returnCount++] = i + 1;
+		/* the operand of a jump or lea is an address, not a word the operation reads */
+		if(!isJumpOrLea(operation->opCode) && ((operation->src >= machine->memory && operation->src < machine->memory + getMemoryLength())
+				|| (operation->dst >= machine->memory && operation->dst < machine->memory + getMemoryLength())))
+			translation->usesMemory = 1;
+	}
+	for(i = 0; translation->returns && i < translation->returnCount; i++)
+		translation->labelled[translation->returnPoints[i]] = 1;
+	/* a register may hold the address of any instruction */
+	if(translation->jumpsThroughRegister){
+		memset(translation->labelled, 1, machine->operationCount);
+		translation->reachesNoInstruction = 1;
+	}
+}
+
+/*
+ * Writes what the function of the program needs - the settings of the machine, the macros of the operations,
+ * the definition of NativeRun and the immediate values the program stores into - and the start of the function
+ */
+void writePrelude(ObjectModule *module, Translation *translation, FILE *file){
+	Machine *machine = translation->machine;
+	int i;
+
+	fprintf(file,"/*\n * %s translated to C by the translator - %d code words, %d data words\n",module->name,module->codeLength,module->dataLength);
+	fprintf(file," * \t\tcompile it into a program behaving like the simulator:\tcc -O2 -o program program.c\n");
+	fprintf(file," * \t\tor into a shared object for the harness (--native):\tcc -O2 -shared -fPIC -DTRANSLATED_LIBRARY -o program.so program.c\n */\n");
+	fprintf(file,"#include <stdio.h>\n#include <stdlib.h>\n#include <string.h>\n#include <limits.h>\n\n");
+	fprintf(file,"#define MEMORY_LENGTH %d\n#define LOAD_ADDRESS %d\n#define PROGRAM_LENGTH %d\n",
+			getMemoryLength(),getLoadAddress(),module->codeLength + module->dataLength);
+	fprintf(file,"#define WORD_MASK %d\n#define SIGN_BIT %d\n#define STACK_DEPTH %d\n\n",
+			(1 << getWordWidth()) - 1,1 << (getWordWidth() - 1),STACK_DEPTH);
+	fprintf(file,"/* every operation counts a step, the run stops before the step beyond the limit */\n");
+	fprintf(file,"#define STEP(address) if(steps == limit){ pc = address; goto limited; } steps++\n");
+	fprintf(file,"#define TRAP(address, reason) { pc = address; trap = reason; goto trapped; }\n");
+	fprintf(file,"#define JUMP_TRAP(address, to) { pc = address; jumpTarget = to; trap = %d; goto trapped; }\n\n",NO_INSTRUCTION_TRAP);
+	fprintf(file,nativeRunDefinition,NUM_OF_REGISTERS);
+
+	for(i = 0; i < machine->operationCount; i++){
+		if(isWrittenImmediate(&machine->operations[i]))
+			fprintf(file,"static int immediate%d = %d;\n",machine->operations[i].address,machine->operations[i].dstImmediate);
+	}
+	if(translation->usesOutput){
+		fprintf(file,"\nstatic void print(NativeRun *run, int word){\n");
+		fprintf(file,"\tif(!run->collectOutput){\n\t\tprintf(\"%%d\\n\", (word & SIGN_BIT)? word - (SIGN_BIT << 1) : word);\n\t\treturn;\n\t}\n");
+		fprintf(file,"\tif(run->printedCount == run->printedCapacity){\n");
+		fprintf(file,"\t\trun->printedCapacity = (run->printedCapacity)? run->printedCapacity * 2 : 16;\n");
+		fprintf(file,"\t\trun->printed = (int*)realloc(run->printed, sizeof(int) * run->printedCapacity);\n\t}\n");
+		fprintf(file,"\trun->printed[run->printedCount++] = word;\n}\n");
+	}
+
+	fprintf(file,"\nint %s(NativeRun *run){\n",TRANSLATED_FUNCTION);
+	if(translation->usesMemory)
+		fprintf(file,"\tint *memory = run->memory;\n");
+	for(i = 0; i < NUM_OF_REGISTERS; i++)
+		fprintf(file,"%sr%d = run->registers[%d]%s",(i)? ", " : "\tint ",i,i,(i + 1 < NUM_OF_REGISTERS)? "" : ";\n");
+	fprintf(file,"\tint zero = run->zero, stub = run->stub, pc = 0, trap = 0, jumpTarget = -1;\n\tlong steps = run->steps, limit = run->limit;\n");
+	if(translation->returnCount && translation->returns)
+		fprintf(file,"\tint stack[STACK_DEPTH], depth = 0;\n");
+	else if(translation->returnCount)
+		fprintf(file,"\tint depth = 0;\n");
+	if(translation->jumpsThroughRegister)
+		fprintf(file,"\tint target;\n");
+	if(translation->usesInput)
+		fprintf(file,"\tint value;\n");
+	fprintf(file,"\n");
+}
+
+/*
+ * Writes the operation as C statements, preceded by its label (when something leads to it) and its assembly
+ */
+void writeOperation(Translation *translation, int index, FILE *file){
+	Machine *machine = translation->machine;
+	Operation *operation = &machine->operations[index];
+	int offset = operation->address - getLoadAddress(), address = operation->address;
+	char src[MAX_INSTRUCTION_TEXT], dst[MAX_INSTRUCTION_TEXT], text[MAX_INSTRUCTION_TEXT];
+
+	if(translation->labelled[index])
+		writeLabel(translation, index, file);
+	formatInstruction(translation->disassembly, address, text);
+	fprintf(file,"\t/* %d: %s%s%s */\n\tSTEP(%d);\n",address,translation->disassembly->labels[offset],
+			(translation->disassembly->labels[offset][0])? ": " : "",text,address);
+	formatOperandExpression(translation, operation, operation->src, src);
+	formatOperandExpression(translation, operation, operation->dst, dst);
+
+	switch(operation->opCode){
+		case MOV_OP: fprintf(file,"\t%s = %s;\n",dst,src);
+			break;
+		case CMP_OP: fprintf(file,"\tzero = %s == %s;\n",src,dst);
+			break;
+		case ADD_OP: fprintf(file,"\t%s = (%s + %s) & WORD_MASK;\n",dst,dst,src);
+			break;
+		case SUB_OP: fprintf(file,"\t%s = (%s - %s) & WORD_MASK;\n",dst,dst,src);
+			break;
+		case NOT_OP: fprintf(file,"\t%s = ~%s & WORD_MASK;\n",dst,dst);
+			break;
+		case CLR_OP: fprintf(file,"\t%s = 0;\n",dst);
+			break;
+		case LEA_OP: fprintf(file,"\tr0 = %d;\n",operation->target);
+			break;
+		case INC_OP: fprintf(file,"\t%s = (%s + 1) & WORD_MASK;\n",dst,dst);
+			break;
+		case DEC_OP: fprintf(file,"\t%s = (%s - 1) & WORD_MASK;\n",dst,dst);
+			break;
+		case JMP_OP: writeJump(translation, operation->target, NULL, file);
+			break;
+		case BNE_OP: writeJump(translation, operation->target, "!zero", file);
+			break;
+		case GET_OP:
+			fprintf(file,"\tif(run->input && run->inputPosition < run->inputCount)\n\t\tvalue = run->input[run->inputPosition++];\n");
+			fprintf(file,"\telse if(run->input || scanf(\"%%d\", &value) != 1)\n\t\tTRAP(%d, %d);\n",address,NO_INPUT_TRAP);
+			fprintf(file,"\t%s = value & WORD_MASK;\n",dst);
+			break;
+		case PRN_OP: fprintf(file,"\tprint(run, %s);\n",dst);
+			break;
+		case JSR_OP:
+		case JSR_REGISTER_OP:
+			fprintf(file,"\tif(depth == STACK_DEPTH)\n\t\tTRAP(%d, %d);\n",address,STACK_OVERFLOW_TRAP);
+			/* the stack holds the number of the return, not its address */
+			if(translation->returns)
+				fprintf(file,"\tstack[depth++] = %d;\n",translation->returnsWritten++);
+			else
+				fprintf(file,"\tdepth++;\n");
+			if(operation->opCode == JSR_OP)
+				writeJump(translation, operation->target, NULL, file);
+			else
+				fprintf(file,"\ttarget = %s;\n\tpc = %d;\n\tgoto dispatch;\n",dst,address);
+			break;
+		case RTS_OP:
+			if(translation->returnCount)
+				fprintf(file,"\tif(depth == 0)\n\t\tTRAP(%d, %d);\n\tgoto returnTo;\n",address,STACK_UNDERFLOW_TRAP);
+			else
+				fprintf(file,"\tTRAP(%d, %d);\n",address,STACK_UNDERFLOW_TRAP);
+			break;
+		case HLT_OP: fprintf(file,"\tpc = %d;\n\tgoto halted;\n",address + operation->length);
+			break;
+		case JMP_REGISTER_OP: fprintf(file,"\ttarget = %s;\n\tpc = %d;\n\tgoto dispatch;\n",dst,address);
+			break;
+		case BNE_REGISTER_OP: fprintf(file,"\tif(!zero){\n\t\ttarget = %s;\n\t\tpc = %d;\n\t\tgoto dispatch;\n\t}\n",dst,address);
+			break;
+		case STUB_CALL_OP:
+			break;
+		case TRAP_OP: fprintf(file,"\tTRAP(%d, %d);\n",address,operation->target);
+			break;
+	}
+}
+
+/*
+ * Writes a jump to the operation at the index - taken only if the condition (unless NULL) holds
+ * a jump to no instruction runs its trap in place, as the step of the trap the machine runs
+ */
+void writeJump(Translation *translation, int index, char *condition, FILE *file){
+	Operation *trap = &translation->machine->operations[index];
+	if(condition)
+		fprintf(file,"\tif(%s)\n\t",condition);
+	if(index > translation->machine->operationCount + 1)
+		fprintf(file,"\t{ STEP(%d); JUMP_TRAP(%d, %d); }\n",trap->address,trap->address,trap->jumpTarget);
+	else
+		fprintf(file,"\tgoto L%d;\n",translation->machine->operations[index].address);
+}
+
+/*
+ * Writes the switches returns and jumps through registers go through
+ */
+void writeSwitches(Translation *translation, FILE *file){
+	Machine *machine = translation->machine;
+	int i;
+
+	if(translation->returnCount && translation->returns){
+		fprintf(file,"returnTo:\n\tswitch(stack[--depth]){\n");
+		for(i = 0; i < translation->returnCount; i++){
+			if(i + 1 < translation->returnCount)
+				fprintf(file,"\t\tcase %d: ",i);
+			else
+				fprintf(file,"\t\tdefault: ");
+			if(translation->returnPoints[i] == machine->operationCount)
+				fprintf(file,"goto endOfCode;\n");
+			else
+				fprintf(file,"goto L%d;\n",machine->operations[translation->returnPoints[i]].address);
+		}
+		fprintf(file,"\t}\n");
+	}
+	if(translation->jumpsThroughRegister){
+		fprintf(file,"dispatch:\n\tswitch(target){\n");
+		for(i = 0; i < machine->operationCount; i++)
+			fprintf(file,"\t\tcase %d: goto L%d;\n",machine->operations[i].address,machine->operations[i].address);
+		fprintf(file,"\t\tdefault: goto noInstruction;\n\t}\n");
+	}
+}
+
+/*
+ * Writes the main function of the program (unless compiled as a shared object) - it loads the words of the program
+ * into the memory, runs it and reports how it stopped as the simulator does
+ */
+void writeMain(ObjectModule *module, FILE *file){
+	int i, length = module->codeLength + module->dataLength;
+
+	fprintf(file,"#ifndef TRANSLATED_LIBRARY\n");
+	fprintf(file,"static const int image[PROGRAM_LENGTH + 1] = {");
+	for(i = 0; i < length; i++)
+		fprintf(file,"%s%d,",(i % 16)? " " : "\n\t",module->words[i]);
+	fprintf(file," 0\n};\n\nstatic const char *traps[] = {");
+	for(i = 0; i < NUM_OF_TRAPS; i++){
+		fprintf(file,"\n\t");
+		writeCString(getTrapMessage(i), file);
+		fprintf(file,(i + 1 < NUM_OF_TRAPS)? "," : "\n};\n\n");
+	}
+	fprintf(file,"int main(int argc, char **argv){\n\tNativeRun run;\n\tmemset(&run, 0, sizeof(NativeRun));\n");
+	fprintf(file,"\trun.limit = LONG_MAX;\n");
+	fprintf(file,"\tif(argc == 3 && strcmp(argv[1], \"--max-steps\") == 0)\n\t\trun.limit = atol(argv[2]);\n");
+	fprintf(file,"\telse if(argc != 1){\n\t\tfprintf(stderr, \"Usage: %%s [--max-steps N]\\n\", argv[0]);\n\t\treturn 1;\n\t}\n");
+	fprintf(file,"\trun.memory = (int*)calloc(MEMORY_LENGTH, sizeof(int));\n");
+	fprintf(file,"\tmemcpy(run.memory + LOAD_ADDRESS, image, sizeof(int) * PROGRAM_LENGTH);\n");
+	fprintf(file,"\t%s(&run);\n\tfflush(stdout);\n",TRANSLATED_FUNCTION);
+	fprintf(file,"\tif(run.state == %d && run.trap == %d)\n",TRAPPED_STATE,NO_INSTRUCTION_TRAP);
+	fprintf(file,"\t\tfprintf(stderr, \"Error: %%s %%s (at %%d, jumping to %%d)\\n\", ");
+	writeCString(module->name, file);
+	fprintf(file,", traps[run.trap], run.address, run.target);\n");
+	fprintf(file,"\telse if(run.state == %d)\n\t\tfprintf(stderr, \"Error: %%s %%s (at %%d)\\n\", ",TRAPPED_STATE);
+	writeCString(module->name, file);
+	fprintf(file,", traps[run.trap], run.address);\n");
+	fprintf(file,"\telse if(run.state == %d)\n\t\tfprintf(stderr, \"Error: %%s didn't halt within %%ld steps\\n\", ",LIMIT_STATE);
+	writeCString(module->name, file);
+	fprintf(file,", run.limit);\n");
+	fprintf(file,"\tfree(run.memory);\n\treturn run.state != %d;\n}\n#endif\n",HALTED_STATE);
+}
+
+/*
+ * Writes to text the C expression of the word an operand of the operation reads and writes (empty if none)
+ * Returns text
+ */
+char* formatOperandExpression(Translation *translation, Operation *operation, int *word, char *text){
+	Machine *machine = translation->machine;
+	*text = '\0';
+	if(!word)
+		return text;
+	if(word >= machine->memory && word < machine->memory + getMemoryLength())
+		sprintf(text, "memory[%d]", (int)(word - machine->memory));
+	else if(word >= machine->registers && word < machine->registers + NUM_OF_REGISTERS)
+		sprintf(text, "r%d", (int)(word - machine->registers));
+	else if(word == &machine->stub)
+		strcpy(text, "stub");
+	else if(word == operation->dst && isWrittenImmediate(operation))
+		sprintf(text, "immediate%d", operation->address);
+	else
+		sprintf(text, "%d", *word);
+	return text;
+}
+
+/*
+ * Returns 1 if the operation stores into its immediate destination (which keeps the value between runs), otherwise 0
+ */
+int isWrittenImmediate(Operation *operation){
+	return operation->opCode < NUM_OF_OPCODES && operation->dst == &operation->dstImmediate && writesDestination(operation->opCode);
+}
+
+/*
+ * Returns 1 if the operation (an opcode or one of the operations of machine.h) uses the address of its operand
+ * rather than the word at it, otherwise 0
+ */
+int isJumpOrLea(int opCode){
+	return opCode == JMP_OP || opCode == BNE_OP || opCode == JSR_OP || opCode == LEA_OP || opCode == STUB_CALL_OP || opCode == TRAP_OP;
+}
+
+/*
+ * Writes the C label of the operation at the index
+ */
+void writeLabel(Translation *translation, int index, FILE *file){
+	fprintf(file,"L%d:\n",translation->machine->operations[index].address);
+}
+
+/*
+ * Writes the text as a quoted C string
+ */
+void writeCString(char *text, FILE *file){
+	fputc('"', file);
+	for(; *text; text++){
+		if(*text == '"' || *text == '\\')
+			fputc('\\', file);
+		fputc(*text, file);
+	}
+	fputc('"', file);
+}
@@ -0,0 +1,44 @@
+/*
+ * translation.h
+ * 		module translates assembled programs to C - the operations of the program loaded into a machine
+ * 		(see machine.h) are written as a function the system compiler turns into native code, either a program
+ * 		of its own (behaving like the simulator) or a shared object the harness runs instead of the machine
+ */
+#ifndef TRANSLATION_H
+#define TRANSLATION_H
+#include <stdio.h>
+#include "machine.h"
+#include "object.h"
+
+#define TRANSLATED_FUNCTION "runTranslated"	/* the function a translation exports */
+
+/* the state a translated program runs in - its definition is written into every translation as well */
+typedef struct NativeRun {
+	int *memory;			/* the memory of the machine, holding the program */
+	int registers[NUM_OF_REGISTERS];
+	int zero;
+	int stub;
+	int *input;				/* numbers get reads, NULL to read the standard input */
+	int inputCount;
+	int inputPosition;
+	int collectOutput;		/* collect the values prn prints instead of printing them */
+	int *printed;			/* the collected values (reallocated as they are added) */
+	int printedCount;
+	int printedCapacity;
+	long limit;				/* operations executed before the run stops */
+	long steps;
+	int state;				/* enum machineStates */
+	int trap;				/* enum traps */
+	int address;			/* address of the operation the run stopped at (the jump, for a jump to no instruction) */
+	int target;				/* the address a jump to no instruction led to */
+} NativeRun;
+
+/* a translated program - runs from the first instruction with an empty stack, returns the state it stopped in */
+typedef int (*TranslatedProgram)(NativeRun *run);
+
+/*
+ * Writes the C translation of the module (loaded into the machine) to the file
+ */
+void writeTranslation(ObjectModule *module, Machine *machine, FILE *file);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * translator.c
+ * 		the translator - translates an assembled program to C, to be compiled into native code (see translation.h)
+ *
+ * 		Usage: translator [-o file] [--memory N] [--load-address N] [--word-width N] program
+ * 		The program is given by the name of its files (without extension), its translation is written to the file
+ * 		(the standard output by default). Compiled on its own the translation behaves like the simulator running
+ * 		the program, compiled as a shared object (with -DTRANSLATED_LIBRARY) the harness runs it with --native.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "translation.h"
+#include "machine.h"
+#include "object.h"
+#include "geometry.h"
+#include "utilities.h"
+#include "constraints.h"
+
+int main(int argc, char **argv){
+	ObjectModule *module = NULL;
+	Machine *machine = NULL;
+	FILE *file = stdout;
+	char *name = NULL, *outputName = NULL;
+	int geometry[3] = {DEFAULT_MEMORY_LENGTH, DEFAULT_LOAD_ADDRESS, DEFAULT_WORD_WIDTH};
+	int i, handled, success = 1;
+
+	for(i = 1; success && i < argc; i++){
+		if((handled = parseGeometryOption(argc, argv, &i, geometry)) != 0)
+			success = handled > 0;
+		else if(strcmp(argv[i], "-o") == 0){
+			if(i + 1 < argc)
+				outputName = argv[++i];
+			else{
+				fprintf(stderr,"Error: option '-o' requires a file\n");
+				success = 0;
+			}
+		}
+		else if(argv[i][0] == '-' || name){
+			fprintf(stderr,"Error: unexpected parameter '%s'\n",argv[i]);
+			success = 0;
+		}
+		else
+			name = argv[i];
+	}
+	if(success && !name){
+		fprintf(stderr,"Usage: translator [-o file] [--memory N] [--load-address N] [--word-width N] program\n");
+		success = 0;
+	}
+	success = success && setGeometry(geometry[0], geometry[1], geometry[2]);
+	success = success && (module = readObjectModule(name)) != NULL;
+	success = success && (machine = createMachine(module)) != NULL;
+	if(success && outputName && !(file = fopen(outputName, "w"))){
+		fprintf(stderr,"Error: couldn't create file %s\n",outputName);
+		success = 0;
+	}
+	if(success){
+		writeTranslation(module, machine, file);
+		if(file != stdout)
+			fclose(file);
+	}
+	destroyMachine(machine);
+	destroyObjectModule(module);
+	return !success;
+}
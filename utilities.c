@@ -49,7 +49,7 @@ void strTrim(char *str){
  * Receives a filename and extension and returns a new string containing the two concatenated to a full filename
  */
 char* constructUrl(char* name, char* extension){
-	char* str = (char*)malloc(MAX_FILE_NAME_LENGTH*sizeof(char));
+	char* str = (char*)malloc((strlen(name) + strlen(extension) + 2)*sizeof(char));
 	strcpy(str,name);
 	strcat(str,".");
 	strcat(str,extension);
@@ -0,0 +1,377 @@
+/*
+ * watch.c
+ * 		module keeps the assembler running, assembling the command line files again whenever they change
+ *
+ * 		The directories holding the files are watched with inotify - editors often save by replacing the file,
+ * 		which a watch on the file itself would lose. Events arriving in a burst are collected until the
+ * 		directories stay quiet for WATCH_DEBOUNCE_MS, then the content hash of every touched file is compared
+ * 		with the hash from its last run, so a file saved without changes (or an output the assembler itself
+ * 		just wrote) is never assembled again. While nothing changes the process sleeps in poll().
+ * 		The libraries a file includes (the dependencies --deps lists) are watched along with it, their
+ * 		directories included, and a change to one of them assembles every file including it again.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "watch.h"
+#include "main.h"
+#include "cache.h"
+#include "hash.h"
+#include "library.h"
+#include "diagnostics.h"
+#include "utilities.h"
+#include "constraints.h"
+
+#define WATCH_DEBOUNCE_MS 100
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)
+#define EVENT_BUFFER_LENGTH 4096
+
+typedef struct Dependency {
+	char *name;				/* name of an included library, as the .include line names it */
+	char *baseName;			/* the name without its directory */
+	int directory;			/* index of the watched directory holding the library, -1 if it can't be watched */
+} Dependency;
+
+typedef struct WatchedFile {
+	char *name;				/* name given on the command line (without extension) */
+	char *baseName;			/* name without its directory */
+	int directory;			/* index of the watched directory holding the file */
+	char sourceHash[HASH_HEX_LENGTH];				/* content of "[name].as" when last assembled, empty if missing */
+	char outputHashes[MAX_VARIANTS][HASH_HEX_LENGTH];	/* content of every variant's ".am" after the last run */
+	char dependencyHash[HASH_HEX_LENGTH];			/* content of the included libraries after the last run */
+	Dependency *dependencies;
+	int dependencyCount;
+	int touched;			/* an event named the file since the last check */
+} WatchedFile;
+
+typedef struct WatchedDirectory {
+	char *path;
+	int descriptor;			/* inotify watch descriptor */
+} WatchedDirectory;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+int addDirectory(int inotifyFd, WatchedDirectory **directories, int *directoryCount, char *path);
+char* splitPath(char *name, char **baseName);
+void collectDependencies(WatchedFile *file, int inotifyFd, WatchedDirectory **directories, int *directoryCount);
+char* hashDependencies(WatchedFile *file, char *hex);
+void destroyDependencies(WatchedFile *file);
+int readEvents(int inotifyFd, WatchedDirectory *directories, int directoryCount, WatchedFile *files, int fileCount);
+void touchFiles(char *eventName, int directory, WatchedFile *files, int fileCount);
+int hasChanged(WatchedFile *file, Options *options, char *sourceHash);
+void runFile(WatchedFile *file, Options *options, char *sourceHash, int inotifyFd, WatchedDirectory **directories, int *directoryCount);
+void hashOutputs(WatchedFile *file, Options *options, char hashes[][HASH_HEX_LENGTH]);
+int hashWatchedFile(char *name, Variant *variant, char *extension, char *hex);
+void onWatchStopSignal(int sig);
+
+/*
+ * Assembles every command line file, then waits for changes to the source files (to the libraries they include,
+ * or to their expanded source outputs) and assembles again only the files whose content changed
+ * Returns when receiving SIGINT or SIGTERM
+ */
+int runWatch(Options *options){
+	WatchedFile *files;
+	WatchedDirectory *directories;
+	struct sigaction action;
+	struct pollfd descriptor;
+	char sourceHash[HASH_HEX_LENGTH];
+	int i, inotifyFd, directoryCount = 0, success = 1, ready;
+
+	inotifyFd = inotify_init();
+	if(inotifyFd < 0){
+		perror("Error: couldn't start watching files");
+		return 1;
+	}
+	files = (WatchedFile*)calloc(options->fileCount, sizeof(WatchedFile));
+	directories = NULL;
+	for(i = 0; success && i < options->fileCount; i++){
+		files[i].name = options->files[i];
+		files[i].directory = addDirectory(inotifyFd, &directories, &directoryCount, splitPath(files[i].name, &files[i].baseName));
+		success = files[i].directory >= 0;
+	}
+
+	/* handlers are installed without SA_RESTART so poll() returns once a stop is requested */
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onWatchStopSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	for(i = 0; success && i < options->fileCount; i++){
+		hashWatchedFile(files[i].name, NULL, ".as", sourceHash);
+		runFile(&files[i], options, sourceHash, inotifyFd, &directories, &directoryCount);
+	}
+	if(success){
+		finishCache(options);
+		reportProgress("Watching %d files for changes", options->fileCount);
+		flushDiagnostics();
+		fflush(stdout);
+	}
+
+	descriptor.fd = inotifyFd;
+	descriptor.events = POLLIN;
+	while(success && !stopRequested){
+		/* sleeps until the first event, then keeps collecting until a quiet period */
+		if(poll(&descriptor, 1, -1) <= 0)
+			continue;
+		ready = 1;
+		while(ready > 0 && !stopRequested){
+			success = readEvents(inotifyFd, directories, directoryCount, files, options->fileCount);
+			ready = (success)? poll(&descriptor, 1, WATCH_DEBOUNCE_MS) : 0;
+		}
+		for(i = 0; success && !stopRequested && i < options->fileCount; i++){
+			if(!files[i].touched)
+				continue;
+			files[i].touched = 0;
+			if(hasChanged(&files[i], options, sourceHash))
+				runFile(&files[i], options, sourceHash, inotifyFd, &directories, &directoryCount);
+		}
+		finishCache(options);
+	}
+
+	for(i = 0; i < directoryCount; i++)
+		free(directories[i].path);
+	for(i = 0; i < options->fileCount; i++)
+		destroyDependencies(&files[i]);
+	free(directories);
+	free(files);
+	close(inotifyFd);
+	closeLibraries();
+	return !success;
+}
+
+/*
+ * Watches the directory unless it is already watched
+ * Returns the index of the directory or -1 if it can't be watched
+ */
+int addDirectory(int inotifyFd, WatchedDirectory **directories, int *directoryCount, char *path){
+	int i, descriptor;
+	for(i = 0; i < *directoryCount; i++){
+		if(strcmp((*directories)[i].path, path) == 0){
+			free(path);
+			return i;
+		}
+	}
+	descriptor = inotify_add_watch(inotifyFd, path, WATCH_EVENTS);
+	if(descriptor < 0){
+		fprintf(stderr, "Error: couldn't watch directory '%s': %s\n", path, strerror(errno));
+		free(path);
+		return -1;
+	}
+	*directories = (WatchedDirectory*)realloc(*directories, sizeof(WatchedDirectory) * (*directoryCount + 1));
+	(*directories)[*directoryCount].path = path;
+	(*directories)[*directoryCount].descriptor = descriptor;
+	return (*directoryCount)++;
+}
+
+/*
+ * Stores the name without its directory in baseName
+ * Returns a new string with the directory of the name ("." if it has none)
+ */
+char* splitPath(char *name, char **baseName){
+	char *slash = strrchr(name, '/'), *path;
+	*baseName = (slash)? slash + 1 : name;
+	if(slash){
+		path = (char*)malloc(slash - name + 2);
+		strncpy(path, name, slash - name + 1);
+		path[slash - name + 1] = '\0';
+	}
+	else{
+		path = (char*)malloc(2);
+		strcpy(path, ".");
+	}
+	return path;
+}
+
+/*
+ * Finds the libraries the source of the file includes and watches their directories
+ */
+void collectDependencies(WatchedFile *file, int inotifyFd, WatchedDirectory **directories, int *directoryCount){
+	char line[MAX_LINE_LENGTH], name[MAX_LINE_LENGTH];
+	char *url = constructUrl(file->name, "as");
+	FILE *source = fopen(url, "r");
+	Dependency *dependency;
+	int lineStart = 1;
+
+	destroyDependencies(file);
+	while(source && fgets(line, MAX_LINE_LENGTH, source)){
+		/* the rest of a long line is never a directive */
+		if(lineStart && getIncludeName(line, name)){
+			file->dependencies = (Dependency*)realloc(file->dependencies, sizeof(Dependency) * (file->dependencyCount + 1));
+			dependency = &file->dependencies[file->dependencyCount++];
+			dependency->name = (char*)malloc(strlen(name) + 1);
+			strcpy(dependency->name, name);
+			/* a library whose directory can't be watched (reported) is still compared when the file is touched */
+			dependency->directory = addDirectory(inotifyFd, directories, directoryCount, splitPath(dependency->name, &dependency->baseName));
+		}
+		lineStart = strchr(line, '\n') != NULL;
+	}
+	if(source)
+		fclose(source);
+	free(url);
+}
+
+/*
+ * Stores the hash of the names and content of the file's libraries in hex
+ * (a library shipped only precompiled is identified by its precompiled file)
+ * Returns hex
+ */
+char* hashDependencies(WatchedFile *file, char *hex){
+	char libraryHash[HASH_HEX_LENGTH];
+	Hash hash;
+	int i;
+
+	hashInit(&hash);
+	for(i = 0; i < file->dependencyCount; i++){
+		if(!hashWatchedFile(file->dependencies[i].name, NULL, ".as", libraryHash))
+			hashWatchedFile(file->dependencies[i].name, NULL, ".aml", libraryHash);
+		hashUpdate(&hash, file->dependencies[i].name, strlen(file->dependencies[i].name) + 1);
+		hashUpdate(&hash, libraryHash, strlen(libraryHash) + 1);
+	}
+	hashFinal(&hash, hex);
+	return hex;
+}
+
+/*
+ * Frees the dependencies of the file
+ */
+void destroyDependencies(WatchedFile *file){
+	int i;
+	for(i = 0; i < file->dependencyCount; i++)
+		free(file->dependencies[i].name);
+	free(file->dependencies);
+	file->dependencies = NULL;
+	file->dependencyCount = 0;
+}
+
+/*
+ * Reads the pending events, marking the files they name as touched
+ * Returns 1 if succeeded or 0 if the events can't be read
+ */
+int readEvents(int inotifyFd, WatchedDirectory *directories, int directoryCount, WatchedFile *files, int fileCount){
+	/* aligned for the struct inotify_event records read into it */
+	long storage[EVENT_BUFFER_LENGTH / sizeof(long)];
+	char *buffer = (char*)storage, *running;
+	struct inotify_event *event;
+	ssize_t length;
+	int i;
+
+	length = read(inotifyFd, buffer, sizeof(storage));
+	if(length < 0)
+		return errno == EINTR;
+	for(running = buffer; running < buffer + length; running += sizeof(struct inotify_event) + event->len){
+		event = (struct inotify_event*)running;
+		if(!event->len)
+			continue;
+		for(i = 0; i < directoryCount; i++){
+			if(directories[i].descriptor == event->wd)
+				touchFiles(event->name, i, files, fileCount);
+		}
+	}
+	return 1;
+}
+
+/*
+ * Marks the files of the directory whose source (or an output) has the event's name,
+ * and the files including a library of the directory with the event's name
+ */
+void touchFiles(char *eventName, int directory, WatchedFile *files, int fileCount){
+	size_t length;
+	int i, j;
+	for(i = 0; i < fileCount; i++){
+		length = strlen(files[i].baseName);
+		/* "[name].as", "[name].am" and "[name].[variant].am" */
+		if(files[i].directory == directory && strncmp(eventName, files[i].baseName, length) == 0
+				&& eventName[length] == '.' && (strcmp(eventName + strlen(eventName) - 3, ".as") == 0
+				|| strcmp(eventName + strlen(eventName) - 3, ".am") == 0))
+			files[i].touched = 1;
+		/* "[library].as" and "[library].aml" */
+		for(j = 0; j < files[i].dependencyCount; j++){
+			length = strlen(files[i].dependencies[j].baseName);
+			if(files[i].dependencies[j].directory == directory && strncmp(eventName, files[i].dependencies[j].baseName, length) == 0
+					&& (strcmp(eventName + length, ".as") == 0 || strcmp(eventName + length, ".aml") == 0))
+				files[i].touched = 1;
+		}
+	}
+}
+
+/*
+ * Compares the current content of the file's source, included libraries and outputs with their content
+ * after its last run, storing the hash of the source in sourceHash
+ * returns 1 for true 0 for false
+ */
+int hasChanged(WatchedFile *file, Options *options, char *sourceHash){
+	char hashes[MAX_VARIANTS][HASH_HEX_LENGTH], dependencyHash[HASH_HEX_LENGTH];
+	int i;
+
+	hashWatchedFile(file->name, NULL, ".as", sourceHash);
+	if(strcmp(sourceHash, file->sourceHash) != 0)
+		return *sourceHash != '\0'; /* a source deleted (or in the middle of being replaced) waits for its new content */
+	if(strcmp(hashDependencies(file, dependencyHash), file->dependencyHash) != 0)
+		return 1;
+	hashOutputs(file, options, hashes);
+	for(i = 0; i < options->variantCount; i++){
+		if(strcmp(hashes[i], file->outputHashes[i]) != 0)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Assembles the file, remembering the content of its source, of the libraries it includes
+ * (watching their directories) and of the outputs the run left
+ */
+void runFile(WatchedFile *file, Options *options, char *sourceHash, int inotifyFd, WatchedDirectory **directories, int *directoryCount){
+	if(*sourceHash){
+		if(!options->sizeOnly && !options->checkOnly)
+			reportProgress("Begin operation on %s.as", file->name);
+		assembleFile(file->name, options);
+		if(!options->sizeOnly && !options->checkOnly)
+			reportProgress("-------------");
+		flushDiagnostics();
+		fflush(stdout);
+		fflush(stderr);
+	}
+	strcpy(file->sourceHash, sourceHash);
+	collectDependencies(file, inotifyFd, directories, directoryCount);
+	hashDependencies(file, file->dependencyHash);
+	hashOutputs(file, options, file->outputHashes);
+}
+
+/*
+ * Stores the hash of every variant's ".am" output in hashes (empty when it doesn't exist)
+ */
+void hashOutputs(WatchedFile *file, Options *options, char hashes[][HASH_HEX_LENGTH]){
+	int i;
+	for(i = 0; i < options->variantCount; i++)
+		hashWatchedFile(file->name, &options->variants[i], ".am", hashes[i]);
+}
+
+/*
+ * Stores the hash of "[name][.variant][extension]" in hex, or an empty string if the file doesn't exist
+ * Returns 1 if the file exists or 0 if not
+ */
+int hashWatchedFile(char *name, Variant *variant, char *extension, char *hex){
+	char *variantName = constructVariantName(name, variant);
+	char *fileName = (char*)malloc(strlen(variantName) + strlen(extension) + 1);
+	int exists;
+
+	strcpy(fileName, variantName);
+	strcat(fileName, extension);
+	exists = hashFile(fileName, hex);
+	if(!exists)
+		*hex = '\0';
+	free(fileName);
+	free(variantName);
+	return exists;
+}
+
+void onWatchStopSignal(int sig){
+	stopRequested = 1;
+}
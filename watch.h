@@ -0,0 +1,16 @@
+/*
+ * watch.h
+ * 		module keeps the assembler running, assembling the command line files again whenever they change
+ */
+#ifndef WATCH_H
+#define WATCH_H
+#include "options.h"
+
+/*
+ * Assembles every command line file, then waits for changes to the source files (to the libraries they include,
+ * or to their expanded source outputs) and assembles again only the files whose content changed
+ * Returns when receiving SIGINT or SIGTERM
+ */
+int runWatch(Options *options);
+
+#endif